@@ -47,6 +47,7 @@
 #include "dialog-lot-viewer.h"
 #include "gnc-component-manager.h"
 #include "gnc-prefs.h"
+#include "gnc-session.h"
 #include "gnc-ui-util.h"
 #include "gnc-window.h"
 #include "misc-gnome-utils.h"
@@ -755,20 +756,28 @@ lv_response_cb (GtkDialog *dialog, gint response, gpointer data)
     case RESPONSE_SCRUB_LOT:
         if (NULL == lot)
             return;
+        qof_session_begin_group_commit (gnc_get_current_session ());
         if (xaccAccountIsAPARType (xaccAccountGetType(lv->account)))
             gncScrubBusinessLot (lot);
         else
             xaccScrubLot (lot);
+        if (!qof_session_end_group_commit (gnc_get_current_session ()))
+            gnc_engine_signal_commit_error (
+                qof_session_pop_error (gnc_get_current_session ()));
         gnc_lot_viewer_fill (lv);
         lv_show_splits_in_lot (lv);
         break;
 
     case RESPONSE_SCRUB_ACCOUNT:
         gnc_suspend_gui_refresh ();
+        qof_session_begin_group_commit (gnc_get_current_session ());
         if (xaccAccountIsAPARType (xaccAccountGetType(lv->account)))
             gncScrubBusinessAccountLots (lv->account, gnc_window_show_progress);
         else
             xaccAccountScrubLots (lv->account);
+        if (!qof_session_end_group_commit (gnc_get_current_session ()))
+            gnc_engine_signal_commit_error (
+                qof_session_pop_error (gnc_get_current_session ()));
         gnc_resume_gui_refresh ();
         gnc_lot_viewer_fill (lv);
         lv_show_splits_free (lv);
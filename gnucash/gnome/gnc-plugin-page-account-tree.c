@@ -1768,6 +1768,7 @@ gnc_plugin_page_account_tree_cmd_scrub (GtkAction *action, GncPluginPageAccountT
     g_return_if_fail (account != NULL);
 
     gnc_suspend_gui_refresh ();
+    qof_session_begin_group_commit (gnc_get_current_session ());
 
     window = GNC_WINDOW(GNC_PLUGIN_PAGE (page)->window);
     gnc_window_set_progressbar_window (window);
@@ -1781,7 +1782,9 @@ gnc_plugin_page_account_tree_cmd_scrub (GtkAction *action, GncPluginPageAccountT
 
     gncScrubBusinessAccount(account, gnc_window_show_progress);
 
-
+    if (!qof_session_end_group_commit (gnc_get_current_session ()))
+        gnc_engine_signal_commit_error (
+            qof_session_pop_error (gnc_get_current_session ()));
     gnc_resume_gui_refresh ();
 }
 
@@ -1790,16 +1793,21 @@ gnc_plugin_page_account_tree_cmd_scrub_sub (GtkAction *action, GncPluginPageAcco
 {
     Account *account = gnc_plugin_page_account_tree_get_current_account (page);
     GncWindow *window;
+    GList *problems;
 
     g_return_if_fail (account != NULL);
 
     gnc_suspend_gui_refresh ();
+    qof_session_begin_group_commit (gnc_get_current_session ());
 
     window = GNC_WINDOW(GNC_PLUGIN_PAGE (page)->window);
     gnc_window_set_progressbar_window (window);
 
-    xaccAccountTreeScrubOrphans (account, gnc_window_show_progress);
-    xaccAccountTreeScrubImbalance (account, gnc_window_show_progress);
+    /* Check every transaction once, then fix only those with problems. */
+    problems = xaccAccountTreeCheckTransactions (account);
+    xaccScrubCheckedTransactions (problems, gnc_account_get_root (account),
+                                  gnc_window_show_progress);
+    g_list_free_full (problems, g_free);
 
     // XXX: Lots/capital gains scrubbing is disabled
     if (g_getenv("GNC_AUTO_SCRUB_LOTS") != NULL)
@@ -1807,6 +1815,9 @@ gnc_plugin_page_account_tree_cmd_scrub_sub (GtkAction *action, GncPluginPageAcco
 
     gncScrubBusinessAccountTree(account, gnc_window_show_progress);
 
+    if (!qof_session_end_group_commit (gnc_get_current_session ()))
+        gnc_engine_signal_commit_error (
+            qof_session_pop_error (gnc_get_current_session ()));
     gnc_resume_gui_refresh ();
 }
 
@@ -1815,20 +1826,28 @@ gnc_plugin_page_account_tree_cmd_scrub_all (GtkAction *action, GncPluginPageAcco
 {
     Account *root = gnc_get_current_root_account ();
     GncWindow *window;
+    GList *problems;
 
     gnc_suspend_gui_refresh ();
+    qof_session_begin_group_commit (gnc_get_current_session ());
 
     window = GNC_WINDOW(GNC_PLUGIN_PAGE (page)->window);
     gnc_window_set_progressbar_window (window);
 
-    xaccAccountTreeScrubOrphans (root, gnc_window_show_progress);
-    xaccAccountTreeScrubImbalance (root, gnc_window_show_progress);
+    /* Check every transaction once, then fix only those with problems. */
+    problems = xaccAccountTreeCheckTransactions (root);
+    xaccScrubCheckedTransactions (problems, gnc_account_get_root (root),
+                                  gnc_window_show_progress);
+    g_list_free_full (problems, g_free);
     // XXX: Lots/capital gains scrubbing is disabled
     if (g_getenv("GNC_AUTO_SCRUB_LOTS") != NULL)
         xaccAccountTreeScrubLots(root);
 
     gncScrubBusinessAccountTree(root, gnc_window_show_progress);
 
+    if (!qof_session_end_group_commit (gnc_get_current_session ()))
+        gnc_engine_signal_commit_error (
+            qof_session_pop_error (gnc_get_current_session ()));
     gnc_resume_gui_refresh ();
 }
 
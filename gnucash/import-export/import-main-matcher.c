@@ -43,6 +43,7 @@
 #include "gnc-ui.h"
 #include "gnc-ui-util.h"
 #include "gnc-engine.h"
+#include "gnc-session.h"
 #include "gnc-gtk-utils.h"
 #include "import-settings.h"
 #include "import-match-picker.h"
@@ -196,6 +197,7 @@ on_matcher_ok_clicked (GtkButton *button, GNCImportMainMatcher *info)
     /* Don't run any queries and/or split sorts while processing the matcher
     results. */
     gnc_suspend_gui_refresh();
+    qof_session_begin_group_commit (gnc_get_current_session ());
 
     do
     {
@@ -214,6 +216,9 @@ on_matcher_ok_clicked (GtkButton *button, GNCImportMainMatcher *info)
     }
     while (gtk_tree_model_iter_next (model, &iter));
 
+    if (!qof_session_end_group_commit (gnc_get_current_session ()))
+        gnc_engine_signal_commit_error (
+            qof_session_pop_error (gnc_get_current_session ()));
     gnc_gen_trans_list_delete (info);
 
     /* Allow GUI refresh again. */
@@ -46,6 +46,7 @@
 #include "gnc-event.h"
 #include "gnc-exp-parser.h"
 #include "gnc-glib-utils.h"
+#include "gnc-session.h"
 #include "gnc-sx-instance-model.h"
 #include "gnc-ui-util.h"
 #include "qof.h"
@@ -1356,6 +1357,9 @@ gnc_sx_instance_model_effect_change(GncSxInstanceModel *model,
         return;
     }
 
+    /* Write the created transactions and updated SXes together. */
+    qof_session_begin_group_commit (gnc_get_current_session ());
+
     for (iter = model->sx_instance_list; iter != NULL; iter = iter->next)
     {
         GList *instance_iter;
@@ -1445,6 +1449,10 @@ gnc_sx_instance_model_effect_change(GncSxInstanceModel *model,
         gnc_sx_set_instance_count(instances->sx, instance_count);
         xaccSchedXactionSetRemOccur(instances->sx, remain_occur_count);
     }
+
+    if (!qof_session_end_group_commit (gnc_get_current_session ()))
+        gnc_engine_signal_commit_error (
+            qof_session_pop_error (gnc_get_current_session ()));
 }
 
 void
@@ -880,7 +880,11 @@ GncDbiBackend<Type>::load (QofBook* book, QofBackendLoadType loadType)
         create_tables();
     }
 
+    /* Tables may be read on other threads during the load, and they
+     * don't set the process-wide locale themselves. */
+    auto locale = gnc_push_locale (LC_NUMERIC, "C");
     GncSqlBackend::load(book, loadType);
+    gnc_pop_locale (LC_NUMERIC, locale);
 
     if (Type == DbType::DBI_SQLITE)
         gnc_features_set_used(book, GNC_FEATURE_SQLITE3_ISO_DATES);
@@ -957,6 +961,10 @@ GncDbiBackend<Type>::safe_sync (QofBook* book)
     g_return_if_fail (book != nullptr);
 
     ENTER ("book=%p, primary=%p", book, m_book);
+    wait_for_writes();
+    /* The tables are rewritten from memory, so everything must be in it. */
+    if (lazy_loading())
+        GncSqlBackend::load (m_book, LOAD_TYPE_LOAD_ALL);
     if (!conn->begin_transaction())
     {
         LEAVE("Failed to obtain a transaction.");
@@ -1000,6 +1008,10 @@ GncDbiBackend<DbType::DBI_MYSQL>::safe_sync (QofBook* book)
     g_return_if_fail (book != nullptr);
 
     ENTER ("book=%p, primary=%p", book, m_book);
+    wait_for_writes();
+    /* The tables are rewritten from memory, so everything must be in it. */
+    if (lazy_loading())
+        GncSqlBackend::load (m_book, LOAD_TYPE_LOAD_ALL);
     if (!conn->table_operation (TableOpType::backup))
     {
         set_error(ERR_BACKEND_SERVER_ERR);
@@ -40,14 +40,16 @@ static QofLogModule log_module = G_LOG_DOMAIN;
 #include "gnc-dbiproviderimpl.hpp"
 
 static const unsigned int DBI_MAX_CONN_ATTEMPTS = 5;
+/* Rows fetched at a time by a streaming result. */
+static const unsigned int DBI_CURSOR_FETCH_ROWS = 5000;
 const std::string lock_table = "gnclock";
 
 /* --------------------------------------------------------- */
 class GncDbiSqlStatement : public GncSqlStatement
 {
 public:
-    GncDbiSqlStatement(const GncSqlConnection* conn, const std::string& sql) :
-        m_conn{conn}, m_sql {sql} {}
+    GncDbiSqlStatement(const GncSqlConnection* conn, std::string sql) :
+        m_conn{conn}, m_sql {std::move(sql)} {}
     ~GncDbiSqlStatement() {}
     const char* to_sql() const override;
     void add_where_cond(QofIdTypeConst, const PairVec&) override;
@@ -80,9 +82,144 @@ GncDbiSqlStatement::add_where_cond(QofIdTypeConst type_name,
     }
 }
 
+/* --------------------------------------------------------- */
+GncDbiSqlStatementTemplate::GncDbiSqlStatementTemplate(
+    const GncSqlConnection* conn, E_DB_OPERATION op, const std::string& table,
+    const PairVec& values) : m_conn{conn}, m_op{op}
+{
+    std::string sql;
+
+    m_columns.reserve(values.size());
+    for (auto const& col_value : values)
+        m_columns.push_back(col_value.first);
+
+    switch (op)
+    {
+    case OP_DB_INSERT:
+        sql = "INSERT INTO " + table + "(";
+        for (auto const& col : m_columns)
+        {
+            if (&col != &m_columns.front())
+                sql += ",";
+            sql += col;
+        }
+        m_head = sql + ") VALUES";
+        sql = "(";
+        for (size_t i = 0; i < m_columns.size(); ++i)
+        {
+            if (i)
+                sql += ",";
+            add_piece (sql, i, false);
+        }
+        sql += ")";
+        break;
+    case OP_DB_UPDATE:
+        sql = "UPDATE " + table + " SET ";
+        for (size_t i = 0; i < m_columns.size(); ++i)
+        {
+            if (i)
+                sql += ",";
+            sql += m_columns[i] + "=";
+            add_piece (sql, i, false);
+        }
+        sql += " WHERE " + m_columns[0];
+        add_piece (sql, 0, true);
+        break;
+    case OP_DB_DELETE:
+        sql = "DELETE FROM " + table + " WHERE " + m_columns[0];
+        add_piece (sql, 0, true);
+        break;
+    }
+    m_tail = std::move(sql);
+    m_row_text = m_tail.size();
+    for (auto const& piece : m_pieces)
+        m_row_text += piece.sql.size() + (piece.condition ? 4 : 0);
+}
+
+void
+GncDbiSqlStatementTemplate::add_piece (std::string& sql, size_t value,
+                                       bool condition)
+{
+    m_pieces.push_back({std::move(sql), value, condition});
+    sql.clear();
+}
+
+bool
+GncDbiSqlStatementTemplate::matches (E_DB_OPERATION op,
+                                     const PairVec& values) const noexcept
+{
+    if (op != m_op || values.size() != m_columns.size())
+        return false;
+    for (size_t i = 0; i < values.size(); ++i)
+        if (values[i].first != m_columns[i])
+            return false;
+    return true;
+}
+
+size_t
+GncDbiSqlStatementTemplate::row_size (const PairVec& values) const noexcept
+{
+    auto size = m_row_text;
+    for (auto const& piece : m_pieces)
+        size += values[piece.value].second.size();
+    return size;
+}
+
+void
+GncDbiSqlStatementTemplate::append_row (std::string& sql,
+                                        const PairVec& values) const noexcept
+{
+    for (auto const& piece : m_pieces)
+    {
+        auto const& value = values[piece.value].second;
+        sql += piece.sql;
+        if (piece.condition)
+            sql += value == "NULL" ? " IS " : " = ";
+        sql += value;
+    }
+    sql += m_tail;
+}
+
+GncSqlStatementPtr
+GncDbiSqlStatementTemplate::bind (const PairVec& values) const noexcept
+{
+    g_return_val_if_fail (matches (m_op, values), nullptr);
+
+    std::string sql;
+    sql.reserve(m_head.size() + row_size (values));
+    sql += m_head;
+    append_row (sql, values);
+    return GncSqlStatementPtr{new GncDbiSqlStatement (m_conn, std::move(sql))};
+}
+
+GncSqlStatementPtr
+GncDbiSqlStatementTemplate::bind (const std::vector<PairVec>& rows)
+    const noexcept
+{
+    g_return_val_if_fail (m_op == OP_DB_INSERT, nullptr);
+    g_return_val_if_fail (!rows.empty(), nullptr);
+
+    auto size = m_head.size();
+    for (auto const& values : rows)
+    {
+        g_return_val_if_fail (matches (m_op, values), nullptr);
+        size += row_size (values) + 1;
+    }
+    std::string sql;
+    sql.reserve(size);
+    sql += m_head;
+    for (auto const& values : rows)
+    {
+        if (&values != &rows.front())
+            sql += ",";
+        append_row (sql, values);
+    }
+    return GncSqlStatementPtr{new GncDbiSqlStatement (m_conn, std::move(sql))};
+}
+
 GncDbiSqlConnection::GncDbiSqlConnection (DbType type, QofBackend* qbe,
                                           dbi_conn conn, bool ignore_lock) :
-    m_qbe{qbe}, m_conn{conn},
+    m_type{type}, m_qbe{qbe}, m_conn{conn},
     m_provider{type == DbType::DBI_SQLITE ?
             make_dbi_provider<DbType::DBI_SQLITE>() :
             type == DbType::DBI_MYSQL ?
@@ -100,6 +237,52 @@ GncDbiSqlConnection::GncDbiSqlConnection (DbType type, QofBackend* qbe,
     }
 }
 
+GncDbiSqlConnection::GncDbiSqlConnection (DbType type, QofBackend* qbe,
+                                          dbi_conn conn) :
+    m_type{type}, m_reader{true}, m_qbe{qbe}, m_conn{conn},
+    m_provider{type == DbType::DBI_SQLITE ?
+            make_dbi_provider<DbType::DBI_SQLITE>() :
+            type == DbType::DBI_MYSQL ?
+            make_dbi_provider<DbType::DBI_MYSQL>() :
+            make_dbi_provider<DbType::DBI_PGSQL>()},
+    m_conn_ok{true}, m_last_error{ERR_BACKEND_NO_ERR}, m_error_repeat{0},
+    m_retry{false}, m_sql_savepoint{0}
+{
+}
+
+GncSqlConnection*
+GncDbiSqlConnection::open_reader () const noexcept
+{
+    auto conn = dbi_conn_open (dbi_conn_get_driver (m_conn));
+    if (conn == nullptr)
+        return nullptr;
+    /* Options are either strings or numbers. */
+    for (auto key = dbi_conn_get_option_list (m_conn, nullptr); key != nullptr;
+         key = dbi_conn_get_option_list (m_conn, key))
+    {
+        auto value = dbi_conn_get_option (m_conn, key);
+        auto result = value ? dbi_conn_set_option (conn, key, value) :
+            dbi_conn_set_option_numeric (conn, key,
+                                         dbi_conn_get_option_numeric (m_conn,
+                                                                      key));
+        if (result < 0)
+        {
+            PWARN ("Failed to set option %s for a reader connection", key);
+            dbi_conn_close (conn);
+            return nullptr;
+        }
+    }
+    if (dbi_conn_connect (conn) < 0)
+    {
+        const char* errstr;
+        dbi_conn_error (conn, &errstr);
+        PWARN ("Failed to open a reader connection: %s", errstr);
+        dbi_conn_close (conn);
+        return nullptr;
+    }
+    return new GncDbiSqlConnection (m_type, m_qbe, conn);
+}
+
 bool
 GncDbiSqlConnection::lock_database (bool ignore_lock)
 {
@@ -248,7 +431,8 @@ GncDbiSqlConnection::~GncDbiSqlConnection()
 {
     if (m_conn)
     {
-        unlock_database();
+        if (!m_reader)
+            unlock_database();
         dbi_conn_close(m_conn);
         m_conn = nullptr;
     }
@@ -261,6 +445,15 @@ GncDbiSqlConnection::execute_select_statement (const GncSqlStatementPtr& stmt)
     dbi_result result;
 
     DEBUG ("SQL: %s\n", stmt->to_sql());
+    /* The locale is process-wide, so on another thread it's up to the
+     * owner of the main connection to have set it. */
+    if (m_reader)
+    {
+        result = dbi_conn_query (m_conn, stmt->to_sql());
+        if (result == nullptr)
+            return nullptr;
+        return GncSqlResultPtr(new GncDbiSqlResult (this, result));
+    }
     auto locale = gnc_push_locale (LC_NUMERIC, "C");
     do
     {
@@ -280,6 +473,77 @@ GncDbiSqlConnection::execute_select_statement (const GncSqlStatementPtr& stmt)
     return GncSqlResultPtr(new GncDbiSqlResult (this, result));
 }
 
+/* libdbi's MySQL and SQLite3 drivers always read the whole result into
+ * memory, so only PostgreSQL, with a server-side cursor, can do better. The
+ * cursor is declared in a transaction, which close_cursor commits: a WITH
+ * HOLD cursor would have the server materialize the whole result at the
+ * first commit, which in autocommit mode is the declaration itself. */
+GncSqlResultPtr
+GncDbiSqlConnection::execute_streaming_select_statement (const GncSqlStatementPtr& stmt)
+    noexcept
+{
+    if (m_type != DbType::DBI_PGSQL || m_reader)
+        return execute_select_statement (stmt);
+    if (!begin_transaction ())
+        return execute_select_statement (stmt);
+
+    auto cursor = "gnc_cursor_" + std::to_string (++m_cursors);
+    auto sql = "DECLARE " + cursor + " NO SCROLL CURSOR FOR " +
+        stmt->to_sql();
+    dbi_result result;
+
+    DEBUG ("SQL: %s\n", sql.c_str());
+    do
+    {
+        init_error ();
+        result = dbi_conn_query (m_conn, sql.c_str());
+    }
+    while (m_retry);
+    /* Run it the usual way to report the error. */
+    if (result == nullptr)
+    {
+        rollback_transaction ();
+        return execute_select_statement (stmt);
+    }
+    dbi_result_free (result);
+    return GncSqlResultPtr(new GncDbiSqlResult (this, cursor));
+}
+
+dbi_result
+GncDbiSqlConnection::fetch_cursor (const std::string& cursor) const noexcept
+{
+    auto sql = "FETCH FORWARD " + std::to_string (DBI_CURSOR_FETCH_ROWS) +
+        " FROM " + cursor;
+
+    DEBUG ("SQL: %s\n", sql.c_str());
+    auto locale = gnc_push_locale (LC_NUMERIC, "C");
+    auto result = dbi_conn_query (m_conn, sql.c_str());
+    gnc_pop_locale (LC_NUMERIC, locale);
+    if (result == nullptr)
+    {
+        PERR ("Error executing SQL %s\n", sql.c_str());
+        m_qbe->set_error (ERR_BACKEND_SERVER_ERR);
+    }
+    return result;
+}
+
+void
+GncDbiSqlConnection::close_cursor (const std::string& cursor) noexcept
+{
+    auto sql = "CLOSE " + cursor;
+
+    DEBUG ("SQL: %s\n", sql.c_str());
+    auto result = dbi_conn_query (m_conn, sql.c_str());
+    if (result == nullptr)
+    {
+        PWARN ("Error executing SQL %s\n", sql.c_str());
+        rollback_transaction ();
+        return;
+    }
+    dbi_result_free (result);
+    commit_transaction ();
+}
+
 int
 GncDbiSqlConnection::execute_nonselect_statement (const GncSqlStatementPtr& stmt)
     noexcept
@@ -293,13 +557,14 @@ GncDbiSqlConnection::execute_nonselect_statement (const GncSqlStatementPtr& stmt
         result = dbi_conn_query (m_conn, stmt->to_sql());
     }
     while (m_retry);
-    if (result == nullptr && m_last_error)
+    /* A reader has no error handler to set m_last_error. */
+    if (result == nullptr && (m_last_error || m_reader))
     {
         PERR ("Error executing SQL %s\n", stmt->to_sql());
         if(m_last_error)
-            m_qbe->set_error(m_last_error);
+            report_error (m_last_error);
         else
-            m_qbe->set_error(ERR_BACKEND_SERVER_ERR);
+            report_error (ERR_BACKEND_SERVER_ERR);
         return -1;
     }
     if (!result)
@@ -310,9 +575,9 @@ GncDbiSqlConnection::execute_nonselect_statement (const GncSqlStatementPtr& stmt
     {
         PERR ("Error in dbi_result_free() result\n");
         if(m_last_error)
-            m_qbe->set_error(m_last_error);
+            report_error (m_last_error);
         else
-            m_qbe->set_error(ERR_BACKEND_SERVER_ERR);
+            report_error (ERR_BACKEND_SERVER_ERR);
     }
     return num_rows;
 }
@@ -324,6 +589,22 @@ GncDbiSqlConnection::create_statement_from_sql (const std::string& sql)
     return std::unique_ptr<GncSqlStatement>{new GncDbiSqlStatement (this, sql)};
 }
 
+const GncSqlStatementTemplate*
+GncDbiSqlConnection::get_statement_template (E_DB_OPERATION op,
+                                             const std::string& table,
+                                             const PairVec& values) noexcept
+{
+    if (values.empty())
+        return nullptr;
+    auto& templates = m_templates[table];
+    for (auto const& stmt : templates)
+        if (stmt->matches (op, values))
+            return stmt.get();
+    templates.emplace_back(new GncDbiSqlStatementTemplate (this, op, table,
+                                                           values));
+    return templates.back().get();
+}
+
 bool
 GncDbiSqlConnection::does_table_exist (const std::string& table_name)
     const noexcept
@@ -331,6 +612,13 @@ GncDbiSqlConnection::does_table_exist (const std::string& table_name)
     return ! m_provider->get_table_list(m_conn, table_name).empty();
 }
 
+void
+GncDbiSqlConnection::report_error (QofBackendError error) const noexcept
+{
+    if (!m_reader)
+        qof_backend_set_error (m_qbe, error);
+}
+
 bool
 GncDbiSqlConnection::begin_transaction () noexcept
 {
@@ -341,7 +629,7 @@ GncDbiSqlConnection::begin_transaction () noexcept
     if (!verify ())
     {
         PERR ("gnc_dbi_verify_conn() failed\n");
-        qof_backend_set_error (m_qbe, ERR_BACKEND_SERVER_ERR);
+        report_error (ERR_BACKEND_SERVER_ERR);
         return false;
     }
 
@@ -363,13 +651,13 @@ GncDbiSqlConnection::begin_transaction () noexcept
     if (!result)
     {
         PERR ("BEGIN transaction failed()\n");
-        qof_backend_set_error (m_qbe, ERR_BACKEND_SERVER_ERR);
+        report_error (ERR_BACKEND_SERVER_ERR);
         return false;
     }
     if (dbi_result_free (result) < 0)
     {
         PERR ("Error in dbi_result_free() result\n");
-        qof_backend_set_error (m_qbe, ERR_BACKEND_SERVER_ERR);
+        report_error (ERR_BACKEND_SERVER_ERR);
         return false;
     }
     ++m_sql_savepoint;
@@ -394,14 +682,14 @@ GncDbiSqlConnection::rollback_transaction () noexcept
     if (!result)
     {
         PERR ("Error in conn_rollback_transaction()\n");
-        qof_backend_set_error (m_qbe, ERR_BACKEND_SERVER_ERR);
+        report_error (ERR_BACKEND_SERVER_ERR);
         return false;
     }
 
     if (dbi_result_free (result) < 0)
     {
         PERR ("Error in dbi_result_free() result\n");
-        qof_backend_set_error (m_qbe, ERR_BACKEND_SERVER_ERR);
+        report_error (ERR_BACKEND_SERVER_ERR);
         return false;
     }
 
@@ -428,14 +716,14 @@ GncDbiSqlConnection::commit_transaction () noexcept
     if (!result)
     {
         PERR ("Error in conn_commit_transaction()\n");
-        qof_backend_set_error (m_qbe, ERR_BACKEND_SERVER_ERR);
+        report_error (ERR_BACKEND_SERVER_ERR);
         return false;
     }
 
     if (dbi_result_free (result) < 0)
     {
         PERR ("Error in dbi_result_free() result\n");
-        qof_backend_set_error (m_qbe, ERR_BACKEND_SERVER_ERR);
+        report_error (ERR_BACKEND_SERVER_ERR);
         return false;
     }
     --m_sql_savepoint;
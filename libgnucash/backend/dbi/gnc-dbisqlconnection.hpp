@@ -25,6 +25,8 @@
 
 #include <string>
 #include <vector>
+#include <memory>
+#include <unordered_map>
 
 #include <gnc-sql-connection.hpp>
 #include "gnc-backend-dbi.hpp"
@@ -35,6 +37,51 @@
 using StrVec = std::vector<std::string>;
 class GncDbiProvider;
 
+/**
+ * libdbi can't prepare statements on the server, so a template is just the
+ * SQL text, built once and cut where the values go; binding a row splices
+ * its quoted values between the pieces. An INSERT's head, up to VALUES, is
+ * kept apart so that one statement can insert several rows.
+ */
+class GncDbiSqlStatementTemplate : public GncSqlStatementTemplate
+{
+public:
+    GncDbiSqlStatementTemplate(const GncSqlConnection* conn, E_DB_OPERATION op,
+                               const std::string& table,
+                               const PairVec& values);
+    ~GncDbiSqlStatementTemplate() {}
+    GncSqlStatementPtr bind (const PairVec& values) const noexcept override;
+    GncSqlStatementPtr bind (const std::vector<PairVec>& rows)
+        const noexcept override;
+    /** Whether the template is for op on the columns in values. */
+    bool matches (E_DB_OPERATION op, const PairVec& values) const noexcept;
+
+private:
+    /* The SQL text preceding a value, the index of the value and whether
+     * it's the value of a WHERE condition, which is "IS NULL" for NULL.
+     */
+    struct Piece
+    {
+        std::string sql;
+        size_t value;
+        bool condition;
+    };
+    void add_piece (std::string& sql, size_t value, bool condition);
+    size_t row_size (const PairVec& values) const noexcept;
+    void append_row (std::string& sql, const PairVec& values) const noexcept;
+
+    const GncSqlConnection* m_conn = nullptr;
+    E_DB_OPERATION m_op;
+    StrVec m_columns;
+    std::string m_head;
+    std::vector<Piece> m_pieces;
+    std::string m_tail;
+    /** The length of a row's SQL without its values. */
+    size_t m_row_text = 0;
+};
+
+using GncDbiSqlStatementTemplatePtr = std::unique_ptr<GncDbiSqlStatementTemplate>;
+
 /**
  * Encapsulate a libdbi dbi_conn connection.
  */
@@ -44,12 +91,24 @@ public:
     GncDbiSqlConnection (DbType type, QofBackend* qbe, dbi_conn conn,
                          bool ignore_lock);
     ~GncDbiSqlConnection() override;
+    GncSqlConnection* open_reader () const noexcept override;
     GncSqlResultPtr execute_select_statement (const GncSqlStatementPtr&)
         noexcept override;
+    GncSqlResultPtr execute_streaming_select_statement (const GncSqlStatementPtr&)
+        noexcept override;
+    /** Fetch the next batch of rows from a cursor declared by
+     * execute_streaming_select_statement. Returns NULL if error. */
+    dbi_result fetch_cursor (const std::string& cursor) const noexcept;
+    /** Close a cursor declared by execute_streaming_select_statement and
+     * commit the transaction it was declared in. */
+    void close_cursor (const std::string& cursor) noexcept;
     int execute_nonselect_statement (const GncSqlStatementPtr&)
         noexcept override;
     GncSqlStatementPtr create_statement_from_sql (const std::string&)
         const noexcept override;
+    const GncSqlStatementTemplate*
+        get_statement_template (E_DB_OPERATION, const std::string&, const PairVec&)
+        noexcept override;
     bool does_table_exist (const std::string&) const noexcept override;
     bool begin_transaction () noexcept override;
     bool rollback_transaction () noexcept override;
@@ -86,6 +145,13 @@ public:
                                 const ColVec& info_vec) const noexcept;
     bool drop_indexes() noexcept;
 private:
+    /** A reader: it doesn't lock the database and leaves reporting errors
+     * to the caller, so that it can be used from another thread. */
+    GncDbiSqlConnection (DbType type, QofBackend* qbe, dbi_conn conn);
+    /** Set the backend's error, unless this is a reader. */
+    void report_error (QofBackendError error) const noexcept;
+    DbType m_type;
+    bool m_reader = false;
     QofBackend* m_qbe = nullptr;
     dbi_conn m_conn;
     std::unique_ptr<GncDbiProvider> m_provider;
@@ -108,6 +174,13 @@ private:
      */
     bool m_retry;
     unsigned int m_sql_savepoint;
+    /** Number of cursors declared, to give each a unique name. */
+    unsigned int m_cursors = 0;
+    /** Statement templates by table name. A table has one for each
+     * operation and set of columns; columns with null values are left out.
+     */
+    std::unordered_map<std::string,
+                       std::vector<GncDbiSqlStatementTemplatePtr>> m_templates;
     bool lock_database(bool ignore_lock);
     void unlock_database();
     bool rename_table(const std::string& old_name, const std::string& new_name);
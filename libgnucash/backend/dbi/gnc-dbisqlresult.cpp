@@ -43,8 +43,20 @@ static QofLogModule log_module = G_LOG_DOMAIN;
 #define HAVE_LIBDBI_TO_LONGLONG 0
 #endif
 
+GncDbiSqlResult::GncDbiSqlResult(GncDbiSqlConnection* conn,
+                                 const std::string& cursor) :
+    m_conn{conn}, m_dbi_result{conn->fetch_cursor (cursor)}, m_iter{this},
+    m_row{&m_iter}, m_sentinel{nullptr}, m_cursor{cursor}
+{
+}
+
 GncDbiSqlResult::~GncDbiSqlResult()
 {
+    if (!m_cursor.empty())
+        m_conn->close_cursor (m_cursor);
+    /* A failed fetch from the cursor has already been reported. */
+    if (m_dbi_result == nullptr && !m_cursor.empty())
+        return;
     int status = dbi_result_free (m_dbi_result);
 
     if (status == 0)
@@ -85,6 +97,17 @@ GncDbiSqlResult::size() const noexcept
 {
     return dbi_result_get_numrows(m_dbi_result);
 }
+
+/* Replace the rows, all read, with the next batch from the cursor. */
+GncSqlRow&
+GncDbiSqlResult::next_batch()
+{
+    if (m_cursor.empty() || m_dbi_result == nullptr)
+        return m_sentinel;
+    dbi_result_free (m_dbi_result);
+    m_dbi_result = m_conn->fetch_cursor (m_cursor);
+    return begin();
+}
 /* --------------------------------------------------------- */
 
 GncSqlRow&
@@ -95,7 +118,7 @@ GncDbiSqlResult::IteratorImpl::operator++()
         return m_inst->m_row;
     int error = m_inst->dberror();
     if (error == DBI_ERROR_BADIDX || error == 0) //ran off the end of the results
-        return m_inst->m_sentinel;
+        return m_inst->next_batch();
     PERR("Error %d incrementing results iterator.", error);
     qof_backend_set_error (m_inst->m_conn->qbe(), ERR_BACKEND_SERVER_ERR);
     return m_inst->m_sentinel;
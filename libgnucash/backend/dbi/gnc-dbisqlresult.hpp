@@ -36,9 +36,12 @@ class GncDbiSqlConnection;
 class GncDbiSqlResult : public GncSqlResult
 {
 public:
-    GncDbiSqlResult(const GncDbiSqlConnection* conn, dbi_result result) :
+    GncDbiSqlResult(GncDbiSqlConnection* conn, dbi_result result) :
         m_conn{conn}, m_dbi_result{result}, m_iter{this}, m_row{&m_iter},
         m_sentinel{nullptr} {}
+    /** A result read a batch at a time from a cursor declared on conn,
+     * which is closed, ending its transaction, when the result is deleted. */
+    GncDbiSqlResult(GncDbiSqlConnection* conn, const std::string& cursor);
     ~GncDbiSqlResult();
     uint64_t size() const noexcept;
     int dberror() const noexcept;
@@ -67,12 +70,14 @@ protected:
     };
 
 private:
-    const GncDbiSqlConnection* m_conn = nullptr;
+    GncSqlRow& next_batch();
+    GncDbiSqlConnection* m_conn = nullptr;
     dbi_result m_dbi_result;
     IteratorImpl m_iter;
     GncSqlRow m_row;
     GncSqlRow m_sentinel;
-
+    /** The cursor the rows are fetched from, if any. */
+    std::string m_cursor;
 };
 
 #endif //__GNC_DBISQLRESULT_HPP__
@@ -24,6 +24,7 @@
  *                                                                  *
 \********************************************************************/
 
+#include <guid.hpp>
 #include <kvp-frame.hpp>
 
 extern "C"
@@ -44,7 +45,11 @@ extern "C"
 #include <TransLog.h>
 #include "Transaction.h"
 #include "Split.h"
+#include "Query.h"
 #include "gnc-commodity.h"
+#include "gnc-lot.h"
+#include "SX-book.h"
+#include <ScrubBusiness.h>
 #include "gncAddress.h"
 #include "gncCustomer.h"
 #include "gncInvoice.h"
@@ -54,6 +59,10 @@ extern "C"
 /* For test_conn_index_functions */
 #include "../gnc-backend-dbi.hpp"
 #include "../gnc-backend-dbi.h"
+/* For test_statement_template */
+#include "../gnc-dbisqlconnection.hpp"
+/* For test_dbi_slots_load */
+#include <gnc-slots-sql.h>
 extern "C"
 {
 #include <unittest-support.h>
@@ -62,6 +71,7 @@ extern "C"
 
 #include <string>
 #include <vector>
+#include <map>
 #include <algorithm>
 
 #include "test-dbi-stuff.h"
@@ -425,6 +435,775 @@ test_dbi_store_and_reload (Fixture* fixture, gconstpointer pData)
     qof_session_destroy (session_3);
 }
 
+static Account*
+account_with_splits (Account* root)
+{
+    auto descendants = gnc_account_get_descendants (root);
+    Account* found = nullptr;
+    for (auto node = descendants; node && !found; node = node->next)
+        if (xaccAccountGetSplitList (GNC_ACCOUNT (node->data)) != nullptr)
+            found = GNC_ACCOUNT (node->data);
+    g_list_free (descendants);
+    return found;
+}
+
+/* Transactions left out of a lazy load are loaded when queried. */
+static void
+test_dbi_lazy_load (Fixture* fixture, gconstpointer pData)
+{
+    const gchar* url = (const gchar*)pData;
+    QofSession* session_2;
+    QofSession* session_3;
+
+    auto msg = "[GncDbiSqlConnection::unlock_database()] There was no lock entry in the Lock table";
+    auto log_domain = nullptr;
+    auto loglevel = static_cast<GLogLevelFlags> (G_LOG_LEVEL_WARNING |
+                                                 G_LOG_FLAG_FATAL);
+    TestErrorStruct* check = test_error_struct_new (log_domain, loglevel, msg);
+    fixture->hdlrs = test_log_set_fatal_handler (fixture->hdlrs, check,
+                                                 (GLogFunc)test_checked_handler);
+    if (fixture->filename)
+        url = fixture->filename;
+
+    // Save the session data
+    session_2 = qof_session_new ();
+    qof_session_begin (session_2, url, FALSE, TRUE, TRUE);
+    qof_session_swap_data (fixture->session, session_2);
+    qof_book_mark_session_dirty (qof_session_get_book (session_2));
+    qof_session_save (session_2, NULL);
+    g_assert_cmpint (qof_session_get_error (session_2), == , ERR_BACKEND_NO_ERR);
+    auto book_2 = qof_session_get_book (session_2);
+    auto acc_2 = account_with_splits (gnc_book_get_root_account (book_2));
+    g_assert (acc_2 != nullptr);
+
+    // Reload it lazily
+    g_setenv ("GNC_SQL_LAZY_LOAD", "0", TRUE);
+    session_3 = qof_session_new ();
+    qof_session_begin (session_3, url, TRUE, FALSE, FALSE);
+    qof_session_load (session_3, NULL);
+    g_unsetenv ("GNC_SQL_LAZY_LOAD");
+    g_assert_cmpint (qof_session_get_error (session_3), == , ERR_BACKEND_NO_ERR);
+    auto book_3 = qof_session_get_book (session_3);
+    auto acc_3 = xaccAccountLookup (qof_instance_get_guid (acc_2), book_3);
+    g_assert (acc_3 != nullptr);
+    g_assert (xaccAccountGetSplitList (acc_3) == nullptr);
+    /* The balances are summed by the database until the splits are loaded. */
+    g_assert (gnc_numeric_equal (xaccAccountGetBalance (acc_3),
+                                 xaccAccountGetBalance (acc_2)));
+    g_assert (gnc_numeric_equal (xaccAccountGetClearedBalance (acc_3),
+                                 xaccAccountGetClearedBalance (acc_2)));
+    g_assert (gnc_numeric_equal (xaccAccountGetReconciledBalance (acc_3),
+                                 xaccAccountGetReconciledBalance (acc_2)));
+    g_assert (gnc_numeric_equal (xaccAccountGetPresentBalance (acc_3),
+                                 xaccAccountGetPresentBalance (acc_2)));
+
+    auto query = qof_query_create_for (GNC_ID_SPLIT);
+    qof_query_set_book (query, book_3);
+    xaccQueryAddSingleAccountMatch (query, acc_3, QOF_QUERY_AND);
+    auto splits = qof_query_run (query);
+    g_assert_cmpuint (g_list_length (splits), == ,
+                      g_list_length (xaccAccountGetSplitList (acc_2)));
+    g_assert_cmpuint (g_list_length (xaccAccountGetSplitList (acc_3)), == ,
+                      g_list_length (xaccAccountGetSplitList (acc_2)));
+    qof_query_destroy (query);
+    g_assert (gnc_numeric_equal (xaccAccountGetBalance (acc_3),
+                                 xaccAccountGetBalance (acc_2)));
+
+    qof_session_ensure_all_data_loaded (session_3);
+    compare_books (book_2, book_3);
+    qof_session_end (session_2);
+    qof_session_destroy (session_2);
+    qof_session_end (session_3);
+    qof_session_destroy (session_3);
+}
+
+static guint
+query_account (QofBook* book, Account* acc)
+{
+    auto query = qof_query_create_for (GNC_ID_SPLIT);
+    qof_query_set_book (query, book);
+    xaccQueryAddSingleAccountMatch (query, acc, QOF_QUERY_AND);
+    auto count = g_list_length (qof_query_run (query));
+    qof_query_destroy (query);
+    return count;
+}
+
+static guint
+count_template_splits (QofBook* book)
+{
+    auto descendants =
+        gnc_account_get_descendants (gnc_book_get_template_root (book));
+    guint count = 0;
+    for (auto node = descendants; node; node = node->next)
+        count += g_list_length (
+            xaccAccountGetSplitList (GNC_ACCOUNT (node->data)));
+    g_list_free (descendants);
+    return count;
+}
+
+/* With a limit on the transactions kept in memory those least recently
+ * queried, by account, date or not at all, are unloaded, but the
+ * transactions of lots and the scheduled transactions' templates stay. */
+static void
+test_dbi_lazy_load_limit (Fixture* fixture, gconstpointer pData)
+{
+    const gchar* url = (const gchar*)pData;
+    QofSession* session_2;
+    QofSession* session_3;
+
+    auto msg = "[GncDbiSqlConnection::unlock_database()] There was no lock entry in the Lock table";
+    auto log_domain = nullptr;
+    auto loglevel = static_cast<GLogLevelFlags> (G_LOG_LEVEL_WARNING |
+                                                 G_LOG_FLAG_FATAL);
+    TestErrorStruct* check = test_error_struct_new (log_domain, loglevel, msg);
+    fixture->hdlrs = test_log_set_fatal_handler (fixture->hdlrs, check,
+                                                 (GLogFunc)test_checked_handler);
+    if (fixture->filename)
+        url = fixture->filename;
+
+    // Save the session data
+    session_2 = qof_session_new ();
+    qof_session_begin (session_2, url, FALSE, TRUE, TRUE);
+    qof_session_swap_data (fixture->session, session_2);
+    qof_book_mark_session_dirty (qof_session_get_book (session_2));
+    qof_session_save (session_2, NULL);
+    g_assert_cmpint (qof_session_get_error (session_2), == , ERR_BACKEND_NO_ERR);
+    auto book_2 = qof_session_get_book (session_2);
+    auto root_2 = gnc_book_get_root_account (book_2);
+    auto checking_2 = gnc_account_lookup_by_name (root_2, "Checking Account");
+    auto fund_2 = gnc_account_lookup_by_name (root_2, "Fund");
+    auto gains_2 = gnc_account_lookup_by_name (root_2, "Gains-CAD");
+    g_assert (checking_2 && fund_2 && gains_2);
+    auto n_checking = g_list_length (xaccAccountGetSplitList (checking_2));
+    g_assert_cmpuint (n_checking, >, 0);
+    auto n_template = count_template_splits (book_2);
+    g_assert_cmpuint (n_template, >, 0);
+
+    // Reload it lazily, keeping at most one transaction
+    g_setenv ("GNC_SQL_LAZY_LOAD", "1", TRUE);
+    session_3 = qof_session_new ();
+    qof_session_begin (session_3, url, TRUE, FALSE, FALSE);
+    qof_session_load (session_3, NULL);
+    g_unsetenv ("GNC_SQL_LAZY_LOAD");
+    g_assert_cmpint (qof_session_get_error (session_3), == , ERR_BACKEND_NO_ERR);
+    auto book_3 = qof_session_get_book (session_3);
+    auto checking_3 = xaccAccountLookup (qof_instance_get_guid (checking_2),
+                                         book_3);
+    auto fund_3 = xaccAccountLookup (qof_instance_get_guid (fund_2), book_3);
+    auto gains_3 = xaccAccountLookup (qof_instance_get_guid (gains_2), book_3);
+    g_assert (checking_3 && fund_3 && gains_3);
+
+    /* The lots have all of their splits, so scrubbing them leaves them be,
+     * and the balances count the splits loaded with them once. */
+    auto lots_2 = xaccAccountGetLotList (fund_2);
+    auto lots_3 = xaccAccountGetLotList (fund_3);
+    g_assert_cmpuint (g_list_length (lots_3), ==, g_list_length (lots_2));
+    g_assert_cmpuint (g_list_length (lots_3), >, 0);
+    for (auto node = lots_3; node; node = node->next)
+    {
+        auto lot_3 = GNC_LOT (node->data);
+        auto guid = *qof_instance_get_guid (lot_3);
+        auto lot_2 = gnc_lot_lookup (&guid, book_2);
+        g_assert_cmpint (gnc_lot_count_splits (lot_3), ==,
+                         gnc_lot_count_splits (lot_2));
+        gncScrubBusinessLot (lot_3);
+        g_assert (gnc_lot_lookup (&guid, book_3) == lot_3);
+        g_assert_cmpint (gnc_lot_count_splits (lot_3), ==,
+                         gnc_lot_count_splits (lot_2));
+    }
+    g_list_free (lots_2);
+    g_list_free (lots_3);
+    g_assert (gnc_numeric_equal (xaccAccountGetBalance (fund_3),
+                                 xaccAccountGetBalance (fund_2)));
+    g_assert (xaccAccountGetSplitList (checking_3) == nullptr);
+    g_assert_cmpuint (count_template_splits (book_3), ==, n_template);
+
+    /* A date range is unloaded once something else has been queried
+     * since. */
+    auto query = qof_query_create_for (GNC_ID_SPLIT);
+    qof_query_set_book (query, book_3);
+    xaccQueryAddDateMatchTT (query, TRUE, gnc_dmy2time64 (1, 1, 2000),
+                             TRUE, gnc_dmy2time64_end (31, 12, 2020),
+                             QOF_QUERY_AND);
+    qof_query_run (query);
+    qof_query_destroy (query);
+    g_assert_cmpuint (g_list_length (xaccAccountGetSplitList (checking_3)), ==,
+                      n_checking);
+    query_account (book_3, gains_3);
+    g_assert (xaccAccountGetSplitList (checking_3) == nullptr);
+
+    /* So is an account. */
+    g_assert_cmpuint (query_account (book_3, checking_3), ==, n_checking);
+    g_assert_cmpuint (g_list_length (xaccAccountGetSplitList (checking_3)), ==,
+                      n_checking);
+    query_account (book_3, gains_3);
+    g_assert (xaccAccountGetSplitList (checking_3) == nullptr);
+    g_assert (gnc_numeric_equal (xaccAccountGetBalance (checking_3),
+                                 xaccAccountGetBalance (checking_2)));
+    g_assert_cmpuint (count_template_splits (book_3), ==, n_template);
+
+    /* And everything, after which transactions are loaded as they're queried
+     * again. */
+    qof_session_ensure_all_data_loaded (session_3);
+    g_assert_cmpuint (g_list_length (xaccAccountGetSplitList (checking_3)), ==,
+                      n_checking);
+    query_account (book_3, gains_3);
+    g_assert (xaccAccountGetSplitList (checking_3) == nullptr);
+    g_assert_cmpuint (query_account (book_3, checking_3), ==, n_checking);
+    g_assert (gnc_numeric_equal (xaccAccountGetBalance (checking_3),
+                                 xaccAccountGetBalance (checking_2)));
+    /* Evicting everything left the templates. */
+    g_assert_cmpuint (count_template_splits (book_3), ==, n_template);
+
+    qof_session_ensure_all_data_loaded (session_3);
+    compare_books (book_2, book_3);
+    qof_session_end (session_2);
+    qof_session_destroy (session_2);
+    qof_session_end (session_3);
+    qof_session_destroy (session_3);
+}
+
+/* The slots of many objects, nested frames and all, are loaded together. */
+static void
+test_dbi_slots_load (Fixture* fixture, gconstpointer pData)
+{
+    const gchar* url = (const gchar*)pData;
+    auto msg = "[GncDbiSqlConnection::unlock_database()] There was no lock entry in the Lock table";
+    auto log_domain = nullptr;
+    auto loglevel = static_cast<GLogLevelFlags> (G_LOG_LEVEL_WARNING |
+                                                 G_LOG_FLAG_FATAL);
+    TestErrorStruct* check = test_error_struct_new (log_domain, loglevel, msg);
+    fixture->hdlrs = test_log_set_fatal_handler (fixture->hdlrs, check,
+                                                 (GLogFunc)test_checked_handler);
+    if (fixture->filename)
+        url = fixture->filename;
+
+    /* More accounts than are asked for in one query, some without slots. */
+    auto book = qof_session_get_book (fixture->session);
+    auto root = gnc_book_get_root_account (book);
+    for (auto i = 0; i < 600; ++i)
+    {
+        auto acc = xaccMallocAccount (book);
+        xaccAccountBeginEdit (acc);
+        auto name = g_strdup_printf ("Slots %d", i);
+        xaccAccountSetName (acc, name);
+        g_free (name);
+        if (i % 3)
+        {
+            auto frame = qof_instance_get_slots (QOF_INSTANCE (acc));
+            frame->set ({"index"}, new KvpValue (INT64_C (0) + i));
+            if (i % 3 == 2)
+                frame->set_path ({"nested", "name"},
+                                 new KvpValue (g_strdup_printf ("n%d", i)));
+        }
+        gnc_account_append_child (root, acc);
+        xaccAccountCommitEdit (acc);
+    }
+
+    auto session_2 = qof_session_new ();
+    qof_session_begin (session_2, url, FALSE, TRUE, TRUE);
+    qof_session_swap_data (fixture->session, session_2);
+    qof_book_mark_session_dirty (qof_session_get_book (session_2));
+    qof_session_save (session_2, NULL);
+    g_assert_cmpint (qof_session_get_error (session_2), == , ERR_BACKEND_NO_ERR);
+    qof_session_end (session_2);
+    qof_session_destroy (session_2);
+
+    auto session_3 = qof_session_new ();
+    qof_session_begin (session_3, url, TRUE, FALSE, FALSE);
+    qof_session_load (session_3, NULL);
+    g_assert_cmpint (qof_session_get_error (session_3), == , ERR_BACKEND_NO_ERR);
+    auto book_3 = qof_session_get_book (session_3);
+    auto sql_be = dynamic_cast<GncSqlBackend*> (qof_book_get_backend (book_3));
+    g_assert (sql_be != nullptr);
+
+    /* Empty each account's slots and load them again. */
+    InstanceVec instances;
+    std::vector<KvpFrame*> loaded;
+    auto descendants = gnc_account_get_descendants (gnc_book_get_root_account (book_3));
+    for (auto node = descendants; node; node = node->next)
+    {
+        auto inst = QOF_INSTANCE (node->data);
+        instances.push_back (inst);
+        loaded.push_back (new KvpFrame {*qof_instance_get_slots (inst)});
+        qof_instance_set_slots (inst, new KvpFrame);
+    }
+    g_list_free (descendants);
+    g_assert_cmpuint (instances.size(), >, 600);
+    gnc_sql_slots_load_for_instancevec (sql_be, instances);
+    for (size_t i = 0; i < instances.size(); ++i)
+    {
+        auto frame = qof_instance_get_slots (instances[i]);
+        g_assert_cmpint (compare (frame, loaded[i]), ==, 0);
+        delete loaded[i];
+        /* They're known to be stored as they are. */
+        auto key = gnc::GUID{*qof_instance_get_guid (instances[i])}.to_string();
+        auto saved = sql_be->saved_slots().find (key);
+        g_assert (saved != sql_be->saved_slots().end());
+        g_assert (saved->second->known);
+        auto& values = saved->second->values;
+        auto index = frame->get_slot ({"index"});
+        if (index == nullptr)
+            g_assert_cmpuint (values.size(), ==, 0);
+        else
+        {
+            auto const& value = values.at ("index");
+            g_assert_cmpint (value.type, ==, KvpValue::Type::INT64);
+            g_assert_cmpint (value.value[0], ==, index->get<int64_t>());
+        }
+        if (frame->get_slot ({"nested", "name"}) != nullptr)
+        {
+            g_assert_cmpint (values.at ("nested").type, ==,
+                             KvpValue::Type::FRAME);
+            g_assert_cmpint (values.at ("nested/name").type, ==,
+                             KvpValue::Type::STRING);
+        }
+    }
+    auto acc = gnc_account_lookup_by_name (gnc_book_get_root_account (book_3),
+                                           "Slots 599");
+    auto frame = qof_instance_get_slots (QOF_INSTANCE (acc));
+    g_assert_cmpint (frame->get_slot ({"index"})->get<int64_t>(), ==, 599);
+    g_assert_cmpstr (frame->get_slot ({"nested", "name"})->get<const char*>(),
+                     ==, "n599");
+    qof_session_end (session_3);
+    qof_session_destroy (session_3);
+}
+
+/* More splits than are fetched from a cursor at a time are all loaded, and
+ * read again while another streamed result is open; closing the results
+ * leaves no transaction open to swallow later commits. */
+static void
+test_dbi_streaming (Fixture* fixture, gconstpointer pData)
+{
+    const gchar* url = (const gchar*)pData;
+    const int num_tx = 2600;
+    auto msg = "[GncDbiSqlConnection::unlock_database()] There was no lock entry in the Lock table";
+    auto log_domain = nullptr;
+    auto loglevel = static_cast<GLogLevelFlags> (G_LOG_LEVEL_WARNING |
+                                                 G_LOG_FLAG_FATAL);
+    TestErrorStruct* check = test_error_struct_new (log_domain, loglevel, msg);
+    fixture->hdlrs = test_log_set_fatal_handler (fixture->hdlrs, check,
+                                                 (GLogFunc)test_checked_handler);
+    if (fixture->filename)
+        url = fixture->filename;
+
+    auto book = qof_session_get_book (fixture->session);
+    auto root = gnc_book_get_root_account (book);
+    auto currency = gnc_commodity_table_lookup (gnc_commodity_table_get_table (book),
+                                                GNC_COMMODITY_NS_CURRENCY, "CAD");
+    auto from = xaccMallocAccount (book);
+    auto to = xaccMallocAccount (book);
+    for (auto acc : {from, to})
+    {
+        xaccAccountBeginEdit (acc);
+        xaccAccountSetType (acc, ACCT_TYPE_BANK);
+        xaccAccountSetName (acc, acc == from ? "Stream From" : "Stream To");
+        xaccAccountSetCommodity (acc, currency);
+        gnc_account_append_child (root, acc);
+        xaccAccountCommitEdit (acc);
+    }
+    for (auto i = 0; i < num_tx; ++i)
+    {
+        auto tx = xaccMallocTransaction (book);
+        xaccTransBeginEdit (tx);
+        xaccTransSetCurrency (tx, currency);
+        xaccTransSetDatePostedSecsNormalized (tx, gnc_time (nullptr) - i * 60);
+        for (auto acc : {from, to})
+        {
+            auto split = xaccMallocSplit (book);
+            auto amount = gnc_numeric_create (acc == from ? -100 : 100, 100);
+            xaccSplitSetParent (split, tx);
+            xaccSplitSetAccount (split, acc);
+            xaccSplitSetAmount (split, amount);
+            xaccSplitSetValue (split, amount);
+        }
+        xaccTransCommitEdit (tx);
+    }
+    auto from_guid = *qof_instance_get_guid (QOF_INSTANCE (from));
+    auto to_guid = *qof_instance_get_guid (QOF_INSTANCE (to));
+
+    auto session_2 = qof_session_new ();
+    qof_session_begin (session_2, url, FALSE, TRUE, TRUE);
+    qof_session_swap_data (fixture->session, session_2);
+    qof_book_mark_session_dirty (qof_session_get_book (session_2));
+    qof_session_save (session_2, NULL);
+    g_assert_cmpint (qof_session_get_error (session_2), == , ERR_BACKEND_NO_ERR);
+    qof_session_end (session_2);
+    qof_session_destroy (session_2);
+
+    auto session_3 = qof_session_new ();
+    qof_session_begin (session_3, url, TRUE, FALSE, FALSE);
+    qof_session_load (session_3, NULL);
+    g_assert_cmpint (qof_session_get_error (session_3), == , ERR_BACKEND_NO_ERR);
+    auto book_3 = qof_session_get_book (session_3);
+    auto from_3 = xaccAccountLookup (&from_guid, book_3);
+    auto to_3 = xaccAccountLookup (&to_guid, book_3);
+    g_assert (from_3 != nullptr && to_3 != nullptr);
+    g_assert_cmpint (g_list_length (xaccAccountGetSplitList (from_3)), ==, num_tx);
+    g_assert_cmpint (g_list_length (xaccAccountGetSplitList (to_3)), ==, num_tx);
+    g_assert (gnc_numeric_equal (xaccAccountGetBalance (to_3),
+                                 gnc_numeric_create (num_tx, 1)));
+
+    auto sql_be = dynamic_cast<GncSqlBackend*> (qof_book_get_backend (book_3));
+    g_assert (sql_be != nullptr);
+    auto stmt = sql_be->create_statement_from_sql ("SELECT guid FROM splits");
+    auto splits = sql_be->execute_streaming_select_statement (stmt);
+    g_assert (splits != nullptr);
+    auto inner_stmt = sql_be->create_statement_from_sql ("SELECT guid FROM transactions");
+    auto txs = sql_be->execute_streaming_select_statement (inner_stmt);
+    g_assert (txs != nullptr);
+    auto num_splits = 0, num_txs = 0;
+    for (auto row : *splits)
+    {
+        (void)row;
+        ++num_splits;
+    }
+    for (auto row : *txs)
+    {
+        (void)row;
+        ++num_txs;
+    }
+    delete txs;
+    delete splits;
+    /* setup_memory adds a transaction of its own. */
+    g_assert_cmpint (num_splits, ==, 2 * num_tx + 2);
+    g_assert_cmpint (num_txs, ==, num_tx + 1);
+
+    xaccAccountBeginEdit (from_3);
+    xaccAccountSetName (from_3, "Streamed From");
+    xaccAccountCommitEdit (from_3);
+    qof_session_end (session_3);
+    g_assert_cmpint (qof_session_get_error (session_3), == , ERR_BACKEND_NO_ERR);
+    qof_session_destroy (session_3);
+
+    session_2 = qof_session_new ();
+    qof_session_begin (session_2, url, TRUE, FALSE, FALSE);
+    qof_session_load (session_2, NULL);
+    g_assert_cmpint (qof_session_get_error (session_2), == , ERR_BACKEND_NO_ERR);
+    auto from_2 = xaccAccountLookup (&from_guid, qof_session_get_book (session_2));
+    g_assert (from_2 != nullptr);
+    g_assert_cmpstr (xaccAccountGetName (from_2), ==, "Streamed From");
+    qof_session_end (session_2);
+    qof_session_destroy (session_2);
+}
+
+/* Commits written behind are in the database once the session ends. */
+static void
+test_dbi_write_behind (Fixture* fixture, gconstpointer pData)
+{
+    const gchar* url = (const gchar*)pData;
+    QofSession* session_2;
+    QofSession* session_3;
+
+    auto msg = "[GncDbiSqlConnection::unlock_database()] There was no lock entry in the Lock table";
+    auto log_domain = nullptr;
+    auto loglevel = static_cast<GLogLevelFlags> (G_LOG_LEVEL_WARNING |
+                                                 G_LOG_FLAG_FATAL);
+    TestErrorStruct* check = test_error_struct_new (log_domain, loglevel, msg);
+    fixture->hdlrs = test_log_set_fatal_handler (fixture->hdlrs, check,
+                                                 (GLogFunc)test_checked_handler);
+    if (fixture->filename)
+        url = fixture->filename;
+
+    // Save the session data
+    session_2 = qof_session_new ();
+    qof_session_begin (session_2, url, FALSE, TRUE, TRUE);
+    qof_session_swap_data (fixture->session, session_2);
+    qof_book_mark_session_dirty (qof_session_get_book (session_2));
+    qof_session_save (session_2, NULL);
+    g_assert_cmpint (qof_session_get_error (session_2), == , ERR_BACKEND_NO_ERR);
+    qof_session_end (session_2);
+    qof_session_destroy (session_2);
+
+    // Reload it, add accounts and rename one
+    g_setenv ("GNC_SQL_WRITE_BEHIND", "1", TRUE);
+    session_3 = qof_session_new ();
+    qof_session_begin (session_3, url, TRUE, FALSE, FALSE);
+    qof_session_load (session_3, NULL);
+    g_unsetenv ("GNC_SQL_WRITE_BEHIND");
+    g_assert_cmpint (qof_session_get_error (session_3), == , ERR_BACKEND_NO_ERR);
+    auto book_3 = qof_session_get_book (session_3);
+    auto root_3 = gnc_book_get_root_account (book_3);
+    auto acc_3 = account_with_splits (root_3);
+    g_assert (acc_3 != nullptr);
+    std::vector<Account*> added;
+    for (auto name : {"Behind 1", "Behind 2", "Behind 3"})
+    {
+        auto acc = xaccMallocAccount (book_3);
+        xaccAccountBeginEdit (acc);
+        xaccAccountSetName (acc, name);
+        xaccAccountSetCommodity (acc, xaccAccountGetCommodity (acc_3));
+        gnc_account_append_child (root_3, acc);
+        xaccAccountCommitEdit (acc);
+        added.push_back (acc);
+    }
+    xaccAccountBeginEdit (acc_3);
+    xaccAccountSetName (acc_3, "Renamed behind");
+    xaccAccountCommitEdit (acc_3);
+    qof_session_end (session_3);
+    g_assert_cmpint (qof_session_get_error (session_3), == , ERR_BACKEND_NO_ERR);
+
+    // Load what was written
+    session_2 = qof_session_new ();
+    qof_session_begin (session_2, url, TRUE, FALSE, FALSE);
+    qof_session_load (session_2, NULL);
+    g_assert_cmpint (qof_session_get_error (session_2), == , ERR_BACKEND_NO_ERR);
+    auto book_2 = qof_session_get_book (session_2);
+    for (auto acc : added)
+    {
+        auto acc_2 = xaccAccountLookup (qof_instance_get_guid (acc), book_2);
+        g_assert (acc_2 != nullptr);
+        g_assert_cmpstr (xaccAccountGetName (acc_2), == ,
+                         xaccAccountGetName (acc));
+    }
+    auto acc_2 = xaccAccountLookup (qof_instance_get_guid (acc_3), book_2);
+    g_assert (acc_2 != nullptr);
+    g_assert_cmpstr (xaccAccountGetName (acc_2), == , "Renamed behind");
+    qof_session_end (session_2);
+    qof_session_destroy (session_2);
+    qof_session_destroy (session_3);
+}
+
+/* Lets the backend log its errors without failing the test, counting them. */
+static gboolean
+count_backend_errors (const gchar* log_domain, GLogLevelFlags log_level,
+                      const gchar* msg, gpointer user_data)
+{
+    if (!g_str_has_prefix (log_domain, "gnc.backend"))
+        return TRUE;
+    if (log_level & G_LOG_LEVEL_CRITICAL)
+        ++*static_cast<int*> (user_data);
+    return FALSE;
+}
+
+/* A commit that fails behind the caller's back is reported on the main
+ * thread, leaving the instance and the book dirty. */
+static void
+test_dbi_write_behind_error (Fixture* fixture, gconstpointer pData)
+{
+    const gchar* url = (const gchar*)pData;
+    auto errors = 0;
+    if (fixture->filename)
+        url = fixture->filename;
+
+    auto session_2 = qof_session_new ();
+    qof_session_begin (session_2, url, FALSE, TRUE, TRUE);
+    qof_session_swap_data (fixture->session, session_2);
+    qof_book_mark_session_dirty (qof_session_get_book (session_2));
+    qof_session_save (session_2, NULL);
+    g_assert_cmpint (qof_session_get_error (session_2), == , ERR_BACKEND_NO_ERR);
+    qof_session_end (session_2);
+    qof_session_destroy (session_2);
+
+    g_setenv ("GNC_SQL_WRITE_BEHIND", "1", TRUE);
+    auto session_3 = qof_session_new ();
+    qof_session_begin (session_3, url, TRUE, FALSE, FALSE);
+    qof_session_load (session_3, NULL);
+    g_unsetenv ("GNC_SQL_WRITE_BEHIND");
+    g_assert_cmpint (qof_session_get_error (session_3), == , ERR_BACKEND_NO_ERR);
+    auto book_3 = qof_session_get_book (session_3);
+    auto acc_3 = account_with_splits (gnc_book_get_root_account (book_3));
+    g_assert (acc_3 != nullptr);
+    auto sql_be = dynamic_cast<GncSqlBackend*> (qof_book_get_backend (book_3));
+    g_assert (sql_be != nullptr);
+
+    /* The rename can't be written without the table. */
+    g_test_log_set_fatal_handler ((GTestLogFatalFunc)count_backend_errors,
+                                  &errors);
+    auto stmt = sql_be->create_statement_from_sql ("DROP TABLE accounts");
+    g_assert_cmpint (sql_be->execute_nonselect_statement (stmt), >=, 0);
+    xaccAccountBeginEdit (acc_3);
+    xaccAccountSetName (acc_3, "Not written");
+    xaccAccountCommitEdit (acc_3);
+    g_assert (!qof_instance_get_dirty_flag (QOF_INSTANCE (acc_3)));
+
+    /* Loading waits for the worker and reports what it did. */
+    qof_session_ensure_all_data_loaded (session_3);
+    g_assert_cmpint (qof_session_get_error (session_3), == ,
+                     ERR_BACKEND_SERVER_ERR);
+    g_assert_cmpint (errors, >, 0);
+    g_assert (qof_instance_get_dirty_flag (QOF_INSTANCE (acc_3)));
+    g_assert (qof_book_session_not_saved (book_3));
+    qof_session_end (session_3);
+    qof_session_destroy (session_3);
+}
+
+/* The commits of a group are written when it ends. Rolling it back writes
+ * none of them and leaves what they saved dirty. */
+static void
+test_dbi_group_commit (Fixture* fixture, gconstpointer pData)
+{
+    const gchar* url = (const gchar*)pData;
+    auto msg = "[GncDbiSqlConnection::unlock_database()] There was no lock entry in the Lock table";
+    auto log_domain = nullptr;
+    auto loglevel = static_cast<GLogLevelFlags> (G_LOG_LEVEL_WARNING |
+                                                 G_LOG_FLAG_FATAL);
+    TestErrorStruct* check = test_error_struct_new (log_domain, loglevel, msg);
+    fixture->hdlrs = test_log_set_fatal_handler (fixture->hdlrs, check,
+                                                 (GLogFunc)test_checked_handler);
+    if (fixture->filename)
+        url = fixture->filename;
+
+    auto session_2 = qof_session_new ();
+    qof_session_begin (session_2, url, FALSE, TRUE, TRUE);
+    qof_session_swap_data (fixture->session, session_2);
+    qof_book_mark_session_dirty (qof_session_get_book (session_2));
+    qof_session_save (session_2, NULL);
+    g_assert_cmpint (qof_session_get_error (session_2), == , ERR_BACKEND_NO_ERR);
+    qof_session_end (session_2);
+    qof_session_destroy (session_2);
+
+    auto session_3 = qof_session_new ();
+    qof_session_begin (session_3, url, TRUE, FALSE, FALSE);
+    qof_session_load (session_3, NULL);
+    g_assert_cmpint (qof_session_get_error (session_3), == , ERR_BACKEND_NO_ERR);
+    auto book_3 = qof_session_get_book (session_3);
+    auto acc_3 = gnc_account_lookup_by_name (gnc_book_get_root_account (book_3),
+                                             "Bank 1");
+    g_assert (acc_3 != nullptr);
+
+    qof_session_begin_group_commit (session_3);
+    xaccAccountBeginEdit (acc_3);
+    xaccAccountSetName (acc_3, "Grouped");
+    xaccAccountCommitEdit (acc_3);
+    g_assert (qof_session_end_group_commit (session_3));
+    g_assert (!qof_instance_get_dirty_flag (QOF_INSTANCE (acc_3)));
+    g_assert (!qof_book_session_not_saved (book_3));
+
+    qof_session_begin_group_commit (session_3);
+    xaccAccountBeginEdit (acc_3);
+    xaccAccountSetName (acc_3, "Rolled back");
+    xaccAccountCommitEdit (acc_3);
+    g_assert (!qof_instance_get_dirty_flag (QOF_INSTANCE (acc_3)));
+    qof_session_rollback_group_commit (session_3);
+    g_assert_cmpint (qof_session_get_error (session_3), == , ERR_BACKEND_NO_ERR);
+    g_assert (qof_instance_get_dirty_flag (QOF_INSTANCE (acc_3)));
+    g_assert (qof_book_session_not_saved (book_3));
+    auto guid = *qof_instance_get_guid (acc_3);
+    qof_session_end (session_3);
+    qof_session_destroy (session_3);
+
+    /* Only the first group was written. */
+    auto session_4 = qof_session_new ();
+    qof_session_begin (session_4, url, TRUE, FALSE, FALSE);
+    qof_session_load (session_4, NULL);
+    g_assert_cmpint (qof_session_get_error (session_4), == , ERR_BACKEND_NO_ERR);
+    auto acc_4 = xaccAccountLookup (&guid, qof_session_get_book (session_4));
+    g_assert (acc_4 != nullptr);
+    g_assert_cmpstr (xaccAccountGetName (acc_4), ==, "Grouped");
+    qof_session_end (session_4);
+    qof_session_destroy (session_4);
+}
+
+/* The id and value of each slots row, by name, read from an SQLite file. */
+using StoredSlots = std::map<std::string, std::pair<long long, std::string>>;
+
+static StoredSlots
+stored_slots (const char* filename)
+{
+    StoredSlots slots;
+#if HAVE_LIBDBI_R
+    auto conn = dbi_conn_new_r ("sqlite3", dbi_instance);
+#else
+    auto conn = dbi_conn_new ("sqlite3");
+#endif
+    auto dir = g_path_get_dirname (filename);
+    auto base = g_path_get_basename (filename);
+    dbi_conn_set_option (conn, "sqlite3_dbdir", dir);
+    dbi_conn_set_option (conn, "dbname", base);
+    g_free (dir);
+    g_free (base);
+    g_assert_cmpint (dbi_conn_connect (conn), == , 0);
+    auto result = dbi_conn_query (conn, "SELECT id, name, int64_val, "
+                                  "string_val FROM slots");
+    g_assert (result != nullptr);
+    while (dbi_result_next_row (result))
+    {
+        auto str = dbi_result_get_string (result, "string_val");
+        slots[dbi_result_get_string (result, "name")] =
+            {dbi_result_get_as_longlong (result, "id"),
+             str ? str : std::to_string (dbi_result_get_as_longlong (result,
+                                                                     "int64_val"))};
+    }
+    dbi_result_free (result);
+    dbi_conn_close (conn);
+    return slots;
+}
+
+/* Saving an object writes only the slots that changed, comparing them with
+ * the slots stored when it was saved or loaded rather than with the
+ * database; the rows of unchanged slots keep their ids. */
+static void
+test_dbi_slot_changes (Fixture* fixture, gconstpointer pData)
+{
+    auto msg = "[GncDbiSqlConnection::unlock_database()] There was no lock entry in the Lock table";
+    auto log_domain = nullptr;
+    auto loglevel = static_cast<GLogLevelFlags> (G_LOG_LEVEL_WARNING |
+                                                 G_LOG_FLAG_FATAL);
+    TestErrorStruct* check = test_error_struct_new (log_domain, loglevel, msg);
+    fixture->hdlrs = test_log_set_fatal_handler (fixture->hdlrs, check,
+                                                 (GLogFunc)test_checked_handler);
+    auto url = fixture->filename;
+
+    // Save the session data
+    auto session_2 = qof_session_new ();
+    qof_session_begin (session_2, url, FALSE, TRUE, TRUE);
+    qof_session_swap_data (fixture->session, session_2);
+    auto book_2 = qof_session_get_book (session_2);
+    auto acc_2 = gnc_account_lookup_by_name (gnc_book_get_root_account (book_2),
+                                             "Bank 1");
+    g_assert (acc_2 != nullptr);
+    auto frame = qof_instance_get_slots (QOF_INSTANCE (acc_2));
+    frame->set_path ({"nested", "a"}, new KvpValue (INT64_C (1)));
+    qof_book_mark_session_dirty (book_2);
+    qof_session_save (session_2, NULL);
+    g_assert_cmpint (qof_session_get_error (session_2), == , ERR_BACKEND_NO_ERR);
+    auto saved = stored_slots (url);
+    g_assert_cmpuint (saved.count ("double-val"), == , 1);
+    g_assert_cmpuint (saved.count ("nested/a"), == , 1);
+
+    // Change, add and remove slots of the saved account
+    xaccAccountBeginEdit (acc_2);
+    delete frame->set ({"int64-val"}, new KvpValue (INT64_C (200)));
+    delete frame->set ({"double-val"}, nullptr);
+    frame->set ({"new-val"}, new KvpValue (g_strdup ("new")));
+    qof_instance_set_dirty (QOF_INSTANCE (acc_2));
+    xaccAccountCommitEdit (acc_2);
+    g_assert_cmpint (qof_session_get_error (session_2), == , ERR_BACKEND_NO_ERR);
+    auto changed = stored_slots (url);
+    g_assert_cmpuint (changed.count ("double-val"), == , 0);
+    g_assert_cmpstr (changed["int64-val"].second.c_str(), == , "200");
+    g_assert_cmpint (changed["int64-val"].first, == , saved["int64-val"].first);
+    g_assert_cmpstr (changed["new-val"].second.c_str(), == , "new");
+    for (auto name : {"string-val", "guid-val", "time-val", "numeric-val",
+                      "nested", "nested/a"})
+        g_assert_cmpint (changed[name].first, == , saved[name].first);
+    qof_session_end (session_2);
+    qof_session_destroy (session_2);
+
+    // Reload it and change a nested frame
+    auto session_3 = qof_session_new ();
+    qof_session_begin (session_3, url, TRUE, FALSE, FALSE);
+    qof_session_load (session_3, NULL);
+    g_assert_cmpint (qof_session_get_error (session_3), == , ERR_BACKEND_NO_ERR);
+    auto acc_3 = xaccAccountLookup (qof_instance_get_guid (acc_2),
+                                    qof_session_get_book (session_3));
+    g_assert (acc_3 != nullptr);
+    frame = qof_instance_get_slots (QOF_INSTANCE (acc_3));
+    xaccAccountBeginEdit (acc_3);
+    frame->set_path ({"nested", "b"}, new KvpValue (g_strdup ("b")));
+    qof_instance_set_dirty (QOF_INSTANCE (acc_3));
+    xaccAccountCommitEdit (acc_3);
+    g_assert_cmpint (qof_session_get_error (session_3), == , ERR_BACKEND_NO_ERR);
+    auto reloaded = stored_slots (url);
+    g_assert_cmpstr (reloaded["nested/b"].second.c_str(), == , "b");
+    for (auto name : {"int64-val", "string-val", "guid-val", "time-val",
+                      "numeric-val", "new-val", "nested", "nested/a"})
+        g_assert_cmpint (reloaded[name].first, == , changed[name].first);
+    qof_session_end (session_3);
+    qof_session_destroy (session_3);
+}
+
 /** Test the safe_save mechanism.  Beware that this test used on its
  * own doesn't ensure that the resave is done safely, only that the
  * database is intact and unchanged after the save. To observe the
@@ -643,14 +1422,66 @@ test_adjust_sql_options_string (void)
     }
 }
 
+static void
+test_statement_template (void)
+{
+    PairVec values{{"guid", "'a'"}, {"name", "'Bank'"}, {"code", "NULL"}};
+    PairVec other{{"guid", "NULL"}, {"name", "'Cash'"}, {"code", "'1'"}};
+
+    GncDbiSqlStatementTemplate insert{nullptr, OP_DB_INSERT, "t", values};
+    g_assert (insert.matches (OP_DB_INSERT, other));
+    g_assert (!insert.matches (OP_DB_UPDATE, values));
+    g_assert (!insert.matches (OP_DB_INSERT,
+                               PairVec{{"guid", "'a'"}, {"name", "'Bank'"}}));
+    g_assert (!insert.matches (OP_DB_INSERT,
+                               PairVec{{"guid", "'a'"}, {"code", "NULL"},
+                                       {"name", "'Bank'"}}));
+    g_assert_cmpstr (insert.bind (values)->to_sql(), ==,
+                     "INSERT INTO t(guid,name,code) VALUES('a','Bank',NULL)");
+    g_assert_cmpstr (insert.bind (std::vector<PairVec>{values, other})->to_sql(),
+                     ==, "INSERT INTO t(guid,name,code) VALUES"
+                     "('a','Bank',NULL),(NULL,'Cash','1')");
+
+    GncDbiSqlStatementTemplate update{nullptr, OP_DB_UPDATE, "t", values};
+    g_assert_cmpstr (update.bind (values)->to_sql(), ==,
+                     "UPDATE t SET guid='a',name='Bank',code=NULL "
+                     "WHERE guid = 'a'");
+    g_assert_cmpstr (update.bind (other)->to_sql(), ==,
+                     "UPDATE t SET guid=NULL,name='Cash',code='1' "
+                     "WHERE guid IS NULL");
+
+    PairVec key{{"guid", "'a'"}};
+    GncDbiSqlStatementTemplate remove{nullptr, OP_DB_DELETE, "t", key};
+    g_assert_cmpstr (remove.bind (key)->to_sql(), ==,
+                     "DELETE FROM t WHERE guid = 'a'");
+}
+
 static void
 create_dbi_test_suite (const char* dbm_name, const char* url)
 {
     auto subsuite = g_strdup_printf ("%s/%s", suitename, dbm_name);
     GNC_TEST_ADD (subsuite, "store_and_reload", Fixture, url, setup,
                   test_dbi_store_and_reload, teardown);
+    GNC_TEST_ADD (subsuite, "lazy_load", Fixture, url, setup,
+                  test_dbi_lazy_load, teardown);
+    GNC_TEST_ADD (subsuite, "lazy_load_limit", Fixture, url, setup,
+                  test_dbi_lazy_load_limit, teardown);
+    GNC_TEST_ADD (subsuite, "write_behind", Fixture, url, setup,
+                  test_dbi_write_behind, teardown);
+    GNC_TEST_ADD (subsuite, "write_behind_error", Fixture, url, setup,
+                  test_dbi_write_behind_error, teardown);
+    GNC_TEST_ADD (subsuite, "group_commit", Fixture, url, setup_memory,
+                  test_dbi_group_commit, teardown);
     GNC_TEST_ADD (subsuite, "safe_save", Fixture, url, setup_memory,
                   test_dbi_safe_save, teardown);
+    GNC_TEST_ADD (subsuite, "slots_load", Fixture, url, setup_memory,
+                  test_dbi_slots_load, teardown);
+    GNC_TEST_ADD (subsuite, "streaming", Fixture, url, setup_memory,
+                  test_dbi_streaming, teardown);
+    /* Reads the slots table directly, which is only easy with SQLite. */
+    if (g_strcmp0 (dbm_name, "sqlite3") == 0)
+        GNC_TEST_ADD (subsuite, "slot_changes", Fixture, url, setup_memory,
+                      test_dbi_slot_changes, teardown);
     GNC_TEST_ADD (subsuite, "version_control", Fixture, url, setup_memory,
                   test_dbi_version_control, teardown);
     GNC_TEST_ADD (subsuite, "business_store_and_reload", Fixture, url,
@@ -690,4 +1521,6 @@ test_suite_gnc_backend_dbi (void)
 
     GNC_TEST_ADD_FUNC( suitename, "adjust sql options string localtime", 
         test_adjust_sql_options_string );
+    GNC_TEST_ADD_FUNC (suitename, "statement template",
+                       test_statement_template);
 }
@@ -36,6 +36,8 @@ class GncSqlAccountBackend : public GncSqlObjectBackend
 public:
     GncSqlAccountBackend();
     void load_all(GncSqlBackend*) override;
+    std::vector<std::string> load_all_queries() const override {
+        return table_queries(); }
     bool commit(GncSqlBackend*, QofInstance*) override;
 };
 
@@ -36,6 +36,8 @@ class GncSqlBudgetBackend : public GncSqlObjectBackend
 public:
     GncSqlBudgetBackend();
     void load_all(GncSqlBackend*) override;
+    std::vector<std::string> load_all_queries() const override {
+        return table_queries(); }
     void create_tables(GncSqlBackend*) override;
     bool commit (GncSqlBackend* sql_be, QofInstance* inst) override;
     bool write(GncSqlBackend*) override;
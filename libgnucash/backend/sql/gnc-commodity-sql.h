@@ -42,6 +42,8 @@ class GncSqlCommodityBackend : public GncSqlObjectBackend
 public:
     GncSqlCommodityBackend();
     void load_all(GncSqlBackend*) override;
+    std::vector<std::string> load_all_queries() const override {
+        return table_queries(); }
     bool commit(GncSqlBackend*, QofInstance*) override;
 };
 
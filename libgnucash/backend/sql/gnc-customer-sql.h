@@ -37,6 +37,8 @@ class GncSqlCustomerBackend : public GncSqlObjectBackend
 public:
     GncSqlCustomerBackend();
     void load_all(GncSqlBackend*) override;
+    std::vector<std::string> load_all_queries() const override {
+        return table_queries(); }
     void create_tables(GncSqlBackend*) override;
     bool write(GncSqlBackend*) override;
 };
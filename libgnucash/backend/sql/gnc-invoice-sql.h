@@ -37,6 +37,8 @@ class GncSqlInvoiceBackend : public GncSqlObjectBackend
 public:
     GncSqlInvoiceBackend();
     void load_all(GncSqlBackend*) override;
+    std::vector<std::string> load_all_queries() const override {
+        return table_queries(); }
     void create_tables(GncSqlBackend*) override;
     bool commit (GncSqlBackend* sql_be, QofInstance* inst) override;
     bool write(GncSqlBackend*) override;
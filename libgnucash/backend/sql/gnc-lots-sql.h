@@ -36,6 +36,8 @@ class GncSqlLotsBackend : public GncSqlObjectBackend
 public:
     GncSqlLotsBackend();
     void load_all(GncSqlBackend*) override;
+    std::vector<std::string> load_all_queries() const override {
+        return table_queries(); }
     void create_tables(GncSqlBackend*) override;
     bool write(GncSqlBackend*) override;
 };
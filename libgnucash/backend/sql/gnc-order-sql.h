@@ -37,6 +37,8 @@ class GncSqlOrderBackend : public GncSqlObjectBackend
 public:
     GncSqlOrderBackend();
     void load_all(GncSqlBackend*) override;
+    std::vector<std::string> load_all_queries() const override {
+        return table_queries(); }
     bool write(GncSqlBackend*) override;
 };
 
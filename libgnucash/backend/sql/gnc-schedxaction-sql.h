@@ -39,6 +39,8 @@ class GncSqlSchedXactionBackend : public GncSqlObjectBackend
 public:
     GncSqlSchedXactionBackend();
     void load_all(GncSqlBackend*) override;
+    std::vector<std::string> load_all_queries() const override {
+        return table_queries(); }
     bool commit (GncSqlBackend* sql_be, QofInstance* inst) override;
 };
 
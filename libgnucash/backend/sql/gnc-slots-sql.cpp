@@ -40,8 +40,14 @@ extern "C"
 #endif
 }
 
+#include <algorithm>
+#include <cstring>
+#include <functional>
 #include <string>
 #include <sstream>
+#include <map>
+#include <unordered_map>
+#include <vector>
 
 #include "gnc-sql-connection.hpp"
 #include "gnc-sql-backend.hpp"
@@ -63,6 +69,9 @@ typedef enum
     LIST
 } context_t;
 
+struct pending_slots_t;
+using PendingSlots = std::vector<pending_slots_t>;
+
 struct slot_info_t
 {
     GncSqlBackend* be;
@@ -75,8 +84,24 @@ struct slot_info_t
     KvpValue* pKvpValue;
     std::string path;
     std::string parent_path;
+    PendingSlots* pending;      /* if set, nested frames and lists are queued
+                                 * here instead of being read at once. */
+    GncSqlSavedSlots* saved;    /* if set, the guids of the frames and lists
+                                 * read or written are recorded here. */
+};
+
+/* A frame or list whose own slots haven't been read yet. */
+struct pending_slots_t
+{
+    std::string guid;           /* the obj_guid its slots are stored under */
+    slot_info_t* info;
+    std::string list_key;       /* for a list, its key in the parent frame */
+    bool is_list;
 };
 
+/* Number of guids looked up by each query when loading queued slots. */
+#define PENDING_SLOTS_CHUNK 500
+
 
 static  gpointer get_obj_guid (gpointer pObject);
 static void set_obj_guid (void);
@@ -100,6 +125,7 @@ static GDate* get_gdate_val (gpointer pObject);
 static void set_gdate_val (gpointer pObject, GDate* value);
 static slot_info_t* slot_info_copy (slot_info_t* pInfo, GncGUID* guid);
 static void slots_load_info (slot_info_t* pInfo);
+static void load_pending_slots (GncSqlBackend* sql_be, PendingSlots& pending);
 
 #define SLOT_MAX_PATHNAME_LEN 4096
 #define SLOT_MAX_STRINGVAL_LEN 4096
@@ -454,8 +480,19 @@ set_guid_val (gpointer pObject,  gpointer pValue)
         KvpValue* pValue = NULL;
         auto key = get_key (pInfo);
 
+        if (pInfo->saved != nullptr && pInfo->context != LIST)
+            pInfo->saved->frames[pInfo->path] = *newInfo->guid;
+        newInfo->saved = nullptr;
         newInfo->context = LIST;
 
+        if (pInfo->pending != nullptr)
+        {
+            /* The list's value is set once its items are loaded. */
+            newInfo->guid = nullptr;
+            pInfo->pending->push_back ({gnc::GUID{*(GncGUID*)pValue}.to_string(),
+                                        newInfo, key, true});
+            break;
+        }
         slots_load_info (newInfo);
         pValue = new KvpValue {newInfo->pList};
         pInfo->pKvpFrame->set ({key.c_str()}, pValue);
@@ -468,6 +505,9 @@ set_guid_val (gpointer pObject,  gpointer pValue)
         auto newFrame = new KvpFrame;
         newInfo->pKvpFrame = newFrame;
 
+        if (pInfo->saved != nullptr && pInfo->context != LIST)
+            pInfo->saved->frames[pInfo->path] = *newInfo->guid;
+
         switch (pInfo->context)
         {
         case LIST:
@@ -487,6 +527,13 @@ set_guid_val (gpointer pObject,  gpointer pValue)
         }
 
         newInfo->context = FRAME;
+        if (pInfo->pending != nullptr)
+        {
+            newInfo->guid = nullptr;
+            pInfo->pending->push_back ({gnc::GUID{*(GncGUID*)pValue}.to_string(),
+                                        newInfo, "", false});
+            break;
+        }
         slots_load_info (newInfo);
         delete newInfo;
         break;
@@ -570,6 +617,8 @@ slot_info_copy (slot_info_t* pInfo, GncGUID* guid)
     newSlot->pList = pInfo->pList;
     newSlot->context = pInfo->context;
     newSlot->pKvpValue = pInfo->pKvpValue;
+    newSlot->pending = pInfo->pending;
+    newSlot->saved = pInfo->saved;
     if (!pInfo->path.empty())
         newSlot->parent_path = pInfo->path + "/";
     else
@@ -597,6 +646,8 @@ save_slot (const char* key, KvpValue* value, slot_info_t & slot_info)
     {
         auto pKvpFrame = value->get<KvpFrame*> ();
         auto guid = guid_new ();
+        if (slot_info.saved != nullptr)
+            slot_info.saved->frames[slot_info.path] = *guid;
         slot_info_t* pNewInfo = slot_info_copy (&slot_info, guid);
         KvpValue* oldValue = slot_info.pKvpValue;
         slot_info.pKvpValue = new KvpValue {guid};
@@ -615,7 +666,10 @@ save_slot (const char* key, KvpValue* value, slot_info_t & slot_info)
     case KvpValue::Type::GLIST:
     {
         GncGUID* guid = guid_new ();
+        if (slot_info.saved != nullptr)
+            slot_info.saved->frames[slot_info.path] = *guid;
         slot_info_t* pNewInfo = slot_info_copy (&slot_info, guid);
+        pNewInfo->saved = nullptr;
         KvpValue* oldValue = slot_info.pKvpValue;
         slot_info.pKvpValue = new KvpValue {guid};  // Transfer ownership!
         slot_info.is_ok = slot_info.be->do_db_operation(OP_DB_INSERT,
@@ -646,6 +700,200 @@ save_slot (const char* key, KvpValue* value, slot_info_t & slot_info)
     }
 }
 
+/* An object's slots are saved by comparing them with the slots stored for
+ * it, as last loaded or saved, and writing only the differences. Scalars
+ * are updated in place, nested frames are compared slot by slot and lists
+ * are replaced whole if they differ. Objects whose stored slots aren't
+ * known, such as those saved before a failed commit, are rewritten.
+ */
+
+static std::string
+slot_row_condition (slot_info_t& slot_info, const std::string& path)
+{
+    return std::string{col_table[obj_guid_col]->name()} + "='" +
+        gnc::GUID{*slot_info.guid}.to_string() + "' AND " +
+        col_table[name_col]->name() + "=" + slot_info.be->quote_string (path);
+}
+
+/* Delete the stored slot at path in the frame slot_info is for, along with
+ * the rows of its frame or list. */
+static bool
+delete_saved_slot (slot_info_t& slot_info, const std::string& path)
+{
+    auto child = slot_info.saved->frames.find (path);
+    if (child != slot_info.saved->frames.end())
+    {
+        if (!gnc_sql_slots_delete (slot_info.be, &child->second))
+            return false;
+        slot_info.saved->frames.erase (child);
+    }
+
+    auto sql = std::string{"DELETE FROM " TABLE_NAME " WHERE "} +
+        slot_row_condition (slot_info, path);
+    auto stmt = slot_info.be->create_statement_from_sql(sql);
+    return stmt != nullptr &&
+        slot_info.be->execute_nonselect_statement (stmt) != -1;
+}
+
+static bool
+update_saved_slot (slot_info_t& slot_info)
+{
+    PairVec values;
+    for (auto const& table_row : col_table)
+        if (!table_row->is_autoincr())
+            table_row->add_to_query (TABLE_NAME, &slot_info, values);
+
+    std::string sql{"UPDATE " TABLE_NAME " SET "};
+    for (auto const& col_value : values)
+    {
+        if (&col_value != &values.front())
+            sql += ",";
+        sql += col_value.first + "=" + col_value.second;
+    }
+    sql += " WHERE " + slot_row_condition (slot_info, slot_info.path);
+    auto stmt = slot_info.be->create_statement_from_sql(sql);
+    return stmt != nullptr &&
+        slot_info.be->execute_nonselect_statement (stmt) != -1;
+}
+
+/* What is kept of a slot's value to tell whether it has changed. */
+static GncSqlSavedSlots::Value
+saved_slot_value (KvpValue* value)
+{
+    GncSqlSavedSlots::Value saved {value->get_type (), {0, 0}};
+    switch (saved.type)
+    {
+    case KvpValue::Type::INT64:
+        saved.value[0] = value->get<int64_t> ();
+        break;
+    case KvpValue::Type::DOUBLE:
+    {
+        auto d = value->get<double> ();
+        memcpy (&saved.value[0], &d, sizeof d);
+        break;
+    }
+    case KvpValue::Type::NUMERIC:
+    {
+        auto n = value->get<gnc_numeric> ();
+        saved.value[0] = n.num;
+        saved.value[1] = n.denom;
+        break;
+    }
+    case KvpValue::Type::STRING:
+    {
+        auto str = value->get<const char*> ();
+        saved.value[0] = std::hash<std::string>{} (str ? str : "");
+        break;
+    }
+    case KvpValue::Type::GUID:
+    {
+        auto guid = value->get<GncGUID*> ();
+        if (guid != nullptr)
+            memcpy (saved.value, guid->reserved, sizeof saved.value);
+        break;
+    }
+    case KvpValue::Type::TIME64:
+        saved.value[0] = value->get<Time64> ().t;
+        break;
+    case KvpValue::Type::GDATE:
+    {
+        auto date = value->get<GDate> ();
+        if (g_date_valid (&date))
+            saved.value[0] = g_date_get_julian (&date);
+        break;
+    }
+    case KvpValue::Type::GLIST:
+        saved.value[0] = std::hash<std::string>{} (value->to_string ());
+        break;
+    default:
+        break;
+    }
+    return saved;
+}
+
+static void
+save_slot_values (GncSqlSavedSlots* saved, KvpFrame* frame,
+                  const std::string& parent_path)
+{
+    frame->for_each_slot_temp ([&](const char* key, KvpValue* value) {
+        auto path = parent_path + key;
+        saved->values[path] = saved_slot_value (value);
+        if (value->get_type () == KvpValue::Type::FRAME)
+            save_slot_values (saved, value->get<KvpFrame*> (), path + "/");
+    });
+}
+
+/* Record frame as the slots stored for saved's object. */
+static void
+remember_slots (GncSqlSavedSlots* saved, KvpFrame* frame)
+{
+    saved->values.clear ();
+    save_slot_values (saved, frame, "");
+    saved->known = true;
+}
+
+/* Write the differences between frame and what is recorded as stored for
+ * it under slot_info.guid. */
+static void
+save_frame_changes (slot_info_t& slot_info, KvpFrame* frame)
+{
+    auto parent_path = slot_info.parent_path;
+    auto& values = slot_info.saved->values;
+    frame->for_each_slot_temp ([&](const char* key, KvpValue* value) {
+        if (!slot_info.is_ok)
+            return;
+        auto path = parent_path + key;
+        auto type = value->get_type ();
+        auto old = values.find (path);
+        if (old != values.end() && old->second.type == type)
+        {
+            auto child = slot_info.saved->frames.find (path);
+            if (type == KvpValue::Type::FRAME &&
+                child != slot_info.saved->frames.end())
+            {
+                slot_info_t child_info = slot_info;
+                child_info.guid = &child->second;
+                child_info.parent_path = path + "/";
+                save_frame_changes (child_info, value->get<KvpFrame*> ());
+                slot_info.is_ok = child_info.is_ok;
+                return;
+            }
+            if (type != KvpValue::Type::FRAME &&
+                old->second == saved_slot_value (value))
+                return;
+            if (type != KvpValue::Type::FRAME &&
+                type != KvpValue::Type::GLIST)
+            {
+                slot_info.pKvpValue = value;
+                slot_info.path = path;
+                slot_info.value_type = type;
+                slot_info.is_ok = update_saved_slot (slot_info);
+                return;
+            }
+        }
+        /* Lists are replaced whole, as are slots whose type has changed. */
+        if (old != values.end() && !delete_saved_slot (slot_info, path))
+        {
+            slot_info.is_ok = FALSE;
+            return;
+        }
+        save_slot (key, value, slot_info);
+    });
+
+    /* Whatever else was stored here has been removed from the frame. */
+    for (auto const& old : values)
+    {
+        if (!slot_info.is_ok)
+            break;
+        auto const& path = old.first;
+        if (path.compare (0, parent_path.size (), parent_path) != 0 ||
+            path.find ('/', parent_path.size ()) != std::string::npos)
+            continue;
+        if (frame->get_slot ({path.substr (parent_path.size ())}) == nullptr)
+            slot_info.is_ok = delete_saved_slot (slot_info, path);
+    }
+}
+
 gboolean
 gnc_sql_slots_save (GncSqlBackend* sql_be, const GncGUID* guid, gboolean is_infant,
                     QofInstance* inst)
@@ -658,16 +906,33 @@ gnc_sql_slots_save (GncSqlBackend* sql_be, const GncGUID* guid, gboolean is_infa
     g_return_val_if_fail (guid != NULL, FALSE);
     g_return_val_if_fail (pFrame != NULL, FALSE);
 
-    // If this is not saving into a new db, clear out the old saved slots first
-    if (!sql_be->pristine() && !is_infant)
-    {
-        (void)gnc_sql_slots_delete (sql_be, guid);
-    }
-
     slot_info.be = sql_be;
     slot_info.guid = guid;
-    pFrame->for_each_slot_temp (save_slot, slot_info);
+    auto key = gnc::GUID{*guid}.to_string();
+    auto& saved_slots = sql_be->saved_slots();
+    auto saved = saved_slots.find (key);
+    if (saved != saved_slots.end() && saved->second->known &&
+        !sql_be->pristine() && !is_infant)
+    {
+        // Write only what has changed since the slots were loaded or saved.
+        slot_info.saved = saved->second.get();
+        save_frame_changes (slot_info, pFrame);
+    }
+    else
+    {
+        // If this is not saving into a new db, clear out the old saved slots first
+        if (!sql_be->pristine() && !is_infant)
+            (void)gnc_sql_slots_delete (sql_be, guid);
+        auto& entry = saved_slots[key];
+        entry.reset (new GncSqlSavedSlots);
+        slot_info.saved = entry.get();
+        pFrame->for_each_slot_temp (save_slot, slot_info);
+    }
 
+    if (slot_info.is_ok)
+        remember_slots (slot_info.saved, pFrame);
+    else
+        saved_slots.erase (key);
     return slot_info.is_ok;
 }
 
@@ -709,6 +974,7 @@ gnc_sql_slots_delete (GncSqlBackend* sql_be, const GncGUID* guid)
         }
     }
 
+    sql_be->saved_slots().erase (guid_buf);
     slot_info.be = sql_be;
     slot_info.guid = guid;
     slot_info.is_ok = TRUE;
@@ -746,20 +1012,75 @@ load_slot (slot_info_t* pInfo, GncSqlRow& row)
     delete slot_info;
 }
 
+/* Load the frames and lists queued while loading other slots, reading each
+ * level of nesting with a few large queries rather than one per frame. The
+ * rows are ordered by id so that list items keep their order. */
+static void
+load_pending_slots (GncSqlBackend* sql_be, PendingSlots& pending)
+{
+    auto obj_guid_name = col_table[obj_guid_col]->name();
+    while (!pending.empty())
+    {
+        PendingSlots next;
+        std::unordered_map<std::string, slot_info_t*> by_guid;
+        for (auto& slots : pending)
+        {
+            slots.info->pending = &next;
+            by_guid.emplace (slots.guid, slots.info);
+        }
+
+        for (size_t first = 0; first < pending.size();
+             first += PENDING_SLOTS_CHUNK)
+        {
+            auto last = std::min (pending.size(), first + PENDING_SLOTS_CHUNK);
+            std::string sql ("SELECT * FROM " TABLE_NAME " WHERE obj_guid IN (");
+            for (auto i = first; i < last; ++i)
+            {
+                if (i != first)
+                    sql += ",";
+                sql += "'" + pending[i].guid + "'";
+            }
+            sql += ") ORDER BY obj_guid, id";
+            auto stmt = sql_be->create_statement_from_sql (sql);
+            if (stmt == nullptr)
+                continue;
+            auto result = sql_be->execute_select_statement (stmt);
+            if (result == nullptr)
+                continue;
+            for (auto row : *result)
+            {
+                try
+                {
+                    auto info = by_guid.find (row.get_string_at_col (obj_guid_name));
+                    if (info != by_guid.end())
+                        load_slot (info->second, row);
+                }
+                catch (std::invalid_argument&)
+                {
+                    continue;
+                }
+            }
+            delete result;
+        }
+
+        for (auto& slots : pending)
+        {
+            if (slots.is_list)
+                slots.info->pKvpFrame->set ({slots.list_key.c_str()},
+                                            new KvpValue {slots.info->pList});
+            delete slots.info;
+        }
+        pending.swap (next);
+    }
+}
+
 void
 gnc_sql_slots_load (GncSqlBackend* sql_be, QofInstance* inst)
 {
-    slot_info_t info = { NULL, NULL, TRUE, NULL, KvpValue::Type::INVALID,
-                         NULL, FRAME, NULL, "" };
     g_return_if_fail (sql_be != NULL);
     g_return_if_fail (inst != NULL);
 
-    info.be = sql_be;
-    info.guid = qof_instance_get_guid (inst);
-    info.pKvpFrame = qof_instance_get_slots (inst);
-    info.context = NONE;
-
-    slots_load_info (&info);
+    gnc_sql_slots_load_for_instancevec (sql_be, InstanceVec{inst});
 }
 
 static void
@@ -820,12 +1141,54 @@ load_slot_for_list_item (GncSqlBackend* sql_be, GncSqlRow& row,
 
 }
 
+/* The objects whose slots are being loaded, with where their stored slots
+ * are recorded, if they can be. */
+using LoadedSlots = std::unordered_map<QofInstance*, GncSqlSavedSlots*>;
+
+/* Note an object whose slots are being loaded. Slots already in its frame
+ * may not be stored, so the stored slots are only known if there are none. */
+static LoadedSlots::iterator
+add_loaded_slots (GncSqlBackend* sql_be, QofInstance* inst, LoadedSlots& loaded)
+{
+    auto seen = loaded.find (inst);
+    if (seen != loaded.end())
+        return seen;
+
+    GncSqlSavedSlots* saved = nullptr;
+    auto key = gnc::GUID{*qof_instance_get_guid (inst)}.to_string();
+    if (qof_instance_get_slots (inst)->empty())
+    {
+        auto& entry = sql_be->saved_slots()[key];
+        entry.reset (new GncSqlSavedSlots);
+        saved = entry.get();
+    }
+    else
+        sql_be->saved_slots().erase (key);
+    return loaded.emplace (inst, saved).first;
+}
+
 static void
-load_slot_for_book_object (GncSqlBackend* sql_be, GncSqlRow& row,
-                           BookLookupFn lookup_fn)
+load_slot_for_instance (GncSqlBackend* sql_be, GncSqlRow& row,
+                        QofInstance* inst, PendingSlots& pending,
+                        LoadedSlots& loaded)
 {
     slot_info_t slot_info = { NULL, NULL, TRUE, NULL, KvpValue::Type::INVALID,
                               NULL, FRAME, NULL, "" };
+
+    slot_info.be = sql_be;
+    slot_info.pKvpFrame = qof_instance_get_slots (inst);
+    slot_info.path.clear();
+    slot_info.pending = &pending;
+    slot_info.saved = add_loaded_slots (sql_be, inst, loaded)->second;
+
+    gnc_sql_load_object (sql_be, row, TABLE_NAME, &slot_info, col_table);
+}
+
+static void
+load_slot_for_book_object (GncSqlBackend* sql_be, GncSqlRow& row,
+                           BookLookupFn lookup_fn, PendingSlots& pending,
+                           LoadedSlots& loaded)
+{
     const GncGUID* guid;
     QofInstance* inst;
 
@@ -837,11 +1200,66 @@ load_slot_for_book_object (GncSqlBackend* sql_be, GncSqlRow& row,
     inst = lookup_fn (guid, sql_be->book());
     if (inst == NULL) return; /* Silently bail if the guid isn't loaded yet. */
 
-    slot_info.be = sql_be;
-    slot_info.pKvpFrame = qof_instance_get_slots (inst);
-    slot_info.path.clear();
+    load_slot_for_instance (sql_be, row, inst, pending, loaded);
+}
 
-    gnc_sql_load_object (sql_be, row, TABLE_NAME, &slot_info, col_table);
+/* Record what was loaded, to save only what changes. */
+static void
+save_loaded_slots (const LoadedSlots& loaded)
+{
+    for (auto const& inst_saved : loaded)
+        if (inst_saved.second != nullptr)
+            remember_slots (inst_saved.second,
+                            qof_instance_get_slots (inst_saved.first));
+}
+
+void
+gnc_sql_slots_load_for_instancevec (GncSqlBackend* sql_be,
+                                    const InstanceVec& instances)
+{
+    g_return_if_fail (sql_be != NULL);
+
+    if (instances.empty())
+        return;
+
+    /* The objects are all of one type, so each row's is in one collection. */
+    auto coll = qof_instance_get_collection (instances.front());
+    const std::string obj_guid_name (obj_guid_col_table[0]->name());
+    PendingSlots pending;
+    LoadedSlots loaded;
+    for (auto inst : instances)
+        add_loaded_slots (sql_be, inst, loaded);
+
+    for (size_t first = 0; first < instances.size();
+         first += PENDING_SLOTS_CHUNK)
+    {
+        auto last = std::min (instances.size(), first + PENDING_SLOTS_CHUNK);
+        std::string sql ("SELECT * FROM " TABLE_NAME " WHERE ");
+        sql += obj_guid_name + " IN (";
+        for (auto i = first; i < last; ++i)
+        {
+            if (i != first)
+                sql += ",";
+            sql += "'" + gnc::GUID{*qof_instance_get_guid (instances[i])}.to_string() + "'";
+        }
+        sql += ") ORDER BY " + obj_guid_name + ", id";
+        auto stmt = sql_be->create_statement_from_sql (sql);
+        if (stmt == nullptr)
+            continue;
+        auto result = sql_be->execute_select_statement (stmt);
+        if (result == nullptr)
+            continue;
+        for (auto row : *result)
+        {
+            auto inst = qof_collection_lookup_entity (coll,
+                                                      load_obj_guid (sql_be, row));
+            if (inst != nullptr)
+                load_slot_for_instance (sql_be, row, inst, pending, loaded);
+        }
+        delete result;
+    }
+    load_pending_slots (sql_be, pending);
+    save_loaded_slots (loaded);
 }
 
 /**
@@ -853,6 +1271,15 @@ load_slot_for_book_object (GncSqlBackend* sql_be, GncSqlRow& row,
  * @param subquery Subquery SQL string
  * @param lookup_fn Lookup function
  */
+std::string
+gnc_sql_slots_subquery_sql (const std::string& subquery)
+{
+    std::string pkey(obj_guid_col_table[0]->name());
+    std::string sql("SELECT * FROM " TABLE_NAME " WHERE ");
+    sql += pkey + " IN (" + subquery + ")";
+    return sql;
+}
+
 void gnc_sql_slots_load_for_sql_subquery (GncSqlBackend* sql_be,
                                           const std::string subquery,
                                           BookLookupFn lookup_fn)
@@ -862,9 +1289,7 @@ void gnc_sql_slots_load_for_sql_subquery (GncSqlBackend* sql_be,
     // Ignore empty subquery
     if (subquery.empty()) return;
 
-    std::string pkey(obj_guid_col_table[0]->name());
-    std::string sql("SELECT * FROM " TABLE_NAME " WHERE ");
-    sql += pkey + " IN (" + subquery + ")";
+    auto sql = gnc_sql_slots_subquery_sql (subquery);
 
     // Execute the query and load the slots
     auto stmt = sql_be->create_statement_from_sql(sql);
@@ -873,10 +1298,14 @@ void gnc_sql_slots_load_for_sql_subquery (GncSqlBackend* sql_be,
         PERR ("stmt == NULL, SQL = '%s'\n", sql.c_str());
         return;
     }
-    auto result = sql_be->execute_select_statement(stmt);
+    auto result = sql_be->execute_streaming_select_statement(stmt);
+    PendingSlots pending;
+    LoadedSlots loaded;
     for (auto row : *result)
-        load_slot_for_book_object (sql_be, row, lookup_fn);
+        load_slot_for_book_object (sql_be, row, lookup_fn, pending, loaded);
     delete result;
+    load_pending_slots (sql_be, pending);
+    save_loaded_slots (loaded);
 }
 
 /* ================================================================= */
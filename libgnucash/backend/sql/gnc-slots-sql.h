@@ -34,7 +34,13 @@ extern "C"
 #include "guid.h"
 #include "qof.h"
 }
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <kvp-frame.hpp>
 #include "gnc-sql-object-backend.hpp"
+#include "gnc-sql-column-table-entry.hpp"
 
 /**
  * Slots are neither loadable nor committable. Note that the default
@@ -49,6 +55,33 @@ public:
     bool commit(GncSqlBackend*, QofInstance*) override { return false; }
 };
 
+/**
+ * An object's slots as they are stored, kept by the backend so that saving
+ * the object writes only the slots that have changed since.
+ */
+struct GncSqlSavedSlots
+{
+    /** A stored slot: its type and value, or for a string or list a hash of
+     * it. Nothing is kept for a frame but its type. */
+    struct Value
+    {
+        KvpValue::Type type;
+        uint64_t value[2];
+        bool operator== (const Value& other) const noexcept
+        {
+            return type == other.type && value[0] == other.value[0] &&
+                value[1] == other.value[1];
+        }
+    };
+    /** False until the slots have been read or written. */
+    bool known = false;
+    /** The slots outside lists, by path. */
+    std::unordered_map<std::string, Value> values;
+    /** The obj_guid under which the rows of each FRAME or GLIST slot outside
+     * a list are stored, by path. */
+    std::unordered_map<std::string, GncGUID> frames;
+};
+
 /**
  * gnc_sql_slots_save - Saves slots for an object to the db.
  *
@@ -76,9 +109,25 @@ gboolean gnc_sql_slots_delete (GncSqlBackend* sql_be, const GncGUID* guid);
  */
 void gnc_sql_slots_load (GncSqlBackend* sql_be, QofInstance* inst);
 
+/**
+ * Loads slots for objects of one type from the db, with a query for each
+ * few hundred of them rather than one for each.
+ *
+ * @param sql_be SQL backend
+ * @param instances The objects
+ */
+void gnc_sql_slots_load_for_instancevec (GncSqlBackend* sql_be,
+                                         const InstanceVec& instances);
+
 typedef QofInstance* (*BookLookupFn) (const GncGUID* guid,
                                       const QofBook* book);
 
+/**
+ * The SELECT statement gnc_sql_slots_load_for_sql_subquery runs for a
+ * subquery.
+ */
+std::string gnc_sql_slots_subquery_sql (const std::string& subquery);
+
 /**
  * gnc_sql_slots_load_for_sql_subquery - Loads slots for all objects whose guid is
  * supplied by a subquery.  The subquery should be of the form "SELECT DISTINCT guid FROM ...".
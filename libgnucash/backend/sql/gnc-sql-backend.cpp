@@ -32,10 +32,14 @@ extern "C"
 #include <gncTaxTable.h>
 #include <gncInvoice.h>
 #include <gnc-pricedb.h>
+#include <TransLog.h>
+#include "qofquery-p.h"
+#include "qofquerycore-p.h"
 }
 
 #include <algorithm>
 #include <cassert>
+#include <thread>
 
 #include "gnc-sql-connection.hpp"
 #include "gnc-sql-backend.hpp"
@@ -70,6 +74,17 @@ static QofLogModule log_module = G_LOG_DOMAIN;
 #define TABLE_COL_NAME "table_name"
 #define VERSION_COL_NAME "table_version"
 
+/* Limits on the rows written by one INSERT while syncing. Old SQLite
+ * versions allow 500 rows in a VALUES clause and MySQL's
+ * max_allowed_packet used to default to 1MB.
+ */
+static const size_t BULK_INSERT_ROWS = 250;
+static const size_t BULK_INSERT_SIZE = 512 * 1024;
+
+/* At most this many reader connections fetch tables during the initial
+ * load. */
+static const unsigned int PREFETCH_READERS = 4;
+
 using StrVec = std::vector<std::string>;
 
 static EntryVec version_table
@@ -87,12 +102,25 @@ GncSqlBackend::GncSqlBackend(GncSqlConnection *conn, QofBook* book) :
         connect (conn);
 }
 
+GncSqlBackend::~GncSqlBackend()
+{
+    stop_write_behind();
+}
+
 void
 GncSqlBackend::connect(GncSqlConnection *conn) noexcept
 {
+    stop_write_behind();
     if (m_conn != nullptr && m_conn != conn)
         delete m_conn;
+    m_bulk_inserts.clear();
+    if (m_group_depth > 0)
+    {
+        m_group_depth = 0;
+        finish_group_commit (false);
+    }
     finalize_version_info();
+    m_saved_slots.clear();
     m_conn = conn;
 }
 
@@ -108,10 +136,62 @@ GncSqlBackend::create_statement_from_sql(const std::string& str) const noexcept
     return stmt;
 }
 
+/* Get the result of the statement if it was run ahead, or nullptr. */
+GncSqlResultPtr
+GncSqlBackend::take_prefetched(const GncSqlStatementPtr& stmt) const noexcept
+{
+    auto prefetched = m_prefetched.find (stmt->to_sql());
+    if (prefetched == m_prefetched.end())
+        return nullptr;
+    {
+        /* Let it run if it hasn't, and the few after it. */
+        std::lock_guard<std::mutex> lock (m_prefetch_mutex);
+        m_prefetch_window = std::max (m_prefetch_window,
+                                      prefetched->second.first + 1 +
+                                      m_readers.size());
+    }
+    m_prefetch_cv.notify_all();
+    GncSqlResultPtr result = nullptr;
+    try
+    {
+        result = prefetched->second.second.get();
+    }
+    catch (const std::exception& err)
+    {
+        PWARN ("Prefetching %s failed: %s", stmt->to_sql(), err.what());
+    }
+    m_prefetched.erase (prefetched);
+    return result;
+}
+
 GncSqlResultPtr
 GncSqlBackend::execute_select_statement(const GncSqlStatementPtr& stmt) const noexcept
 {
-    auto result = m_conn->execute_select_statement(stmt);
+    /* The query might be about rows still queued. */
+    flush_inserts();
+    write_through();
+    /* If prefetching failed, run it again here to report the error. */
+    auto result = take_prefetched (stmt);
+    if (result != nullptr)
+        return result;
+    result = m_conn->execute_select_statement(stmt);
+    if (result == nullptr)
+    {
+        PERR ("SQL error: %s\n", stmt->to_sql());
+        qof_backend_set_error ((QofBackend*)this, ERR_BACKEND_SERVER_ERR);
+    }
+    return result;
+}
+
+GncSqlResultPtr
+GncSqlBackend::execute_streaming_select_statement(const GncSqlStatementPtr& stmt) const noexcept
+{
+    flush_inserts();
+    write_through();
+    auto result = take_prefetched (stmt);
+    if (result != nullptr)
+        return result;
+    result = m_conn->execute_streaming_select_statement(stmt);
     if (result == nullptr)
     {
         PERR ("SQL error: %s\n", stmt->to_sql());
@@ -123,6 +203,13 @@ GncSqlBackend::execute_select_statement(const GncSqlStatementPtr& stmt) const no
 int
 GncSqlBackend::execute_nonselect_statement(const GncSqlStatementPtr& stmt) const noexcept
 {
+    flush_inserts();
+    if (m_queue_writes)
+    {
+        m_commit_writes.emplace_back (stmt->to_sql());
+        return 0;
+    }
+    wait_for_writes();
     auto result = m_conn->execute_nonselect_statement(stmt);
     if (result == -1)
     {
@@ -149,6 +236,7 @@ GncSqlBackend::create_table(const std::string& table_name,
     {
         table_row->add_to_table (info_vec);
     }
+    wait_for_writes();
     return m_conn->create_table (table_name, info_vec);
 
 }
@@ -167,6 +255,7 @@ GncSqlBackend::create_index(const std::string& index_name,
                             const std::string& table_name,
                             const EntryVec& col_table) const noexcept
 {
+    wait_for_writes();
     return m_conn->create_index(index_name, table_name, col_table);
 }
 
@@ -180,6 +269,7 @@ GncSqlBackend::add_columns_to_table(const std::string& table_name,
     {
         table_row->add_to_table (info_vec);
     }
+    wait_for_writes();
     return m_conn->add_columns_to_table(table_name, info_vec);
 }
 
@@ -271,6 +361,8 @@ GncSqlBackend::load (QofBook* book, QofBackendLoadType loadType)
 
     ENTER ("sql_be=%p, book=%p", this, book);
 
+    wait_for_writes();
+    report_writes();
     m_loading = TRUE;
 
     if (loadType == LOAD_TYPE_INITIAL_LOAD)
@@ -281,10 +373,54 @@ GncSqlBackend::load (QofBook* book, QofBackendLoadType loadType)
         auto num_types = m_backend_registry.size();
         auto num_done = 0;
 
+        /* Transactions can be left to load as they're queried, keeping at
+         * most the number given, if any, in memory. */
+        auto lazy = g_getenv ("GNC_SQL_LAZY_LOAD");
+        m_lazy_load = lazy != nullptr;
+        m_max_resident_tx = lazy ? strtoul (lazy, nullptr, 10) : 0;
+        m_all_tx_loaded = false;
+        m_loaded_lru.clear();
+
+        /* The tables that are read whole -- commodities, accounts, prices,
+         * lots, budgets, scheduled transactions, the business objects and
+         * their slots -- are read on other connections in the order they'll
+         * be loaded, while the objects are built from them here. Transactions
+         * and splits are streamed on this connection as they're built, so
+         * they aren't loaded any faster. */
+        StrVec queries;
+        auto is_fixed = [](const std::string& type) {
+            return std::find (fixed_load_order.begin(), fixed_load_order.end(),
+                              type) != fixed_load_order.end() ||
+                std::find (business_fixed_load_order.begin(),
+                           business_fixed_load_order.end(),
+                           type) != business_fixed_load_order.end();
+        };
+        auto add_queries = [&queries](GncSqlObjectBackendPtr obe) {
+            if (obe == nullptr)
+                return;
+            auto obe_queries = obe->load_all_queries();
+            queries.insert (queries.end(), obe_queries.begin(),
+                            obe_queries.end());
+        };
+        for (auto type : fixed_load_order)
+            add_queries (m_backend_registry.get_object_backend(type));
+        for (auto type : business_fixed_load_order)
+            add_queries (m_backend_registry.get_object_backend(type));
+        for (auto entry : m_backend_registry)
+            if (!is_fixed (std::get<0>(entry)))
+                add_queries (std::get<1>(entry));
+        start_prefetch (queries);
+
         /* Load any initial stuff. Some of this needs to happen in a certain order */
         for (auto type : fixed_load_order)
         {
             num_done++;
+            if (m_lazy_load && type == GNC_ID_TRANS)
+            {
+                update_progress(num_done * 100 / num_types);
+                gnc_sql_transaction_load_tx_in_lots (this);
+                continue;
+            }
             auto obe = m_backend_registry.get_object_backend(type);
             if (obe)
             {
@@ -307,16 +443,19 @@ GncSqlBackend::load (QofBook* book, QofBackendLoadType loadType)
         gnc_account_foreach_descendant(root, (AccountCb)xaccAccountBeginEdit,
                                        nullptr);
 
+        if (m_lazy_load)
+            gnc_sql_transaction_set_start_balances (this);
+
         m_backend_registry.load_remaining(this);
 
         gnc_account_foreach_descendant(root, (AccountCb)xaccAccountCommitEdit,
                                        nullptr);
+        finish_prefetch();
     }
     else if (loadType == LOAD_TYPE_LOAD_ALL)
     {
         // Load all transactions
-        auto obe = m_backend_registry.get_object_backend (GNC_ID_TRANS);
-        obe->load_all (this);
+        load_all_transactions ();
     }
 
     m_loading = FALSE;
@@ -333,9 +472,402 @@ GncSqlBackend::load (QofBook* book, QofBackendLoadType loadType)
     qof_book_mark_session_saved (book);
     finish_progress();
 
+    if (loadType == LOAD_TYPE_INITIAL_LOAD &&
+        g_getenv ("GNC_SQL_WRITE_BEHIND") != nullptr)
+        start_write_behind();
+
     LEAVE ("");
 }
 
+void
+GncSqlBackend::start_prefetch (const StrVec& queries) noexcept
+{
+    auto num_readers = std::min (PREFETCH_READERS,
+                                 std::max (std::thread::hardware_concurrency(),
+                                           2u));
+    while (m_readers.size() < num_readers && m_readers.size() < queries.size())
+    {
+        auto reader = m_conn->open_reader();
+        if (reader == nullptr)
+            break;
+        m_readers.push_back (reader);
+    }
+    if (m_readers.empty())
+        return;
+
+    /* Deal the queries out in turn so that the first ones are fetched
+     * first. */
+    struct Fetch
+    {
+        size_t index;
+        GncSqlStatementPtr stmt;
+        std::promise<GncSqlResultPtr> promise;
+    };
+    std::vector<std::vector<Fetch>> fetches (m_readers.size());
+    size_t index = 0;
+    for (auto const& sql : queries)
+    {
+        if (m_prefetched.count (sql))
+            continue;
+        auto next = index % m_readers.size();
+        auto stmt = m_readers[next]->create_statement_from_sql (sql);
+        if (stmt == nullptr)
+            continue;
+        std::promise<GncSqlResultPtr> promise;
+        m_prefetched.emplace (sql, std::make_pair (index,
+                                                   promise.get_future()));
+        fetches[next].push_back ({index++, std::move (stmt),
+                                  std::move (promise)});
+    }
+    m_prefetch_window = m_readers.size();
+    m_prefetch_stopped = false;
+
+    auto fetch_all = [this](GncSqlConnection* reader,
+                            std::vector<Fetch> fetches) {
+        for (auto& fetch : fetches)
+        {
+            std::unique_lock<std::mutex> lock (m_prefetch_mutex);
+            m_prefetch_cv.wait (lock, [this, &fetch]() {
+                    return fetch.index < m_prefetch_window ||
+                        m_prefetch_stopped; });
+            auto stopped = m_prefetch_stopped;
+            lock.unlock();
+            if (stopped)
+                fetch.promise.set_value (nullptr);
+            else
+                fetch.promise.set_value (
+                    reader->execute_select_statement (fetch.stmt));
+        }
+    };
+    for (size_t i = 0; i < m_readers.size(); ++i)
+    {
+        try
+        {
+            m_prefetchers.push_back (
+                std::async (std::launch::async, fetch_all, m_readers[i],
+                            std::move (fetches[i])));
+        }
+        catch (const std::system_error& err)
+        {
+            /* The promises are broken, so the queries run on m_conn. */
+            PWARN ("Unable to start reading tables ahead: %s", err.what());
+        }
+    }
+}
+
+void
+GncSqlBackend::finish_prefetch () noexcept
+{
+    {
+        /* Queries not run yet never will be. */
+        std::lock_guard<std::mutex> lock (m_prefetch_mutex);
+        m_prefetch_stopped = true;
+    }
+    m_prefetch_cv.notify_all();
+    for (auto& prefetched : m_prefetched)
+    {
+        try
+        {
+            delete prefetched.second.second.get();
+        }
+        catch (const std::exception&)
+        {
+        }
+    }
+    m_prefetched.clear();
+    /* Each waits for its thread to finish. */
+    m_prefetchers.clear();
+    for (auto reader : m_readers)
+        delete reader;
+    m_readers.clear();
+}
+
+/* ================================================================= */
+/* Lazy loading of transactions, enabled by setting GNC_SQL_LAZY_LOAD in the
+ * environment. A split or transaction query gets the transactions of the
+ * accounts it names, or failing that of the posted date range it restricts
+ * to, or failing both all of them.
+ */
+
+/* What a query needs loaded */
+struct QueryScope
+{
+    bool all = false;
+    std::vector<GncGUID> accounts;
+    std::vector<std::pair<time64, time64>> ranges;
+};
+
+static bool
+param_path_is (QofQueryParamList* path, const char* first, const char* second)
+{
+    if (path == nullptr || g_strcmp0 (static_cast<char*>(path->data), first))
+        return false;
+    path = path->next;
+    if (second == nullptr)
+        return path == nullptr;
+    return path != nullptr && path->next == nullptr &&
+        !g_strcmp0 (static_cast<char*>(path->data), second);
+}
+
+static void
+add_term_accounts (QofQueryTerm* term, std::vector<GncGUID>& accounts)
+{
+    auto pred_data = qof_query_term_get_pred_data (term);
+    if (g_strcmp0 (pred_data->type_name, QOF_TYPE_GUID))
+        return;
+    auto guid_data = reinterpret_cast<query_guid_t>(pred_data);
+    if (guid_data->options != QOF_GUID_MATCH_ANY)
+        return;
+    for (auto node = guid_data->guids; node; node = node->next)
+        accounts.push_back (*static_cast<GncGUID*>(node->data));
+}
+
+/* Narrow [start, end] to the dates a date term can match. */
+static bool
+narrow_term_range (QofQueryTerm* term, time64& start, time64& end)
+{
+    auto pred_data = qof_query_term_get_pred_data (term);
+    if (g_strcmp0 (pred_data->type_name, QOF_TYPE_DATE))
+        return false;
+    auto date_data = reinterpret_cast<query_date_t>(pred_data);
+    /* Wide enough to cover the canonical day time of any date. */
+    time64 slack = date_data->options == QOF_DATE_MATCH_DAY ? 2 * 86400 : 0;
+    switch (pred_data->how)
+    {
+    case QOF_COMPARE_LT:
+    case QOF_COMPARE_LTE:
+        end = std::min (end, date_data->date + slack);
+        return true;
+    case QOF_COMPARE_GT:
+    case QOF_COMPARE_GTE:
+        start = std::max (start, date_data->date - slack);
+        return true;
+    case QOF_COMPARE_EQUAL:
+        start = std::max (start, date_data->date - slack);
+        end = std::min (end, date_data->date + slack);
+        return true;
+    default:
+        return false;
+    }
+}
+
+static QueryScope
+query_scope (QofQuery* query)
+{
+    QueryScope scope;
+    bool for_splits = !g_strcmp0 (qof_query_get_search_for (query),
+                                  GNC_ID_SPLIT);
+    auto or_terms = qof_query_get_terms (query);
+    scope.all = or_terms == nullptr;
+    for (auto or_node = or_terms; or_node && !scope.all; or_node = or_node->next)
+    {
+        std::vector<GncGUID> accounts;
+        time64 start = INT64_MIN, end = INT64_MAX;
+        bool dated = false;
+        for (auto node = static_cast<GList*>(or_node->data); node;
+             node = node->next)
+        {
+            auto term = static_cast<QofQueryTerm*>(node->data);
+            if (qof_query_term_is_inverted (term))
+                continue;
+            auto path = qof_query_term_get_param_path (term);
+            if (for_splits && accounts.empty() &&
+                param_path_is (path, SPLIT_ACCOUNT, QOF_PARAM_GUID))
+                add_term_accounts (term, accounts);
+            else if (for_splits ?
+                     param_path_is (path, SPLIT_TRANS, TRANS_DATE_POSTED) :
+                     param_path_is (path, TRANS_DATE_POSTED, nullptr))
+                dated = narrow_term_range (term, start, end) || dated;
+        }
+        /* Each alternative must be narrowed down, or anything may match. */
+        if (!accounts.empty())
+            scope.accounts.insert (scope.accounts.end(), accounts.begin(),
+                                   accounts.end());
+        else if (dated)
+            scope.ranges.emplace_back (start, end);
+        else
+            scope.all = true;
+    }
+    return scope;
+}
+
+void
+GncSqlBackend::load_for_query (QofQuery* query)
+{
+    /* Once all transactions are loaded there's nothing more to load, but
+     * with a limit on them the next query may unload some again. */
+    if (!m_lazy_load || (m_all_tx_loaded && m_max_resident_tx == 0) ||
+        m_loading || m_in_query || m_book == nullptr)
+        return;
+    auto search_for = qof_query_get_search_for (query);
+    if (g_strcmp0 (search_for, GNC_ID_SPLIT) &&
+        g_strcmp0 (search_for, GNC_ID_TRANS))
+        return;
+
+    auto scope = query_scope (query);
+    ENTER ("query=%p, all=%d, accounts=%zu, ranges=%zu", query, scope.all,
+           scope.accounts.size(), scope.ranges.size());
+
+    /* The events of loaded and unloaded transactions are delivered when
+     * they're all done, and the queries run by their handlers don't load
+     * anything more. */
+    m_in_query = true;
+    m_balances.clear();
+    qof_event_begin_batch ();
+    xaccLogDisable ();
+    m_loading = true;
+    if (scope.all)
+    {
+        if (!m_all_tx_loaded)
+            PWARN ("Query isn't limited to some accounts or dates, loading all transactions");
+        load_all_transactions ();
+    }
+    for (auto const& guid : scope.accounts)
+        load_account_transactions (guid);
+    for (auto const& range : scope.ranges)
+        load_transactions_between (range.first, range.second);
+    /* What this query needs stays, whatever the limit. */
+    unload_least_recent ((scope.all ? 1 : 0) + scope.accounts.size() +
+                         scope.ranges.size());
+    m_loading = false;
+    xaccLogEnable ();
+    qof_event_end_batch ();
+    m_in_query = false;
+    LEAVE ("");
+}
+
+bool
+GncSqlBackend::get_account_balance (const QofInstance* account, time64 start,
+                                    time64 end, gnc_numeric* balance)
+{
+    if (!lazy_loading() || m_loading || m_book == nullptr)
+        return false;
+    auto guid = qof_instance_get_guid (account);
+    if (std::any_of (m_loaded_lru.begin(), m_loaded_lru.end(),
+                     [guid](const LoadedTransactions& loaded) {
+                         return loaded.kind ==
+                             LoadedTransactions::Kind::ACCOUNT &&
+                             guid_equal (guid, &loaded.account); }))
+        return false;
+
+    auto range = std::make_pair (start, end);
+    auto cached = m_balances.find (range);
+    if (cached == m_balances.end())
+    {
+        /* Callers such as the account tree ask for every account in turn. */
+        auto& balances = m_balances[range];
+        for (auto const& bal : gnc_sql_get_account_balances (this, start, end))
+            balances.emplace (QOF_INSTANCE (bal.acct), bal.balance);
+        cached = m_balances.find (range);
+    }
+    auto bal = cached->second.find (account);
+    *balance = bal == cached->second.end() ? gnc_numeric_zero() : bal->second;
+    return true;
+}
+
+bool
+GncSqlBackend::LoadedTransactions::holds(const Transaction* trans) const noexcept
+{
+    switch (kind)
+    {
+    case Kind::ACCOUNT:
+        for (auto node = xaccTransGetSplitList (trans); node; node = node->next)
+        {
+            auto acc = xaccSplitGetAccount (GNC_SPLIT (node->data));
+            if (acc && guid_equal (&account, qof_entity_get_guid (acc)))
+                return true;
+        }
+        return false;
+    case Kind::RANGE:
+    {
+        auto posted = xaccTransGetDate (trans);
+        return start <= posted && posted <= end;
+    }
+    default:
+        return true;
+    }
+}
+
+/* Move what matches to the front of the list. */
+bool
+GncSqlBackend::find_loaded(const std::function<bool(const LoadedTransactions&)>& match) noexcept
+{
+    auto loaded = std::find_if (m_loaded_lru.begin(), m_loaded_lru.end(),
+                                match);
+    if (loaded == m_loaded_lru.end())
+        return false;
+    m_loaded_lru.splice (m_loaded_lru.begin(), m_loaded_lru, loaded);
+    return true;
+}
+
+void
+GncSqlBackend::load_all_transactions() noexcept
+{
+    if (find_loaded ([](const LoadedTransactions& loaded) {
+                return loaded.kind == LoadedTransactions::Kind::ALL; }))
+        return;
+    auto obe = m_backend_registry.get_object_backend (GNC_ID_TRANS);
+    obe->load_all (this);
+    m_all_tx_loaded = true;
+    m_loaded_lru.push_front ({LoadedTransactions::Kind::ALL, *guid_null(),
+                              INT64_MIN, INT64_MAX});
+}
+
+void
+GncSqlBackend::load_account_transactions(const GncGUID& guid) noexcept
+{
+    if (find_loaded ([&guid](const LoadedTransactions& loaded) {
+                return loaded.kind == LoadedTransactions::Kind::ACCOUNT &&
+                    guid_equal (&guid, &loaded.account); }))
+        return;
+    auto acc = xaccAccountLookup (&guid, m_book);
+    if (acc == nullptr)
+        return;
+    if (!m_all_tx_loaded)
+        gnc_sql_transaction_load_tx_for_account (this, acc);
+    m_loaded_lru.push_front ({LoadedTransactions::Kind::ACCOUNT, guid,
+                              INT64_MIN, INT64_MAX});
+}
+
+void
+GncSqlBackend::load_transactions_between(time64 start, time64 end) noexcept
+{
+    if (find_loaded ([start, end](const LoadedTransactions& loaded) {
+                return loaded.kind == LoadedTransactions::Kind::RANGE &&
+                    loaded.start <= start && end <= loaded.end; }))
+        return;
+    if (!m_all_tx_loaded)
+        gnc_sql_transaction_load_tx_between (this, start, end);
+    m_loaded_lru.push_front ({LoadedTransactions::Kind::RANGE, *guid_null(),
+                              start, end});
+}
+
+void
+GncSqlBackend::unload_least_recent(size_t keep) noexcept
+{
+    if (m_max_resident_tx == 0)
+        return;
+
+    auto coll = qof_book_get_collection (m_book, GNC_ID_TRANS);
+    while (qof_collection_count (coll) > m_max_resident_tx &&
+           m_loaded_lru.size() > keep)
+    {
+        auto evicted = m_loaded_lru.back();
+        m_loaded_lru.pop_back();
+        if (evicted.kind == LoadedTransactions::Kind::ALL)
+            m_all_tx_loaded = false;
+        /* Transactions that something still loaded holds on to stay. */
+        auto count = gnc_sql_transaction_unload_tx (this,
+            [this, &evicted](const Transaction* trans) {
+                return evicted.holds (trans) &&
+                    std::none_of (m_loaded_lru.begin(), m_loaded_lru.end(),
+                                  [trans](const LoadedTransactions& loaded) {
+                                      return loaded.holds (trans); });
+            });
+        DEBUG ("Unloaded %u transactions", count);
+    }
+}
+
 /* ================================================================= */
 
 bool
@@ -378,10 +910,21 @@ GncSqlBackend::write_accounts()
     return is_ok;
 }
 
+/* write_objects_t plus the number of transactions written and to write,
+ * for the progress bar. A total of 0 just pulses it.
+ */
+struct write_tx_t
+{
+    write_objects_t objects;
+    unsigned int done;
+    unsigned int total;
+};
+
 static gboolean // Can't be bool because of signature for xaccAccountTreeForEach
 write_tx (Transaction* tx, gpointer data)
 {
-    auto s = static_cast<write_objects_t*>(data);
+    auto w = static_cast<write_tx_t*>(data);
+    auto s = &w->objects;
 
     g_return_val_if_fail (tx != NULL, 0);
     g_return_val_if_fail (data != NULL, 0);
@@ -394,7 +937,11 @@ write_tx (Transaction* tx, gpointer data)
     {
         s->is_ok = splitbe->commit(s->be, QOF_INSTANCE(split_node->data));
     }
-    s->be->update_progress (101.0);
+    ++w->done;
+    if (w->total > 0 && w->done <= w->total)
+        s->be->update_progress (w->done * 100.0 / w->total);
+    else
+        s->be->update_progress (101.0);
     return (s->is_ok ? 0 : 1);
 }
 
@@ -402,19 +949,20 @@ bool
 GncSqlBackend::write_transactions()
 {
     auto obe = m_backend_registry.get_object_backend(GNC_ID_TRANS);
-    write_objects_t data{this, TRUE, obe.get()};
+    auto coll = qof_book_get_collection (m_book, GNC_ID_TRANS);
+    write_tx_t data{{this, TRUE, obe.get()}, 0, qof_collection_count (coll)};
 
     (void)xaccAccountTreeForEachTransaction (
         gnc_book_get_root_account (m_book), write_tx, &data);
     update_progress(101.0);
-    return data.is_ok;
+    return data.objects.is_ok;
 }
 
 bool
 GncSqlBackend::write_template_transactions()
 {
     auto obe = m_backend_registry.get_object_backend(GNC_ID_TRANS);
-    write_objects_t data{this, true, obe.get()};
+    write_tx_t data{{this, true, obe.get()}, 0, 0};
     auto ra = gnc_book_get_template_root (m_book);
     if (gnc_account_n_descendants (ra) > 0)
     {
@@ -422,7 +970,7 @@ GncSqlBackend::write_template_transactions()
         update_progress(101.0);
     }
 
-    return data.is_ok;
+    return data.objects.is_ok;
 }
 
 bool
@@ -452,6 +1000,8 @@ GncSqlBackend::sync(QofBook* book)
 {
     g_return_if_fail (book != NULL);
 
+    wait_for_writes();
+    report_writes();
     reset_version_info();
     ENTER ("book=%p, sql_be->book=%p", book, m_book);
     update_progress(101.0);
@@ -462,7 +1012,11 @@ GncSqlBackend::sync(QofBook* book)
 
     /* Save all contents */
     m_book = book;
+    m_saved_commodities.clear();
+    m_saved_slots.clear();
     auto is_ok = m_conn->begin_transaction();
+    /* Every row is new, so queue the inserts and write them in bulk. */
+    m_bulk_write = true;
 
     // FIXME: should write the set of commodities that are used
     // write_commodities(sql_be, book);
@@ -493,6 +1047,13 @@ GncSqlBackend::sync(QofBook* book)
             std::get<1>(entry)->write (this);
     }
     if (is_ok)
+    {
+        is_ok = flush_inserts();
+    }
+    m_bulk_write = false;
+    m_bulk_inserts.clear();
+    m_saved_commodities.clear();
+    if (is_ok)
     {
         is_ok = m_conn->commit_transaction();
     }
@@ -509,6 +1070,7 @@ GncSqlBackend::sync(QofBook* book)
     {
         set_error (ERR_BACKEND_SERVER_ERR);
         m_conn->rollback_transaction ();
+        m_saved_slots.clear();
     }
     finish_progress();
     LEAVE ("book=%p", book);
@@ -564,7 +1126,9 @@ GncSqlBackend::commit (QofInstance* inst)
     if (qof_book_is_readonly(m_book))
     {
         set_error (ERR_BACKEND_READONLY);
-        (void)m_conn->rollback_transaction ();
+        wait_for_writes();
+        if (!m_group_open)
+            (void)m_conn->rollback_transaction ();
         return;
     }
     /* During initial load where objects are being created, don't commit
@@ -574,6 +1138,8 @@ GncSqlBackend::commit (QofInstance* inst)
         qof_instance_mark_clean (inst);
         return;
     }
+    m_balances.clear();
+    report_writes();
 
     // The engine has a PriceDB object but it isn't in the database
     if (strcmp (inst->e_type, "PriceDB") == 0)
@@ -599,7 +1165,13 @@ GncSqlBackend::commit (QofInstance* inst)
         return;
     }
 
-    if (!m_conn->begin_transaction ())
+    if (is_destroying && GNC_IS_COMMODITY (inst))
+        m_saved_commodities.erase (GNC_COMMODITY (inst));
+
+    /* Inside a group the group's transaction is used as it is. */
+    m_queue_writes = m_writer.joinable() && !m_group_open;
+    m_write_through_failed = false;
+    if (!m_queue_writes && !m_conn->begin_transaction ())
     {
         PERR ("begin_transaction failed\n");
         LEAVE ("Rolled back - database transaction begin error");
@@ -610,10 +1182,12 @@ GncSqlBackend::commit (QofInstance* inst)
 
     auto obe = m_backend_registry.get_object_backend(std::string{inst->e_type});
     if (obe != nullptr)
-        is_ok = obe->commit(this, inst);
+        is_ok = obe->commit(this, inst) && !m_write_through_failed;
     else
     {
         PERR ("Unknown object type '%s'\n", inst->e_type);
+        m_queue_writes = false;
+        m_commit_writes.clear();
         (void)m_conn->rollback_transaction ();
 
         // Don't let unknown items still mark the book as being dirty
@@ -622,24 +1196,272 @@ GncSqlBackend::commit (QofInstance* inst)
         LEAVE ("Rolled back - unknown object type");
         return;
     }
-    if (!is_ok)
+    if (m_queue_writes)
+    {
+        m_queue_writes = false;
+        if (!is_ok)
+        {
+            // Nothing has been written; this *should* leave things dirty.
+            m_commit_writes.clear();
+            m_saved_slots.clear();
+            LEAVE ("Not queued - database error");
+            return;
+        }
+        WriteBehind writes{std::move (m_commit_writes), is_destroying ?
+                nullptr : QOF_INSTANCE (g_object_ref (inst))};
+        m_commit_writes.clear();
+        {
+            std::lock_guard<std::mutex> lock{m_writes_mutex};
+            m_writes.push_back (std::move (writes));
+        }
+        m_writes_cond.notify_all();
+    }
+    else if (!is_ok)
     {
         // Error - roll it back
         (void)m_conn->rollback_transaction();
+        m_saved_slots.clear();
 
         // This *should* leave things marked dirty
         LEAVE ("Rolled back - database error");
         return;
     }
+    else
+        (void)m_conn->commit_transaction ();
 
-    (void)m_conn->commit_transaction ();
-
-    qof_book_mark_session_saved(m_book);
     qof_instance_mark_clean (inst);
+    /* Inside a group the instance isn't saved until the group's transaction
+     * is committed. A destroyed instance can't be marked dirty again if it
+     * isn't, so it isn't kept. */
+    if (!m_group_open)
+        qof_book_mark_session_saved(m_book);
+    else if (!is_destroying)
+        m_group_committed.push_back (QOF_INSTANCE (g_object_ref (inst)));
 
     LEAVE ("");
 }
 
+void
+GncSqlBackend::begin_group_commit()
+{
+    if (m_group_depth++ > 0)
+        return;
+
+    m_group_failed = false;
+    wait_for_writes();
+    m_group_open = m_conn != nullptr && !m_loading &&
+        !qof_book_is_readonly (m_book) && m_conn->begin_transaction ();
+    if (!m_group_open)
+        PWARN ("No group transaction, committing objects one by one");
+}
+
+bool
+GncSqlBackend::end_group_commit()
+{
+    if (m_group_depth == 0)
+    {
+        PWARN ("No group commit to end");
+        return true;
+    }
+    if (--m_group_depth > 0)
+        return true;
+    if (!m_group_open)
+        return !m_group_failed;
+
+    if (!m_group_failed)
+    {
+        if (m_conn->commit_transaction ())
+        {
+            finish_group_commit (true);
+            return true;
+        }
+        PERR ("Group commit failed, rolling back\n");
+        set_error (ERR_BACKEND_SERVER_ERR);
+    }
+    (void)m_conn->rollback_transaction ();
+    finish_group_commit (false);
+    return false;
+}
+
+void
+GncSqlBackend::rollback_group_commit()
+{
+    /* Nested groups can't be rolled back alone, so the whole group is. */
+    m_group_failed = true;
+    (void)end_group_commit ();
+}
+
+void
+GncSqlBackend::finish_group_commit (bool committed) noexcept
+{
+    for (auto inst : m_group_committed)
+    {
+        if (!committed)
+            qof_instance_set_dirty (inst);
+        g_object_unref (inst);
+    }
+    if (!committed)
+        m_saved_slots.clear();
+    if (committed && !m_group_committed.empty())
+        qof_book_mark_session_saved (m_book);
+    else if (!committed && !m_group_committed.empty())
+        qof_book_mark_session_dirty (m_book);
+    m_group_committed.clear();
+    m_group_open = false;
+}
+
+
+void
+GncSqlBackend::start_write_behind() noexcept
+{
+    if (m_writer.joinable())
+        return;
+    m_writer_conn = m_conn->open_reader();
+    if (m_writer_conn == nullptr)
+    {
+        PWARN ("No connection to write behind on, committing synchronously");
+        return;
+    }
+    m_stop_writer = false;
+    m_writer = std::thread{&GncSqlBackend::write_behind, this};
+}
+
+void
+GncSqlBackend::stop_write_behind() noexcept
+{
+    if (!m_writer.joinable())
+        return;
+    {
+        std::lock_guard<std::mutex> lock{m_writes_mutex};
+        m_stop_writer = true;
+    }
+    m_writes_cond.notify_all();
+    m_writer.join();
+    delete m_writer_conn;
+    m_writer_conn = nullptr;
+    m_saved_commodities.clear();
+    report_writes();
+}
+
+/* The worker: run the queued commits in order until told to stop, and
+ * then run whatever is left. */
+void
+GncSqlBackend::write_behind() noexcept
+{
+    std::unique_lock<std::mutex> lock{m_writes_mutex};
+    while (true)
+    {
+        m_writes_cond.wait (lock, [this]{
+                return !m_writes.empty() || m_stop_writer; });
+        if (m_writes.empty())
+            return;
+        auto writes = std::move (m_writes.front());
+        m_writes.pop_front();
+        m_writing = true;
+        lock.unlock();
+        auto error = run_writes (writes);
+        lock.lock();
+        m_written.emplace_back (writes.inst, error);
+        m_writing = false;
+        m_writes_cond.notify_all();
+    }
+}
+
+/* Runs on the worker, so it mustn't touch the backend: what went wrong is
+ * returned for report_writes to set. */
+QofBackendError
+GncSqlBackend::run_writes (const WriteBehind& writes) noexcept
+{
+    if (!m_writer_conn->begin_transaction ())
+        return ERR_BACKEND_SERVER_ERR;
+    for (auto const& sql : writes.sql)
+    {
+        auto stmt = m_writer_conn->create_statement_from_sql (sql);
+        if (m_writer_conn->execute_nonselect_statement (stmt) == -1)
+        {
+            PERR ("SQL error: %s\n", sql.c_str());
+            (void)m_writer_conn->rollback_transaction ();
+            return ERR_BACKEND_SERVER_ERR;
+        }
+    }
+    if (!m_writer_conn->commit_transaction ())
+        return ERR_BACKEND_SERVER_ERR;
+    return ERR_BACKEND_NO_ERR;
+}
+
+void
+GncSqlBackend::wait_for_writes() const noexcept
+{
+    if (!m_writer.joinable())
+        return;
+    std::unique_lock<std::mutex> lock{m_writes_mutex};
+    m_writes_cond.wait (lock, [this]{ return m_writes.empty() && !m_writing; });
+}
+
+/* The commit in progress has to read the database, so write what it has
+ * queued and do the rest of it synchronously. */
+void
+GncSqlBackend::write_through() const noexcept
+{
+    if (!m_queue_writes)
+    {
+        wait_for_writes();
+        return;
+    }
+    m_queue_writes = false;
+    wait_for_writes();
+    if (!m_conn->begin_transaction ())
+    {
+        m_write_through_failed = true;
+        m_commit_writes.clear();
+        return;
+    }
+    for (auto const& sql : m_commit_writes)
+    {
+        auto stmt = m_conn->create_statement_from_sql (sql);
+        if (m_conn->execute_nonselect_statement (stmt) == -1)
+        {
+            PERR ("SQL error: %s\n", sql.c_str());
+            qof_backend_set_error ((QofBackend*)this, ERR_BACKEND_SERVER_ERR);
+            m_write_through_failed = true;
+            break;
+        }
+    }
+    m_commit_writes.clear();
+}
+
+/* Commits that failed behind our back leave their instances and the book
+ * dirty again, as a failed commit would have. */
+void
+GncSqlBackend::report_writes() noexcept
+{
+    std::vector<std::pair<QofInstance*, QofBackendError>> written;
+    {
+        std::lock_guard<std::mutex> lock{m_writes_mutex};
+        written.swap (m_written);
+    }
+    auto error = ERR_BACKEND_NO_ERR;
+    for (auto const& commit : written)
+    {
+        if (commit.second != ERR_BACKEND_NO_ERR)
+        {
+            if (error == ERR_BACKEND_NO_ERR)
+                error = commit.second;
+            if (commit.first != nullptr)
+                qof_instance_set_dirty (commit.first);
+        }
+        if (commit.first != nullptr)
+            g_object_unref (commit.first);
+    }
+    if (error != ERR_BACKEND_NO_ERR)
+    {
+        PERR ("Writing a commit behind failed\n");
+        set_error (error);
+        m_saved_slots.clear();
+        if (m_book != nullptr)
+            qof_book_mark_session_dirty (m_book);
+    }
+}
 
 /**
  * Sees if the version table exists, and if it does, loads the info into
@@ -839,6 +1661,9 @@ GncSqlBackend::do_db_operation (E_DB_OPERATION op, const char* table_name,
     g_return_val_if_fail (obj_name != nullptr, false);
     g_return_val_if_fail (pObject != nullptr, false);
 
+    if (op == OP_DB_INSERT && m_bulk_write)
+        return queue_insert (table_name, obj_name, pObject, table);
+
     switch(op)
     {
         case  OP_DB_INSERT:
@@ -856,15 +1681,98 @@ GncSqlBackend::do_db_operation (E_DB_OPERATION op, const char* table_name,
     return (execute_nonselect_statement(stmt) != -1);
 }
 
+bool
+GncSqlBackend::queue_insert (const char* table_name, QofIdTypeConst obj_name,
+                             gpointer pObject,
+                             const EntryVec& table) const noexcept
+{
+    PairVec values{get_object_values(obj_name, pObject, table)};
+    auto tmpl = m_conn->get_statement_template (OP_DB_INSERT, table_name,
+                                                values);
+    if (tmpl == nullptr)
+    {
+        PERR ("SQL error making statement for %s\n", table_name);
+        qof_backend_set_error ((QofBackend*)this, ERR_BACKEND_SERVER_ERR);
+        return false;
+    }
+
+    /* Rows with different columns (null values are left out) can't share
+     * an INSERT, so rows are queued by statement template. */
+    auto insert = std::find_if (m_bulk_inserts.begin(), m_bulk_inserts.end(),
+                                [tmpl](const BulkInsert& i) {
+                                    return i.stmt == tmpl; });
+    if (insert == m_bulk_inserts.end())
+        insert = m_bulk_inserts.insert (m_bulk_inserts.end(),
+                                        BulkInsert{tmpl, {}, 0});
+    for (auto const& col_value : values)
+        insert->size += col_value.second.size() + 1;
+    insert->rows.push_back (std::move (values));
+    if (insert->rows.size() < BULK_INSERT_ROWS &&
+        insert->size < BULK_INSERT_SIZE)
+        return true;
+    return flush_insert (*insert);
+}
+
+bool
+GncSqlBackend::flush_insert (BulkInsert& insert) const noexcept
+{
+    if (insert.rows.empty())
+        return true;
+    auto stmt = insert.stmt->bind (insert.rows);
+    insert.rows.clear();
+    insert.size = 0;
+    if (stmt == nullptr || m_conn->execute_nonselect_statement (stmt) == -1)
+    {
+        PERR ("SQL error: %s\n", stmt ? stmt->to_sql() : "bulk insert");
+        qof_backend_set_error ((QofBackend*)this, ERR_BACKEND_SERVER_ERR);
+        return false;
+    }
+    return true;
+}
+
+bool
+GncSqlBackend::flush_inserts () const noexcept
+{
+    bool is_ok = true;
+    for (auto& insert : m_bulk_inserts)
+        is_ok = flush_insert (insert) && is_ok;
+    return is_ok;
+}
+
 bool
 GncSqlBackend::save_commodity(gnc_commodity* comm) noexcept
 {
     if (comm == nullptr) return false;
     QofInstance* inst = QOF_INSTANCE(comm);
     auto obe = m_backend_registry.get_object_backend(std::string(inst->e_type));
-    if (obe && !obe->instance_in_db(this, inst))
-        return obe->commit(this, inst);
-    return true;
+    if (!obe)
+        return true;
+    /* A pristine database changes only through us, so once a commodity is
+     * known to be in it there's no need to ask again. Neither is there while
+     * writing behind, when asking would make the commit wait for the
+     * writer; the database is locked and a deleted commodity is forgotten. */
+    auto cache = m_is_pristine_db || m_writer.joinable();
+    if (cache &&
+        m_saved_commodities.find (comm) != m_saved_commodities.end())
+        return true;
+    auto is_ok = obe->instance_in_db(this, inst) || obe->commit(this, inst);
+    if (is_ok && cache)
+        m_saved_commodities.insert (comm);
+    return is_ok;
+}
+
+GncSqlStatementPtr
+GncSqlBackend::bind_statement (E_DB_OPERATION op, const char* table_name,
+                               const PairVec& values) const noexcept
+{
+    auto tmpl = m_conn->get_statement_template (op, table_name, values);
+    if (tmpl == nullptr)
+    {
+        PERR ("SQL error making statement for %s\n", table_name);
+        qof_backend_set_error ((QofBackend*)this, ERR_BACKEND_SERVER_ERR);
+        return nullptr;
+    }
+    return tmpl->bind (values);
 }
 
 GncSqlStatementPtr
@@ -873,34 +1781,12 @@ GncSqlBackend::build_insert_statement (const char* table_name,
                                        gpointer pObject,
                                        const EntryVec& table) const noexcept
 {
-    GncSqlStatementPtr stmt;
-    PairVec col_values;
-    std::ostringstream sql;
-
     g_return_val_if_fail (table_name != nullptr, nullptr);
     g_return_val_if_fail (obj_name != nullptr, nullptr);
     g_return_val_if_fail (pObject != nullptr, nullptr);
     PairVec values{get_object_values(obj_name, pObject, table)};
 
-    sql << "INSERT INTO " << table_name <<"(";
-    for (auto const& col_value : values)
-    {
-        if (col_value != *values.begin())
-            sql << ",";
-        sql << col_value.first;
-    }
-
-    sql << ") VALUES(";
-    for (auto col_value : values)
-    {
-        if (col_value != *values.begin())
-            sql << ",";
-        sql << col_value.second;
-    }
-    sql << ")";
-
-    stmt = create_statement_from_sql(sql.str());
-    return stmt;
+    return bind_statement (OP_DB_INSERT, table_name, values);
 }
 
 GncSqlStatementPtr
@@ -908,34 +1794,16 @@ GncSqlBackend::build_update_statement(const gchar* table_name,
                                       QofIdTypeConst obj_name, gpointer pObject,
                                       const EntryVec& table) const noexcept
 {
-    GncSqlStatementPtr stmt;
-    std::ostringstream sql;
-
     g_return_val_if_fail (table_name != nullptr, nullptr);
     g_return_val_if_fail (obj_name != nullptr, nullptr);
     g_return_val_if_fail (pObject != nullptr, nullptr);
 
-
+    /* The statement's where condition is the first column and value,
+     * i.e. the guid of the object.
+     */
     PairVec values{get_object_values (obj_name, pObject, table)};
 
-    // Create the SQL statement
-    sql <<  "UPDATE " << table_name << " SET ";
-
-    for (auto const& col_value : values)
-    {
-        if (col_value != *values.begin())
-            sql << ",";
-        sql << col_value.first << "=" <<
-            col_value.second;
-    }
-
-    stmt = create_statement_from_sql(sql.str());
-    /* We want our where condition to be just the first column and
-     * value, i.e. the guid of the object.
-     */
-    values.erase(values.begin() + 1, values.end());
-    stmt->add_where_cond(obj_name, values);
-    return stmt;
+    return bind_statement (OP_DB_UPDATE, table_name, values);
 }
 
 GncSqlStatementPtr
@@ -944,22 +1812,18 @@ GncSqlBackend::build_delete_statement(const gchar* table_name,
                                       gpointer pObject,
                                       const EntryVec& table) const noexcept
 {
-    std::ostringstream sql;
-
     g_return_val_if_fail (table_name != nullptr, nullptr);
     g_return_val_if_fail (obj_name != nullptr, nullptr);
     g_return_val_if_fail (pObject != nullptr, nullptr);
 
-    sql << "DELETE FROM " << table_name;
-    auto stmt = create_statement_from_sql (sql.str());
-
     /* WHERE */
     PairVec values;
     table[0]->add_to_query (obj_name, pObject, values);
-    PairVec col_values{values[0]};
-    stmt->add_where_cond (obj_name, col_values);
+    if (values.empty())
+        return nullptr;
+    values.resize (1);
 
-    return stmt;
+    return bind_statement (OP_DB_DELETE, table_name, values);
 }
 
 GncSqlBackend::ObjectBackendRegistry::ObjectBackendRegistry()
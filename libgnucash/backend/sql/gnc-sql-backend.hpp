@@ -30,10 +30,21 @@ extern "C"
 #include <Account.h>
 }
 #include <memory>
+#include <condition_variable>
+#include <deque>
 #include <exception>
+#include <functional>
+#include <future>
+#include <list>
+#include <map>
+#include <mutex>
 #include <sstream>
+#include <thread>
 #include <vector>
+#include <unordered_map>
+#include <unordered_set>
 #include <qof-backend.hpp>
+#include "gnc-sql-connection.hpp"
 
 class GncSqlColumnTableEntry;
 using GncSqlColumnTableEntryPtr = std::shared_ptr<GncSqlColumnTableEntry>;
@@ -50,13 +61,9 @@ using GncSqlResultPtr = GncSqlResult*;
 using VersionPair = std::pair<const std::string, unsigned int>;
 using VersionVec = std::vector<VersionPair>;
 using uint_t = unsigned int;
-
-typedef enum
-{
-    OP_DB_INSERT,
-    OP_DB_UPDATE,
-    OP_DB_DELETE
-} E_DB_OPERATION;
+struct GncSqlSavedSlots;
+using SavedSlotsMap = std::unordered_map<std::string,
+                                         std::unique_ptr<GncSqlSavedSlots>>;
 
 /**
  *
@@ -66,13 +73,36 @@ class GncSqlBackend : public QofBackend
 {
 public:
     GncSqlBackend(GncSqlConnection *conn, QofBook* book);
-    virtual ~GncSqlBackend() = default;
+    virtual ~GncSqlBackend();
     /**
      * Load the contents of an SQL database into a book.
      *
      * @param book Book to be loaded
      */
     void load(QofBook*, QofBackendLoadType) override;
+    /**
+     * Load the transactions a query might match, if transactions are being
+     * loaded lazily.
+     *
+     * @param query The query about to be run
+     */
+    void load_for_query(QofQuery*) override;
+    /**
+     * Whether some transactions may be in the database but not in memory.
+     */
+    bool lazy_loading() const noexcept { return m_lazy_load && !m_all_tx_loaded; }
+    /**
+     * Get the balance of an account from the database if its transactions
+     * might not all be loaded.
+     *
+     * @param account The account
+     * @param start Sum the splits of transactions posted on or after this
+     * @param end and before this
+     * @param balance Set to the sum
+     * @return false if the account's splits are all in memory
+     */
+    bool get_account_balance(const QofInstance* account, time64 start,
+                             time64 end, gnc_numeric* balance) override;
     /**
      * Save the contents of a book to an SQL database.
      *
@@ -97,6 +127,21 @@ public:
      * @param inst Object being edited
      */
     void rollback(QofInstance*) override;
+    /**
+     * Start a group commit: the commits until the matching end_group_commit()
+     * share one database transaction instead of each having its own.
+     */
+    void begin_group_commit() override;
+    /**
+     * Commit the group's database transaction, or roll it back if that fails.
+     *
+     * @return true if the group's commits were written
+     */
+    bool end_group_commit() override;
+    /**
+     * Roll back the group's database transaction.
+     */
+    void rollback_group_commit() override;
     /** Connect the backend to a GncSqlConnection.
      * Sets up version info. Calling with nullptr clears the connection and
      * destroys the version info.
@@ -121,6 +166,14 @@ public:
      * @return Results, or nullptr if an error has occurred
      */
     GncSqlResultPtr execute_select_statement(const GncSqlStatementPtr& stmt) const noexcept;
+    /** Like execute_select_statement, but for results too large to want in
+     * memory all at once. The rows may be fetched a batch at a time as they
+     * are iterated, so the result can only be iterated once.
+     *
+     * @param statement Statement
+     * @return Results, or nullptr if an error has occurred
+     */
+    GncSqlResultPtr execute_streaming_select_statement(const GncSqlStatementPtr& stmt) const noexcept;
     int execute_nonselect_statement(const GncSqlStatementPtr& stmt) const noexcept;
     std::string quote_string(const std::string&) const noexcept;
     /**
@@ -237,6 +290,9 @@ public:
     QofBook* book() const noexcept { return m_book; }
     void set_loading(bool loading) noexcept { m_loading = loading; }
     bool pristine() const noexcept { return m_is_pristine_db; }
+    /** The slots stored for each object, by guid, as gnc-slots-sql last
+     * loaded or saved them. */
+    SavedSlotsMap& saved_slots() noexcept { return m_saved_slots; }
     void update_progress(double pct) const noexcept;
     void finish_progress() const noexcept;
 
@@ -248,12 +304,31 @@ protected:
     bool m_is_pristine_db; /**< Are we saving to a new pristine db? */
     const char* m_time_format = nullptr; /**< Server-specific date-time string format */
     VersionVec m_versions;    /**< Version number for each table */
+    /** Wait until the commits being written behind are in the database.
+     * Anything but a commit must call it before using m_conn. */
+    void wait_for_writes() const noexcept;
+    void start_prefetch (const std::vector<std::string>& queries) noexcept;
+    void finish_prefetch () noexcept;
 private:
     bool write_account_tree(Account*);
     bool write_accounts();
     bool write_transactions();
     bool write_template_transactions();
     bool write_schedXactions();
+    /** Rows waiting to be written by one multi-row INSERT. */
+    struct BulkInsert
+    {
+        const GncSqlStatementTemplate* stmt;
+        std::vector<PairVec> rows;
+        size_t size;
+    };
+    bool queue_insert (const char* table_name, QofIdTypeConst obj_name,
+                       gpointer pObject, const EntryVec& table) const noexcept;
+    bool flush_insert (BulkInsert& insert) const noexcept;
+    bool flush_inserts () const noexcept;
+    GncSqlStatementPtr bind_statement (E_DB_OPERATION op,
+                                       const char* table_name,
+                                       const PairVec& values) const noexcept;
     GncSqlStatementPtr build_insert_statement (const char* table_name,
                                                QofIdTypeConst obj_name,
                                                gpointer pObject,
@@ -288,6 +363,104 @@ private:
     };
     ObjectBackendRegistry m_backend_registry;
     std::vector<gnc_commodity*> m_postload_commodities;
+    /** While syncing, inserts are queued and written in bulk. The queues are
+     * mutable because do_db_operation is const.
+     */
+    bool m_bulk_write = false;
+    mutable std::vector<BulkInsert> m_bulk_inserts;
+    /** Lazy loading: the initial load leaves out transactions other than
+     * those in lots, which are loaded as queries need them. What each query
+     * loaded, an account's transactions, those posted in a date range or all
+     * of them, is kept most recently queried first, and those at the end are
+     * unloaded when the book holds more than m_max_resident_tx transactions.
+     */
+    struct LoadedTransactions
+    {
+        enum class Kind { ACCOUNT, RANGE, ALL } kind;
+        GncGUID account;
+        time64 start;
+        time64 end;
+        bool holds(const Transaction*) const noexcept;
+    };
+    bool m_lazy_load = false;
+    bool m_all_tx_loaded = false;
+    size_t m_max_resident_tx = 0;   /**< 0 means no limit */
+    std::list<LoadedTransactions> m_loaded_lru;
+    bool find_loaded(const std::function<bool(const LoadedTransactions&)>&) noexcept;
+    void load_all_transactions() noexcept;
+    void load_account_transactions(const GncGUID& guid) noexcept;
+    void load_transactions_between(time64 start, time64 end) noexcept;
+    void unload_least_recent(size_t keep) noexcept;
+    /** Account balances got from the database by date range, until the next
+     * commit or load. */
+    std::map<std::pair<time64, time64>,
+             std::unordered_map<const QofInstance*, gnc_numeric>> m_balances;
+    /** Open group commits, whether the outermost one must be rolled back,
+     * and the instances committed in it, each holding a reference so that
+     * they can be marked dirty again if it is.
+     */
+    unsigned int m_group_depth = 0;
+    bool m_group_open = false;      /**< The group's transaction was begun */
+    bool m_group_failed = false;
+    std::vector<QofInstance*> m_group_committed;
+    void finish_group_commit (bool committed) noexcept;
+    /** During the initial load, the SELECTs the object backends will run
+     * whole, which are all but those for transactions and splits, are run
+     * ahead on reader connections by other threads. Their results are
+     * kept by SQL text, with their place in the order they were given,
+     * until execute_select_statement asks for them. A query isn't run until
+     * it's among the next m_readers.size() after the last one asked for, so
+     * that only a few results are held at once.
+     */
+    mutable std::unordered_map<std::string,
+                               std::pair<size_t, std::future<GncSqlResultPtr>>>
+        m_prefetched;
+    std::vector<GncSqlConnection*> m_readers;
+    std::vector<std::future<void>> m_prefetchers;
+    mutable std::mutex m_prefetch_mutex;
+    mutable std::condition_variable m_prefetch_cv;
+    mutable size_t m_prefetch_window = 0; /**< Queries before this may run */
+    bool m_prefetch_stopped = false;
+    GncSqlResultPtr take_prefetched (const GncSqlStatementPtr& stmt)
+        const noexcept;
+    /** Commodities known to be in the pristine database being synced, or
+     * in the database while writing behind. */
+    std::unordered_set<gnc_commodity*> m_saved_commodities;
+    /** Forgotten when a save fails, as the database may not hold what was
+     * written, and when the database is rewritten. */
+    SavedSlotsMap m_saved_slots;
+    /** Write-behind, enabled by setting GNC_SQL_WRITE_BEHIND in the
+     * environment: a commit's statements are built when it's made, but they
+     * are run in order by a worker thread on a connection of its own while
+     * the caller goes on. If a commit needs to read the database it waits
+     * for the worker and finishes synchronously. The outcome of each commit
+     * is reported back to the main thread, which sets the backend error, the
+     * next time it commits, syncs or loads.
+     */
+    struct WriteBehind
+    {
+        std::vector<std::string> sql;
+        QofInstance* inst;      /**< Referenced unless it's being destroyed */
+    };
+    std::thread m_writer;
+    GncSqlConnection* m_writer_conn = nullptr;
+    mutable std::mutex m_writes_mutex; /**< Guards the members below */
+    mutable std::condition_variable m_writes_cond;
+    std::deque<WriteBehind> m_writes;
+    bool m_writing = false;     /**< The worker is running a commit */
+    bool m_stop_writer = false;
+    std::vector<std::pair<QofInstance*, QofBackendError>> m_written;
+    /** The statements of the commit in progress, while they're being
+     * queued; mutable because execute_nonselect_statement is const. */
+    mutable bool m_queue_writes = false;
+    mutable bool m_write_through_failed = false;
+    mutable std::vector<std::string> m_commit_writes;
+    void start_write_behind() noexcept;
+    void stop_write_behind() noexcept;
+    void write_behind() noexcept;
+    QofBackendError run_writes (const WriteBehind& writes) noexcept;
+    void write_through() const noexcept;
+    void report_writes() noexcept;
 };
 
 #endif //__GNC_SQL_BACKEND_HPP__
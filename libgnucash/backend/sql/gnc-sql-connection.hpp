@@ -41,6 +41,13 @@ using PairVec = std::vector<std::pair<std::string, std::string>>;
 struct GncSqlColumnInfo;
 using ColVec = std::vector<GncSqlColumnInfo>;
 
+typedef enum
+{
+    OP_DB_INSERT,
+    OP_DB_UPDATE,
+    OP_DB_DELETE
+} E_DB_OPERATION;
+
 /**
  * SQL statement provider.
  */
@@ -54,6 +61,23 @@ public:
 
 using GncSqlStatementPtr = std::unique_ptr<GncSqlStatement>;
 
+/**
+ * The SQL for an operation on a table's columns, worked out once and filled
+ * in with the values of any number of rows. It isn't a statement prepared by
+ * the database server: binding makes a statement that's sent like any other.
+ */
+class GncSqlStatementTemplate
+{
+public:
+    virtual ~GncSqlStatementTemplate() {}
+    /** Make the statement for one row. The values must be quoted and be for
+     * the columns the template was made for, in the same order. */
+    virtual GncSqlStatementPtr bind (const PairVec& values) const noexcept = 0;
+    /** Make one statement inserting all the rows; INSERT statements only. */
+    virtual GncSqlStatementPtr bind (const std::vector<PairVec>& rows)
+        const noexcept = 0;
+};
+
 /**
  * Encapsulate the connection to the database. This is an abstract class; the
  * implementation is database-specific.
@@ -65,11 +89,25 @@ public:
     virtual ~GncSqlConnection() = default;
     virtual GncSqlResultPtr execute_select_statement (const GncSqlStatementPtr&)
         noexcept = 0;
+    /** Like execute_select_statement, but the rows may be fetched from the
+     * database a batch at a time as they're iterated instead of all at once,
+     * so the result can be iterated only once and its size() is that of the
+     * current batch. */
+    virtual GncSqlResultPtr
+        execute_streaming_select_statement (const GncSqlStatementPtr& stmt)
+        noexcept { return execute_select_statement (stmt); }
     /** Returns false if error */
     virtual int execute_nonselect_statement (const GncSqlStatementPtr&)
         noexcept = 0;
     virtual GncSqlStatementPtr create_statement_from_sql (const std::string&)
         const noexcept = 0;
+    /** Get the template for an operation on a table with the columns in
+     * values; it's made the first time and cached on the connection.
+     * UPDATE and DELETE statements select the row by the first column.
+     * Returns NULL if error */
+    virtual const GncSqlStatementTemplate*
+        get_statement_template (E_DB_OPERATION, const std::string&,
+                                const PairVec&) noexcept = 0;
     /** Returns true if successful */
     virtual bool does_table_exist (const std::string&) const noexcept = 0;
     /** Returns TRUE if successful, false if error */
@@ -97,6 +135,12 @@ public:
                            bool retry) noexcept = 0;
     virtual bool verify() noexcept = 0;
     virtual bool retry_connection(const char* msg) noexcept = 0;
+    /** Open another connection to the same database, for running
+     * statements on another thread while this one is in use. It doesn't
+     * lock the database, and only reports a failed statement or transaction
+     * by its return value, never by setting the backend error. Returns NULL
+     * if that isn't supported. */
+    virtual GncSqlConnection* open_reader () const noexcept { return nullptr; }
 
 };
 
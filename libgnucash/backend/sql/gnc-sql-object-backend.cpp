@@ -88,6 +88,15 @@ GncSqlObjectBackend::create_tables (GncSqlBackend* sql_be)
              "Table creation aborted.", m_table_name.c_str(), m_version, version);
 }
 
+std::vector<std::string>
+GncSqlObjectBackend::table_queries () const
+{
+    std::string pkey(m_col_table[0]->name());
+    return {"SELECT * FROM " + m_table_name,
+            gnc_sql_slots_subquery_sql ("SELECT DISTINCT " + pkey + " FROM " +
+                                        m_table_name)};
+}
+
 bool
 GncSqlObjectBackend::instance_in_db(const GncSqlBackend* sql_be,
                                     QofInstance* inst) const noexcept
@@ -60,6 +60,14 @@ public:
      * @param sql_be The GncSqlBackend containing the database connection.
      */
     virtual void load_all (GncSqlBackend* sql_be) = 0;
+    /**
+     * The SELECT statements load_all runs, in the order it runs them, so
+     * that GncSqlBackend can fetch the results ahead of time. Loaders that
+     * stream their results return nothing, as a result fetched ahead is
+     * read whole.
+     * @return The statements' SQL, or nothing if they aren't fixed.
+     */
+    virtual std::vector<std::string> load_all_queries () const { return {}; }
     /**
      * Conditionally create or update a database table from m_col_table. The
      * condition is the version returned by querying the database's version
@@ -106,6 +114,11 @@ public:
     bool instance_in_db(const GncSqlBackend* sql_be,
                         QofInstance* inst) const noexcept;
 protected:
+    /**
+     * The queries of a load_all reading the whole table and then the slots
+     * of every row in it.
+     */
+    std::vector<std::string> table_queries () const;
     const std::string m_table_name;
     const int m_version;
     const std::string m_type_name; /// The front-end QofIdType
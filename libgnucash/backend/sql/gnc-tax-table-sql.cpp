@@ -244,14 +244,14 @@ load_taxtable_entries (GncSqlBackend* sql_be, GncTaxTable* tt)
         load_single_ttentry (sql_be, row, tt);
 }
 
-static void
+static GncTaxTable*
 load_single_taxtable (GncSqlBackend* sql_be, GncSqlRow& row,
                       TaxTblParentGuidVec& l_tt_needing_parents)
 {
     const GncGUID* guid;
     GncTaxTable* tt;
 
-    g_return_if_fail (sql_be != NULL);
+    g_return_val_if_fail (sql_be != NULL, NULL);
 
     guid = gnc_sql_load_guid (sql_be, row);
     tt = gncTaxTableLookup (sql_be->book(), guid);
@@ -260,7 +260,6 @@ load_single_taxtable (GncSqlBackend* sql_be, GncSqlRow& row,
         tt = gncTaxTableCreate (sql_be->book());
     }
     gnc_sql_load_object (sql_be, row, GNC_ID_TAXTABLE, tt, tt_col_table);
-    gnc_sql_slots_load (sql_be, QOF_INSTANCE (tt));
     load_taxtable_entries (sql_be, tt);
 
     /* If the tax table doesn't have a parent, it might be because it hasn't
@@ -281,6 +280,7 @@ load_single_taxtable (GncSqlBackend* sql_be, GncSqlRow& row,
     }
 
     qof_instance_mark_clean (QOF_INSTANCE (tt));
+    return tt;
 }
 
 void
@@ -294,9 +294,12 @@ GncSqlTaxTableBackend::load_all (GncSqlBackend* sql_be)
     auto stmt = sql_be->create_statement_from_sql(sql.str());
     auto result = sql_be->execute_select_statement(stmt);
     TaxTblParentGuidVec tt_needing_parents;
+    InstanceVec instances;
 
     for (auto row : *result)
-        load_single_taxtable (sql_be, row, tt_needing_parents);
+        instances.push_back (QOF_INSTANCE (load_single_taxtable (
+                                               sql_be, row, tt_needing_parents)));
+    gnc_sql_slots_load_for_instancevec (sql_be, instances);
 
     /* While there are items on the list of taxtables needing parents,
        try to see if the parent has now been loaded.  Theory says that if
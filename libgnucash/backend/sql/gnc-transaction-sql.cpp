@@ -40,6 +40,7 @@ extern "C"
 #include "Transaction.h"
 #include <Scrub.h>
 #include "gnc-lot.h"
+#include "SX-book.h"
 #include "engine-helpers.h"
 #include "gnc-commodity.h"
 #include "gnc-engine.h"
@@ -49,8 +50,12 @@ extern "C"
 #endif
 }
 
+#include <algorithm>
+#include <cmath>
 #include <string>
 #include <sstream>
+#include <unordered_map>
+#include <unordered_set>
 
 #include "escape.h"
 
@@ -241,35 +246,52 @@ load_single_split (GncSqlBackend* sql_be, GncSqlRow& row)
     }
     return pSplit;
 }
-static void
-load_splits_for_transactions (GncSqlBackend* sql_be, std::string selector)
+/* The query for the splits of the transactions whose guids selector, a
+ * parenthesized subquery, selects or of all transactions if it's empty. */
+static std::string
+splits_sql (const std::string& selector)
 {
-    g_return_if_fail (sql_be != NULL);
-
-    const std::string spkey(split_col_table[0]->name());
     const std::string sskey(tx_guid_col_table[0]->name());
     const std::string tpkey(tx_col_table[0]->name());
 
     std::string sql("SELECT ");
     if (selector.empty())
-    {
         sql += SPLIT_TABLE ".* FROM " SPLIT_TABLE " INNER JOIN "
             TRANSACTION_TABLE " ON " SPLIT_TABLE "." + sskey + " = "
             TRANSACTION_TABLE "." + tpkey;
-        selector = "(SELECT DISTINCT " + tpkey + " FROM " TRANSACTION_TABLE ")";
-    }
     else
         sql += " * FROM " SPLIT_TABLE " WHERE " + sskey + " IN " + selector;
+    return sql;
+}
+
+/* The subquery for the guids of those splits. */
+static std::string
+split_guids_sql (std::string selector)
+{
+    const std::string spkey(split_col_table[0]->name());
+    const std::string sskey(tx_guid_col_table[0]->name());
+    const std::string tpkey(tx_col_table[0]->name());
+
+    if (selector.empty())
+        selector = "(SELECT DISTINCT " + tpkey + " FROM " TRANSACTION_TABLE ")";
+    std::string sql("SELECT DISTINCT ");
+    sql += spkey + " FROM " SPLIT_TABLE " WHERE " + sskey + " IN " + selector;
+    return sql;
+}
+
+static void
+load_splits_for_transactions (GncSqlBackend* sql_be, std::string selector)
+{
+    g_return_if_fail (sql_be != NULL);
 
     // Execute the query and load the splits
-    auto stmt = sql_be->create_statement_from_sql(sql);
-    auto result = sql_be->execute_select_statement (stmt);
+    auto stmt = sql_be->create_statement_from_sql(splits_sql (selector));
+    auto result = sql_be->execute_streaming_select_statement (stmt);
 
     for (auto row : *result)
         load_single_split (sql_be, row);
-    sql = "SELECT DISTINCT ";
-    sql += spkey + " FROM " SPLIT_TABLE " WHERE " + sskey + " IN " + selector;
-    gnc_sql_slots_load_for_sql_subquery(sql_be, sql,
+    delete result;
+    gnc_sql_slots_load_for_sql_subquery(sql_be, split_guids_sql (selector),
                                         (BookLookupFn)xaccSplitLookup);
 }
 
@@ -307,21 +329,86 @@ load_single_tx (GncSqlBackend* sql_be, GncSqlRow& row)
 }
 
 /**
- * Structure to hold start/end balances for each account.  The values are
- * saved before splits are loaded, and then used to adjust the start balances
- * so that the end balances (which are calculated and correct on initial load)
- * are unchanged.
+ * While transactions are loaded lazily an account's starting balances are
+ * the sums of its splits that aren't loaded, so that its balances are those
+ * of all of its splits.  What the transactions loaded or unloaded add to the
+ * balances of the accounts they touch is moved out of or into those
+ * accounts' starting balances.
  */
 typedef struct
 {
-    Account* acc;
-    gnc_numeric start_bal;
-    gnc_numeric end_bal;
-    gnc_numeric start_cleared_bal;
-    gnc_numeric end_cleared_bal;
-    gnc_numeric start_reconciled_bal;
-    gnc_numeric end_reconciled_bal;
-} full_acct_balances_t;
+    gnc_numeric balance;
+    gnc_numeric cleared_balance;
+    gnc_numeric reconciled_balance;
+} balance_change_t;
+
+using BalanceChanges = std::unordered_map<Account*, balance_change_t>;
+
+static void
+add_balance_changes (BalanceChanges& changes, Transaction* trans)
+{
+    auto add = [](gnc_numeric& sum, gnc_numeric amount) {
+        sum = gnc_numeric_add (sum, amount, GNC_DENOM_AUTO, GNC_HOW_DENOM_LCD);
+    };
+    for (auto node = xaccTransGetSplitList (trans); node; node = node->next)
+    {
+        auto split = GNC_SPLIT (node->data);
+        auto acc = xaccSplitGetAccount (split);
+        if (acc == nullptr)
+            continue;
+        auto& change = changes.emplace (acc, balance_change_t{
+                gnc_numeric_zero(), gnc_numeric_zero(),
+                gnc_numeric_zero()}).first->second;
+        auto amount = xaccSplitGetAmount (split);
+        auto state = xaccSplitGetReconcile (split);
+        add (change.balance, amount);
+        if (state != NREC)
+            add (change.cleared_balance, amount);
+        if (state == YREC || state == FREC)
+            add (change.reconciled_balance, amount);
+    }
+}
+
+/**
+ * Move the starting balances of the accounts whose splits were loaded or
+ * unloaded so that their balances are what they were before.
+ *
+ * @param changes What the splits add to each account's balances
+ * @param loaded Whether the splits were loaded rather than unloaded
+ */
+static void
+shift_start_balances (const BalanceChanges& changes, bool loaded)
+{
+    auto shift = [loaded](gnc_numeric start, gnc_numeric change) {
+        return loaded ?
+            gnc_numeric_sub (start, change, GNC_DENOM_AUTO, GNC_HOW_DENOM_LCD) :
+            gnc_numeric_add (start, change, GNC_DENOM_AUTO, GNC_HOW_DENOM_LCD);
+    };
+    for (auto const& acc_change : changes)
+    {
+        auto acc = acc_change.first;
+        auto const& change = acc_change.second;
+        gnc_numeric* start;
+        gnc_numeric* start_cleared;
+        gnc_numeric* start_reconciled;
+
+        g_object_get (acc,
+                      "start-balance", &start,
+                      "start-cleared-balance", &start_cleared,
+                      "start-reconciled-balance", &start_reconciled,
+                      NULL);
+        gnc_account_set_start_balance (acc, shift (*start, change.balance));
+        gnc_account_set_start_cleared_balance (
+            acc, shift (*start_cleared, change.cleared_balance));
+        gnc_account_set_start_reconciled_balance (
+            acc, shift (*start_reconciled, change.reconciled_balance));
+        g_boxed_free (GNC_TYPE_NUMERIC, start);
+        g_boxed_free (GNC_TYPE_NUMERIC, start_cleared);
+        g_boxed_free (GNC_TYPE_NUMERIC, start_reconciled);
+        xaccAccountRecomputeBalance (acc);
+        qof_event_gen (QOF_INSTANCE (acc), QOF_EVENT_MODIFY, nullptr);
+    }
+}
 
 /**
  * Executes a transaction query statement and loads the transactions and all
@@ -329,9 +416,12 @@ typedef struct
  *
  * @param sql_be SQL backend
  * @param stmt SQL statement
+ * @param changes If not null, what the loaded transactions add to account
+ * balances is added to it
  */
 static void
-query_transactions (GncSqlBackend* sql_be, std::string selector)
+query_transactions (GncSqlBackend* sql_be, std::string selector,
+                    BalanceChanges* changes = nullptr)
 {
     g_return_if_fail (sql_be != NULL);
 
@@ -343,13 +433,7 @@ query_transactions (GncSqlBackend* sql_be, std::string selector)
     else if (!selector.empty()) // plain condition
         sql += " WHERE " + selector;
     auto stmt = sql_be->create_statement_from_sql(sql);
-    auto result = sql_be->execute_select_statement(stmt);
-    if (result->begin() == result->end())
-    {
-        PINFO("Query %s returned no results", sql.c_str());
-        return;
-    }
-
+    auto result = sql_be->execute_streaming_select_statement(stmt);
     Transaction* tx;
 
     // Load the transactions
@@ -364,6 +448,12 @@ query_transactions (GncSqlBackend* sql_be, std::string selector)
             instances.push_back(QOF_INSTANCE(tx));
         }
     }
+    delete result;
+    if (instances.empty())
+    {
+        PINFO("Query %s returned no results", sql.c_str());
+        return;
+    }
 
     // Load all splits and slots for the transactions
     if (!instances.empty())
@@ -389,7 +479,11 @@ query_transactions (GncSqlBackend* sql_be, std::string selector)
 
     // Commit all of the transactions
     for (auto instance : instances)
+    {
          xaccTransCommitEdit(GNC_TRANSACTION(instance));
+         if (changes != nullptr)
+             add_balance_changes (*changes, GNC_TRANSACTION(instance));
+    }
 
 }
 
@@ -702,9 +796,115 @@ void gnc_sql_transaction_load_tx_for_account (GncSqlBackend* sql_be,
     std::string sql("(SELECT DISTINCT ");
     sql += stkey + " FROM " SPLIT_TABLE " WHERE " + sakey + " = '";
     sql += gnc::GUID(*guid).to_string() + "')";
+    BalanceChanges changes;
+    query_transactions (sql_be, sql,
+                        sql_be->lazy_loading() ? &changes : nullptr);
+    shift_start_balances (changes, true);
+}
+
+/**
+ * Loads all transactions posted between start and end inclusive.
+ *
+ * @param sql_be SQL backend
+ * @param start Earliest posted date, or INT64_MIN for no limit
+ * @param end Latest posted date, or INT64_MAX for no limit
+ */
+void
+gnc_sql_transaction_load_tx_between (GncSqlBackend* sql_be, time64 start,
+                                     time64 end)
+{
+    g_return_if_fail (sql_be != NULL);
+
+    const std::string pdkey(post_date_col_table[0]->name());
+    std::string sql;
+    if (start > MINTIME)
+        sql += pdkey + " >= '" + GncDateTime(start).format_iso8601() + "'";
+    if (end < MAXTIME)
+    {
+        if (!sql.empty())
+            sql += " AND ";
+        sql += pdkey + " <= '" + GncDateTime(end).format_iso8601() + "'";
+    }
+
+    BalanceChanges changes;
+    auto root = gnc_book_get_root_account (sql_be->book());
+    gnc_account_foreach_descendant(root, (AccountCb)xaccAccountBeginEdit,
+                                   nullptr);
+    query_transactions (sql_be, sql,
+                        sql_be->lazy_loading() ? &changes : nullptr);
+    gnc_account_foreach_descendant(root, (AccountCb)xaccAccountCommitEdit,
+                                   nullptr);
+    shift_start_balances (changes, true);
+}
+
+void
+gnc_sql_transaction_load_tx_in_lots (GncSqlBackend* sql_be)
+{
+    g_return_if_fail (sql_be != NULL);
+
+    const std::string stkey(split_col_table[1]->name()); //txn_guid
+    const std::string slkey(split_col_table[9]->name()); //lot_guid
+    std::string sql("(SELECT DISTINCT ");
+    sql += stkey + " FROM " SPLIT_TABLE " WHERE " + slkey + " IS NOT NULL)";
     query_transactions (sql_be, sql);
 }
 
+guint
+gnc_sql_transaction_unload_tx (GncSqlBackend* sql_be,
+                               const TransPredicate& unload)
+{
+    g_return_val_if_fail (sql_be != NULL, 0);
+
+    std::vector<Transaction*> unloading;
+    auto coll = qof_book_get_collection (sql_be->book(), GNC_ID_TRANS);
+    qof_collection_foreach (coll, [](QofInstance* inst, gpointer data) {
+            static_cast<std::vector<Transaction*>*>(data)->push_back (
+                GNC_TRANSACTION (inst));
+        }, &unloading);
+
+    auto template_root = gnc_book_get_template_root (sql_be->book());
+    auto last = std::remove_if (unloading.begin(), unloading.end(),
+                                [&unload, template_root](Transaction* trans) {
+        if (xaccTransIsOpen (trans) ||
+            qof_instance_is_dirty (QOF_INSTANCE (trans)) ||
+            xaccTransGetReadOnly (trans))
+            return true;
+        /* Lots, and through them capital gains and business documents,
+         * hold on to their splits. The scheduled transactions' templates
+         * are loaded with them and are never loaded again. */
+        for (auto node = xaccTransGetSplitList (trans); node; node = node->next)
+        {
+            auto split = GNC_SPLIT (node->data);
+            auto acc = xaccSplitGetAccount (split);
+            if (xaccSplitGetLot (split) != nullptr ||
+                (acc && template_root &&
+                 xaccAccountHasAncestor (acc, template_root)))
+                return true;
+        }
+        return !unload (trans);
+    });
+    unloading.erase (last, unloading.end());
+
+    if (unloading.empty())
+        return 0;
+    BalanceChanges changes;
+    auto& saved_slots = sql_be->saved_slots();
+    for (auto trans : unloading)
+    {
+        if (sql_be->lazy_loading())
+            add_balance_changes (changes, trans);
+        saved_slots.erase (gnc::GUID{*qof_instance_get_guid (trans)}.to_string());
+        for (auto node = xaccTransGetSplitList (trans); node; node = node->next)
+            saved_slots.erase (
+                gnc::GUID{*qof_instance_get_guid (node->data)}.to_string());
+        xaccTransBeginEdit (trans);
+        xaccTransDestroy (trans);
+        xaccTransCommitEdit (trans);
+    }
+    shift_start_balances (changes, false);
+    return unloading.size();
+}
+
 /**
  * Loads all transactions.  This might be used during a save-as operation to ensure that
  * all data is in memory and ready to be saved.
@@ -716,12 +916,15 @@ GncSqlTransBackend::load_all (GncSqlBackend* sql_be)
 {
     g_return_if_fail (sql_be != NULL);
 
+    BalanceChanges changes;
     auto root = gnc_book_get_root_account (sql_be->book());
     gnc_account_foreach_descendant(root, (AccountCb)xaccAccountBeginEdit,
                                    nullptr);
-    query_transactions (sql_be, "");
+    query_transactions (sql_be, "",
+                        sql_be->lazy_loading() ? &changes : nullptr);
     gnc_account_foreach_descendant(root, (AccountCb)xaccAccountCommitEdit,
                                    nullptr);
+    shift_start_balances (changes, true);
 }
 
 static void
@@ -945,6 +1148,135 @@ static const EntryVec acct_balances_col_table
                                          (QofSetterFunc)set_acct_bal_balance),
 };
 
+/* The sum of a BIGINT column is a DECIMAL in some databases, which libdbi
+ * may hand over as a double or a string. */
+static gint64
+get_sum_at_col (GncSqlRow& row, const char* col)
+{
+    try
+    {
+        return row.get_int_at_col (col);
+    }
+    catch (std::invalid_argument&) {}
+    try
+    {
+        return llround (row.get_double_at_col (col));
+    }
+    catch (std::invalid_argument&) {}
+    try
+    {
+        return g_ascii_strtoll (row.get_string_at_col (col).c_str(), nullptr,
+                                10);
+    }
+    catch (std::invalid_argument&)
+    {
+        PERR ("Unable to read the sum in column %s", col);
+        return 0;
+    }
+}
+
+std::vector<acct_balances_t>
+gnc_sql_get_account_balances (GncSqlBackend* sql_be, time64 start, time64 end)
+{
+    std::vector<acct_balances_t> balances;
+
+    g_return_val_if_fail (sql_be != NULL, balances);
+
+    const std::string sakey(split_col_table[2]->name()); //account_guid
+    const std::string sskey(tx_guid_col_table[0]->name()); //tx_guid
+    const std::string tpkey(tx_col_table[0]->name()); //guid
+    const std::string pdkey(post_date_col_table[0]->name()); //post_date
+    const std::string rskey(acct_balances_col_table[1]->name());
+    const std::string qkey(acct_balances_col_table[2]->name());
+    const std::string split_col(SPLIT_TABLE ".");
+
+    std::string sql("SELECT ");
+    sql += split_col + sakey + " AS " + acct_balances_col_table[0]->name() +
+        ", " + split_col + rskey + " AS " + rskey +
+        ", SUM(" + split_col + qkey + "_num) AS " + qkey + "_num" +
+        ", " + split_col + qkey + "_denom AS " + qkey + "_denom" +
+        " FROM " SPLIT_TABLE;
+    if (start > MINTIME || end < MAXTIME)
+    {
+        sql += " INNER JOIN " TRANSACTION_TABLE " ON " + split_col + sskey +
+            " = " TRANSACTION_TABLE "." + tpkey + " WHERE ";
+        if (start > MINTIME)
+            sql += pdkey + " >= '" + GncDateTime(start).format_iso8601() + "'";
+        if (start > MINTIME && end < MAXTIME)
+            sql += " AND ";
+        if (end < MAXTIME)
+            sql += pdkey + " < '" + GncDateTime(end).format_iso8601() + "'";
+    }
+    sql += " GROUP BY " + split_col + sakey + ", " + split_col + rskey + ", " +
+        split_col + qkey + "_denom ORDER BY " + split_col + sakey;
+
+    auto stmt = sql_be->create_statement_from_sql(sql);
+    if (stmt == nullptr)
+        return balances;
+    auto result = sql_be->execute_select_statement(stmt);
+    if (result == nullptr)
+        return balances;
+
+    /* Rows come in runs by account, one per reconcile state and
+     * denominator. */
+    for (auto row : *result)
+    {
+        single_acct_balance_t bal{sql_be, nullptr, NREC, gnc_numeric_zero()};
+        gnc_sql_load_object (sql_be, row, nullptr, &bal,
+                             acct_balances_col_table);
+        if (bal.acct == nullptr)
+            continue;
+        auto num = get_sum_at_col (row, (qkey + "_num").c_str());
+        auto denom = row.get_int_at_col ((qkey + "_denom").c_str());
+        auto amount = gnc_numeric_create (num, denom);
+        if (balances.empty() || balances.back().acct != bal.acct)
+            balances.push_back ({bal.acct, gnc_numeric_zero(),
+                                 gnc_numeric_zero(), gnc_numeric_zero()});
+        auto& acct_bal = balances.back();
+        auto add = [&amount](gnc_numeric& sum) {
+            sum = gnc_numeric_add (sum, amount, GNC_DENOM_AUTO,
+                                   GNC_HOW_DENOM_LCD);
+        };
+        add (acct_bal.balance);
+        if (bal.reconcile_state != NREC)
+            add (acct_bal.cleared_balance);
+        if (bal.reconcile_state == YREC || bal.reconcile_state == FREC)
+            add (acct_bal.reconciled_balance);
+    }
+    delete result;
+    return balances;
+}
+
+void
+gnc_sql_transaction_set_start_balances (GncSqlBackend* sql_be)
+{
+    g_return_if_fail (sql_be != NULL);
+
+    auto sub = [](gnc_numeric& sum, gnc_numeric amount) {
+        sum = gnc_numeric_sub (sum, amount, GNC_DENOM_AUTO, GNC_HOW_DENOM_LCD);
+    };
+    for (auto bal : gnc_sql_get_account_balances (sql_be, MINTIME, MAXTIME))
+    {
+        /* Splits already loaded, such as those in lots, add to the start. */
+        for (auto node = xaccAccountGetSplitList (bal.acct); node;
+             node = node->next)
+        {
+            auto split = GNC_SPLIT (node->data);
+            auto amount = xaccSplitGetAmount (split);
+            auto state = xaccSplitGetReconcile (split);
+            sub (bal.balance, amount);
+            if (state != NREC)
+                sub (bal.cleared_balance, amount);
+            if (state == YREC || state == FREC)
+                sub (bal.reconciled_balance, amount);
+        }
+        gnc_account_set_start_balance (bal.acct, bal.balance);
+        gnc_account_set_start_cleared_balance (bal.acct, bal.cleared_balance);
+        gnc_account_set_start_reconciled_balance (bal.acct,
+                                                  bal.reconciled_balance);
+    }
+}
+
 /* ----------------------------------------------------------------- */
 template<> void
 GncSqlColumnTableEntryImpl<CT_TXREF>::load (const GncSqlBackend* sql_be,
@@ -35,6 +35,9 @@ extern "C"
 #include "qof.h"
 #include "Account.h"
 }
+#include <functional>
+#include <vector>
+
 class GncSqlTransBackend : public GncSqlObjectBackend
 {
 public:
@@ -61,6 +64,39 @@ public:
  */
 void gnc_sql_transaction_load_tx_for_account (GncSqlBackend* sql_be,
                                               Account* account);
+/**
+ * Loads all transactions posted between start and end inclusive.
+ *
+ * @param sql_be SQL backend
+ * @param start Earliest posted date, or INT64_MIN for no limit
+ * @param end Latest posted date, or INT64_MAX for no limit
+ */
+void gnc_sql_transaction_load_tx_between (GncSqlBackend* sql_be, time64 start,
+                                          time64 end);
+
+/**
+ * Loads the transactions having a split in a lot, which lots, and through
+ * them capital gains and business documents, can't do without.  Part of the
+ * initial load of a book whose transactions are loaded lazily, before
+ * gnc_sql_transaction_set_start_balances.
+ *
+ * @param sql_be SQL backend
+ */
+void gnc_sql_transaction_load_tx_in_lots (GncSqlBackend* sql_be);
+
+using TransPredicate = std::function<bool(const Transaction*)>;
+/**
+ * Removes transactions from memory, leaving them in the database; the
+ * backend must be loading, so that they're destroyed without being deleted
+ * from it. Transactions that are being edited, have unsaved changes, are
+ * read-only or have a split in a lot are kept whatever unload says.
+ *
+ * @param sql_be SQL backend
+ * @param unload Whether a transaction should be removed
+ * @return The number of transactions removed
+ */
+guint gnc_sql_transaction_unload_tx (GncSqlBackend* sql_be,
+                                     const TransPredicate& unload);
 typedef struct
 {
     Account* acct;
@@ -69,5 +105,30 @@ typedef struct
     gnc_numeric reconciled_balance;
 } acct_balances_t;
 
+/**
+ * Sums each account's splits in the database, grouped by reconcile state,
+ * without loading them.
+ *
+ * @param sql_be SQL backend
+ * @param start Only splits of transactions posted on or after this, or
+ * MINTIME for no limit
+ * @param end Only splits of transactions posted before this, or MAXTIME for
+ * no limit
+ * @return The balances of the accounts having such splits
+ */
+std::vector<acct_balances_t> gnc_sql_get_account_balances (GncSqlBackend* sql_be,
+                                                           time64 start,
+                                                           time64 end);
+
+/**
+ * Starts each account's balances from the sums of its splits in the
+ * database less those already loaded, for a book whose transactions are
+ * loaded lazily.  They're kept in step as transactions are loaded and
+ * unloaded.
+ *
+ * @param sql_be SQL backend
+ */
+void gnc_sql_transaction_set_start_balances (GncSqlBackend* sql_be);
+
 
 #endif /* GNC_TRANSACTION_SQL_H */
@@ -37,6 +37,8 @@ class GncSqlVendorBackend : public GncSqlObjectBackend
 public:
     GncSqlVendorBackend();
     void load_all(GncSqlBackend*) override;
+    std::vector<std::string> load_all_queries() const override {
+        return table_queries(); }
     bool commit(GncSqlBackend*, QofInstance*) override;
     bool write(GncSqlBackend*) override;
 };
@@ -32,6 +32,10 @@ extern "C"
 #include "../gnc-sql-backend.hpp"
 #include "../gnc-sql-result.hpp"
 
+#include <atomic>
+#include <string>
+#include <vector>
+
 static const gchar* suitename = "/backend/sql/gnc-backend-sql";
 void test_suite_gnc_backend_sql (void);
 
@@ -43,6 +47,8 @@ public:
     void session_begin(QofSession*, const char*, bool, bool, bool) override {}
     void session_end() override {}
     void safe_sync(QofBook* book) override { sync(book); }
+    using GncSqlBackend::start_prefetch;
+    using GncSqlBackend::finish_prefetch;
 };
 
 class GncMockSqlConnection;
@@ -88,8 +94,11 @@ private:
 class GncMockSqlStatement : public GncSqlStatement
 {
 public:
-    const char* to_sql() const { return "SELECT * FROM foo"; }
+    GncMockSqlStatement(const std::string& sql) : m_sql{sql} {}
+    const char* to_sql() const { return m_sql.c_str(); }
     void add_where_cond (QofIdTypeConst, const PairVec&) {}
+private:
+    std::string m_sql;
 };
 
 
@@ -97,13 +106,33 @@ class GncMockSqlConnection : public GncSqlConnection
 {
 public:
     GncMockSqlConnection() : m_result{this} {}
+    /* Opens up to num_readers readers, which count the results they make
+     * in fetched. */
+    GncMockSqlConnection(unsigned int num_readers,
+                         std::atomic<unsigned int>* fetched) :
+        m_result{this}, m_num_readers{num_readers}, m_fetched{fetched} {}
     GncSqlResultPtr execute_select_statement (const GncSqlStatementPtr&)
-        noexcept override { return &m_result; }
+        noexcept override {
+        if (m_fetched == nullptr)
+            return &m_result;
+        ++*m_fetched;
+        return new GncMockSqlResult (this);
+    }
     int execute_nonselect_statement (const GncSqlStatementPtr&)
         noexcept override { return 1; }
-    GncSqlStatementPtr create_statement_from_sql (const std::string&)
+    GncSqlStatementPtr create_statement_from_sql (const std::string& sql)
         const noexcept override {
-        return std::unique_ptr<GncMockSqlStatement>(new GncMockSqlStatement); }
+        return std::unique_ptr<GncMockSqlStatement>(new GncMockSqlStatement (sql)); }
+    GncSqlConnection* open_reader () const noexcept override {
+        if (m_num_readers == 0)
+            return nullptr;
+        --m_num_readers;
+        return new GncMockSqlConnection (0, m_fetched);
+    }
+    const GncSqlStatementTemplate* get_statement_template (E_DB_OPERATION,
+                                                           const std::string&,
+                                                           const PairVec&)
+        noexcept override { return nullptr; }
     bool does_table_exist (const std::string&) const noexcept override {
         return true; }
     bool begin_transaction () noexcept override { return true;}
@@ -123,6 +152,8 @@ public:
     bool retry_connection(const char* msg) noexcept override { return true; }
 private:
     GncMockSqlResult m_result;
+    mutable unsigned int m_num_readers = 0;
+    std::atomic<unsigned int>* m_fetched = nullptr;
 };
 
 /* gnc_sql_init
@@ -155,6 +186,50 @@ gnc_sql_load (GncSqlBackend* sql_be,  QofBook *book, QofBackendLoadType loadType
 test_gnc_sql_load (Fixture *fixture, gconstpointer pData)
 {
 }*/
+
+static void
+wait_for_fetched (const std::atomic<unsigned int>& fetched, unsigned int count)
+{
+    for (auto tries = 0; fetched < count && tries < 100; ++tries)
+        g_usleep (10000);
+    /* Give the readers time to fetch more than they should. */
+    g_usleep (50000);
+}
+
+/* Tables read ahead during the load are held only a few at a time. */
+static void
+test_gnc_sql_prefetch (void)
+{
+    std::atomic<unsigned int> fetched{0};
+    GncMockSqlConnection conn{2, &fetched};
+    qof_object_initialize ();
+    auto book = qof_book_new();
+    auto sql_be = new GncMockSqlBackend (&conn, book);
+    std::vector<std::string> queries;
+    for (auto i = 0; i < 8; ++i)
+        queries.push_back ("SELECT * FROM t" + std::to_string (i));
+
+    /* Each of the two readers fetches the first query dealt to it and
+     * waits, and each one asked for lets another be fetched. */
+    sql_be->start_prefetch (queries);
+    wait_for_fetched (fetched, 2);
+    g_assert_cmpuint (fetched, ==, 2);
+    for (unsigned int i = 0; i < 4; ++i)
+    {
+        auto stmt = conn.create_statement_from_sql (queries[i]);
+        auto result = sql_be->execute_select_statement (stmt);
+        g_assert (result != nullptr);
+        delete result;
+        wait_for_fetched (fetched, i + 3);
+        g_assert_cmpuint (fetched, ==, i + 3);
+    }
+    /* Those left behind aren't fetched at all. */
+    sql_be->finish_prefetch ();
+    g_assert_cmpuint (fetched, ==, 6);
+
+    delete sql_be;
+    qof_book_destroy (book);
+}
 /* write_account_tree
 static gboolean
 write_account_tree (GncSqlBackend* sql_be, Account* root)// 3
@@ -843,6 +918,7 @@ test_suite_gnc_backend_sql (void)
 // GNC_TEST_ADD (suitename, "create tables cb", Fixture, nullptr, test_create_tables_cb,  teardown);
 // GNC_TEST_ADD (suitename, "initial load cb", Fixture, nullptr, test_initial_load_cb,  teardown);
 // GNC_TEST_ADD (suitename, "gnc sql load", Fixture, nullptr, test_gnc_sql_load,  teardown);
+    GNC_TEST_ADD_FUNC (suitename, "gnc sql prefetch", test_gnc_sql_prefetch);
 // GNC_TEST_ADD (suitename, "write account tree", Fixture, nullptr, test_write_account_tree,  teardown);
 // GNC_TEST_ADD (suitename, "write accounts", Fixture, nullptr, test_write_accounts,  teardown);
 // GNC_TEST_ADD (suitename, "write tx", Fixture, nullptr, test_write_tx,  teardown);
@@ -35,6 +35,7 @@ extern "C"
 #include "sixtp-parsers.h"
 #include "sixtp-dom-parsers.h"
 #include "sixtp-dom-generators.h"
+#include "gnc-xml-writer.hpp"
 #include "io-gncxml-gen.h"
 #include "io-gncxml-v2.h"
 
@@ -142,6 +143,40 @@ price_parse_xml_sub_node (GNCPrice* p, xmlNodePtr sub_node, QofBook* book)
     return TRUE;
 }
 
+GNCPrice*
+dom_tree_to_price (xmlNodePtr price_xml, QofBook* book)
+{
+    xmlNodePtr child;
+    GNCPrice* p;
+
+    if (!price_xml->xmlChildrenNode) return NULL;
+
+    p = gnc_price_create (book);
+    if (!p) return NULL;
+
+    for (child = price_xml->xmlChildrenNode; child; child = child->next)
+    {
+        switch (child->type)
+        {
+        case XML_COMMENT_NODE:
+        case XML_TEXT_NODE:
+            break;
+        case XML_ELEMENT_NODE:
+            if (!price_parse_xml_sub_node (p, child, book))
+            {
+                gnc_price_unref (p);
+                return NULL;
+            }
+            break;
+        default:
+            PERR ("Unknown node type (%d) while parsing gnc-price xml.", child->type);
+            gnc_price_unref (p);
+            return NULL;
+        }
+    }
+    return p;
+}
+
 static gboolean
 price_parse_xml_end_handler (gpointer data_for_children,
                              GSList* data_from_children,
@@ -153,7 +188,6 @@ price_parse_xml_end_handler (gpointer data_for_children,
 {
     gboolean ok = TRUE;
     xmlNodePtr price_xml = (xmlNodePtr) data_for_children;
-    xmlNodePtr child;
     GNCPrice* p = NULL;
     gxpf_data* gdata = static_cast<decltype (gdata)> (global_data);
     QofBook* book = static_cast<decltype (book)> (gdata->bookdata);
@@ -174,52 +208,11 @@ price_parse_xml_end_handler (gpointer data_for_children,
         ok = FALSE;
         goto cleanup_and_exit;
     }
-    if (!price_xml->xmlChildrenNode)
-    {
-        ok = FALSE;
-        goto cleanup_and_exit;
-    }
-
-    p = gnc_price_create (book);
-    if (!p)
-    {
-        ok = FALSE;
-        goto cleanup_and_exit;
-    }
-
-    for (child = price_xml->xmlChildrenNode; child; child = child->next)
-    {
-        switch (child->type)
-        {
-        case XML_COMMENT_NODE:
-        case XML_TEXT_NODE:
-            break;
-        case XML_ELEMENT_NODE:
-            if (!price_parse_xml_sub_node (p, child, book))
-            {
-                ok = FALSE;
-                goto cleanup_and_exit;
-            }
-            break;
-        default:
-            PERR ("Unknown node type (%d) while parsing gnc-price xml.", child->type);
-            child = NULL;
-            ok = FALSE;
-            goto cleanup_and_exit;
-            break;
-        }
-    }
+    p = dom_tree_to_price (price_xml, book);
+    ok = (p != NULL);
 
 cleanup_and_exit:
-    if (ok)
-    {
-        *result = p;
-    }
-    else
-    {
-        *result = NULL;
-        gnc_price_unref (p);
-    }
+    *result = p;
     xmlFreeNode (price_xml);
     return ok;
 }
@@ -462,6 +455,107 @@ gnc_price_to_dom_tree (const xmlChar* tag, GNCPrice* price)
     return price_xml;
 }
 
+static gboolean
+commodity_ref_is_valid (const gnc_commodity* c)
+{
+    return c && gnc_commodity_get_namespace (c) && gnc_commodity_get_mnemonic (c);
+}
+
+/* Stream the same element gnc_price_to_dom_tree builds. Like it, write
+ * nothing and return FALSE for a price that can't be written whole. */
+gboolean
+gnc_price_write_xml (GncXmlWriter& writer, GNCPrice* price)
+{
+    const gchar* typestr, *sourcestr;
+
+    if (!price) return FALSE;
+
+    auto commodity = gnc_price_get_commodity (price);
+    auto currency = gnc_price_get_currency (price);
+    auto time = gnc_price_get_time64 (price);
+
+    if (!commodity_ref_is_valid (commodity) || !commodity_ref_is_valid (currency)
+        || time == INT64_MAX)
+        return FALSE;
+
+    writer.start_element ("price");
+    writer.guid_element ("price:id", gnc_price_get_guid (price));
+    writer.commodity_ref_element ("price:commodity", commodity);
+    writer.commodity_ref_element ("price:currency", currency);
+    writer.time64_element ("price:time", time);
+
+    sourcestr = gnc_price_get_source_string (price);
+    if (sourcestr && (strlen (sourcestr) != 0))
+        writer.content_element ("price:source", sourcestr);
+
+    typestr = gnc_price_get_typestr (price);
+    if (typestr && (strlen (typestr) != 0))
+        writer.content_element ("price:type", typestr);
+
+    writer.numeric_element ("price:value", gnc_price_get_value (price));
+    writer.end_element ();
+
+    return !writer.error ();
+}
+
+struct PriceWriteData
+{
+    GncXmlWriter* writer;
+    sixtp_gdv2* gd;
+    bool started;
+};
+
+static gboolean
+write_price_cb (GNCPrice* p, gpointer data)
+{
+    auto pwd = static_cast<PriceWriteData*> (data);
+    auto commodity = gnc_price_get_commodity (p);
+    auto currency = gnc_price_get_currency (p);
+
+    if (!commodity_ref_is_valid (commodity) || !commodity_ref_is_valid (currency)
+        || gnc_price_get_time64 (p) == INT64_MAX)
+    {
+        PWARN ("Skipping a price without a valid commodity, currency or time");
+        return TRUE;
+    }
+
+    /* The pricedb element is only started once there is a price for it. */
+    if (!pwd->started)
+    {
+        pwd->writer->start_element ("gnc:pricedb");
+        pwd->writer->attribute ("version", "1");
+        pwd->started = true;
+    }
+    if (!gnc_price_write_xml (*pwd->writer, p))
+        return FALSE;
+
+    if (pwd->gd)
+    {
+        pwd->gd->counter.prices_loaded++;
+        sixtp_run_callback (pwd->gd, "prices");
+    }
+    return TRUE;
+}
+
+/* Stream the pricedb element, skipping the prices that can't be written
+ * whole; if there are none, nothing is written. Each price written is
+ * counted in gd unless it is NULL. Returns FALSE on a write error. */
+gboolean
+gnc_pricedb_write_xml (GncXmlWriter& writer, GNCPriceDB* db, sixtp_gdv2* gd)
+{
+    PriceWriteData pwd {&writer, gd, false};
+
+    if (!db || gnc_pricedb_get_num_prices (db) == 0)
+        return TRUE;
+
+    if (!gnc_pricedb_foreach_price (db, write_price_cb, &pwd, TRUE))
+        return FALSE;
+    if (pwd.started)
+        writer.end_element ();
+
+    return !writer.error ();
+}
+
 static gboolean
 xml_add_gnc_price_adapter (GNCPrice* p, gpointer data)
 {
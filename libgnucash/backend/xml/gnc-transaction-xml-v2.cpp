@@ -41,6 +41,7 @@ extern "C"
 #include "sixtp-utils.h"
 #include "sixtp-dom-parsers.h"
 #include "sixtp-dom-generators.h"
+#include "gnc-xml-writer.hpp"
 
 #include "gnc-xml.h"
 
@@ -192,6 +193,81 @@ gnc_transaction_dom_tree_create (Transaction* trn)
     return ret;
 }
 
+/* The streaming equivalents of split_to_dom_tree and
+ * gnc_transaction_dom_tree_create; they must write the same elements in
+ * the same order. */
+static void
+write_split (GncXmlWriter& writer, const gchar* tag, Split* spl)
+{
+    writer.start_element (tag);
+
+    writer.guid_element ("split:id", xaccSplitGetGUID (spl));
+
+    auto memo = xaccSplitGetMemo (spl);
+    if (memo && g_strcmp0 (memo, "") != 0)
+        writer.text_element ("split:memo", memo);
+
+    auto action = xaccSplitGetAction (spl);
+    if (action && g_strcmp0 (action, "") != 0)
+        writer.text_element ("split:action", action);
+
+    char tmp[2];
+    tmp[0] = xaccSplitGetReconcile (spl);
+    tmp[1] = '\0';
+    writer.text_element ("split:reconciled-state", tmp);
+
+    auto reconciled = xaccSplitGetDateReconciled (spl);
+    if (reconciled)
+        writer.time64_element ("split:reconcile-date", reconciled);
+
+    writer.numeric_element ("split:value", xaccSplitGetValue (spl));
+    writer.numeric_element ("split:quantity", xaccSplitGetAmount (spl));
+
+    writer.guid_element ("split:account",
+                         xaccAccountGetGUID (xaccSplitGetAccount (spl)));
+
+    GNCLot* lot = xaccSplitGetLot (spl);
+    if (lot)
+        writer.guid_element ("split:lot", gnc_lot_get_guid (lot));
+
+    writer.slots_element ("split:slots", QOF_INSTANCE (spl));
+
+    writer.end_element ();
+}
+
+gboolean
+gnc_transaction_write_xml (GncXmlWriter& writer, Transaction* trn)
+{
+    writer.start_element ("gnc:transaction");
+    writer.attribute ("version", transaction_version_string);
+
+    writer.guid_element ("trn:id", xaccTransGetGUID (trn));
+
+    writer.commodity_ref_element ("trn:currency",
+                                  xaccTransGetCurrency (trn));
+
+    auto num = xaccTransGetNum (trn);
+    if (num && g_strcmp0 (num, "") != 0)
+        writer.text_element ("trn:num", num);
+
+    writer.time64_element ("trn:date-posted", xaccTransRetDatePosted (trn));
+    writer.time64_element ("trn:date-entered", xaccTransRetDateEntered (trn));
+
+    auto description = xaccTransGetDescription (trn);
+    if (description)
+        writer.text_element ("trn:description", description);
+
+    writer.slots_element ("trn:slots", QOF_INSTANCE (trn));
+
+    writer.start_element ("trn:splits");
+    for (auto n = xaccTransGetSplitList (trn); n; n = n->next)
+        write_split (writer, "trn:split", static_cast<Split*> (n->data));
+    writer.end_element ();
+
+    writer.end_element ();
+    return !writer.error ();
+}
+
 /***********************************************************************/
 
 struct split_pdata
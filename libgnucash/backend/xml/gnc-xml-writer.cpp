@@ -0,0 +1,468 @@
+/********************************************************************
+ * gnc-xml-writer.cpp: Stream XML to a file without building a DOM. *
+ *                                                                  *
+ * This program is free software; you can redistribute it and/or    *
+ * modify it under the terms of the GNU General Public License as   *
+ * published by the Free Software Foundation; either version 2 of   *
+ * the License, or (at your option) any later version.              *
+ *                                                                  *
+ * This program is distributed in the hope that it will be useful,  *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of   *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the    *
+ * GNU General Public License for more details.                     *
+ *                                                                  *
+ * You should have received a copy of the GNU General Public License*
+ * along with this program; if not, contact:                        *
+ *                                                                  *
+ * Free Software Foundation           Voice:  +1-617-542-5942       *
+ * 51 Franklin Street, Fifth Floor    Fax:    +1-617-542-2652       *
+ * Boston, MA  02110-1301,  USA       gnu@gnu.org                   *
+\********************************************************************/
+extern "C"
+{
+#include <config.h>
+#include <glib.h>
+#include <gnc-date.h>
+}
+
+#include "gnc-xml-writer.hpp"
+#include "sixtp-dom-generators.h"
+
+#include <kvp-frame.hpp>
+#include <gnc-datetime.hpp>
+#include <algorithm>
+
+static QofLogModule log_module = GNC_MOD_IO;
+
+/* libxml2 stops indenting below this depth. */
+static const size_t MAX_INDENT_LEVEL = 30;
+
+/* Flush once this much has been buffered even inside an element. */
+static const size_t WRITE_CHUNK_SIZE = 64 * 1024;
+
+void
+GncXmlWriter::indent (size_t level)
+{
+    m_buf.append (2 * std::min (level, MAX_INDENT_LEVEL), ' ');
+}
+
+/* Close the start tag of the current element ahead of its first child. As
+ * in xmlNodeDumpOutput, an element holding text has none of its content
+ * indented. */
+void
+GncXmlWriter::open_parent_for (bool text)
+{
+    auto& parent = m_stack.back ();
+    if (parent.has_children)
+        return;
+    parent.has_children = true;
+    if (text)
+        parent.format = false;
+    m_buf += '>';
+    if (parent.format)
+        m_buf += '\n';
+}
+
+/* Apply checked_char_cast's replacements and libxml2's escaping for text
+ * content or attribute values. */
+void
+GncXmlWriter::append_text (const char* text, bool attr)
+{
+    const gchar* end;
+    gboolean valid;
+
+    do
+    {
+        valid = g_utf8_validate (text, -1, &end);
+        for (auto p = text; p < end; ++p)
+        {
+            auto c = static_cast<unsigned char> (*p);
+            switch (c)
+            {
+            case '<':
+                m_buf += "&lt;";
+                break;
+            case '>':
+                m_buf += "&gt;";
+                break;
+            case '&':
+                m_buf += "&amp;";
+                break;
+            case '\r':
+                m_buf += "&#13;";
+                break;
+            case '"':
+                m_buf += attr ? "&quot;" : "\"";
+                break;
+            case '\n':
+                m_buf += attr ? "&#10;" : "\n";
+                break;
+            case '\t':
+                m_buf += attr ? "&#9;" : "\t";
+                break;
+            default:
+                if (c < 0x20)
+                    m_buf += '?';
+                else if (c >= 0x80 && attr)
+                {
+                    /* Attributes are written as if to a document without
+                     * an encoding, so non-ASCII becomes character refs. */
+                    gchar ref[16];
+                    g_snprintf (ref, sizeof (ref), "&#x%X;",
+                                g_utf8_get_char (p));
+                    m_buf += ref;
+                    p = g_utf8_next_char (p) - 1;
+                }
+                else
+                    m_buf += *p;
+            }
+        }
+        if (!valid)
+        {
+            m_buf += '?';
+            text = end + 1;
+        }
+    }
+    while (!valid);
+}
+
+void
+GncXmlWriter::start_element (const char* tag)
+{
+    bool format = true;
+
+    if (!m_stack.empty ())
+    {
+        open_parent_for (false);
+        format = m_stack.back ().format;
+        if (format)
+            indent (m_stack.size ());
+    }
+    m_buf += '<';
+    m_buf += tag;
+    m_stack.push_back ({tag, false, format});
+}
+
+void
+GncXmlWriter::attribute (const char* name, const char* value)
+{
+    g_return_if_fail (!m_stack.empty () && !m_stack.back ().has_children);
+    g_return_if_fail (name && value);
+
+    m_buf += ' ';
+    m_buf += name;
+    m_buf += "=\"";
+    append_text (value, true);
+    m_buf += '"';
+}
+
+void
+GncXmlWriter::text (const char* text)
+{
+    g_return_if_fail (!m_stack.empty ());
+
+    open_parent_for (true);
+    if (text)
+        append_text (text, false);
+}
+
+void
+GncXmlWriter::content (const char* text)
+{
+    if (text && *text)
+        this->text (text);
+}
+
+void
+GncXmlWriter::end_element ()
+{
+    g_return_if_fail (!m_stack.empty ());
+
+    auto element = m_stack.back ();
+    m_stack.pop_back ();
+    if (!element.has_children)
+        m_buf += "/>";
+    else
+    {
+        if (element.format)
+            indent (m_stack.size ());
+        m_buf += "</";
+        m_buf += element.tag;
+        m_buf += '>';
+    }
+
+    if (m_stack.empty ())
+        flush ();
+    else
+    {
+        if (m_stack.back ().format)
+            m_buf += '\n';
+        if (m_buf.size () >= WRITE_CHUNK_SIZE)
+            flush ();
+    }
+}
+
+gboolean
+GncXmlWriter::flush ()
+{
+    if (!m_buf.empty ())
+    {
+        fwrite (m_buf.data (), 1, m_buf.size (), m_out);
+        m_buf.clear ();
+    }
+    return !error ();
+}
+
+void
+GncXmlWriter::text_element (const char* tag, const char* text)
+{
+    start_element (tag);
+    if (text)
+        this->text (text);
+    end_element ();
+}
+
+void
+GncXmlWriter::content_element (const char* tag, const char* text)
+{
+    start_element (tag);
+    content (text);
+    end_element ();
+}
+
+void
+GncXmlWriter::guid_element (const char* tag, const GncGUID* guid)
+{
+    char guid_str[GUID_ENCODING_LENGTH + 1];
+
+    if (!guid_to_string_buff (guid, guid_str))
+    {
+        PERR ("guid_to_string_buff failed\n");
+        return;
+    }
+
+    start_element (tag);
+    attribute ("type", "guid");
+    content (guid_str);
+    end_element ();
+}
+
+gboolean
+GncXmlWriter::commodity_ref_element (const char* tag, const gnc_commodity* c)
+{
+    g_return_val_if_fail (c, FALSE);
+
+    auto name_space = gnc_commodity_get_namespace (c);
+    auto mnemonic = gnc_commodity_get_mnemonic (c);
+    if (!name_space || !mnemonic)
+        return FALSE;
+
+    start_element (tag);
+    text_element ("cmdty:space", name_space);
+    text_element ("cmdty:id", mnemonic);
+    end_element ();
+    return TRUE;
+}
+
+static std::string
+time64_to_xml_string (time64 time)
+{
+    g_return_val_if_fail (time != INT64_MAX, "");
+    auto date_str = GncDateTime (time).format_iso8601 ();
+    if (!date_str.empty ())
+        date_str += " +0000"; /* As in time64_to_dom_tree */
+    return date_str;
+}
+
+gboolean
+GncXmlWriter::time64_element (const char* tag, time64 time)
+{
+    auto date_str = time64_to_xml_string (time);
+    if (date_str.empty ())
+        return FALSE;
+
+    start_element (tag);
+    text_element ("ts:date", date_str.c_str ());
+    end_element ();
+    return TRUE;
+}
+
+void
+GncXmlWriter::gdate_element (const char* tag, const GDate* date)
+{
+    gchar date_str[512];
+
+    g_return_if_fail (date);
+    g_date_strftime (date_str, sizeof (date_str), "%Y-%m-%d", date);
+
+    start_element (tag);
+    text_element ("gdate", date_str);
+    end_element ();
+}
+
+void
+GncXmlWriter::numeric_element (const char* tag, gnc_numeric num)
+{
+    gchar* numstr = gnc_numeric_to_string (num);
+    g_return_if_fail (numstr);
+
+    content_element (tag, numstr);
+    g_free (numstr);
+}
+
+/* These follow add_kvp_value_node and add_kvp_slot in
+ * sixtp-dom-generators.cpp element for element. */
+static void write_kvp_slot (GncXmlWriter& writer, const char* key,
+                            KvpValue* value);
+
+static void
+write_kvp_text_value (GncXmlWriter& writer, const char* tag,
+                      const char* type, gchar* text)
+{
+    writer.start_element (tag);
+    writer.attribute ("type", type);
+    writer.content (text);
+    writer.end_element ();
+    g_free (text);
+}
+
+static void
+write_kvp_value (GncXmlWriter& writer, const char* tag, KvpValue* val)
+{
+    switch (val->get_type ())
+    {
+    case KvpValue::Type::INT64:
+        write_kvp_text_value (writer, tag, "integer",
+                              g_strdup_printf ("%" G_GINT64_FORMAT,
+                                               val->get<int64_t> ()));
+        break;
+    case KvpValue::Type::DOUBLE:
+        write_kvp_text_value (writer, tag, "double",
+                              double_to_string (val->get<double> ()));
+        break;
+    case KvpValue::Type::NUMERIC:
+        write_kvp_text_value (writer, tag, "numeric",
+                              gnc_numeric_to_string (val->get<gnc_numeric> ()));
+        break;
+    case KvpValue::Type::STRING:
+        writer.start_element (tag);
+        writer.attribute ("type", "string");
+        if (auto str = val->get<const char*> ())
+            writer.text (str);
+        writer.end_element ();
+        break;
+    case KvpValue::Type::GUID:
+    {
+        gchar guidstr[GUID_ENCODING_LENGTH + 1] = "";
+        guid_to_string_buff (val->get<GncGUID*> (), guidstr);
+        write_kvp_text_value (writer, tag, "guid", g_strdup (guidstr));
+        break;
+    }
+    /* Note: The type attribute must remain 'timespec' to maintain
+     * compatibility.
+     */
+    case KvpValue::Type::TIME64:
+    {
+        auto date_str = time64_to_xml_string (val->get<Time64> ().t);
+        if (date_str.empty ())
+            break;
+        writer.start_element (tag);
+        writer.attribute ("type", "timespec");
+        writer.text_element ("ts:date", date_str.c_str ());
+        writer.end_element ();
+        break;
+    }
+    case KvpValue::Type::GDATE:
+    {
+        auto d = val->get<GDate> ();
+        gchar date_str[512];
+        g_date_strftime (date_str, sizeof (date_str), "%Y-%m-%d", &d);
+        writer.start_element (tag);
+        writer.attribute ("type", "gdate");
+        writer.text_element ("gdate", date_str);
+        writer.end_element ();
+        break;
+    }
+    case KvpValue::Type::GLIST:
+        writer.start_element (tag);
+        writer.attribute ("type", "list");
+        for (auto cursor = val->get<GList*> (); cursor; cursor = cursor->next)
+            write_kvp_value (writer, "slot:value",
+                             static_cast<KvpValue*> (cursor->data));
+        writer.end_element ();
+        break;
+    case KvpValue::Type::FRAME:
+    {
+        writer.start_element (tag);
+        writer.attribute ("type", "frame");
+        if (auto frame = val->get<KvpFrame*> ())
+            frame->for_each_slot_temp ([&writer] (const char* key,
+                                                  KvpValue* value)
+            {
+                write_kvp_slot (writer, key, value);
+            });
+        writer.end_element ();
+        break;
+    }
+    default:
+        writer.start_element (tag);
+        writer.end_element ();
+        break;
+    }
+}
+
+static void
+write_kvp_slot (GncXmlWriter& writer, const char* key, KvpValue* value)
+{
+    writer.start_element ("slot");
+    writer.text_element ("slot:key", key);
+    write_kvp_value (writer, "slot:value", value);
+    writer.end_element ();
+}
+
+void
+GncXmlWriter::slots_element (const char* tag, const QofInstance* inst)
+{
+    KvpFrame* frame = qof_instance_get_slots (inst);
+    if (!frame || frame->empty ())
+        return;
+
+    start_element (tag);
+    frame->for_each_slot_temp ([this] (const char* key, KvpValue* value)
+    {
+        write_kvp_slot (*this, key, value);
+    });
+    end_element ();
+}
+
+void
+GncXmlWriter::dom_tree (xmlNodePtr node)
+{
+    switch (node->type)
+    {
+    case XML_ELEMENT_NODE:
+        start_element (reinterpret_cast<const char*> (node->name));
+        for (auto attr = node->properties; attr; attr = attr->next)
+        {
+            auto value = xmlNodeListGetString (NULL, attr->children, 1);
+            attribute (reinterpret_cast<const char*> (attr->name),
+                       value ? reinterpret_cast<const char*> (value) : "");
+            xmlFree (value);
+        }
+        /* Any text among the children stops libxml2 indenting them. */
+        for (auto child = node->children; child; child = child->next)
+            if (child->type == XML_TEXT_NODE)
+                m_stack.back ().format = false;
+        for (auto child = node->children; child; child = child->next)
+            dom_tree (child);
+        end_element ();
+        break;
+    case XML_TEXT_NODE:
+        text (node->content ? reinterpret_cast<const char*> (node->content)
+              : "");
+        break;
+    default:
+        PWARN ("Skipping XML node of type %d", node->type);
+        break;
+    }
+}
@@ -0,0 +1,104 @@
+/********************************************************************
+ * gnc-xml-writer.hpp: Stream XML to a file without building a DOM. *
+ *                                                                  *
+ * This program is free software; you can redistribute it and/or    *
+ * modify it under the terms of the GNU General Public License as   *
+ * published by the Free Software Foundation; either version 2 of   *
+ * the License, or (at your option) any later version.              *
+ *                                                                  *
+ * This program is distributed in the hope that it will be useful,  *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of   *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the    *
+ * GNU General Public License for more details.                     *
+ *                                                                  *
+ * You should have received a copy of the GNU General Public License*
+ * along with this program; if not, contact:                        *
+ *                                                                  *
+ * Free Software Foundation           Voice:  +1-617-542-5942       *
+ * 51 Franklin Street, Fifth Floor    Fax:    +1-617-542-2652       *
+ * Boston, MA  02110-1301,  USA       gnu@gnu.org                   *
+\********************************************************************/
+
+#ifndef __GNC_XML_WRITER_HPP__
+#define __GNC_XML_WRITER_HPP__
+
+extern "C"
+{
+#include <stdio.h>
+#include <glib.h>
+#include "gnc-commodity.h"
+#include "qof.h"
+}
+
+#include <string>
+#include <vector>
+#include "gnc-xml-helper.h"
+
+/** Writes XML elements straight to a FILE*, producing exactly the bytes
+ * that xmlElemDump would for the equivalent tree built by the
+ * sixtp-dom-generators functions: two-space indentation, elements holding
+ * text written on one line and childless elements closed with "/>".
+ *
+ * Output is buffered and always written out when a top-level element is
+ * closed, so callers may fprintf to the same FILE* between elements. As
+ * with xmlElemDump, no newline follows a top-level element.
+ *
+ * Element content is either text or child elements, never both. Tag and
+ * attribute name strings must stay valid until their element is ended.
+ */
+class GncXmlWriter
+{
+public:
+    explicit GncXmlWriter (FILE* out) : m_out{out} {}
+    GncXmlWriter (const GncXmlWriter&) = delete;
+    GncXmlWriter& operator= (const GncXmlWriter&) = delete;
+    ~GncXmlWriter () { flush (); }
+
+    void start_element (const char* tag);
+    void attribute (const char* name, const char* value);
+    /** Add a text node to the current element, even an empty one. */
+    void text (const char* text);
+    /** Like xmlNodeAddContent: add text unless it is empty. */
+    void content (const char* text);
+    void end_element ();
+
+    /** Like xmlNewTextChild: the element holds a text node even when
+     * text is empty, and is empty only if text is NULL. */
+    void text_element (const char* tag, const char* text);
+    /** Like text_to_dom_tree: an empty text yields an empty element. */
+    void content_element (const char* tag, const char* text);
+    void guid_element (const char* tag, const GncGUID* guid);
+    /** Returns FALSE, writing nothing, if the commodity has no namespace
+     * or mnemonic. */
+    gboolean commodity_ref_element (const char* tag, const gnc_commodity* c);
+    /** Returns FALSE, writing nothing, if time can't be formatted. */
+    gboolean time64_element (const char* tag, time64 time);
+    void gdate_element (const char* tag, const GDate* date);
+    void numeric_element (const char* tag, gnc_numeric num);
+    /** Write the instance's slots, or nothing if it has none. */
+    void slots_element (const char* tag, const QofInstance* inst);
+    /** Write a tree built by the DOM generators. */
+    void dom_tree (xmlNodePtr node);
+
+    /** Write out anything buffered. Returns FALSE on a write error. */
+    gboolean flush ();
+    gboolean error () const { return ferror (m_out) != 0; }
+
+private:
+    struct Element
+    {
+        const char* tag;
+        bool has_children;      /* the start tag has been closed */
+        bool format;            /* children are indented, one per line */
+    };
+
+    void open_parent_for (bool text);
+    void indent (size_t level);
+    void append_text (const char* text, bool attr);
+
+    FILE* m_out;
+    std::string m_buf;
+    std::vector<Element> m_stack;
+};
+
+#endif /* __GNC_XML_WRITER_HPP__ */
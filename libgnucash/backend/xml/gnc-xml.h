@@ -36,6 +36,8 @@ extern "C"
 #include "gnc-xml-helper.h"
 #include "sixtp.h"
 
+class GncXmlWriter;
+
 xmlNodePtr gnc_account_dom_tree_create (Account* act, gboolean exporting,
                                         gboolean allow_incompat);
 sixtp* gnc_account_sixtp_parser_create (void);
@@ -54,6 +56,10 @@ xmlNodePtr gnc_lot_dom_tree_create (GNCLot*);
 sixtp* gnc_lot_sixtp_parser_create (void);
 
 xmlNodePtr gnc_pricedb_dom_tree_create (GNCPriceDB* db);
+gboolean gnc_price_write_xml (GncXmlWriter& writer, GNCPrice* price);
+gboolean gnc_pricedb_write_xml (GncXmlWriter& writer, GNCPriceDB* db,
+                                sixtp_gdv2* gd);
+GNCPrice* dom_tree_to_price (xmlNodePtr node, QofBook* book);
 sixtp* gnc_pricedb_sixtp_parser_create (void);
 
 xmlNodePtr gnc_schedXaction_dom_tree_create (SchedXaction* sx);
@@ -63,6 +69,7 @@ xmlNodePtr gnc_budget_dom_tree_create (GncBudget* bgt);
 sixtp* gnc_budget_sixtp_parser_create (void);
 
 xmlNodePtr gnc_transaction_dom_tree_create (Transaction* txn);
+gboolean gnc_transaction_write_xml (GncXmlWriter& writer, Transaction* txn);
 sixtp* gnc_transaction_sixtp_parser_create (void);
 
 sixtp* gnc_template_transaction_sixtp_parser_create (void);
@@ -70,11 +70,16 @@ extern "C"
 #include "sixtp-parsers.h"
 #include "sixtp-utils.h"
 #include "gnc-xml.h"
+#include "gnc-xml-writer.hpp"
 #include "io-utils.h"
 #include "sixtp-dom-parsers.h"
 #include "io-gncxml-v2.h"
 #include "io-gncxml-gen.h"
 
+#include <deque>
+#include <string>
+#include <vector>
+
 /* Do not treat -Wstrict-aliasing warnings as errors because of problems of the
  * G_LOCK* macros as declared by glib.  See
  * https://bugs.gnucash.org/show_bug.cgi?id=316221 for additional information.
@@ -107,6 +112,7 @@ struct file_backend
     sixtp*          parser;
     FILE*           out;
     QofBook*        book;
+    GncXmlWriter*   writer;
 };
 
 static std::vector<GncXmlDataType_t> backend_registry;
@@ -545,6 +551,7 @@ static const char* TRANSACTION_TAG = "gnc:transaction";
 static const char* SCHEDXACTION_TAG = "gnc:schedxaction";
 static const char* TEMPLATE_TRANSACTION_TAG = "gnc:template-transactions";
 static const char* BUDGET_TAG = "gnc:budget";
+static const char* PRICE_TAG = "price";
 
 static void
 add_item (const GncXmlDataType_t& data, struct file_backend* be_data)
@@ -634,6 +641,539 @@ generic_callback (const char* tag, gpointer globaldata, gpointer data)
     return TRUE;
 }
 
+/***********************************************************************/
+/* Parallel loading
+ *
+ * Most of a large book is long runs of sibling <gnc:account> and
+ * <gnc:transaction> elements, and of <price> elements in the
+ * <gnc:pricedb>.  Parsing those into DOM trees doesn't touch the engine, so
+ * the loader cuts each run into chunks which a thread pool parses with
+ * libxml2.  The main thread pushes everything between the chunks through
+ * the sixtp parser as before, and hands each chunk's trees, in file order,
+ * to the same code the sixtp parser would have called for them.  Only
+ * that last step touches the book.
+ *
+ * The file is read and scanned a block at a time, and the text of each
+ * chunk or stretch between chunks is copied out into a segment.  Only the
+ * segments queued ahead of the main thread are held in memory, never the
+ * whole file.
+ */
+
+/* Runs are cut into chunks of about this many bytes. */
+#define LOAD_CHUNK_SIZE (256 * 1024)
+/* How many chunks per thread may be queued ahead of the main thread. */
+#define LOAD_CHUNKS_AHEAD 4
+/* The file is read this much at a time. */
+#define LOAD_READ_SIZE (64 * 1024)
+
+struct load_segment
+{
+    std::string text;
+    const char* tag;            /* The tag of every element in a chunk, or
+                                 * NULL for text for the sixtp parser */
+    xmlDocPtr doc;              /* NULL if it didn't parse */
+    gboolean parsed;
+};
+
+/* Offsets are from the start of the file. */
+struct load_scanner
+{
+    FILE* file;
+    std::string buf;            /* The file from base on */
+    size_t base;
+    size_t pos;                 /* Where scanning resumes */
+    size_t queued;              /* Everything before this is in a segment */
+    gboolean eof;
+    gboolean scanning;          /* FALSE once the rest goes to sixtp */
+    std::vector<std::string> stack; /* The open elements' names */
+    const char* chunk_tag;      /* Set while a chunk is being gathered */
+    size_t chunk_begin;
+    size_t chunk_end;
+    size_t chunk_depth;
+};
+
+struct chunked_load
+{
+    load_scanner scanner;
+    std::deque<load_segment> segments;
+    size_t queued_bytes;
+    gxpf_data* gpdata;
+    sixtp* account_parser;
+    sixtp* transaction_parser;
+    GThreadPool* pool;
+    GMutex mutex;
+    GCond cond;
+    gboolean ok;
+};
+
+static const char*
+load_chunk_tag (const std::string& name, const std::string& parent)
+{
+    if (parent == BOOK_TAG || parent == GNC_V2_STRING)
+    {
+        if (name == TRANSACTION_TAG)
+            return TRANSACTION_TAG;
+        if (name == ACCOUNT_TAG)
+            return ACCOUNT_TAG;
+    }
+    else if (parent == PRICEDB_TAG && name == PRICE_TAG)
+        return PRICE_TAG;
+    return NULL;
+}
+
+static gboolean
+only_whitespace (const char* text, size_t len)
+{
+    for (size_t i = 0; i < len; i++)
+        if (!g_ascii_isspace (text[i]))
+            return FALSE;
+    return TRUE;
+}
+
+/* The chunks are parsed as UTF-8, so only look for them in files that
+ * are. */
+static gboolean
+load_is_utf8 (const std::string& contents)
+{
+    if (contents.compare (0, 5, "<?xml") != 0)
+        return TRUE;
+
+    auto decl_end = contents.find ("?>");
+    auto encoding = contents.find ("encoding=", 0);
+    if (decl_end == std::string::npos || encoding == std::string::npos
+        || encoding > decl_end)
+        return TRUE;
+
+    auto value = contents.c_str () + encoding + strlen ("encoding=") + 1;
+    return g_ascii_strncasecmp (value, "utf-8", 5) == 0
+           || g_ascii_strncasecmp (value, "utf8", 4) == 0;
+}
+
+/* Read another block, first dropping what is already in segments.
+ * Returns FALSE if there was nothing more to read. */
+static gboolean
+load_read (chunked_load* load)
+{
+    auto& sc = load->scanner;
+
+    if (sc.eof)
+        return FALSE;
+
+    sc.buf.erase (0, sc.queued - sc.base);
+    sc.base = sc.queued;
+
+    auto old_size = sc.buf.size ();
+    sc.buf.resize (old_size + LOAD_READ_SIZE);
+    auto len = fread (&sc.buf[old_size], 1, LOAD_READ_SIZE, sc.file);
+    sc.buf.resize (old_size + len);
+    if (len < LOAD_READ_SIZE)
+    {
+        sc.eof = TRUE;
+        if (ferror (sc.file))
+        {
+            PWARN ("Error reading XML file");
+            load->ok = FALSE;
+        }
+    }
+    return len > 0;
+}
+
+/* Queue the text from begin to end, as a chunk for the thread pool if tag
+ * is set. */
+static void
+queue_segment (chunked_load* load, size_t begin, size_t end, const char* tag)
+{
+    auto& sc = load->scanner;
+
+    if (end <= begin)
+        return;
+    load->segments.push_back (load_segment {
+        std::string (sc.buf, begin - sc.base, end - begin), tag, NULL, FALSE});
+    load->queued_bytes += end - begin;
+    sc.queued = end;
+    if (tag)
+        g_thread_pool_push (load->pool, &load->segments.back (), NULL);
+}
+
+static void
+finish_chunk (chunked_load* load)
+{
+    auto& sc = load->scanner;
+
+    if (sc.chunk_tag && sc.chunk_end > sc.chunk_begin)
+    {
+        queue_segment (load, sc.queued, sc.chunk_begin, NULL);
+        queue_segment (load, sc.chunk_begin, sc.chunk_end, sc.chunk_tag);
+    }
+    sc.chunk_tag = NULL;
+}
+
+enum load_scan_result
+{
+    LOAD_SCAN_OK,
+    LOAD_SCAN_MORE,             /* The buffer ends inside the next token */
+    LOAD_SCAN_STOP              /* Leave the rest of the file to sixtp */
+};
+
+/* Scan the next token, gathering runs of sibling elements into chunks.
+ * This only tokenizes the file: anything unexpected just leaves the
+ * affected elements to the sixtp parser, which will also report any real
+ * error. */
+static load_scan_result
+scan_load_token (chunked_load* load)
+{
+    auto& sc = load->scanner;
+    const std::string& buf = sc.buf;
+    const char* doc = buf.data ();
+    size_t size = buf.size ();
+    size_t base = sc.base;      /* Offsets below are into buf. */
+    /* The longest token prefix that is compared below. */
+    const size_t lookahead = 9;
+
+    auto starts = [&] (size_t at, const char* s)
+    {
+        return buf.compare (at, strlen (s), s) == 0;
+    };
+
+    size_t pos = sc.pos - base;
+    auto lt = static_cast<const char*> (memchr (doc + pos, '<', size - pos));
+    if (!lt)
+    {
+        sc.pos = base + size;
+        return LOAD_SCAN_MORE;
+    }
+    size_t start = lt - doc;
+    sc.pos = base + start;
+    if (size - start < lookahead && !sc.eof)
+        return LOAD_SCAN_MORE;
+
+    if (starts (start, "</"))
+    {
+        auto gt = buf.find ('>', start);
+        if (gt == std::string::npos)
+            return LOAD_SCAN_MORE;
+        if (sc.stack.empty ())
+            return LOAD_SCAN_STOP;
+        sc.pos = base + gt + 1;
+        sc.stack.pop_back ();
+        if (sc.chunk_tag && sc.stack.size () == sc.chunk_depth)
+            sc.chunk_end = sc.pos;
+        else if (sc.chunk_tag && sc.stack.size () < sc.chunk_depth)
+            finish_chunk (load);
+        return LOAD_SCAN_OK;
+    }
+
+    if (starts (start, "<!") || starts (start, "<?"))
+    {
+        size_t end;
+        if (starts (start, "<!--"))
+            end = buf.find ("-->", start);
+        else if (starts (start, "<![CDATA["))
+            end = buf.find ("]]>", start);
+        else if (starts (start, "<?"))
+            end = buf.find ("?>", start);
+        else
+        {
+            /* A DOCTYPE could declare entities the chunk parser
+             * wouldn't see. */
+            end = buf.find ('>', start);
+            if (end != std::string::npos && buf.find ('[', start) < end)
+                return LOAD_SCAN_STOP;
+        }
+        if (end == std::string::npos)
+            return LOAD_SCAN_MORE;
+
+        /* The DOM trees the sixtp parser builds have neither comments
+         * nor CDATA sections, so keep the sixtp parser for any element
+         * containing them. */
+        if (sc.chunk_tag && sc.stack.size () > sc.chunk_depth)
+            finish_chunk (load);
+        sc.pos = base + buf.find ('>', end) + 1;
+        return LOAD_SCAN_OK;
+    }
+
+    /* A start tag. */
+    size_t p = start + 1;
+    while (p < size && !strchr (" \t\r\n/>", doc[p]))
+        p++;
+    size_t name_end = p;
+    char quote = 0;
+    for (; p < size; p++)
+    {
+        if (quote)
+        {
+            if (doc[p] == quote)
+                quote = 0;
+        }
+        else if (doc[p] == '"' || doc[p] == '\'')
+            quote = doc[p];
+        else if (doc[p] == '>')
+            break;
+    }
+    if (p >= size)
+        return LOAD_SCAN_MORE;
+    sc.pos = base + p + 1;
+
+    std::string name (doc + start + 1, name_end - start - 1);
+    const char* tag = sc.stack.empty () ? nullptr
+                      : load_chunk_tag (name, sc.stack.back ());
+    if (sc.chunk_tag && sc.stack.size () == sc.chunk_depth
+        && (tag != sc.chunk_tag
+            || sc.chunk_end - sc.chunk_begin >= LOAD_CHUNK_SIZE
+            || !only_whitespace (doc + sc.chunk_end - base,
+                                 base + start - sc.chunk_end)))
+        finish_chunk (load);
+    if (tag && !sc.chunk_tag)
+    {
+        sc.chunk_begin = sc.chunk_end = base + start;
+        sc.chunk_tag = tag;
+        sc.chunk_depth = sc.stack.size ();
+    }
+
+    if (doc[p - 1] == '/')
+    {
+        if (tag)
+            sc.chunk_end = sc.pos;
+    }
+    else
+        sc.stack.push_back (std::move (name));
+    return LOAD_SCAN_OK;
+}
+
+/* Scan until at least one more segment is queued. Returns FALSE once the
+ * whole file is in segments. */
+static gboolean
+scan_load (chunked_load* load)
+{
+    auto& sc = load->scanner;
+    auto n_segments = load->segments.size ();
+
+    while (load->segments.size () == n_segments && load->ok)
+    {
+        if (!sc.scanning)
+        {
+            /* Pass the rest of the file through a block at a time. */
+            queue_segment (load, sc.queued, sc.base + sc.buf.size (), NULL);
+            if (load->segments.size () == n_segments && !load_read (load))
+                return FALSE;
+            continue;
+        }
+
+        switch (scan_load_token (load))
+        {
+        case LOAD_SCAN_OK:
+            /* Don't let the text between chunks pile up. */
+            if (!sc.chunk_tag && sc.pos - sc.queued >= LOAD_CHUNK_SIZE)
+                queue_segment (load, sc.queued, sc.pos, NULL);
+            break;
+        case LOAD_SCAN_MORE:
+            if (load_read (load))
+                break;
+            /* Fall through: the file ends inside a token. */
+        case LOAD_SCAN_STOP:
+            finish_chunk (load);
+            sc.scanning = FALSE;
+            break;
+        }
+    }
+    return load->ok;
+}
+
+/* Thread pool function: parse one chunk into a DOM tree. */
+static void
+parse_load_chunk (gpointer data, gpointer user_data)
+{
+    static const char open_tag[] = "<gnc-chunk>";
+    static const char close_tag[] = "</gnc-chunk>";
+    auto chunk = static_cast<load_segment*> (data);
+    auto load = static_cast<chunked_load*> (user_data);
+    xmlDocPtr doc = NULL;
+
+    /* The namespace prefixes are declared only in the document's root, so
+     * libxml2 names the nodes with their prefixes just as the sixtp DOM
+     * parser does. */
+    auto ctxt = xmlCreatePushParserCtxt (NULL, NULL, NULL, 0, NULL);
+    if (ctxt)
+    {
+        xmlCtxtUseOptions (ctxt, XML_PARSE_NONET | XML_PARSE_NOERROR
+                           | XML_PARSE_NOWARNING);
+        xmlParseChunk (ctxt, open_tag, sizeof (open_tag) - 1, 0);
+        xmlParseChunk (ctxt, chunk->text.data (),
+                       static_cast<int> (chunk->text.size ()), 0);
+        xmlParseChunk (ctxt, close_tag, sizeof (close_tag) - 1, 1);
+        if (ctxt->wellFormed)
+            doc = ctxt->myDoc;
+        else if (ctxt->myDoc)
+            xmlFreeDoc (ctxt->myDoc);
+        xmlFreeParserCtxt (ctxt);
+    }
+
+    g_mutex_lock (&load->mutex);
+    chunk->doc = doc;
+    chunk->parsed = TRUE;
+    g_cond_broadcast (&load->cond);
+    g_mutex_unlock (&load->mutex);
+}
+
+/* Do with a tree from a chunk what its sixtp parser would have done. */
+static gboolean
+add_load_chunk_element (chunked_load* load, const char* tag, xmlNodePtr tree)
+{
+    gpointer result = NULL;
+
+    if (tag == PRICE_TAG)
+    {
+        auto book = static_cast<QofBook*> (load->gpdata->bookdata);
+        auto gd = static_cast<sixtp_gdv2*> (load->gpdata->parsedata);
+        GNCPrice* p = dom_tree_to_price (tree, book);
+
+        xmlFreeNode (tree);
+        if (!p)
+            return FALSE;
+        gnc_pricedb_add_price (gnc_pricedb_get_db (book), p);
+        gnc_price_unref (p);
+        gd->counter.prices_loaded++;
+        sixtp_run_callback (gd, "prices");
+        return TRUE;
+    }
+
+    auto parser = (tag == TRANSACTION_TAG) ? load->transaction_parser
+                  : load->account_parser;
+    return parser->end_handler (tree, NULL, NULL, NULL, load->gpdata,
+                                &result, tag);
+}
+
+static gboolean
+push_load_contents (xmlParserCtxtPtr xml_context, const char* text,
+                    size_t len, gboolean terminate)
+{
+    const size_t max_push = 64 * 1024 * 1024;
+
+    while (len > max_push)
+    {
+        xmlParseChunk (xml_context, text, static_cast<int> (max_push), 0);
+        text += max_push;
+        len -= max_push;
+    }
+    xmlParseChunk (xml_context, text, static_cast<int> (len), terminate);
+    return xml_context->wellFormed;
+}
+
+static void
+chunked_load_push_handler (xmlParserCtxtPtr xml_context, gpointer user_data)
+{
+    auto load = static_cast<chunked_load*> (user_data);
+    size_t max_queued = g_get_num_processors () * LOAD_CHUNKS_AHEAD
+                        * LOAD_CHUNK_SIZE;
+    gboolean more = TRUE;
+
+    while (load->ok)
+    {
+        while (more && load->queued_bytes < max_queued)
+            more = scan_load (load);
+        if (load->segments.empty ())
+            break;
+
+        auto& segment = load->segments.front ();
+        if (segment.tag)
+        {
+            g_mutex_lock (&load->mutex);
+            while (!segment.parsed)
+                g_cond_wait (&load->cond, &load->mutex);
+            g_mutex_unlock (&load->mutex);
+        }
+
+        if (segment.doc)
+        {
+            xmlNodePtr next;
+            for (auto node = xmlDocGetRootElement (segment.doc)->children;
+                 node && load->ok; node = next)
+            {
+                next = node->next;
+                if (node->type != XML_ELEMENT_NODE)
+                    continue;
+                xmlUnlinkNode (node);
+                load->ok = add_load_chunk_element (load, segment.tag, node);
+            }
+            xmlFreeDoc (segment.doc);
+        }
+        /* Text, or a chunk that didn't parse: leave it to the sixtp parser,
+         * which will report any problem. */
+        else if (!push_load_contents (xml_context, segment.text.data (),
+                                      segment.text.size (), FALSE))
+            load->ok = FALSE;
+
+        load->queued_bytes -= segment.text.size ();
+        load->segments.pop_front ();
+    }
+
+    /* Stop parsing chunks nobody will use, and wait for the ones being
+     * parsed before freeing them. */
+    g_thread_pool_free (load->pool, TRUE, TRUE);
+    load->pool = NULL;
+    for (auto& segment : load->segments)
+        if (segment.doc)
+            xmlFreeDoc (segment.doc);
+    load->segments.clear ();
+
+    if (load->ok)
+        load->ok = push_load_contents (xml_context, NULL, 0, TRUE);
+    else
+        xmlParseChunk (xml_context, NULL, 0, 1);
+}
+
+static gboolean
+parse_file_chunked (sixtp* top_parser, FILE* file, sixtp_gdv2* gd,
+                    QofBook* book)
+{
+    chunked_load load;
+    gxpf_data gpdata;
+    gpointer parse_result = NULL;
+    gboolean retval;
+
+    /* For comparing with, or working around, the parallel load. */
+    if (g_getenv ("GNC_XML_SERIAL_LOAD"))
+        return gnc_xml_parse_fd (top_parser, file, generic_callback, gd, book);
+
+    gpdata.cb = generic_callback;
+    gpdata.parsedata = gd;
+    gpdata.bookdata = book;
+
+    auto& sc = load.scanner;
+    sc.file = file;
+    sc.base = sc.pos = sc.queued = 0;
+    sc.eof = FALSE;
+    sc.chunk_tag = NULL;
+    sc.chunk_begin = sc.chunk_end = sc.chunk_depth = 0;
+    load.queued_bytes = 0;
+    load.gpdata = &gpdata;
+    load.ok = TRUE;
+
+    load_read (&load);
+    if (!load.ok)
+        return FALSE;
+    sc.scanning = load_is_utf8 (sc.buf);
+
+    load.account_parser = gnc_account_sixtp_parser_create ();
+    load.transaction_parser = gnc_transaction_sixtp_parser_create ();
+    g_mutex_init (&load.mutex);
+    g_cond_init (&load.cond);
+    xmlInitParser ();
+    load.pool = g_thread_pool_new (parse_load_chunk, &load,
+                                   g_get_num_processors (), FALSE, NULL);
+
+    retval = sixtp_parse_push (top_parser, chunked_load_push_handler, &load,
+                               NULL, &gpdata, &parse_result);
+
+    if (load.pool)
+        g_thread_pool_free (load.pool, TRUE, TRUE);
+    g_mutex_clear (&load.mutex);
+    g_cond_clear (&load.cond);
+    sixtp_destroy (load.account_parser);
+    sixtp_destroy (load.transaction_parser);
+    return retval && load.ok;
+}
+
 static void
 add_parser(const GncXmlDataType_t& data, struct file_backend* be_data)
 {
@@ -805,8 +1345,7 @@ qof_session_load_from_xml_file_v2_full (
         }
         else
         {
-            retval = gnc_xml_parse_fd (top_parser, file,
-                                       generic_callback, gd, book);
+            retval = parse_file_chunked (top_parser, file, gd, book);
             fclose (file);
             if (is_compressed)
                 wait_for_gzip (file);
@@ -1096,71 +1635,28 @@ write_commodities (FILE* out, QofBook* book, sixtp_gdv2* gd)
 static gboolean
 write_pricedb (FILE* out, QofBook* book, sixtp_gdv2* gd)
 {
-    xmlNodePtr node;
-    xmlNodePtr parent;
-    xmlOutputBufferPtr outbuf;
-
-    parent = gnc_pricedb_dom_tree_create (gnc_pricedb_get_db (book));
-
-    if (!parent)
-    {
-        return TRUE;
-    }
-
-    /* Write out the parent pricedb tag then loop to write out each price.
-       We do it this way instead of just calling xmlElemDump so that we can
-       increment the progress bar as we go. */
+    GncXmlWriter writer (out);
+    auto written = gd->counter.prices_loaded;
 
-    if (fprintf (out, "<%s version=\"%s\">\n", parent->name,
-                 xmlGetProp (parent, BAD_CAST "version")) < 0)
+    /* Stream each price rather than building the whole pricedb tree, and
+       update the progress bar as we go. */
+    if (!gnc_pricedb_write_xml (writer, gnc_pricedb_get_db (book), gd)
+        || !writer.flush ())
         return FALSE;
 
-    /* We create our own output buffer so we can call xmlNodeDumpOutput to get
-       the indentation correct. */
-    outbuf = xmlOutputBufferCreateFile (out, NULL);
-    if (outbuf == NULL)
-    {
-        xmlFreeNode (parent);
-        return FALSE;
-    }
-
-    for (node = parent->children; node; node = node->next)
-    {
-        /* Write two spaces since xmlNodeDumpOutput doesn't indent the first line */
-        xmlOutputBufferWrite (outbuf, 2, "  ");
-        xmlNodeDumpOutput (outbuf, NULL, node, 1, 1, NULL);
-        /* It also doesn't terminate the last line */
-        xmlOutputBufferWrite (outbuf, 1, "\n");
-        if (ferror (out))
-            break;
-        gd->counter.prices_loaded += 1;
-        sixtp_run_callback (gd, "prices");
-    }
-
-    xmlOutputBufferClose (outbuf);
-
-    if (ferror (out) || fprintf (out, "</%s>\n", parent->name) < 0)
-    {
-        xmlFreeNode (parent);
-        return FALSE;
-    }
-
-    xmlFreeNode (parent);
-    return TRUE;
+    /* Nothing is written if there were no prices that could be. */
+    if (gd->counter.prices_loaded == written)
+        return TRUE;
+    return !ferror (out) && fprintf (out, "\n") >= 0;
 }
 
 static int
 xml_add_trn_data (Transaction* t, gpointer data)
 {
     struct file_backend* be_data = static_cast<decltype (be_data)> (data);
-    xmlNodePtr node;
-
-    node = gnc_transaction_dom_tree_create (t);
-
-    xmlElemDump (be_data->out, NULL, node);
-    xmlFreeNode (node);
 
-    if (ferror (be_data->out) || fprintf (be_data->out, "\n") < 0)
+    if (!gnc_transaction_write_xml (*be_data->writer, t)
+        || fprintf (be_data->out, "\n") < 0)
         return -1;
 
     be_data->gd->counter.transactions_loaded++;
@@ -1172,9 +1668,11 @@ static gboolean
 write_transactions (FILE* out, QofBook* book, sixtp_gdv2* gd)
 {
     struct file_backend be_data;
+    GncXmlWriter writer (out);
 
     be_data.out = out;
     be_data.gd = gd;
+    be_data.writer = &writer;
     return 0 ==
            xaccAccountTreeForEachTransaction (gnc_book_get_root_account (book),
                                               xml_add_trn_data,
@@ -1186,9 +1684,11 @@ write_template_transaction_data (FILE* out, QofBook* book, sixtp_gdv2* gd)
 {
     Account* ra;
     struct file_backend be_data;
+    GncXmlWriter writer (out);
 
     be_data.out = out;
     be_data.gd = gd;
+    be_data.writer = &writer;
 
     ra = gnc_book_get_template_root (book);
     if (gnc_account_n_descendants (ra) > 0)
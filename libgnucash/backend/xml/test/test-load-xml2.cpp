@@ -47,12 +47,15 @@ extern "C"
 
 #include <unittest-support.h>
 #include <test-engine-stuff.h>
+#include <gnc-pricedb.h>
+#include <zlib.h>
 }
 
 #include "../gnc-backend-xml.h"
 #include "../io-gncxml-v2.h"
 #include "test-file-stuff.h"
 #include <test-stuff.h>
+#include <string>
 
 #define GNC_LIB_NAME "gncmod-backend-xml"
 #define GNC_LIB_REL_PATH "xml"
@@ -118,6 +121,108 @@ test_load_file (const char* filename)
     qof_session_end (session);
 }
 
+static QofSession*
+load_session (const char* filename, gboolean serial)
+{
+    QofSession* session = qof_session_new ();
+
+    if (serial)
+        g_setenv ("GNC_XML_SERIAL_LOAD", "1", TRUE);
+    remove_locks (filename);
+    qof_session_begin (session, filename, TRUE, FALSE, FALSE);
+    qof_session_load (session, NULL);
+    g_unsetenv ("GNC_XML_SERIAL_LOAD");
+    return session;
+}
+
+/* The parallel, chunked load must build the same book as loading the
+ * whole file through the sixtp parser. */
+static void
+test_parallel_load (const char* filename)
+{
+    QofSession* parallel = load_session (filename, FALSE);
+    QofSession* serial = load_session (filename, TRUE);
+    QofBook* book1 = qof_session_get_book (parallel);
+    QofBook* book2 = qof_session_get_book (serial);
+
+    do_test_args (qof_session_get_error (parallel) == ERR_BACKEND_NO_ERR
+                  && qof_session_get_error (serial) == ERR_BACKEND_NO_ERR,
+                  "parallel load", __FILE__, __LINE__,
+                  "qof errors %d and %d for file [%s]",
+                  qof_session_get_error (parallel),
+                  qof_session_get_error (serial), filename);
+    do_test_args (xaccAccountEqual (gnc_book_get_root_account (book1),
+                                    gnc_book_get_root_account (book2), TRUE),
+                  "parallel load accounts", __FILE__, __LINE__,
+                  "accounts differ for file [%s]", filename);
+    do_test_args (gnc_pricedb_equal (gnc_pricedb_get_db (book1),
+                                     gnc_pricedb_get_db (book2)),
+                  "parallel load prices", __FILE__, __LINE__,
+                  "prices differ for file [%s]", filename);
+
+    qof_session_end (parallel);
+    qof_session_end (serial);
+    qof_session_destroy (parallel);
+    qof_session_destroy (serial);
+}
+
+static void
+insert_after (std::string& text, const char* marker, const char* insert,
+              int nth)
+{
+    size_t pos = 0;
+    for (int i = 0; i < nth && pos != std::string::npos; i++)
+        pos = text.find (marker, pos + 1);
+    if (pos != std::string::npos)
+        text.insert (pos + strlen (marker), insert);
+}
+
+/* Elements holding comments or CDATA, comments between the elements of a
+ * run, and compressed files all fall back to the sixtp parser for some or
+ * all of the file. */
+static void
+test_parallel_load_fallbacks (const char* filename)
+{
+    gchar* contents;
+    gsize length;
+    gchar* dir = g_dir_make_tmp ("test-load-xml2-XXXXXX", NULL);
+
+    if (!dir || !g_file_get_contents (filename, &contents, &length, NULL))
+    {
+        failure_args ("parallel load fallbacks", __FILE__, __LINE__,
+                      "can't set up from [%s]", filename);
+        g_free (dir);
+        return;
+    }
+
+    std::string text (contents, length);
+    insert_after (text, "<gnc:transaction version=\"2.0.0\">",
+                  "<!-- in a transaction -->", 1);
+    insert_after (text, "</gnc:transaction>", "<!-- between transactions -->",
+                  3);
+    insert_after (text, "</gnc:account>", "<!-- between accounts -->", 2);
+    insert_after (text, "<trn:description>", "<![CDATA[cdata]]>", 5);
+    gchar* commented = g_build_filename (dir, "commented.gml2", NULL);
+    g_file_set_contents (commented, text.c_str (), text.size (), NULL);
+    test_parallel_load (commented);
+
+    gchar* compressed = g_build_filename (dir, "compressed.gml2", NULL);
+    gzFile gz = gzopen (compressed, "wb");
+    gzwrite (gz, contents, length);
+    gzclose (gz);
+    test_parallel_load (compressed);
+
+    for (auto name : {commented, compressed})
+    {
+        remove_locks (name);
+        g_unlink (name);
+        g_free (name);
+    }
+    g_rmdir (dir);
+    g_free (dir);
+    g_free (contents);
+}
+
 int
 main (int argc, char** argv)
 {
@@ -154,6 +259,9 @@ main (int argc, char** argv)
                 if (!g_file_test (to_open, G_FILE_TEST_IS_DIR))
                 {
                     test_load_file (to_open);
+                    test_parallel_load (to_open);
+                    if (g_str_has_suffix (to_open, "every.gml2"))
+                        test_parallel_load_fallbacks (to_open);
                     files_tested++;
                 }
                 g_free (to_open);
@@ -43,8 +43,10 @@ extern "C"
 #include "sixtp-parsers.h"
 #include "sixtp-dom-parsers.h"
 #include "io-gncxml-v2.h"
+#include "gnc-xml-writer.hpp"
 #include "test-file-stuff.h"
 #include "test-stuff.h"
+#include <string>
 
 static QofSession* session;
 static int iter;
@@ -120,6 +122,94 @@ test_db (GNCPriceDB* db)
     xmlFreeNode (test_node);
 }
 
+static std::string
+read_back (FILE* file)
+{
+    std::string contents;
+    char buf[4096];
+    size_t len;
+
+    fflush (file);
+    rewind (file);
+    while ((len = fread (buf, 1, sizeof (buf), file)) > 0)
+        contents.append (buf, len);
+    return contents;
+}
+
+static std::string
+stream_db (GNCPriceDB* db)
+{
+    FILE* file = tmpfile ();
+    {
+        GncXmlWriter writer (file);
+        gnc_pricedb_write_xml (writer, db, NULL);
+    }
+    auto streamed = read_back (file);
+    fclose (file);
+    return streamed;
+}
+
+static size_t
+count_prices (const std::string& xml)
+{
+    size_t count = 0;
+    for (auto pos = xml.find ("<price>"); pos != std::string::npos;
+         pos = xml.find ("<price>", pos + 1))
+        count++;
+    return count;
+}
+
+/* The streamed pricedb must match the DOM tree's when every price is
+ * valid. A price that can't be written is skipped, and if no price can be
+ * written there is no pricedb element at all. */
+static void
+test_streamed_db (GNCPriceDB* db)
+{
+    QofBook* book = qof_instance_get_book (QOF_INSTANCE (db));
+    xmlNodePtr node = gnc_pricedb_dom_tree_create (db);
+    FILE* dom_file = tmpfile ();
+    GNCPrice* bad;
+
+    xmlElemDump (dom_file, NULL, node);
+    auto dom = read_back (dom_file);
+    auto streamed = stream_db (db);
+    do_test_args (dom == streamed, "pricedb_xml_writer", __FILE__, __LINE__,
+                  "%d", iter);
+    fclose (dom_file);
+    xmlFreeNode (node);
+
+    bad = get_random_price (book);
+    gnc_price_set_time64 (bad, INT64_MAX);
+    gnc_pricedb_add_price (db, bad);
+    streamed = stream_db (db);
+    do_test_args (count_prices (streamed) == gnc_pricedb_get_num_prices (db) - 1,
+                  "pricedb_xml_writer skips invalid price", __FILE__, __LINE__,
+                  "%d", iter);
+    gnc_pricedb_remove_price (db, bad);
+    gnc_price_unref (bad);
+}
+
+static void
+test_invalid_db (void)
+{
+    QofSession* sess = qof_session_new ();
+    QofBook* book = qof_session_get_book (sess);
+    GNCPriceDB* db = gnc_pricedb_get_db (book);
+
+    for (int i = 0; i < 3; i++)
+    {
+        GNCPrice* bad = get_random_price (book);
+        gnc_price_set_time64 (bad, INT64_MAX);
+        gnc_pricedb_add_price (db, bad);
+        gnc_price_unref (bad);
+    }
+    auto streamed = stream_db (db);
+    do_test_args (gnc_pricedb_get_num_prices (db) > 0 && streamed.empty (),
+                  "pricedb_xml_writer omits pricedb without valid prices",
+                  __FILE__, __LINE__, "%s", streamed.c_str ());
+    qof_session_end (sess);
+}
+
 static void
 test_generation (void)
 {
@@ -136,7 +226,10 @@ test_generation (void)
             return;
         }
         if (gnc_pricedb_get_num_prices (db))
+        {
             test_db (db);
+            test_streamed_db (db);
+        }
 
         gnc_pricedb_destroy (db);
         qof_session_end (session);
@@ -153,6 +246,7 @@ main (int argc, char** argv)
     //qof_log_set_level(GNC_MOD_PRICE, QOF_LOG_DETAIL);
     session = qof_session_new ();
     test_generation ();
+    test_invalid_db ();
     print_test_results ();
     qof_close ();
     exit (get_rv ());
@@ -51,8 +51,11 @@ extern "C"
 #include "../sixtp-parsers.h"
 #include "../sixtp-dom-parsers.h"
 #include "../io-gncxml-gen.h"
+#include "../gnc-xml-writer.hpp"
 #include "test-file-stuff.h"
 #include <test-stuff.h>
+#include <string>
+#include <vector>
 static QofBook* book;
 
 extern gboolean gnc_transaction_xml_v2_testing;
@@ -370,6 +373,96 @@ test_add_transaction (const char* tag, gpointer globaldata, gpointer data)
     return retval;
 }
 
+static std::string
+read_back (FILE* file)
+{
+    std::string contents;
+    char buf[4096];
+    size_t len;
+
+    fflush (file);
+    rewind (file);
+    while ((len = fread (buf, 1, sizeof (buf), file)) > 0)
+        contents.append (buf, len);
+    return contents;
+}
+
+/* The streaming writer must produce exactly what xmlElemDump does. */
+static void
+test_streamed_transaction (Transaction* trn, xmlNodePtr node, int i)
+{
+    FILE* dom_file = tmpfile ();
+    FILE* stream_file = tmpfile ();
+
+    xmlElemDump (dom_file, NULL, node);
+    {
+        GncXmlWriter writer (stream_file);
+        gnc_transaction_write_xml (writer, trn);
+    }
+
+    auto dom = read_back (dom_file);
+    auto streamed = read_back (stream_file);
+    if (dom != streamed)
+        failure_args ("transaction_xml_writer", __FILE__, __LINE__,
+                      "streamed transaction differs from DOM:\n%s\n%s",
+                      dom.c_str (), streamed.c_str ());
+    else
+        success_args ("transaction_xml_writer", __FILE__, __LINE__, "%d", i);
+
+    fclose (dom_file);
+    fclose (stream_file);
+}
+
+/* Not pass/fail: report the time taken to write the same transactions
+ * through a DOM tree and through GncXmlWriter. */
+static void
+benchmark_transaction_writers (void)
+{
+    const int n_trans = 200, n_passes = 50;
+    std::vector<Transaction*> trans;
+    FILE* out = tmpfile ();
+    GTimer* timer;
+    gdouble dom_time, stream_time;
+
+    get_random_account_tree (book);
+    for (int i = 0; i < n_trans; i++)
+        if (auto trn = get_random_transaction (book))
+            trans.push_back (trn);
+
+    timer = g_timer_new ();
+    for (int pass = 0; pass < n_passes; pass++)
+        for (auto trn : trans)
+        {
+            xmlNodePtr node = gnc_transaction_dom_tree_create (trn);
+            xmlElemDump (out, NULL, node);
+            xmlFreeNode (node);
+            fprintf (out, "\n");
+        }
+    fflush (out);
+    dom_time = g_timer_elapsed (timer, NULL);
+
+    g_timer_start (timer);
+    {
+        GncXmlWriter writer (out);
+        for (int pass = 0; pass < n_passes; pass++)
+            for (auto trn : trans)
+            {
+                gnc_transaction_write_xml (writer, trn);
+                fprintf (out, "\n");
+            }
+    }
+    fflush (out);
+    stream_time = g_timer_elapsed (timer, NULL);
+
+    printf ("Wrote %zu transactions %d times: DOM %.3fs, streaming %.3fs\n",
+            trans.size (), n_passes, dom_time, stream_time);
+
+    g_timer_destroy (timer);
+    fclose (out);
+    for (auto trn : trans)
+        really_get_rid_of_transaction (trn);
+}
+
 static void
 test_transaction (void)
 {
@@ -441,6 +534,8 @@ test_transaction (void)
             success_args ("transaction_xml", __FILE__, __LINE__, "%d", i);
         }
 
+        test_streamed_transaction (ran_trn, test_node, i);
+
         filename1 = g_strdup_printf ("test_file_XXXXXX");
 
         fd = g_mkstemp (filename1);
@@ -536,6 +631,7 @@ main (int argc, char** argv)
     else
     {
         test_transaction ();
+        benchmark_transaction_writers ();
     }
 
     print_test_results ();
@@ -31,7 +31,7 @@
 #include <stdint.h>
 #include <string.h>
 
-#include "AccountP.h"
+#include "AccountP.hpp"
 #include "Split.h"
 #include "Transaction.h"
 #include "TransactionP.h"
@@ -40,9 +40,11 @@
 #include "gnc-lot.h"
 #include "gnc-pricedb.h"
 #include "qofinstance-p.h"
+#include "qof-backend.hpp"
 #include "gnc-features.h"
 #include "guid.hpp"
 
+#include <algorithm>
 #include <numeric>
 
 static QofLogModule log_module = GNC_MOD_ACCOUNT;
@@ -64,6 +66,11 @@ static const std::string AB_BANK_CODE("bank-code");
 static const std::string AB_TRANS_RETRIEVAL("trans-retrieval");
 
 static gnc_numeric GetBalanceAsOfDate (Account *acc, time64 date, gboolean ignclosing);
+static void splits_clear (AccountPrivate *priv);
+static void mark_balance_dirty (AccountPrivate *priv, size_t index);
+static void splits_mark_unsorted (AccountPrivate *priv, Split *s);
+static size_t splits_index_of (AccountPrivate *priv, Split *s);
+static void lots_index_clear (AccountPrivate *priv);
 
 using FinalProbabilityVec=std::vector<std::pair<std::string, int32_t>>;
 using ProbabilityVec=std::vector<std::pair<std::string, struct AccountProbability>>;
@@ -277,6 +284,12 @@ gnc_account_init(Account* acc)
 
     priv->policy = xaccGetFIFOPolicy();
     priv->lots = NULL;
+    priv->open_lots_valid = FALSE;
+    new (&priv->open_lots[0]) OpenLotSet ();
+    new (&priv->open_lots[1]) OpenLotSet ();
+    new (&priv->lots_index) LotIndexMap ();
+    new (&priv->stale_lots) LotsSet ();
+    priv->lots_first_order = 0;
 
     priv->commodity = NULL;
     priv->commodity_scu = 0;
@@ -291,9 +304,14 @@ gnc_account_init(Account* acc)
     priv->starting_cleared_balance = gnc_numeric_zero();
     priv->starting_reconciled_balance = gnc_numeric_zero();
     priv->balance_dirty = FALSE;
+    priv->balance_dirty_from = 0;
 
     priv->splits = NULL;
+    new (&priv->splits_vec) SplitsVec ();
+    new (&priv->splits_hash) SplitNodeMap ();
+    new (&priv->splits_dates) SplitDatesVec ();
     priv->sort_dirty = FALSE;
+    new (&priv->sort_dirty_splits) SplitsSet ();
 }
 
 static void
@@ -305,6 +323,16 @@ gnc_account_dispose (GObject *acctp)
 static void
 gnc_account_finalize(GObject* acctp)
 {
+    AccountPrivate *priv = GET_PRIVATE(acctp);
+
+    priv->splits_vec.~SplitsVec();
+    priv->splits_hash.~SplitNodeMap();
+    priv->splits_dates.~SplitDatesVec();
+    priv->sort_dirty_splits.~SplitsSet();
+    priv->open_lots[0].~OpenLotSet();
+    priv->open_lots[1].~OpenLotSet();
+    priv->lots_index.~LotIndexMap();
+    priv->stale_lots.~LotsSet();
     G_OBJECT_CLASS(gnc_account_parent_class)->finalize(acctp);
 }
 
@@ -1271,6 +1299,7 @@ xaccFreeAccount (Account *acc)
         }
         g_list_free (priv->lots);
         priv->lots = NULL;
+        lots_index_clear (priv);
     }
 
     /* Next, clean up the splits */
@@ -1411,8 +1440,7 @@ xaccAccountCommitEdit (Account *acc)
         }
         else
         {
-            g_list_free(priv->splits);
-            priv->splits = NULL;
+            splits_clear (priv);
         }
 
         /* It turns out there's a case where this assertion does not hold:
@@ -1437,6 +1465,7 @@ xaccAccountCommitEdit (Account *acc)
         }
         g_list_free(priv->lots);
         priv->lots = NULL;
+        lots_index_clear (priv);
 
         qof_instance_set_dirty(&acc->inst);
         qof_instance_decrease_editlevel(acc);
@@ -1781,6 +1810,7 @@ gnc_account_set_sort_dirty (Account *acc)
 
     priv = GET_PRIVATE(acc);
     priv->sort_dirty = TRUE;
+    priv->sort_dirty_splits.clear ();
 }
 
 void
@@ -1794,35 +1824,262 @@ gnc_account_set_balance_dirty (Account *acc)
         return;
 
     priv = GET_PRIVATE(acc);
+    mark_balance_dirty (priv, 0);
+}
+
+void
+gnc_account_set_split_dirty (Account *acc, Split *s)
+{
+    AccountPrivate *priv;
+
+    g_return_if_fail(GNC_IS_ACCOUNT(acc));
+    g_return_if_fail(GNC_IS_SPLIT(s));
+
+    if (qof_instance_get_destroying(acc))
+        return;
+
+    priv = GET_PRIVATE(acc);
+    splits_mark_unsorted (priv, s);
+    /* Only look for the split if the next sort won't start over anyway. */
+    if (priv->splits_hash.find (s) == priv->splits_hash.end ())
+        mark_balance_dirty (priv, priv->splits_vec.size ());
+    else if (priv->sort_dirty_splits.empty ())
+        mark_balance_dirty (priv, 0);
+    else
+        mark_balance_dirty (priv, splits_index_of (priv, s));
+}
+
+/* Mark the running balances as stale from the split at index onward. */
+static void
+mark_balance_dirty (AccountPrivate *priv, size_t index)
+{
+    if (!priv->balance_dirty || index < priv->balance_dirty_from)
+        priv->balance_dirty_from = index;
     priv->balance_dirty = TRUE;
 }
 
 /********************************************************************\
 \********************************************************************/
 
+/* The splits_* functions below are the only ones allowed to change the
+ * split containers of an account; they keep the list, the vector and the
+ * hash in step with each other. */
+static bool
+split_order_less (const Split *a, const Split *b)
+{
+    return xaccSplitOrder (a, b) < 0;
+}
+
+/* Link a new list node for s in front of sibling, or at the end of the
+ * list if sibling is NULL, and register it in the hash. */
+static void
+splits_link_node (AccountPrivate *priv, Split *s, GList *sibling)
+{
+    GList *node = g_list_alloc ();
+
+    node->data = s;
+    node->next = sibling;
+    if (sibling)
+        node->prev = sibling->prev;
+    else if (!priv->splits_vec.empty ())
+        node->prev = priv->splits_hash[priv->splits_vec.back ()];
+    else
+        node->prev = NULL;
+
+    if (node->prev)
+        node->prev->next = node;
+    else
+        priv->splits = node;
+    if (sibling)
+        sibling->prev = node;
+
+    priv->splits_hash[s] = node;
+}
+
+/* Insert s at its sorted position and return that position. A binary
+ * search on the vector finds the position and the hash finds the list
+ * node to insert in front of, so no list walk is needed. */
+static size_t
+splits_insert_sorted (AccountPrivate *priv, Split *s)
+{
+    auto pos = std::lower_bound (priv->splits_vec.begin (),
+                                 priv->splits_vec.end (), s, split_order_less);
+    GList *sibling = pos == priv->splits_vec.end () ? NULL :
+        priv->splits_hash[*pos];
+
+    splits_link_node (priv, s, sibling);
+    return priv->splits_vec.insert (pos, s) - priv->splits_vec.begin ();
+}
+
+/* Append s without regard to the sort order and return its position;
+ * the caller must mark it unsorted. */
+static size_t
+splits_append (AccountPrivate *priv, Split *s)
+{
+    splits_link_node (priv, s, NULL);
+    priv->splits_vec.push_back (s);
+    return priv->splits_vec.size () - 1;
+}
+
+/* Return the position of s, which must be in the account. */
+static size_t
+splits_index_of (AccountPrivate *priv, Split *s)
+{
+    /* The vector is normally sorted, so try a binary search first. It
+     * isn't while sort_dirty is set, so fall back to a linear scan. */
+    auto pos = std::lower_bound (priv->splits_vec.begin (),
+                                 priv->splits_vec.end (), s, split_order_less);
+    if (pos == priv->splits_vec.end () || *pos != s)
+        pos = std::find (priv->splits_vec.begin (), priv->splits_vec.end (), s);
+    g_assert (pos != priv->splits_vec.end ());
+    return pos - priv->splits_vec.begin ();
+}
+
+/* Remove s and return the position it had. */
+static size_t
+splits_remove (AccountPrivate *priv, Split *s, GList *node)
+{
+    size_t index = splits_index_of (priv, s);
+
+    priv->splits_vec.erase (priv->splits_vec.begin () + index);
+    priv->splits_hash.erase (s);
+    priv->splits = g_list_delete_link (priv->splits, node);
+    return index;
+}
+
+/* Note that s may be out of place. As long as only a few splits are, they
+ * are remembered so that the next sort only has to move those; beyond
+ * that the whole vector is sorted again. */
+#define MAX_SORT_DIRTY_SPLITS 64
+
+static void
+splits_mark_unsorted (AccountPrivate *priv, Split *s)
+{
+    if (!priv->sort_dirty || !priv->sort_dirty_splits.empty ())
+    {
+        priv->sort_dirty_splits.insert (s);
+        if (priv->sort_dirty_splits.size () > MAX_SORT_DIRTY_SPLITS)
+            priv->sort_dirty_splits.clear ();
+    }
+    priv->sort_dirty = TRUE;
+}
+
+/* Relink the list nodes in the order of the vector, so that list nodes
+ * held by callers stay valid. */
+static void
+splits_relink (AccountPrivate *priv)
+{
+    GList *prev = NULL;
+
+    priv->splits = NULL;
+    for (auto s : priv->splits_vec)
+    {
+        GList *node = priv->splits_hash[s];
+        node->prev = prev;
+        if (prev)
+            prev->next = node;
+        else
+            priv->splits = node;
+        prev = node;
+    }
+    if (prev)
+        prev->next = NULL;
+}
+
+/* Move the splits in sort_dirty_splits back into place and return the
+ * first position that changed. The others are still in order, so they
+ * don't need comparing: each moved split is found a place by a binary
+ * search and the vector is rebuilt in one pass. */
+static size_t
+splits_resort (AccountPrivate *priv)
+{
+    SplitsVec moved, merged;
+    std::vector<size_t> places;
+    size_t first = priv->splits_vec.size ();
+    auto keep = priv->splits_vec.begin ();
+
+    for (auto iter = priv->splits_vec.begin ();
+         iter != priv->splits_vec.end (); ++iter)
+    {
+        if (priv->sort_dirty_splits.find (*iter) == priv->sort_dirty_splits.end ())
+        {
+            *keep++ = *iter;
+            continue;
+        }
+        if (moved.empty ())
+            first = iter - priv->splits_vec.begin ();
+        moved.push_back (*iter);
+    }
+    priv->splits_vec.erase (keep, priv->splits_vec.end ());
+    if (moved.empty ())
+        return first;
+
+    std::stable_sort (moved.begin (), moved.end (), split_order_less);
+    auto from = priv->splits_vec.begin ();
+    for (auto s : moved)
+    {
+        from = std::lower_bound (from, priv->splits_vec.end (), s,
+                                 split_order_less);
+        places.push_back (from - priv->splits_vec.begin ());
+    }
+    first = std::min (first, places.front ());
+
+    merged.reserve (priv->splits_vec.size () + moved.size ());
+    size_t done = 0;
+    for (size_t i = 0; i < moved.size (); ++i)
+    {
+        merged.insert (merged.end (), priv->splits_vec.begin () + done,
+                       priv->splits_vec.begin () + places[i]);
+        merged.push_back (moved[i]);
+        done = places[i];
+    }
+    merged.insert (merged.end (), priv->splits_vec.begin () + done,
+                   priv->splits_vec.end ());
+    priv->splits_vec.swap (merged);
+
+    splits_relink (priv);
+    return first;
+}
+
+static void
+splits_sort (AccountPrivate *priv)
+{
+    std::stable_sort (priv->splits_vec.begin (), priv->splits_vec.end (),
+                      split_order_less);
+    splits_relink (priv);
+}
+
+static void
+splits_clear (AccountPrivate *priv)
+{
+    g_list_free (priv->splits);
+    priv->splits = NULL;
+    priv->splits_vec.clear ();
+    priv->splits_hash.clear ();
+    priv->splits_dates.clear ();
+    priv->sort_dirty_splits.clear ();
+}
+
 gboolean
 gnc_account_insert_split (Account *acc, Split *s)
 {
     AccountPrivate *priv;
-    GList *node;
 
     g_return_val_if_fail(GNC_IS_ACCOUNT(acc), FALSE);
     g_return_val_if_fail(GNC_IS_SPLIT(s), FALSE);
 
     priv = GET_PRIVATE(acc);
-    node = g_list_find(priv->splits, s);
-    if (node)
+    if (priv->splits_hash.find (s) != priv->splits_hash.end ())
         return FALSE;
 
     if (qof_instance_get_editlevel(acc) == 0)
     {
-        priv->splits = g_list_insert_sorted(priv->splits, s,
-                                            (GCompareFunc)xaccSplitOrder);
+        mark_balance_dirty (priv, splits_insert_sorted (priv, s));
     }
     else
     {
-        priv->splits = g_list_prepend(priv->splits, s);
-        priv->sort_dirty = TRUE;
+        mark_balance_dirty (priv, splits_append (priv, s));
+        splits_mark_unsorted (priv, s);
     }
 
     //FIXME: find better event
@@ -1830,7 +2087,6 @@ gnc_account_insert_split (Account *acc, Split *s)
     /* Also send an event based on the account */
     qof_event_gen(&acc->inst, GNC_EVENT_ITEM_ADDED, s);
 
-    priv->balance_dirty = TRUE;
 //  DRH: Should the below be added? It is present in the delete path.
 //  xaccAccountRecomputeBalance(acc);
     return TRUE;
@@ -1840,23 +2096,22 @@ gboolean
 gnc_account_remove_split (Account *acc, Split *s)
 {
     AccountPrivate *priv;
-    GList *node;
 
     g_return_val_if_fail(GNC_IS_ACCOUNT(acc), FALSE);
     g_return_val_if_fail(GNC_IS_SPLIT(s), FALSE);
 
     priv = GET_PRIVATE(acc);
-    node = g_list_find(priv->splits, s);
-    if (NULL == node)
+    auto node = priv->splits_hash.find (s);
+    if (node == priv->splits_hash.end ())
         return FALSE;
 
-    priv->splits = g_list_delete_link(priv->splits, node);
+    mark_balance_dirty (priv, splits_remove (priv, s, node->second));
+    priv->sort_dirty_splits.erase (s);
     //FIXME: find better event type
     qof_event_gen(&acc->inst, QOF_EVENT_MODIFY, NULL);
     // And send the account-based event, too
     qof_event_gen(&acc->inst, GNC_EVENT_ITEM_REMOVED, s);
 
-    priv->balance_dirty = TRUE;
     xaccAccountRecomputeBalance(acc);
     return TRUE;
 }
@@ -1871,9 +2126,47 @@ xaccAccountSortSplits (Account *acc, gboolean force)
     priv = GET_PRIVATE(acc);
     if (!priv->sort_dirty || (!force && qof_instance_get_editlevel(acc) > 0))
         return;
-    priv->splits = g_list_sort(priv->splits, (GCompareFunc)xaccSplitOrder);
+    if (priv->sort_dirty_splits.empty ())
+    {
+        splits_sort (priv);
+        mark_balance_dirty (priv, 0);
+    }
+    else
+    {
+        mark_balance_dirty (priv, splits_resort (priv));
+        priv->sort_dirty_splits.clear ();
+    }
     priv->sort_dirty = FALSE;
-    priv->balance_dirty = TRUE;
+}
+
+GList *
+gnc_account_prepend_splits_posted_between (Account *acc, time64 start,
+                                           time64 end, GList *splits)
+{
+    AccountPrivate *priv;
+
+    g_return_val_if_fail (GNC_IS_ACCOUNT (acc), splits);
+
+    priv = GET_PRIVATE (acc);
+    auto first = priv->splits_vec.cbegin ();
+    auto last = priv->splits_vec.cend ();
+    /* xaccSplitOrder sorts on the date posted first, so the splits in the
+     * range are contiguous if the account is sorted. It isn't sorted here:
+     * a query shouldn't reorder the account's splits as a side effect. */
+    if (!priv->sort_dirty)
+    {
+        auto posted = [](const Split *s)
+        {
+            return xaccTransGetDate (xaccSplitGetParent (s));
+        };
+        first = std::partition_point (first, last, [&](const Split *s)
+                                      { return posted (s) < start; });
+        last = std::partition_point (first, last, [&](const Split *s)
+                                     { return posted (s) <= end; });
+    }
+    for (auto iter = first; iter != last; ++iter)
+        splits = g_list_prepend (splits, *iter);
+    return splits;
 }
 
 static void
@@ -1982,6 +2275,132 @@ gnc_account_set_policy (Account *acc, GNCPolicy *policy)
 /********************************************************************\
 \********************************************************************/
 
+/* The open-lot index: see AccountPrivate. */
+
+static void
+lots_index_clear (AccountPrivate *priv)
+{
+    priv->open_lots_valid = FALSE;
+    priv->open_lots[0].clear ();
+    priv->open_lots[1].clear ();
+    priv->lots_index.clear ();
+    priv->stale_lots.clear ();
+}
+
+static void
+lots_index_unindex (LotIndexEntry& entry)
+{
+    if (!entry.open) return;
+    entry.open->erase (entry.pos);
+    entry.open = nullptr;
+}
+
+/* Put the lot in the open-lot index if it is a candidate for
+ * gnc_account_find_open_lot: it must be open and its balance must have
+ * the same sign as its opening split. */
+static void
+lots_index_update (AccountPrivate *priv, GNCLot *lot, LotIndexEntry& entry)
+{
+    lots_index_unindex (entry);
+    if (gnc_lot_is_closed (lot)) return;
+
+    auto split = gnc_lot_get_earliest_split (lot);
+    if (!split) return;
+    auto trans = xaccSplitGetParent (split);
+    auto amount = xaccSplitGetAmount (split);
+    if (!trans || gnc_numeric_zero_p (amount)) return;
+
+    auto opening_is_positive = gnc_numeric_positive_p (amount);
+    if (opening_is_positive != gnc_numeric_positive_p (gnc_lot_get_balance (lot)))
+        return;
+
+    auto& open = priv->open_lots[opening_is_positive ? 1 : 0];
+    entry.pos = open.insert ({xaccTransRetDatePosted (trans), entry.order, lot,
+                              xaccTransGetCurrency (trans)}).first;
+    entry.open = &open;
+}
+
+static void
+lots_index_refresh (AccountPrivate *priv)
+{
+    if (!priv->open_lots_valid)
+    {
+        lots_index_clear (priv);
+        gint64 order = 0;
+        for (auto node = priv->lots; node; node = node->next)
+        {
+            auto lot = static_cast<GNCLot*>(node->data);
+            auto& entry = priv->lots_index[lot];
+            entry = {order++, nullptr, {}};
+            lots_index_update (priv, lot, entry);
+        }
+        priv->lots_first_order = 0;
+        priv->open_lots_valid = TRUE;
+        return;
+    }
+
+    for (auto lot : priv->stale_lots)
+    {
+        auto it = priv->lots_index.find (lot);
+        if (it != priv->lots_index.end ())
+            lots_index_update (priv, lot, it->second);
+    }
+    priv->stale_lots.clear ();
+}
+
+static void
+lots_index_remove (AccountPrivate *priv, GNCLot *lot)
+{
+    if (!priv->open_lots_valid) return;
+    auto it = priv->lots_index.find (lot);
+    if (it != priv->lots_index.end ())
+    {
+        lots_index_unindex (it->second);
+        priv->lots_index.erase (it);
+    }
+    priv->stale_lots.erase (lot);
+}
+
+void
+gnc_account_lot_changed (Account *acc, GNCLot *lot)
+{
+    g_return_if_fail(GNC_IS_ACCOUNT(acc));
+
+    auto priv = GET_PRIVATE(acc);
+    if (priv->open_lots_valid)
+        priv->stale_lots.insert (lot);
+}
+
+GNCLot *
+gnc_account_find_open_lot (Account *acc, gnc_numeric sign,
+                           gnc_commodity *currency, gboolean latest)
+{
+    g_return_val_if_fail(GNC_IS_ACCOUNT(acc), NULL);
+
+    auto priv = GET_PRIVATE(acc);
+    lots_index_refresh (priv);
+
+    /* The lot must have been opened by a split of the opposite sign. */
+    auto& open = priv->open_lots[gnc_numeric_positive_p (sign) ? 0 : 1];
+    auto in_currency = [currency](const OpenLot& ol)
+    {
+        return !currency || gnc_commodity_equiv (currency, ol.currency);
+    };
+
+    if (!latest)
+    {
+        auto it = std::find_if (open.begin (), open.end (), in_currency);
+        return it == open.end () ? nullptr : it->lot;
+    }
+
+    auto rit = std::find_if (open.rbegin (), open.rend (), in_currency);
+    if (rit == open.rend ())
+        return NULL;
+    /* Of the lots opened at that time, take the first in the lot list. */
+    OpenLot first {rit->posted, G_MININT64, NULL, NULL};
+    return std::find_if (open.lower_bound (first), open.end (), in_currency)->lot;
+}
+
 void
 xaccAccountRemoveLot (Account *acc, GNCLot *lot)
 {
@@ -1995,6 +2414,7 @@ xaccAccountRemoveLot (Account *acc, GNCLot *lot)
 
     ENTER ("(acc=%p, lot=%p)", acc, lot);
     priv->lots = g_list_remove(priv->lots, lot);
+    lots_index_remove (priv, lot);
     qof_event_gen (QOF_INSTANCE(lot), QOF_EVENT_REMOVE, NULL);
     qof_event_gen (&acc->inst, QOF_EVENT_MODIFY, NULL);
     LEAVE ("(acc=%p, lot=%p)", acc, lot);
@@ -2024,10 +2444,16 @@ xaccAccountInsertLot (Account *acc, GNCLot *lot)
         old_acc = lot_account;
         opriv = GET_PRIVATE(old_acc);
         opriv->lots = g_list_remove(opriv->lots, lot);
+        lots_index_remove (opriv, lot);
     }
 
     priv = GET_PRIVATE(acc);
     priv->lots = g_list_prepend(priv->lots, lot);
+    if (priv->open_lots_valid)
+    {
+        priv->lots_index[lot] = {--priv->lots_first_order, nullptr, {}};
+        priv->stale_lots.insert (lot);
+    }
     gnc_lot_set_account(lot, acc);
 
     /* Don't move the splits to the new account.  The caller will do this
@@ -2146,7 +2572,8 @@ xaccAccountRecomputeBalance (Account * acc)
     gnc_numeric  noclosing_balance;
     gnc_numeric  cleared_balance;
     gnc_numeric  reconciled_balance;
-    GList *lp;
+    bool dates_ordered = true;
+    size_t index;
 
     if (NULL == acc) return;
 
@@ -2156,17 +2583,44 @@ xaccAccountRecomputeBalance (Account * acc)
     if (qof_instance_get_destroying(acc)) return;
     if (qof_book_shutting_down(qof_instance_get_book(acc))) return;
 
-    balance            = priv->starting_balance;
-    noclosing_balance  = priv->starting_noclosing_balance;
-    cleared_balance    = priv->starting_cleared_balance;
-    reconciled_balance = priv->starting_reconciled_balance;
+    /* The splits before balance_dirty_from haven't changed since the last
+     * pass, so carry on from the running balances of the last of them. The
+     * date index must be intact up to there too, else start over. */
+    index = priv->balance_dirty_from;
+    if (index > priv->splits_vec.size () || index > priv->splits_dates.size ())
+        index = 0;
 
-    PINFO ("acct=%s starting baln=%" G_GINT64_FORMAT "/%" G_GINT64_FORMAT,
-           priv->accountName, balance.num, balance.denom);
-    for (lp = priv->splits; lp; lp = lp->next)
+    if (index == 0)
+    {
+        balance            = priv->starting_balance;
+        noclosing_balance  = priv->starting_noclosing_balance;
+        cleared_balance    = priv->starting_cleared_balance;
+        reconciled_balance = priv->starting_reconciled_balance;
+    }
+    else
     {
-        Split *split = (Split *) lp->data;
+        Split *last = priv->splits_vec[index - 1];
+        balance            = last->balance;
+        noclosing_balance  = last->noclosing_balance;
+        cleared_balance    = last->cleared_balance;
+        reconciled_balance = last->reconciled_balance;
+    }
+
+    PINFO ("acct=%s starting baln=%" G_GINT64_FORMAT "/%" G_GINT64_FORMAT
+           " at split %" G_GSIZE_FORMAT, priv->accountName, balance.num,
+           balance.denom, index);
+    priv->splits_dates.resize (index);
+    priv->splits_dates.reserve (priv->splits_vec.size ());
+    for (auto iter = priv->splits_vec.begin () + index;
+         iter != priv->splits_vec.end (); ++iter)
+    {
+        Split *split = *iter;
         gnc_numeric amt = xaccSplitGetAmount (split);
+        time64 posted = xaccTransRetDatePosted (split->parent);
+
+        if (!priv->splits_dates.empty () && posted < priv->splits_dates.back ())
+            dates_ordered = false;
+        priv->splits_dates.push_back (posted);
 
         balance = gnc_numeric_add_fixed(balance, amt);
 
@@ -2192,11 +2646,17 @@ xaccAccountRecomputeBalance (Account * acc)
 
     }
 
+    /* Splits without a transaction sort last with a zero date; the date
+     * index can't be searched then, so drop it. */
+    if (!dates_ordered)
+        priv->splits_dates.clear ();
+
     priv->balance = balance;
     priv->noclosing_balance = noclosing_balance;
     priv->cleared_balance = cleared_balance;
     priv->reconciled_balance = reconciled_balance;
     priv->balance_dirty = FALSE;
+    priv->balance_dirty_from = 0;
 }
 
 /********************************************************************\
@@ -2311,7 +2771,7 @@ xaccAccountSetType (Account *acc, GNCAccountType tip)
 
     xaccAccountBeginEdit(acc);
     priv->type = tip;
-    priv->balance_dirty = TRUE; /* new type may affect balance computation */
+    mark_balance_dirty (priv, 0); /* new type may affect balance computation */
     mark_account(acc);
     xaccAccountCommitEdit(acc);
 }
@@ -2493,7 +2953,7 @@ xaccAccountSetCommodity (Account * acc, gnc_commodity * com)
     }
 
     priv->sort_dirty = TRUE;  /* Not needed. */
-    priv->balance_dirty = TRUE;
+    mark_balance_dirty (priv, 0);
     mark_account (acc);
 
     xaccAccountCommitEdit(acc);
@@ -3279,7 +3739,7 @@ gnc_account_set_start_balance (Account *acc, const gnc_numeric start_baln)
 
     priv = GET_PRIVATE(acc);
     priv->starting_balance = start_baln;
-    priv->balance_dirty = TRUE;
+    mark_balance_dirty (priv, 0);
 }
 
 void
@@ -3292,7 +3752,7 @@ gnc_account_set_start_cleared_balance (Account *acc,
 
     priv = GET_PRIVATE(acc);
     priv->starting_cleared_balance = start_baln;
-    priv->balance_dirty = TRUE;
+    mark_balance_dirty (priv, 0);
 }
 
 void
@@ -3305,7 +3765,7 @@ gnc_account_set_start_reconciled_balance (Account *acc,
 
     priv = GET_PRIVATE(acc);
     priv->starting_reconciled_balance = start_baln;
-    priv->balance_dirty = TRUE;
+    mark_balance_dirty (priv, 0);
 }
 
 gnc_numeric
@@ -3333,7 +3793,6 @@ gnc_numeric
 xaccAccountGetProjectedMinimumBalance (const Account *acc)
 {
     AccountPrivate *priv;
-    GList *node;
     time64 today;
     gnc_numeric lowest = gnc_numeric_zero ();
     int seen_a_transaction = 0;
@@ -3342,9 +3801,10 @@ xaccAccountGetProjectedMinimumBalance (const Account *acc)
 
     priv = GET_PRIVATE(acc);
     today = gnc_time64_get_today_end();
-    for (node = g_list_last(priv->splits); node; node = node->prev)
+    for (auto iter = priv->splits_vec.rbegin ();
+         iter != priv->splits_vec.rend (); ++iter)
     {
-        Split *split = static_cast<Split*>(node->data);
+        Split *split = *iter;
 
         if (!seen_a_transaction)
         {
@@ -3370,16 +3830,9 @@ xaccAccountGetProjectedMinimumBalance (const Account *acc)
 static gnc_numeric
 GetBalanceAsOfDate (Account *acc, time64 date, gboolean ignclosing)
 {
-    /* Ideally this could use xaccAccountForEachSplit, but
-     * it doesn't exist yet and I'm uncertain of exactly how
-     * it would work at this time, since it differs from
-     * xaccAccountForEachTransaction by using gpointer return
-     * values rather than gints.
-     */
     AccountPrivate *priv;
-    GList   *lp;
-    gboolean found = FALSE;
-    gnc_numeric balance;
+    size_t index;
+    Split *split;
 
     g_return_val_if_fail(GNC_IS_ACCOUNT(acc), gnc_numeric_zero());
 
@@ -3387,50 +3840,62 @@ GetBalanceAsOfDate (Account *acc, time64 date, gboolean ignclosing)
     xaccAccountRecomputeBalance (acc); /* just in case, normally a noop */
 
     priv = GET_PRIVATE(acc);
-    if (ignclosing)
-        balance = priv->noclosing_balance;
-    else
-        balance = priv->balance;
 
-    lp = priv->splits;
-    while ( lp && !found )
+    /* Find the first split posted on or after the date. The date index is
+     * rebuilt along with the running balances, so it can be binary
+     * searched whenever those are up to date. Otherwise (e.g. the account
+     * is open for editing) walk the splits. */
+    if (!priv->balance_dirty &&
+        priv->splits_dates.size () == priv->splits_vec.size ())
     {
-        time64 trans_time = xaccTransRetDatePosted( xaccSplitGetParent( (Split *)lp->data ));
-        if ( trans_time >= date )
-            found = TRUE;
-        else
-            lp = lp->next;
+        index = std::lower_bound (priv->splits_dates.begin (),
+                                  priv->splits_dates.end (), date) -
+            priv->splits_dates.begin ();
     }
-
-    if ( lp )
+    else
     {
-        if ( lp->prev )
-        {
-            /* Since lp is now pointing to a split which was past the reconcile
-             * date, get the running balance of the previous split.
-             */
-            if (ignclosing)
-                balance = xaccSplitGetNoclosingBalance( (Split *)lp->prev->data );
-            else
-                balance = xaccSplitGetBalance( (Split *)lp->prev->data );
-        }
-        else
-        {
-            /* AsOf date must be before any entries, return zero. */
-            balance = gnc_numeric_zero();
-        }
+        index = std::find_if (priv->splits_vec.begin (),
+                              priv->splits_vec.end (),
+                              [date](const Split *s)
+                              {
+                                  return xaccTransRetDatePosted (s->parent) >= date;
+                              }) - priv->splits_vec.begin ();
     }
 
-    /* Otherwise there were no splits posted after the given date,
-     * so the latest account balance should be good enough.
-     */
+    /* No splits were posted after the given date, so the latest account
+     * balance is good enough. */
+    if (index == priv->splits_vec.size ())
+        return ignclosing ? priv->noclosing_balance : priv->balance;
+
+    /* AsOf date must be before any entries, return zero. */
+    if (index == 0)
+        return gnc_numeric_zero ();
+
+    /* Otherwise the running balance of the split before the one that is
+     * past the date is the answer. */
+    split = priv->splits_vec[index - 1];
+    return ignclosing ? xaccSplitGetNoclosingBalance (split) :
+        xaccSplitGetBalance (split);
+}
 
-    return( balance );
+/* A backend that loads transactions on demand may know a balance without
+ * loading the splits it sums. */
+static gboolean
+GetBackendBalance (const Account *acc, time64 start, time64 end,
+                   gnc_numeric *balance)
+{
+    auto be = qof_book_get_backend (gnc_account_get_book (acc));
+    return be && be->get_account_balance (QOF_INSTANCE (acc), start, end,
+                                          balance);
 }
 
 gnc_numeric
 xaccAccountGetBalanceAsOfDate (Account *acc, time64 date)
 {
+    gnc_numeric balance;
+
+    if (GetBackendBalance (acc, INT64_MIN, date, &balance))
+        return balance;
     return GetBalanceAsOfDate (acc, date, FALSE);
 }
 
@@ -3452,16 +3917,19 @@ gnc_numeric
 xaccAccountGetPresentBalance (const Account *acc)
 {
     AccountPrivate *priv;
-    GList *node;
     time64 today;
 
     g_return_val_if_fail(GNC_IS_ACCOUNT(acc), gnc_numeric_zero());
 
     priv = GET_PRIVATE(acc);
     today = gnc_time64_get_today_end();
-    for (node = g_list_last(priv->splits); node; node = node->prev)
+    gnc_numeric balance;
+    if (GetBackendBalance (acc, INT64_MIN, today + 1, &balance))
+        return balance;
+    for (auto iter = priv->splits_vec.rbegin ();
+         iter != priv->splits_vec.rend (); ++iter)
     {
-        Split *split = static_cast<Split*>(node->data);
+        Split *split = *iter;
 
         if (xaccTransGetDate (xaccSplitGetParent (split)) <= today)
             return xaccSplitGetBalance (split);
@@ -3829,7 +4297,7 @@ xaccAccountCountSplits (const Account *acc, gboolean include_children)
 
     g_return_val_if_fail(GNC_IS_ACCOUNT(acc), 0);
 
-    nr = g_list_length(xaccAccountGetSplitList(acc));
+    nr = GET_PRIVATE(acc)->splits_vec.size();
     if (include_children && (gnc_account_n_children(acc) != 0))
     {
         for (i=0; i < gnc_account_n_children(acc); i++)
@@ -4839,7 +5307,6 @@ finder_help_function(const Account *acc, const char *description,
                      Split **split, Transaction **trans )
 {
     AccountPrivate *priv;
-    GList *slp;
 
     /* First, make sure we set the data to NULL BEFORE we start */
     if (split) *split = NULL;
@@ -4852,9 +5319,10 @@ finder_help_function(const Account *acc, const char *description,
      * list is in date order, and the most recent matches should be
      * returned!?  */
     priv = GET_PRIVATE(acc);
-    for (slp = g_list_last(priv->splits); slp; slp = slp->prev)
+    for (auto iter = priv->splits_vec.rbegin ();
+         iter != priv->splits_vec.rend (); ++iter)
     {
-        Split *lsplit = static_cast<Split*>(slp->data);
+        Split *lsplit = *iter;
         Transaction *ltrans = xaccSplitGetParent(lsplit);
 
         if (g_strcmp0 (description, xaccTransGetDescription (ltrans)) == 0)
@@ -361,6 +361,16 @@ void gnc_account_set_balance_dirty (Account *acc);
  *  @param acc Set the flag on this account. */
 void gnc_account_set_sort_dirty (Account *acc);
 
+/** Tell the account that a split in it has changed, so that the split
+ *  may be out of place and the running balances from it onward may be
+ *  incorrect. Only that split is moved when the splits are next sorted,
+ *  and the balances are recomputed starting from it.
+ *
+ *  @param acc Set the flags on this account.
+ *
+ *  @param s The split that changed. */
+void gnc_account_set_split_dirty (Account *acc, Split *s);
+
 /** Insert the given split from an account.
  *
  *  @param acc The account to which the split should be added.
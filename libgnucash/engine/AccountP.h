@@ -49,84 +49,9 @@ extern "C" {
 
 /** STRUCTS *********************************************************/
 
-/** This is the data that describes an account.
- *
- * This is the *private* header for the account structure.
- * No one outside of the engine should ever include this file.
-*/
-
-/** \struct Account */
-typedef struct AccountPrivate
-{
-    /* The accountName is an arbitrary string assigned by the user.
-     * It is intended to a short, 5 to 30 character long string that
-     * is displayed by the GUI as the account mnemonic.
-     */
-    char *accountName;
-
-    /* The accountCode is an arbitrary string assigned by the user.
-     * It is intended to be reporting code that is a synonym for the
-     * accountName. Typically, it will be a numeric value that follows
-     * the numbering assignments commonly used by accountants, such
-     * as 100, 200 or 600 for top-level accounts, and 101, 102..  etc.
-     * for detail accounts.
-     */
-    char *accountCode;
-
-    /* The description is an arbitrary string assigned by the user.
-     * It is intended to be a longer, 1-5 sentence description of what
-     * this account is all about.
-     */
-    char *description;
-
-    /* The type field is the account type, picked from the enumerated
-     * list that includes ACCT_TYPE_BANK, ACCT_TYPE_STOCK,
-     * ACCT_TYPE_CREDIT, ACCT_TYPE_INCOME, etc.  Its intended use is to
-     * be a hint to the GUI as to how to display and format the
-     * transaction data.
-     */
-    GNCAccountType type;
-
-    /*
-     * The commodity field denotes the kind of 'stuff' stored
-     * in this account.  The 'amount' field of a split indicates
-     * how much of the 'stuff' there is.
-     */
-    gnc_commodity * commodity;
-    int commodity_scu;
-    gboolean non_standard_scu;
-
-    /* The parent and children pointers are used to implement an account
-     * hierarchy, of accounts that have sub-accounts ("detail accounts").
-     */
-    Account *parent;    /* back-pointer to parent */
-    GList *children;    /* list of sub-accounts */
-
-    /* protected data - should only be set by backends */
-    gnc_numeric starting_balance;
-    gnc_numeric starting_noclosing_balance;
-    gnc_numeric starting_cleared_balance;
-    gnc_numeric starting_reconciled_balance;
-
-    /* cached parameters */
-    gnc_numeric balance;
-    gnc_numeric noclosing_balance;
-    gnc_numeric cleared_balance;
-    gnc_numeric reconciled_balance;
-
-    gboolean balance_dirty;     /* balances in splits incorrect */
-
-    GList *splits;              /* list of split pointers */
-    gboolean sort_dirty;        /* sort order of splits is bad */
-
-    LotList   *lots;		/* list of lot pointers */
-    GNCPolicy *policy;		/* Cached pointer to policy method */
-
-    /* The "mark" flag can be used by the user to mark this account
-     * in any way desired.  Handy for specialty traversals of the
-     * account tree. */
-    short mark;
-} AccountPrivate;
+/* The AccountPrivate structure is defined in AccountP.hpp; it holds C++
+ * containers and so is only visible to C++ engine code. */
+typedef struct AccountPrivate AccountPrivate;
 
 struct account_s
 {
@@ -141,6 +66,25 @@ void xaccAccountSetGUID (Account *account, const GncGUID *guid);
 /* Register Accounts with the engine */
 gboolean xaccAccountRegister (void);
 
+/* Prepend to splits those of the account's splits whose transaction was
+ * posted between start and end inclusive, and return the new list. The
+ * account's splits aren't sorted by this; if they need sorting, all of
+ * them are prepended. */
+GList *gnc_account_prepend_splits_posted_between (Account *acc, time64 start,
+                                                  time64 end, GList *splits);
+
+/* Tell the account that the splits, balance or closed state of lot, one
+ * of its lots, may have changed. Called by the lot code. */
+void gnc_account_lot_changed (Account *acc, GNCLot *lot);
+
+/* Return the open lot whose opening split has the opposite sign to sign
+ * and was posted earliest, or latest if latest is TRUE. If currency isn't
+ * NULL only lots opened in that currency are considered. Of lots opened at
+ * the same time, the one first in the account's lot list is returned. The
+ * open lots are indexed by opening date, so this doesn't visit every lot. */
+GNCLot *gnc_account_find_open_lot (Account *acc, gnc_numeric sign,
+                                   gnc_commodity *currency, gboolean latest);
+
 /* Structure for accessing static functions for testing */
 typedef struct
 {
@@ -0,0 +1,181 @@
+/********************************************************************\
+ * AccountP.hpp -- Account engine-private data structure            *
+ * Copyright (C) 1997 Robin D. Clark                                *
+ * Copyright (C) 1997-2002, Linas Vepstas <linas@linas.org>         *
+ *                                                                  *
+ * This program is free software; you can redistribute it and/or    *
+ * modify it under the terms of the GNU General Public License as   *
+ * published by the Free Software Foundation; either version 2 of   *
+ * the License, or (at your option) any later version.              *
+ *                                                                  *
+ * This program is distributed in the hope that it will be useful,  *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of   *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the    *
+ * GNU General Public License for more details.                     *
+ *                                                                  *
+ * You should have received a copy of the GNU General Public License*
+ * along with this program; if not, contact:                        *
+ *                                                                  *
+ * Free Software Foundation           Voice:  +1-617-542-5942       *
+ * 51 Franklin Street, Fifth Floor    Fax:    +1-617-542-2652       *
+ * Boston, MA  02110-1301,  USA       gnu@gnu.org                   *
+ *                                                                  *
+\********************************************************************/
+
+/** @file AccountP.hpp
+ *
+ * The C++ definition of the account's private data. Only Account.cpp
+ * and its tests should include this file; everything else uses the
+ * functions declared in Account.h and AccountP.h.
+ */
+
+#ifndef XACC_ACCOUNT_P_HPP
+#define XACC_ACCOUNT_P_HPP
+
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "AccountP.h"
+
+using SplitsVec = std::vector<Split*>;
+using SplitNodeMap = std::unordered_map<Split*, GList*>;
+using SplitsSet = std::unordered_set<Split*>;
+using SplitDatesVec = std::vector<time64>;
+
+/* An open lot in the open-lot index of its account. */
+struct OpenLot
+{
+    time64 posted;              /* of the opening split's transaction */
+    gint64 order;               /* lower for lots earlier in the lot list */
+    GNCLot *lot;
+    gnc_commodity *currency;    /* of the opening split's transaction */
+
+    bool operator< (const OpenLot& other) const
+    {
+        return posted < other.posted ||
+            (posted == other.posted && order < other.order);
+    }
+};
+using OpenLotSet = std::set<OpenLot>;
+
+/* Where one of the account's lots is in the open-lot index. */
+struct LotIndexEntry
+{
+    gint64 order;
+    OpenLotSet *open;           /* NULL if the lot isn't indexed as open */
+    OpenLotSet::iterator pos;
+};
+using LotIndexMap = std::unordered_map<GNCLot*, LotIndexEntry>;
+using LotsSet = std::unordered_set<GNCLot*>;
+
+/** This is the data that describes an account.
+ *
+ * This is the *private* header for the account structure.
+ * No one outside of the engine should ever include this file.
+*/
+
+/** \struct Account */
+struct AccountPrivate
+{
+    /* The accountName is an arbitrary string assigned by the user.
+     * It is intended to a short, 5 to 30 character long string that
+     * is displayed by the GUI as the account mnemonic.
+     */
+    char *accountName;
+
+    /* The accountCode is an arbitrary string assigned by the user.
+     * It is intended to be reporting code that is a synonym for the
+     * accountName. Typically, it will be a numeric value that follows
+     * the numbering assignments commonly used by accountants, such
+     * as 100, 200 or 600 for top-level accounts, and 101, 102..  etc.
+     * for detail accounts.
+     */
+    char *accountCode;
+
+    /* The description is an arbitrary string assigned by the user.
+     * It is intended to be a longer, 1-5 sentence description of what
+     * this account is all about.
+     */
+    char *description;
+
+    /* The type field is the account type, picked from the enumerated
+     * list that includes ACCT_TYPE_BANK, ACCT_TYPE_STOCK,
+     * ACCT_TYPE_CREDIT, ACCT_TYPE_INCOME, etc.  Its intended use is to
+     * be a hint to the GUI as to how to display and format the
+     * transaction data.
+     */
+    GNCAccountType type;
+
+    /*
+     * The commodity field denotes the kind of 'stuff' stored
+     * in this account.  The 'amount' field of a split indicates
+     * how much of the 'stuff' there is.
+     */
+    gnc_commodity * commodity;
+    int commodity_scu;
+    gboolean non_standard_scu;
+
+    /* The parent and children pointers are used to implement an account
+     * hierarchy, of accounts that have sub-accounts ("detail accounts").
+     */
+    Account *parent;    /* back-pointer to parent */
+    GList *children;    /* list of sub-accounts */
+
+    /* protected data - should only be set by backends */
+    gnc_numeric starting_balance;
+    gnc_numeric starting_noclosing_balance;
+    gnc_numeric starting_cleared_balance;
+    gnc_numeric starting_reconciled_balance;
+
+    /* cached parameters */
+    gnc_numeric balance;
+    gnc_numeric noclosing_balance;
+    gnc_numeric cleared_balance;
+    gnc_numeric reconciled_balance;
+
+    gboolean balance_dirty;     /* balances in splits incorrect */
+    /* While balance_dirty is set, the running balances in the splits
+     * before this index in splits_vec are still correct. */
+    size_t balance_dirty_from;
+
+    /* The splits are kept in three synchronized containers: the GList
+     * handed out by xaccAccountGetSplitList, a vector holding the same
+     * splits in the same order for binary searches and a hash mapping
+     * each split to its node in the GList for O(1) membership tests and
+     * removals. Only the splits_* functions in Account.cpp may change
+     * any of them. */
+    GList *splits;              /* list of split pointers */
+    SplitsVec splits_vec;       /* the same splits, contiguous */
+    SplitNodeMap splits_hash;   /* split -> its node in splits */
+    /* The posted date of each split in splits_vec, rebuilt together with
+     * the running balances in the splits. Empty if the dates aren't in
+     * order, which can only happen for splits without a transaction. */
+    SplitDatesVec splits_dates;
+    gboolean sort_dirty;        /* sort order of splits is bad */
+    /* If sort_dirty is set and this isn't empty, only these splits may be
+     * out of place; the others are still in order. */
+    SplitsSet sort_dirty_splits;
+
+    LotList   *lots;		/* list of lot pointers */
+    /* The open lots indexed by the posted date of their opening split,
+     * one set for each sign of the opening amount: open_lots[1] holds the
+     * lots opened by a positive amount. The index is built by the first
+     * open-lot search and kept up to date from then on. lots_index has an
+     * entry for every lot in lots; lots that may have changed are put in
+     * stale_lots and re-indexed by the next search. */
+    gboolean open_lots_valid;
+    OpenLotSet open_lots[2];
+    LotIndexMap lots_index;
+    LotsSet stale_lots;
+    gint64 lots_first_order;    /* the order of the first lot in lots */
+    GNCPolicy *policy;		/* Cached pointer to policy method */
+
+    /* The "mark" flag can be used by the user to mark this account
+     * in any way desired.  Handy for specialty traversals of the
+     * account tree. */
+    short mark;
+};
+
+#endif /* XACC_ACCOUNT_P_HPP */
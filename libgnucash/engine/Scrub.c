@@ -342,6 +342,244 @@ xaccAccountScrubImbalance (Account *acc, QofPercentageFunc percentagefunc)
     (percentagefunc)(NULL, -1.0);
 }
 
+/* ================================================================ */
+
+/* Transactions checked by one thread pool task. */
+#define CHECK_CHUNK_SIZE 1024
+
+typedef struct
+{
+    Transaction **trans;
+    ScrubCheckFlags *problems;
+    gboolean use_trading;
+} TransCheck;
+
+/* Check a transaction the way xaccSplitScrub and xaccTransIsBalanced
+ * would, but only reading it: this runs on the check threads, so it
+ * mustn't log, edit or look anything up in the book. */
+static ScrubCheckFlags
+trans_check (Transaction *trans, gboolean use_trading)
+{
+    ScrubCheckFlags problems = 0;
+    gnc_commodity *currency = trans->common_currency;
+    gnc_numeric imbal = gnc_numeric_zero();
+    gnc_numeric imbal_trading = gnc_numeric_zero();
+    MonetaryList *imbal_list = NULL;
+    gboolean by_commodity = FALSE;
+    GList *node;
+
+    if (!gnc_commodity_is_currency (currency))
+        problems |= SCRUB_CHECK_NO_CURRENCY;
+
+    for (node = trans->splits; node; node = node->next)
+    {
+        Split *s = node->data;
+        gnc_numeric amount, value;
+        gnc_commodity *commodity;
+
+        if (!xaccTransStillHasSplit (trans, s)) continue;
+        amount = s->amount;
+        value = s->value;
+        if (gnc_numeric_check (amount) || gnc_numeric_check (value))
+        {
+            problems |= SCRUB_CHECK_NUMERIC;
+            continue;
+        }
+        if (!s->acc)
+        {
+            problems |= SCRUB_CHECK_ORPHAN;
+            imbal = gnc_numeric_add (imbal, value, GNC_DENOM_AUTO,
+                                     GNC_HOW_DENOM_EXACT);
+            continue;
+        }
+
+        commodity = xaccAccountGetCommodity (s->acc);
+        if (!commodity)
+        {
+            problems |= SCRUB_CHECK_COMMODITY;
+        }
+        else if (currency && gnc_commodity_equiv (commodity, currency))
+        {
+            int scu = MIN (xaccAccountGetCommoditySCU (s->acc),
+                           gnc_commodity_get_fraction (currency));
+            if (!gnc_numeric_same (amount, value, scu,
+                                   GNC_HOW_RND_ROUND_HALF_UP))
+                problems |= SCRUB_CHECK_COMMODITY;
+        }
+
+        if (use_trading && xaccAccountGetType (s->acc) == ACCT_TYPE_TRADING)
+            imbal_trading = gnc_numeric_add (imbal_trading, value,
+                                             GNC_DENOM_AUTO,
+                                             GNC_HOW_DENOM_EXACT);
+        else
+            imbal = gnc_numeric_add (imbal, value, GNC_DENOM_AUTO,
+                                     GNC_HOW_DENOM_EXACT);
+
+        /* With trading accounts each commodity must balance too. */
+        if (use_trading && currency &&
+            (by_commodity || !gnc_commodity_equiv (commodity, currency) ||
+             !gnc_numeric_equal (amount, value)))
+            by_commodity = TRUE;
+        if (by_commodity)
+            imbal_list = gnc_monetary_list_add_value (imbal_list, commodity,
+                                                      amount);
+    }
+
+    if (problems & SCRUB_CHECK_NUMERIC)
+    {
+        gnc_monetary_list_free (imbal_list);
+        return problems;
+    }
+
+    if (!gnc_numeric_zero_p (imbal) || !gnc_numeric_zero_p (imbal_trading))
+    {
+        problems |= SCRUB_CHECK_IMBALANCE;
+    }
+    else if (by_commodity)
+    {
+        /* The splits before the first one in another commodity were all
+         * in the currency with amount equal to value. */
+        for (node = trans->splits; node; node = node->next)
+        {
+            Split *s = node->data;
+            if (!xaccTransStillHasSplit (trans, s) || !s->acc) continue;
+            if (!gnc_commodity_equiv (xaccAccountGetCommodity (s->acc),
+                                      currency) ||
+                !gnc_numeric_equal (s->amount, s->value))
+                break;
+            imbal_list = gnc_monetary_list_add_value (imbal_list, currency,
+                                                      s->value);
+        }
+        imbal_list = gnc_monetary_list_delete_zeros (imbal_list);
+        if (imbal_list)
+            problems |= SCRUB_CHECK_IMBALANCE;
+    }
+    gnc_monetary_list_free (imbal_list);
+    return problems;
+}
+
+static void
+trans_check_chunk (gpointer data, gpointer user_data)
+{
+    TransCheck *check = user_data;
+    guint start = GPOINTER_TO_UINT (data) - 1;
+    guint i;
+
+    for (i = start; i < start + CHECK_CHUNK_SIZE && check->trans[i]; i++)
+        check->problems[i] = trans_check (check->trans[i], check->use_trading);
+}
+
+typedef struct
+{
+    GHashTable *seen;
+    GPtrArray *trans;
+} TransCollect;
+
+static void
+collect_account_trans (Account *acc, gpointer data)
+{
+    TransCollect *collect = data;
+    GList *node;
+
+    for (node = xaccAccountGetSplitList (acc); node; node = node->next)
+    {
+        Transaction *trans = xaccSplitGetParent (node->data);
+        if (trans && g_hash_table_add (collect->seen, trans))
+            g_ptr_array_add (collect->trans, trans);
+    }
+}
+
+GList *
+xaccAccountTreeCheckTransactions (Account *acc)
+{
+    TransCollect collect;
+    TransCheck check;
+    GThreadPool *pool = NULL;
+    GList *results = NULL;
+    guint n_trans, i;
+
+    if (!acc) return NULL;
+    ENTER ("(acc=%s)", xaccAccountGetName (acc));
+
+    /* Each transaction is checked once, however many of the accounts it
+     * touches. */
+    collect.seen = g_hash_table_new (g_direct_hash, g_direct_equal);
+    collect.trans = g_ptr_array_new ();
+    collect_account_trans (acc, &collect);
+    gnc_account_foreach_descendant (acc, collect_account_trans, &collect);
+    g_hash_table_destroy (collect.seen);
+
+    /* NULL-terminated so that the last chunk knows where to stop. */
+    n_trans = collect.trans->len;
+    g_ptr_array_add (collect.trans, NULL);
+    check.trans = (Transaction**)g_ptr_array_free (collect.trans, FALSE);
+    check.problems = g_new0 (ScrubCheckFlags, n_trans);
+    check.use_trading =
+        qof_book_use_trading_accounts (gnc_account_get_book (acc));
+
+    if (n_trans > CHECK_CHUNK_SIZE)
+        pool = g_thread_pool_new (trans_check_chunk, &check,
+                                  g_get_num_processors (), FALSE, NULL);
+    for (i = 0; i < n_trans; i += CHECK_CHUNK_SIZE)
+    {
+        /* Chunks are passed as start + 1, since a NULL task is refused. */
+        if (!pool || !g_thread_pool_push (pool, GUINT_TO_POINTER (i + 1),
+                                          NULL))
+            trans_check_chunk (GUINT_TO_POINTER (i + 1), &check);
+    }
+    if (pool)
+        g_thread_pool_free (pool, FALSE, TRUE);
+
+    for (i = n_trans; i > 0; i--)
+    {
+        ScrubCheckResult *result;
+        if (!check.problems[i - 1]) continue;
+        result = g_new (ScrubCheckResult, 1);
+        result->trans = check.trans[i - 1];
+        result->problems = check.problems[i - 1];
+        results = g_list_prepend (results, result);
+    }
+    g_free (check.trans);
+    g_free (check.problems);
+
+    LEAVE ("(acc=%s) %u of %u transactions flagged", xaccAccountGetName (acc),
+           g_list_length (results), n_trans);
+    return results;
+}
+
+void
+xaccScrubCheckedTransactions (GList *results, Account *root,
+                              QofPercentageFunc percentagefunc)
+{
+    const char *message = _( "Fixing transactions: %u of %u");
+    guint count = g_list_length (results), current = 0;
+    GList *node;
+
+    g_return_if_fail (root);
+
+    for (node = results; node; node = node->next, current++)
+    {
+        ScrubCheckResult *result = node->data;
+        Transaction *trans = result->trans;
+
+        if (percentagefunc && current % 100 == 0)
+        {
+            char *progress_msg = g_strdup_printf (message, current, count);
+            (percentagefunc)(progress_msg, (100 * current) / count);
+            g_free (progress_msg);
+        }
+
+        if (result->problems & SCRUB_CHECK_ORPHAN)
+            TransScrubOrphansFast (trans, root);
+        if (result->problems & (SCRUB_CHECK_NO_CURRENCY | SCRUB_CHECK_COMMODITY))
+            xaccTransScrubCurrency (trans);
+        /* This scrubs the splits too. */
+        xaccTransScrubImbalance (trans, root, NULL);
+    }
+    if (percentagefunc)
+        (percentagefunc)(NULL, -1.0);
+}
+
 static Split *
 get_balance_split (Transaction *trans, Account *root, Account *account,
                    gnc_commodity *commodity)
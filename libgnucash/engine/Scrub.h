@@ -111,6 +111,46 @@ void xaccTransScrubImbalance (Transaction *trans, Account *root,
 void xaccAccountScrubImbalance (Account *acc, QofPercentageFunc percentagefunc);
 void xaccAccountTreeScrubImbalance (Account *acc, QofPercentageFunc percentagefunc);
 
+/** Problems found by xaccAccountTreeCheckTransactions(). */
+typedef enum
+{
+    SCRUB_CHECK_ORPHAN      = 1 << 0, /**< a split has no account */
+    SCRUB_CHECK_NO_CURRENCY = 1 << 1, /**< the transaction's currency is
+                                       * missing or not a currency */
+    SCRUB_CHECK_IMBALANCE   = 1 << 2, /**< the transaction doesn't balance */
+    SCRUB_CHECK_COMMODITY   = 1 << 3, /**< a split's account has no
+                                       * commodity, or has the transaction
+                                       * currency but amount and value
+                                       * differ */
+    SCRUB_CHECK_NUMERIC     = 1 << 4, /**< a split amount or value isn't a
+                                       * valid number */
+} ScrubCheckFlags;
+
+/** A transaction flagged by xaccAccountTreeCheckTransactions(). */
+typedef struct
+{
+    Transaction *trans;
+    ScrubCheckFlags problems;
+} ScrubCheckResult;
+
+/** The xaccAccountTreeCheckTransactions() method looks at each
+ *    transaction with a split in the indicated account or its children
+ *    once, without changing anything, and returns a list of
+ *    ScrubCheckResult for those with problems. The transactions are
+ *    checked on several threads, so nothing else may change the book
+ *    meanwhile. Free the list with g_list_free_full (list, g_free).
+ */
+GList *xaccAccountTreeCheckTransactions (Account *acc);
+
+/** The xaccScrubCheckedTransactions() method fixes the transactions
+ *    in a list returned by xaccAccountTreeCheckTransactions(), scrubbing
+ *    each one once for orphans, currency, splits and imbalance as
+ *    xaccAccountTreeScrubImbalance() would. Orphaned splits go to
+ *    accounts under root.
+ */
+void xaccScrubCheckedTransactions (GList *results, Account *root,
+                                   QofPercentageFunc percentagefunc);
+
 /** The xaccTransScrubCurrency method fixes transactions without a
  * common_currency by looking for the most commonly used currency
  * among all the splits in the transaction.  If this fails it falls
@@ -163,6 +163,9 @@ xaccAccountScrubLots (Account *acc)
     if (FALSE == xaccAccountHasTrades (acc)) return;
 
     ENTER ("(acc=%s)", xaccAccountGetName(acc));
+    /* Rescrubbing touches every gains transaction of the account, so
+     * deliver the events for all of them together. */
+    qof_event_begin_batch ();
     xaccAccountBeginEdit(acc);
     xaccAccountAssignLots (acc);
 
@@ -174,6 +177,7 @@ xaccAccountScrubLots (Account *acc)
     }
     g_list_free(lots);
     xaccAccountCommitEdit(acc);
+    qof_event_end_batch ();
     LEAVE ("(acc=%s)", xaccAccountGetName(acc));
 }
 
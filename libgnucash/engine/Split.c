@@ -56,6 +56,7 @@
 #include "gnc-lot.h"
 #include "gnc-event.h"
 #include "qofinstance-p.h"
+#include "qofquerycore-p.h"
 
 const char *void_former_amt_str = "void-former-amount";
 const char *void_former_val_str = "void-former-value";
@@ -727,7 +728,7 @@ void mark_split (Split *s)
 {
     if (s->acc)
     {
-        g_object_set(s->acc, "sort-dirty", TRUE, "balance-dirty", TRUE, NULL);
+        gnc_account_set_split_dirty (s->acc, s);
     }
 
     /* set dirty flag on lot too. */
@@ -1017,7 +1018,7 @@ xaccSplitCommitEdit(Split *s)
 
     if (acc)
     {
-        g_object_set(acc, "sort-dirty", TRUE, "balance-dirty", TRUE, NULL);
+        gnc_account_set_split_dirty (acc, s);
         xaccAccountRecomputeBalance(acc);
     }
 }
@@ -1205,6 +1206,7 @@ qofSplitSetAmount (Split *split, gnc_numeric amt)
     {
         split->amount = amt;
     }
+    if (split->lot) gnc_lot_set_closed_unknown (split->lot);
 }
 
 /* The amount of the split in the _account's_ commodity. */
@@ -1478,6 +1480,75 @@ xaccSplitDestroy (Split *split)
 /********************************************************************\
 \********************************************************************/
 
+/* Fill in the split's sort key from its parent, which it must have. It's
+ * kept for the next time unless the parent may still change. */
+static void
+split_order_key_update (Split *split)
+{
+    const Transaction *trans = split->parent;
+
+    if (split->order_key_valid && split->order_key_gen == trans->order_gen &&
+        !xaccTransIsOpen (trans))
+        return;
+    split->order_posted = trans->date_posted;
+    split->order_entered = trans->date_entered;
+    split->order_closing = xaccTransGetIsClosingTxn (trans);
+    split->order_num = atoi (trans->num);
+    split->order_action_num = split->action ? atoi (split->action) : 0;
+    split->order_key_gen = trans->order_gen;
+    split->order_key_valid = !xaccTransIsOpen (trans);
+}
+
+/* The same as xaccTransOrder_num_action on the splits' parents, using the
+ * sort keys. */
+static int
+split_trans_order (const Split *sa, const Split *sb, gboolean action_for_num)
+{
+    const Transaction *ta = sa->parent;
+    const Transaction *tb = sb->parent;
+    const char *da, *db;
+    int na, nb, retval;
+
+    if (ta && !tb) return -1;
+    if (!ta && tb) return +1;
+    if (!ta && !tb) return 0;
+
+    split_order_key_update ((Split*)sa);
+    split_order_key_update ((Split*)sb);
+    if (sa->order_posted != sb->order_posted)
+        return (sa->order_posted > sb->order_posted) -
+            (sa->order_posted < sb->order_posted);
+
+    /* Always sort closing transactions after normal transactions */
+    if (sa->order_closing != sb->order_closing)
+        return sa->order_closing - sb->order_closing;
+
+    if (action_for_num && sa->action && sb->action)
+    {
+        na = sa->order_action_num;
+        nb = sb->order_action_num;
+    }
+    else
+    {
+        na = sa->order_num;
+        nb = sb->order_num;
+    }
+    if (na < nb) return -1;
+    if (na > nb) return +1;
+
+    if (sa->order_entered != sb->order_entered)
+        return (sa->order_entered > sb->order_entered) -
+            (sa->order_entered < sb->order_entered);
+
+    da = ta->description ? ta->description : "";
+    db = tb->description ? tb->description : "";
+    retval = g_utf8_collate (da, db);
+    if (retval)
+        return retval;
+
+    return qof_instance_guid_compare (ta, tb);
+}
+
 gint
 xaccSplitOrder (const Split *sa, const Split *sb)
 {
@@ -1495,11 +1566,7 @@ xaccSplitOrder (const Split *sa, const Split *sb)
      * according to book option */
     action_for_num = qof_book_use_split_action_for_num_field
         (xaccSplitGetBook (sa));
-    if (action_for_num)
-        retval = xaccTransOrder_num_action (sa->parent, sa->action,
-                                            sb->parent, sb->action);
-    else
-        retval = xaccTransOrder (sa->parent, sb->parent);
+    retval = split_trans_order (sa, sb, action_for_num);
     if (retval) return retval;
 
     /* otherwise, sort on memo strings */
@@ -1839,6 +1906,9 @@ xaccSplitSetParent(Split *s, Transaction *t)
         qof_event_gen(&old_trans->inst, GNC_EVENT_ITEM_REMOVED, &ed);
     }
     s->parent = t;
+    s->order_key_valid = FALSE;
+    /* The split's place in its lot depends on the transaction's date. */
+    if (s->lot) gnc_lot_set_closed_unknown (s->lot);
 
     xaccTransCommitEdit(old_trans);
     qof_instance_set_dirty(QOF_INSTANCE(s));
@@ -2233,6 +2303,169 @@ qofSplitSetAccount(Split *s, QofInstance *ent)
     xaccSplitSetAccount(s, acc);
 }
 
+/* The split query index answers account and date-posted terms from the
+ * accounts' split lists instead of testing every split in the book. Like
+ * xaccAccountGetSplitList they hold the splits committed to each account,
+ * which for a split in an open transaction needn't be the account it is
+ * now set to. So the splits of open transactions are always candidates
+ * too; the query tests each candidate against the split as it is now. */
+
+static gboolean
+split_index_by_account (QofBook *book, QofQueryPredData *pd,
+                        GList **candidates)
+{
+    query_guid_t pdata = (query_guid_t)pd;
+    GHashTable *seen;
+    GList *node;
+
+    if (g_strcmp0 (pd->type_name, QOF_TYPE_GUID) ||
+        pdata->options != QOF_GUID_MATCH_ANY)
+        return FALSE;
+
+    /* A GUID listed twice mustn't give its splits twice. */
+    seen = g_hash_table_new (g_direct_hash, g_direct_equal);
+    for (node = pdata->guids; node; node = node->next)
+    {
+        Account *acc = xaccAccountLookup (node->data, book);
+
+        if (!acc || g_hash_table_contains (seen, acc)) continue;
+        g_hash_table_add (seen, acc);
+        *candidates = gnc_account_prepend_splits_posted_between (acc,
+                                                                 INT64_MIN,
+                                                                 INT64_MAX,
+                                                                 *candidates);
+    }
+    g_hash_table_destroy (seen);
+    return TRUE;
+}
+
+typedef struct
+{
+    time64 start;
+    time64 end;
+    guint count;
+    GList *splits;
+} SplitDateIndexData;
+
+static void
+split_index_date_cb (QofInstance *inst, gpointer user_data)
+{
+    SplitDateIndexData *data = user_data;
+    Account *acc = GNC_ACCOUNT (inst);
+
+    data->count += xaccAccountCountSplits (acc, FALSE);
+    data->splits = gnc_account_prepend_splits_posted_between (acc, data->start,
+                                                              data->end,
+                                                              data->splits);
+}
+
+/* The splits of open transactions that aren't in any account's split list
+ * yet, which split_query_index adds as candidates. A split is in the list
+ * of its orig_acc until its transaction is committed. */
+static guint
+split_index_count_open_unlisted (void)
+{
+    GList *open = xaccTransPrependOpenSplits (NULL), *node;
+    guint count = 0;
+
+    for (node = open; node; node = node->next)
+        if (!((Split*)node->data)->orig_acc)
+            count++;
+    g_list_free (open);
+    return count;
+}
+
+static gboolean
+split_index_by_date (QofBook *book, QofQueryPredData *pd, GList **candidates)
+{
+    query_date_t pdata = (query_date_t)pd;
+    SplitDateIndexData data = {INT64_MIN, INT64_MAX, 0, NULL};
+    /* Wide enough to cover the canonical day time of any date. */
+    time64 slack = pdata->options == QOF_DATE_MATCH_DAY ? 2 * 86400 : 0;
+
+    if (g_strcmp0 (pd->type_name, QOF_TYPE_DATE))
+        return FALSE;
+
+    switch (pd->how)
+    {
+    case QOF_COMPARE_LT:
+    case QOF_COMPARE_LTE:
+        data.end = pdata->date + slack;
+        break;
+    case QOF_COMPARE_GT:
+    case QOF_COMPARE_GTE:
+        data.start = pdata->date - slack;
+        break;
+    case QOF_COMPARE_EQUAL:
+        data.start = pdata->date - slack;
+        data.end = pdata->date + slack;
+        break;
+    default:
+        return FALSE;
+    }
+
+    qof_collection_foreach (qof_book_get_collection (book, GNC_ID_ACCOUNT),
+                            split_index_date_cb, &data);
+    data.count += split_index_count_open_unlisted ();
+
+    /* Other splits that aren't in any account can't be found this way. */
+    if (data.count != qof_collection_count (qof_book_get_collection (book,
+                                                                     GNC_ID_SPLIT)))
+    {
+        g_list_free (data.splits);
+        return FALSE;
+    }
+    *candidates = data.splits;
+    return TRUE;
+}
+
+/* Add the splits of open transactions to the candidates, taking out those
+ * already there so that none is listed twice. */
+static GList *
+split_index_add_open (GList *candidates)
+{
+    GList *open = xaccTransPrependOpenSplits (NULL);
+    GHashTable *open_set;
+    GList *node, *next;
+
+    if (!open) return candidates;
+    open_set = g_hash_table_new (g_direct_hash, g_direct_equal);
+    for (node = open; node; node = node->next)
+        g_hash_table_add (open_set, node->data);
+    for (node = candidates; node; node = next)
+    {
+        next = node->next;
+        if (g_hash_table_contains (open_set, node->data))
+            candidates = g_list_delete_link (candidates, node);
+    }
+    g_hash_table_destroy (open_set);
+    return g_list_concat (open, candidates);
+}
+
+static gboolean
+split_query_index (QofBook *book, QofQueryParamList *param_list,
+                   QofQueryPredData *pred_data, GList **candidates)
+{
+    const char *first, *second;
+    gboolean found = FALSE;
+
+    if (!book || !pred_data || !param_list || !param_list->next ||
+        param_list->next->next)
+        return FALSE;
+
+    first = param_list->data;
+    second = param_list->next->data;
+    if (!g_strcmp0 (first, SPLIT_ACCOUNT) && !g_strcmp0 (second, QOF_PARAM_GUID))
+        found = split_index_by_account (book, pred_data, candidates);
+    else if (!g_strcmp0 (first, SPLIT_TRANS) &&
+             !g_strcmp0 (second, TRANS_DATE_POSTED))
+        found = split_index_by_date (book, pred_data, candidates);
+
+    if (found && xaccTransAnyOpen ())
+        *candidates = split_index_add_open (*candidates);
+    return found;
+}
+
 gboolean xaccSplitRegister (void)
 {
     static const QofParam params[] =
@@ -2332,6 +2565,7 @@ gboolean xaccSplitRegister (void)
                         NULL);
     qof_class_register (SPLIT_CORR_ACCT_CODE,
                         (QofSortFunc)xaccSplitCompareOtherAccountCodes, NULL);
+    qof_query_register_index (GNC_ID_SPLIT, split_query_index);
 
     return qof_object_register (&split_object_def);
 }
@@ -126,6 +126,19 @@ struct split_s
     gnc_numeric  noclosing_balance;
     gnc_numeric  cleared_balance;
     gnc_numeric  reconciled_balance;
+
+    /* The leading part of the sort order, cached by xaccSplitOrder so
+     * that sorting compares integers: the parent's dates, whether it
+     * closes the books and its number parsed, and the action parsed. It
+     * is valid while order_key_gen is the parent's order_gen and the
+     * parent isn't open for editing. */
+    gboolean order_key_valid;
+    guint order_key_gen;
+    time64 order_posted;
+    time64 order_entered;
+    gboolean order_closing;
+    int order_num;
+    int order_action_num;
 };
 
 struct _SplitClass
@@ -29,11 +29,18 @@
 #include <glib.h>
 #include <glib/gstdio.h>
 #include <string.h>
+#ifdef G_OS_WIN32
+# include <io.h>
+# define fsync _commit
+#elif defined HAVE_UNISTD_H
+# include <unistd.h>
+#endif
 
 #include "Account.h"
 #include "Transaction.h"
 #include "TransactionP.h"
 #include "TransLog.h"
+#include "TransLogP.h"
 #include "qof.h"
 #ifdef _MSC_VER
 # define g_fopen fopen
@@ -88,6 +95,56 @@ static int gen_logs = 1;
 static FILE * trans_log = NULL; /**< current log file handle */
 static char * trans_log_name = NULL; /**< current log file name */
 static char * log_base_name = NULL;
+static gint log_sync_policy = XACC_LOG_SYNC_NONE;
+
+/* Formatting the records is left to a writer thread, so that committing a
+ * transaction only has to copy out its data. xaccTransWriteLog packs the
+ * transaction into a LogRecord, a single block holding the splits and the
+ * strings, and pushes it onto log_queue. Pushing is a compare-and-exchange
+ * on the head of the list, so it never waits for the writer; the mutex and
+ * condition are only used to wake the writer when the list was empty.
+ * The writer takes the whole list at once, formats it in order and writes
+ * it out with one fflush, so a bulk import is written in large batches.
+ * xaccCloseLog waits for everything queued to be written. If the writer
+ * thread can't be started the records are written as they are logged.
+ */
+typedef struct
+{
+    GncGUID guid;
+    GncGUID acc_guid;
+    gboolean has_account;
+    char reconciled;
+    gnc_numeric amount;
+    gnc_numeric value;
+    time64 date_reconciled;
+    /* offsets into the record's strings */
+    gsize acc_name, memo, action;
+} LogSplit;
+
+typedef struct LogRecord
+{
+    struct LogRecord *next;
+    char flag;
+    time64 now;
+    time64 date_entered;
+    time64 date_posted;
+    GncGUID guid;
+    gsize num, description, notes;
+    guint n_splits;
+    LogSplit *splits;
+    /* NUL-separated; an empty or missing string has offset 0. */
+    char *strings;
+} LogRecord;
+
+/* Write out the formatted text when it grows past this. */
+#define LOG_BUFFER_SIZE 65536
+
+static gpointer log_queue = NULL; /**< LogRecords, newest first */
+static GThread * log_writer = NULL;
+static GMutex log_lock;
+static GCond log_cond;
+static gboolean log_stopping = FALSE;
+static gboolean log_threaded = TRUE;
 
 /********************************************************************\
 \********************************************************************/
@@ -101,6 +158,24 @@ void xaccLogEnable  (void)
     gen_logs = 1;
 }
 
+void
+xaccLogSetSyncPolicy (XaccLogSyncPolicy policy)
+{
+    g_atomic_int_set (&log_sync_policy, policy);
+}
+
+XaccLogSyncPolicy
+xaccLogGetSyncPolicy (void)
+{
+    return g_atomic_int_get (&log_sync_policy);
+}
+
+void
+_utest_translog_set_threaded (gboolean threaded)
+{
+    log_threaded = threaded;
+}
+
 /********************************************************************\
 \********************************************************************/
 
@@ -155,11 +230,180 @@ xaccFileIsCurrentLog (const gchar *name)
 /********************************************************************\
 \********************************************************************/
 
+static void
+log_sync (void)
+{
+    if (fsync (fileno (trans_log)) != 0)
+    {
+        int norr = errno;
+        PERR ("cannot sync journal: %d %s", norr, g_strerror (norr));
+    }
+}
+
+static void
+log_write_buffer (GString *buf)
+{
+    if (buf->len == 0) return;
+    if (fwrite (buf->str, 1, buf->len, trans_log) != buf->len)
+        PERR ("cannot write journal");
+    g_string_truncate (buf, 0);
+}
+
+static void
+log_format_record (GString *buf, const LogRecord *rec)
+{
+    char trans_guid_str[GUID_ENCODING_LENGTH + 1];
+    char split_guid_str[GUID_ENCODING_LENGTH + 1];
+    char acc_guid_str[GUID_ENCODING_LENGTH + 1];
+    char dnow[100], dent[100], dpost[100], drecn[100];
+    guint i;
+
+    gnc_time64_to_iso8601_buff (rec->now, dnow);
+    gnc_time64_to_iso8601_buff (rec->date_entered, dent);
+    gnc_time64_to_iso8601_buff (rec->date_posted, dpost);
+    guid_to_string_buff (&rec->guid, trans_guid_str);
+    g_string_append (buf, "===== START\n");
+
+    for (i = 0; i < rec->n_splits; i++)
+    {
+        const LogSplit *split = &rec->splits[i];
+
+        if (split->has_account)
+            guid_to_string_buff (&split->acc_guid, acc_guid_str);
+        else
+            acc_guid_str[0] = '\0';
+
+        gnc_time64_to_iso8601_buff (split->date_reconciled, drecn);
+        guid_to_string_buff (&split->guid, split_guid_str);
+
+        /* use tab-separated fields */
+        g_string_append_printf (buf,
+                 "%c\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t"
+                 "%s\t%s\t%s\t%s\t%c\t%" G_GINT64_FORMAT "/%" G_GINT64_FORMAT "\t%" G_GINT64_FORMAT "/%" G_GINT64_FORMAT "\t%s\n",
+                 rec->flag,
+                 trans_guid_str, split_guid_str,  /* trans+split make up unique id */
+                 dnow,
+                 dent,
+                 dpost,
+                 acc_guid_str,
+                 rec->strings + split->acc_name,
+                 rec->strings + rec->num,
+                 rec->strings + rec->description,
+                 rec->strings + rec->notes,
+                 rec->strings + split->memo,
+                 rec->strings + split->action,
+                 split->reconciled,
+                 gnc_numeric_num(split->amount),
+                 gnc_numeric_denom(split->amount),
+                 gnc_numeric_num(split->value),
+                 gnc_numeric_denom(split->value),
+                 drecn);
+    }
+
+    g_string_append (buf, "===== END\n");
+}
+
+/* Write out and free records, which are in the order they were logged. */
+static void
+log_write_records (LogRecord *records, GString *buf)
+{
+    while (records)
+    {
+        LogRecord *next = records->next;
+        log_format_record (buf, records);
+        g_free (records);
+        records = next;
+        if (buf->len >= LOG_BUFFER_SIZE)
+            log_write_buffer (buf);
+    }
+    log_write_buffer (buf);
+
+    /* get data out to the disk */
+    fflush (trans_log);
+    if (xaccLogGetSyncPolicy () == XACC_LOG_SYNC_BATCH)
+        log_sync ();
+}
+
+static void
+log_queue_push (LogRecord *rec)
+{
+    gpointer head;
+
+    do
+    {
+        head = g_atomic_pointer_get (&log_queue);
+        rec->next = head;
+    }
+    while (!g_atomic_pointer_compare_and_exchange (&log_queue, head, rec));
+
+    /* The writer only sleeps once it has found the queue empty. */
+    if (!head)
+    {
+        g_mutex_lock (&log_lock);
+        g_cond_signal (&log_cond);
+        g_mutex_unlock (&log_lock);
+    }
+}
+
+/* Take everything queued, oldest first. */
+static LogRecord *
+log_queue_take (void)
+{
+    LogRecord *head, *records = NULL;
+
+    do
+    {
+        head = g_atomic_pointer_get (&log_queue);
+    }
+    while (head &&
+           !g_atomic_pointer_compare_and_exchange (&log_queue, head, NULL));
+
+    while (head)
+    {
+        LogRecord *next = head->next;
+        head->next = records;
+        records = head;
+        head = next;
+    }
+    return records;
+}
+
+static gpointer
+log_writer_func (gpointer data)
+{
+    GString *buf = g_string_sized_new (LOG_BUFFER_SIZE);
+
+    while (TRUE)
+    {
+        LogRecord *records;
+        gboolean stopping;
+
+        g_mutex_lock (&log_lock);
+        while (!g_atomic_pointer_get (&log_queue) && !log_stopping)
+            g_cond_wait (&log_cond, &log_lock);
+        stopping = log_stopping;
+        g_mutex_unlock (&log_lock);
+
+        records = log_queue_take ();
+        if (records)
+            log_write_records (records, buf);
+        else if (stopping)
+            break;
+    }
+
+    g_string_free (buf, TRUE);
+    return NULL;
+}
+
+/********************************************************************\
+\********************************************************************/
+
 void
 xaccOpenLog (void)
 {
     char * filename;
     char * timestamp;
+    GError *error = NULL;
 
     if (!gen_logs)
     {
@@ -202,6 +446,17 @@ xaccOpenLog (void)
              "notes\tmemo\taction\treconciled\t"
              "amount\tvalue\tdate_reconciled\n");
     fprintf (trans_log, "-----------------\n");
+
+    log_stopping = FALSE;
+    if (!log_threaded)
+        return;
+    log_writer = g_thread_try_new ("translog", log_writer_func, NULL, &error);
+    if (!log_writer)
+    {
+        PWARN ("cannot start the journal writer, writing synchronously: %s",
+               error->message);
+        g_error_free (error);
+    }
 }
 
 /********************************************************************\
@@ -211,7 +466,18 @@ void
 xaccCloseLog (void)
 {
     if (!trans_log) return;
+    if (log_writer)
+    {
+        g_mutex_lock (&log_lock);
+        log_stopping = TRUE;
+        g_cond_signal (&log_cond);
+        g_mutex_unlock (&log_lock);
+        g_thread_join (log_writer);
+        log_writer = NULL;
+    }
     fflush (trans_log);
+    if (xaccLogGetSyncPolicy () != XACC_LOG_SYNC_NONE)
+        log_sync ();
     fclose (trans_log);
     trans_log = NULL;
 }
@@ -219,14 +485,32 @@ xaccCloseLog (void)
 /********************************************************************\
 \********************************************************************/
 
+static gsize
+log_string_size (const char *str)
+{
+    return str && *str ? strlen (str) + 1 : 0;
+}
+
+static gsize
+log_pack_string (LogRecord *rec, gsize *pos, const char *str)
+{
+    gsize offset = *pos, len = log_string_size (str);
+
+    if (!len) return 0;
+    memcpy (rec->strings + offset, str, len);
+    *pos += len;
+    return offset;
+}
+
 void
 xaccTransWriteLog (Transaction *trans, char flag)
 {
     GList *node;
-    char trans_guid_str[GUID_ENCODING_LENGTH + 1];
-    char split_guid_str[GUID_ENCODING_LENGTH + 1];
+    LogRecord *rec;
     const char *trans_notes;
-    char dnow[100], dent[100], dpost[100], drecn[100];
+    guint n_splits = 0;
+    gsize size, pos = 1;
+    guint i;
 
     if (!gen_logs)
     {
@@ -235,69 +519,70 @@ xaccTransWriteLog (Transaction *trans, char flag)
     }
     if (!trans_log) return;
 
-    gnc_time64_to_iso8601_buff (gnc_time(NULL), dnow);
-    gnc_time64_to_iso8601_buff (trans->date_entered, dent);
-    gnc_time64_to_iso8601_buff (trans->date_posted, dpost);
-    guid_to_string_buff (xaccTransGetGUID(trans), trans_guid_str);
+    /* Copy out everything that is logged, leaving the formatting to the
+     * writer. The first pass sizes the record. */
     trans_notes = xaccTransGetNotes(trans);
-    fprintf (trans_log, "===== START\n");
-
+    size = 1 + log_string_size (trans->num)
+           + log_string_size (trans->description)
+           + log_string_size (trans_notes);
     for (node = trans->splits; node; node = node->next)
     {
-        time64 time;
         Split *split = node->data;
-        const char * accname = "";
-        char acc_guid_str[GUID_ENCODING_LENGTH + 1];
-        gnc_numeric amt, val;
-
-        if (xaccSplitGetAccount(split))
-        {
-            accname = xaccAccountGetName (xaccSplitGetAccount(split));
-            guid_to_string_buff(xaccAccountGetGUID(xaccSplitGetAccount(split)),
-                                acc_guid_str);
-        }
-        else
-        {
-            acc_guid_str[0] = '\0';
-        }
-
-        gnc_time64_to_iso8601_buff (split->date_reconciled, drecn);
+        Account *acc = xaccSplitGetAccount(split);
 
-        guid_to_string_buff (xaccSplitGetGUID(split), split_guid_str);
-        amt = xaccSplitGetAmount (split);
-        val = xaccSplitGetValue (split);
-
-        /* use tab-separated fields */
-        fprintf (trans_log,
-                 "%c\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t"
-                 "%s\t%s\t%s\t%s\t%c\t%" G_GINT64_FORMAT "/%" G_GINT64_FORMAT "\t%" G_GINT64_FORMAT "/%" G_GINT64_FORMAT "\t%s\n",
-                 flag,
-                 trans_guid_str, split_guid_str,  /* trans+split make up unique id */
-                 /* Note that the next three strings always exist,
-                 		* so we don't need to test them. */
-                 dnow,
-                 dent,
-                 dpost,
-                 acc_guid_str,
-                 accname ? accname : "",
-                 trans->num ? trans->num : "",
-                 trans->description ? trans->description : "",
-                 trans_notes ? trans_notes : "",
-                 split->memo ? split->memo : "",
-                 split->action ? split->action : "",
-                 split->reconciled,
-                 gnc_numeric_num(amt),
-                 gnc_numeric_denom(amt),
-                 gnc_numeric_num(val),
-                 gnc_numeric_denom(val),
-                 /* The next string always exists. No need to test it. */
-                 drecn);
+        if (acc)
+            size += log_string_size (xaccAccountGetName (acc));
+        size += log_string_size (split->memo)
+                + log_string_size (split->action);
+        n_splits++;
     }
 
-    fprintf (trans_log, "===== END\n");
+    rec = g_malloc (sizeof (LogRecord) + n_splits * sizeof (LogSplit) + size);
+    rec->splits = (LogSplit *)(rec + 1);
+    rec->strings = (char *)(rec->splits + n_splits);
+    rec->strings[0] = '\0';
+
+    rec->flag = flag;
+    rec->now = gnc_time(NULL);
+    rec->date_entered = trans->date_entered;
+    rec->date_posted = trans->date_posted;
+    rec->guid = *xaccTransGetGUID(trans);
+    rec->num = log_pack_string (rec, &pos, trans->num);
+    rec->description = log_pack_string (rec, &pos, trans->description);
+    rec->notes = log_pack_string (rec, &pos, trans_notes);
+    rec->n_splits = n_splits;
+
+    for (node = trans->splits, i = 0; node; node = node->next, i++)
+    {
+        Split *split = node->data;
+        Account *acc = xaccSplitGetAccount(split);
+        LogSplit *log_split = &rec->splits[i];
+
+        log_split->guid = *xaccSplitGetGUID(split);
+        log_split->has_account = (acc != NULL);
+        if (acc)
+            log_split->acc_guid = *xaccAccountGetGUID(acc);
+        log_split->acc_name =
+            log_pack_string (rec, &pos, acc ? xaccAccountGetName (acc) : NULL);
+        log_split->memo = log_pack_string (rec, &pos, split->memo);
+        log_split->action = log_pack_string (rec, &pos, split->action);
+        log_split->reconciled = split->reconciled;
+        log_split->amount = xaccSplitGetAmount (split);
+        log_split->value = xaccSplitGetValue (split);
+        log_split->date_reconciled = split->date_reconciled;
+    }
 
-    /* get data out to the disk */
-    fflush (trans_log);
+    if (log_writer)
+    {
+        log_queue_push (rec);
+    }
+    else
+    {
+        GString *buf = g_string_new (NULL);
+        rec->next = NULL;
+        log_write_records (rec, buf);
+        g_string_free (buf, TRUE);
+    }
 }
 
 /************************ END OF ************************************\
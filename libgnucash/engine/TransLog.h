@@ -51,6 +51,10 @@ void    xaccCloseLog (void);
 void    xaccReopenLog (void);
 
 /**
+ * Queue a record of the transaction for the log writer thread, which
+ * formats and writes the records in the order they were queued.
+ * xaccCloseLog waits until all queued records are written.
+ *
  * @param trans The transaction to write out to the log
  * @param flag The engine currently uses the log mechanism with flag char set as
  * follows:
@@ -78,6 +82,20 @@ void    xaccLogDisable (void);
  */
 void    xaccLogSetBaseName (const char *);
 
+/** When the log writer asks the operating system to put what it has
+ *  written on the disk.  Whatever the policy, the log is flushed after
+ *  each batch of records the writer takes from the queue. */
+typedef enum
+{
+    XACC_LOG_SYNC_NONE,   /**< Never; the default. */
+    XACC_LOG_SYNC_CLOSE,  /**< When the log is closed. */
+    XACC_LOG_SYNC_BATCH,  /**< After each batch of records is written. */
+} XaccLogSyncPolicy;
+
+/** Set when the log is synced to the disk. May be called at any time. */
+void    xaccLogSetSyncPolicy (XaccLogSyncPolicy policy);
+XaccLogSyncPolicy xaccLogGetSyncPolicy (void);
+
 /** Test a filename to see if it is the name of the current logfile */
 gboolean xaccFileIsCurrentLog (const gchar *name);
 
@@ -0,0 +1,36 @@
+/********************************************************************\
+ * This program is free software; you can redistribute it and/or    *
+ * modify it under the terms of the GNU General Public License as   *
+ * published by the Free Software Foundation; either version 2 of   *
+ * the License, or (at your option) any later version.              *
+ *                                                                  *
+ * This program is distributed in the hope that it will be useful,  *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of   *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the    *
+ * GNU General Public License for more details.                     *
+ *                                                                  *
+ * You should have received a copy of the GNU General Public License*
+ * along with this program; if not, contact:                        *
+ *                                                                  *
+ * Free Software Foundation           Voice:  +1-617-542-5942       *
+ * 51 Franklin Street, Fifth Floor    Fax:    +1-617-542-2652       *
+ * Boston, MA  02110-1301,  USA       gnu@gnu.org                   *
+\********************************************************************/
+
+/** @file TransLogP.h
+ *
+ * This is the *private* header for the transaction logger.
+ * No one outside of the engine should ever include this file.
+ */
+
+#ifndef XACC_TRANS_LOG_P_H
+#define XACC_TRANS_LOG_P_H
+
+#include <glib.h>
+
+/* For testing: when FALSE, xaccOpenLog doesn't start the writer thread,
+ * as if it couldn't be started, and records are written as they are
+ * logged. TRUE by default; takes effect when the log is next opened. */
+void _utest_translog_set_threaded (gboolean threaded);
+
+#endif /* XACC_TRANS_LOG_P_H */
@@ -189,6 +189,9 @@ const char *assoc_uri_str = "assoc_uri";
 /* This static indicates the debugging module that this .o belongs to.  */
 static QofLogModule log_module = GNC_MOD_ENGINE;
 
+/* The transactions that are open for editing and hold a rollback copy. */
+static GHashTable *open_trans = NULL;
+
 enum
 {
     PROP_0,
@@ -819,6 +822,7 @@ xaccFreeTransaction (Transaction *trans)
     {
         xaccFreeTransaction (trans->orig);
         trans->orig = NULL;
+        g_hash_table_remove (open_trans, trans);
     }
 
     /* qof_instance_release (&trans->inst); */
@@ -1434,6 +1438,7 @@ void
 xaccTransBeginEdit (Transaction *trans)
 {
     if (!trans) return;
+    ++trans->order_gen;
     if (!qof_begin_edit(&trans->inst)) return;
 
     if (qof_book_shutting_down(qof_instance_get_book(trans))) return;
@@ -1447,6 +1452,9 @@ xaccTransBeginEdit (Transaction *trans)
     /* Make a clone of the transaction; we will use this
      * in case we need to roll-back the edit. */
     trans->orig = dupe_trans (trans);
+    if (!open_trans)
+        open_trans = g_hash_table_new (g_direct_hash, g_direct_equal);
+    g_hash_table_add (open_trans, trans);
 }
 
 /********************************************************************\
@@ -1614,6 +1622,8 @@ static void trans_cleanup_commit(Transaction *trans)
     /* Get rid of the copy we made. We won't be rolling back,
      * so we don't need it any more.  */
     PINFO ("get rid of rollback trans=%p", trans->orig);
+    if (trans->orig)
+        g_hash_table_remove (open_trans, trans);
     xaccFreeTransaction (trans->orig);
     trans->orig = NULL;
 
@@ -1764,9 +1774,11 @@ xaccTransRollbackEdit (Transaction *trans)
             SWAP(s->memo, so->memo);
 	    qof_instance_copy_kvp (QOF_INSTANCE (s), QOF_INSTANCE (so));
             s->reconciled = so->reconciled;
+            if (s->lot) gnc_lot_set_closed_unknown (s->lot);
             s->amount = so->amount;
             s->value = so->value;
             s->lot = so->lot;
+            if (s->lot) gnc_lot_set_closed_unknown (s->lot);
             s->gains_split = so->gains_split;
             //SET_GAINS_A_VDIRTY(s);
             s->date_reconciled = so->date_reconciled;
@@ -1846,6 +1858,8 @@ xaccTransRollbackEdit (Transaction *trans)
     if (!qof_book_is_readonly(qof_instance_get_book(trans)))
         xaccTransWriteLog (trans, 'R');
 
+    if (trans->orig)
+        g_hash_table_remove (open_trans, trans);
     xaccFreeTransaction (trans->orig);
 
     trans->orig = NULL;
@@ -1867,6 +1881,29 @@ xaccTransIsOpen (const Transaction *trans)
     return trans ? (0 < qof_instance_get_editlevel(trans)) : FALSE;
 }
 
+gboolean
+xaccTransAnyOpen (void)
+{
+    return open_trans && g_hash_table_size (open_trans) > 0;
+}
+
+GList *
+xaccTransPrependOpenSplits (GList *splits)
+{
+    GHashTableIter iter;
+    gpointer trans;
+
+    if (!open_trans) return splits;
+    g_hash_table_iter_init (&iter, open_trans);
+    while (g_hash_table_iter_next (&iter, &trans, NULL))
+    {
+        GList *node;
+        for (node = ((Transaction*)trans)->splits; node; node = node->next)
+            splits = g_list_prepend (splits, node->data);
+    }
+    return splits;
+}
+
 #define SECS_PER_DAY 86400
 
 int
@@ -2204,6 +2241,7 @@ xaccTransSetIsClosingTxn (Transaction *trans, gboolean is_closing)
         qof_instance_set_kvp (QOF_INSTANCE (trans), NULL, 1, trans_is_closing_str);
         trans->isClosingTxn_cached = 0;
     }
+    mark_trans(trans);  /* Dirty balance of every account in trans */
     qof_instance_set_dirty(QOF_INSTANCE(trans));
     xaccTransCommitEdit(trans);
 }
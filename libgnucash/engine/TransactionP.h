@@ -124,6 +124,10 @@ struct transaction_s
      * cached from the KVP value because it is queried a lot. Tri-state value: -1
      * = uninitialized; 0 = FALSE, 1 = TRUE. */
     gint isClosingTxn_cached;
+
+    /* Changed by every xaccTransBeginEdit, invalidating the sort keys its
+     * splits have cached. */
+    guint order_gen;
 };
 
 struct _TransactionClass
@@ -181,6 +185,15 @@ void xaccDisableDataScrubbing(void);
 void xaccTransRemoveSplit (Transaction *trans, const Split *split);
 void check_open (const Transaction *trans);
 
+/* Returns TRUE if any transaction is open for editing. Until it is
+ * committed the splits of an open transaction may not be in the accounts
+ * they are set to. */
+gboolean xaccTransAnyOpen (void);
+
+/* Prepend the splits of every transaction open for editing to splits and
+ * return the new list. */
+GList *xaccTransPrependOpenSplits (GList *splits);
+
 /* Structure for accessing static functions for testing */
 typedef struct
 {
@@ -102,90 +102,6 @@ xaccAccountHasTrades (const Account *acc)
 
 /* ============================================================== */
 
-struct find_lot_s
-{
-    GNCLot *lot;
-    gnc_commodity *currency;
-    time64 time;
-    int (*numeric_pred)(gnc_numeric);
-    gboolean (*date_pred)(time64 e, time64 tr);
-};
-
-static gboolean
-earliest_pred (time64 earl, time64 tran)
-{
-    return earl > tran;
-}
-
-static gboolean
-latest_pred (time64 earl, time64 tran)
-{
-    return earl < tran;
-}
-
-static gpointer
-finder_helper (GNCLot *lot,  gpointer user_data)
-{
-    struct find_lot_s *els = user_data;
-    Split *s;
-    Transaction *trans;
-    gnc_numeric bal;
-    gboolean opening_is_positive, bal_is_positive;
-    time64 posted = 0;
-
-    if (gnc_lot_is_closed (lot)) return NULL;
-
-    s = gnc_lot_get_earliest_split (lot);
-    if (s == NULL) return NULL;
-
-    /* We want a lot whose balance is of the correct sign.  All splits
-       in a lot must be the opposite sign of the opening split.  We also
-       want to ignore lots that are overfull, i.e., where the balance in
-       the lot is of opposite sign to the opening split in the lot. */
-    if (0 == (els->numeric_pred) (s->amount)) return NULL;
-    bal = gnc_lot_get_balance (lot);
-    opening_is_positive = gnc_numeric_positive_p (s->amount);
-    bal_is_positive = gnc_numeric_positive_p (bal);
-    if (opening_is_positive != bal_is_positive) return NULL;
-
-    trans = s->parent;
-    if (els->currency &&
-            (FALSE == gnc_commodity_equiv (els->currency,
-                                           trans->common_currency)))
-    {
-        return NULL;
-    }
-
-    posted = trans->date_posted;
-    if (els->date_pred (els->time, posted))
-    {
-        els->time = trans->date_posted;
-        els->lot = lot;
-    }
-
-    return NULL;
-}
-
-static inline GNCLot *
-xaccAccountFindOpenLot (Account *acc, gnc_numeric sign,
-                        gnc_commodity *currency,
-                        gint64 guess,
-                        gboolean (*date_pred)(time64, time64))
-{
-    struct find_lot_s es;
-
-    es.lot = NULL;
-    es.currency = currency;
-    es.time = guess;
-    es.date_pred = date_pred;
-
-    if (gnc_numeric_positive_p(sign)) es.numeric_pred = gnc_numeric_negative_p;
-    else es.numeric_pred = gnc_numeric_positive_p;
-
-    xaccAccountForEachLot (acc, finder_helper, &es);
-    return es.lot;
-}
-
 GNCLot *
 xaccAccountFindEarliestOpenLot (Account *acc, gnc_numeric sign,
                                 gnc_commodity *currency)
@@ -194,8 +110,7 @@ xaccAccountFindEarliestOpenLot (Account *acc, gnc_numeric sign,
     ENTER (" sign=%" G_GINT64_FORMAT "/%" G_GINT64_FORMAT, sign.num,
            sign.denom);
 
-    lot = xaccAccountFindOpenLot (acc, sign, currency,
-                                  G_MAXINT64, earliest_pred);
+    lot = gnc_account_find_open_lot (acc, sign, currency, FALSE);
     LEAVE ("found lot=%p %s baln=%s", lot, gnc_lot_get_title (lot),
            gnc_num_dbg_to_string(gnc_lot_get_balance(lot)));
     return lot;
@@ -209,8 +124,7 @@ xaccAccountFindLatestOpenLot (Account *acc, gnc_numeric sign,
     ENTER (" sign=%" G_GINT64_FORMAT "/%" G_GINT64_FORMAT,
            sign.num, sign.denom);
 
-    lot = xaccAccountFindOpenLot (acc, sign, currency,
-                                  G_MININT64, latest_pred);
+    lot = gnc_account_find_open_lot (acc, sign, currency, TRUE);
     LEAVE ("found lot=%p %s", lot, gnc_lot_get_title (lot));
     return lot;
 }
@@ -524,8 +438,21 @@ xaccSplitGetGainsSourceSplit (const Split *split)
 
 /* ============================================================== */
 
-void
-xaccSplitComputeCapGains(Split *split, Account *gain_acc)
+/* The amount and value of a lot before one of its splits, as
+ * gnc_lot_get_balance_before computes them. */
+typedef struct
+{
+    gnc_numeric amount;
+    gnc_numeric value;
+} LotBalance;
+
+/* Compute the gains of the split. If before isn't NULL it is the lot
+ * balance before the split and the caller has already propagated the
+ * dirtiness of the lot's opening splits, as xaccLotComputeCapGains
+ * does. */
+static void
+split_compute_cap_gains (Split *split, Account *gain_acc,
+                         const LotBalance *before)
 {
     SplitList *node;
     GNCLot *lot;
@@ -615,12 +542,15 @@ xaccSplitComputeCapGains(Split *split, Account *gain_acc)
 #endif
         }
         split = s;
+        /* The caller's balance was for the gains split. */
+        before = NULL;
     }
 
     /* Note: if the value of the 'opening' split(s) has changed,
      * then the cap gains are changed. So we need to check not
      * only if this split is dirty, but also the lot-opening splits. */
-    for (node = gnc_lot_get_split_list(lot); node; node = node->next)
+    for (node = before ? NULL : gnc_lot_get_split_list(lot); node;
+            node = node->next)
     {
         Split *s = node->data;
         if (pcy->PolicyIsOpeningSplit(pcy, lot, s))
@@ -654,7 +584,15 @@ xaccSplitComputeCapGains(Split *split, Account *gain_acc)
      * So start working things. */
 
     /* Get the amount and value in this lot at the time of this transaction. */
-    gnc_lot_get_balance_before (lot, split, &lot_amount, &lot_value);
+    if (before)
+    {
+        lot_amount = before->amount;
+        lot_value = before->value;
+    }
+    else
+    {
+        gnc_lot_get_balance_before (lot, split, &lot_amount, &lot_value);
+    }
 
     pcy->PolicyGetLotOpening (pcy, lot, &opening_amount, &opening_value,
                               &opening_currency);
@@ -896,6 +834,12 @@ xaccSplitComputeCapGains(Split *split, Account *gain_acc)
     LEAVE ("(lot=%s)", gnc_lot_get_title(lot));
 }
 
+void
+xaccSplitComputeCapGains(Split *split, Account *gain_acc)
+{
+    split_compute_cap_gains (split, gain_acc, NULL);
+}
+
 /* ============================================================== */
 
 gnc_numeric
@@ -930,6 +874,113 @@ xaccSplitGetCapGains(Split * split)
 
 /* ============================================================== */
 
+/* A split of a lot and the split whose transaction places it in time:
+ * the split whose gains it records if it is a gains split, else itself. */
+typedef struct
+{
+    Split *split;
+    Split *source;
+} LotEntry;
+
+static int
+lot_entry_order (const void *a, const void *b)
+{
+    const LotEntry *ea = a, *eb = b;
+    return xaccTransOrder (ea->source->parent, eb->source->parent);
+}
+
+static void
+lot_balance_add (LotBalance *baln, const Split *s)
+{
+    baln->amount = gnc_numeric_add_fixed (baln->amount, xaccSplitGetAmount (s));
+    baln->value = gnc_numeric_add_fixed (baln->value, xaccSplitGetValue (s));
+}
+
+/* Compute the gains of the lot's splits in a single chronological pass,
+ * keeping the running balance of the lot instead of having each split
+ * sum the splits before it. The balance before a split counts the
+ * splits of earlier transactions and those of its own transaction other
+ * than itself and its gains split, as gnc_lot_get_balance_before does.
+ * Gains transactions that are already right are left alone. */
+static void
+lot_compute_gains_in_order (GNCLot *lot, Account *gain_acc)
+{
+    SplitList *splits, *node;
+    LotEntry *entries;
+    LotBalance running = {gnc_numeric_zero(), gnc_numeric_zero()};
+    guint n = 0, i, end, j, k;
+
+    /* Computing gains adds gains splits to the lot, so work on a copy. */
+    splits = g_list_copy (gnc_lot_get_split_list(lot));
+    entries = g_new (LotEntry, g_list_length (splits));
+    for (node = splits; node; node = node->next)
+    {
+        Split *s = node->data;
+        Split *source = xaccSplitGetGainsSourceSplit (s);
+        if (!source) source = s;
+        /* Without a transaction a split is never before any other. */
+        if (!s->parent || !source->parent) continue;
+        entries[n].split = s;
+        entries[n].source = source;
+        n++;
+    }
+    g_list_free (splits);
+    qsort (entries, n, sizeof (LotEntry), lot_entry_order);
+
+    for (i = 0; i < n; i = end)
+    {
+        Transaction *trans = entries[i].source->parent;
+        GList *created = NULL;
+
+        for (end = i; end < n && entries[end].source->parent == trans; end++)
+            ;
+
+        for (j = i; j < end; j++)
+        {
+            Split *s = entries[j].split;
+            LotBalance before = running;
+            GList *c;
+
+            if (s != entries[j].source)
+            {
+                /* Gains splits are done with their source, unless it is
+                 * in some other lot. */
+                if (entries[j].source->lot != lot)
+                    xaccSplitComputeCapGains (s, gain_acc);
+                continue;
+            }
+
+            for (k = i; k < end; k++)
+                if (entries[k].source != s)
+                    lot_balance_add (&before, entries[k].split);
+            for (c = created; c; c = c->next)
+            {
+                Split *gains = c->data;
+                if (gains->gains_split != s)
+                    lot_balance_add (&before, gains);
+            }
+
+            split_compute_cap_gains (s, gain_acc, &before);
+
+            /* A gains split created for s is part of the lot from now on. */
+            if (s->gains_split && s->gains_split->lot == lot)
+            {
+                for (k = i; k < end; k++)
+                    if (entries[k].split == s->gains_split) break;
+                if (k == end && !g_list_find (created, s->gains_split))
+                    created = g_list_prepend (created, s->gains_split);
+            }
+        }
+
+        for (k = i; k < end; k++)
+            lot_balance_add (&running, entries[k].split);
+        for (node = created; node; node = node->next)
+            lot_balance_add (&running, node->data);
+        g_list_free (created);
+    }
+    g_free (entries);
+}
+
 void
 xaccLotComputeCapGains (GNCLot *lot, Account *gain_acc)
 {
@@ -967,11 +1018,7 @@ xaccLotComputeCapGains (GNCLot *lot, Account *gain_acc)
         }
     }
 
-    for (node = gnc_lot_get_split_list(lot); node; node = node->next)
-    {
-        Split *s = node->data;
-        xaccSplitComputeCapGains (s, gain_acc);
-    }
+    lot_compute_gains_in_order (lot, gain_acc);
     LEAVE("(lot=%p)", lot);
 }
 
@@ -90,6 +90,14 @@ typedef struct GNCLotPrivate
     signed char is_closed;
 #define LOT_CLOSED_UNKNOWN (-1)
 
+    /* The sum of the amounts of the splits, kept up to date as splits
+     * are added and removed. Only valid if balance_valid is set. */
+    gnc_numeric balance;
+    gboolean balance_valid;
+
+    /* Set if splits is known to be in xaccSplitOrderDateOnly order. */
+    gboolean splits_sorted;
+
     /* traversal marker, handy for preventing recursion */
     unsigned char marker;
 } GNCLotPrivate;
@@ -113,6 +121,9 @@ gnc_lot_init(GNCLot* lot)
     priv->account = NULL;
     priv->splits = NULL;
     priv->is_closed = LOT_CLOSED_UNKNOWN;
+    priv->balance = gnc_numeric_zero();
+    priv->balance_valid = TRUE;
+    priv->splits_sorted = TRUE;
     priv->marker = 0;
 }
 
@@ -183,6 +194,8 @@ gnc_lot_set_property (GObject* object,
     {
     case PROP_IS_CLOSED:
         priv->is_closed = g_value_get_int(value);
+        if (priv->account)
+            gnc_account_lot_changed (priv->account, lot);
         break;
     case PROP_MARKER:
         priv->marker = g_value_get_int(value);
@@ -397,6 +410,10 @@ gnc_lot_set_closed_unknown(GNCLot* lot)
     {
         priv = GET_PRIVATE(lot);
         priv->is_closed = LOT_CLOSED_UNKNOWN;
+        priv->balance_valid = FALSE;
+        priv->splits_sorted = FALSE;
+        if (priv->account)
+            gnc_account_lot_changed (priv->account, lot);
     }
 }
 
@@ -486,15 +503,24 @@ gnc_lot_get_balance (GNCLot *lot)
         return zero;
     }
 
-    /* Sum over splits; because they all belong to same account
-     * they will have same denominator.
-     */
-    for (node = priv->splits; node; node = node->next)
+    if (priv->balance_valid)
     {
-        Split *s = node->data;
-        gnc_numeric amt = xaccSplitGetAmount (s);
-        baln = gnc_numeric_add_fixed (baln, amt);
-        g_assert (gnc_numeric_check (baln) == GNC_ERROR_OK);
+        baln = priv->balance;
+    }
+    else
+    {
+        /* Sum over splits; because they all belong to same account
+         * they will have same denominator.
+         */
+        for (node = priv->splits; node; node = node->next)
+        {
+            Split *s = node->data;
+            gnc_numeric amt = xaccSplitGetAmount (s);
+            baln = gnc_numeric_add_fixed (baln, amt);
+            g_assert (gnc_numeric_check (baln) == GNC_ERROR_OK);
+        }
+        priv->balance = baln;
+        priv->balance_valid = TRUE;
     }
 
     /* cache a zero balance as a closed lot */
@@ -605,9 +631,18 @@ gnc_lot_add_split (GNCLot *lot, Split *split)
     xaccSplitSetLot(split, lot);
 
     priv->splits = g_list_append (priv->splits, split);
+    priv->splits_sorted = FALSE;
+    if (priv->balance_valid)
+    {
+        priv->balance = gnc_numeric_add_fixed (priv->balance, split->amount);
+        priv->balance_valid =
+            gnc_numeric_check (priv->balance) == GNC_ERROR_OK;
+    }
 
     /* for recomputation of is-closed */
     priv->is_closed = LOT_CLOSED_UNKNOWN;
+    if (priv->account)
+        gnc_account_lot_changed (priv->account, lot);
     gnc_lot_commit_edit(lot);
 
     qof_event_gen (QOF_INSTANCE(lot), QOF_EVENT_MODIFY, NULL);
@@ -625,8 +660,21 @@ gnc_lot_remove_split (GNCLot *lot, Split *split)
     gnc_lot_begin_edit(lot);
     qof_instance_set_dirty(QOF_INSTANCE(lot));
     priv->splits = g_list_remove (priv->splits, split);
+    /* Only a split that was in the lot can be taken off the balance. */
+    if (priv->balance_valid && split->lot == lot)
+    {
+        priv->balance = gnc_numeric_sub_fixed (priv->balance, split->amount);
+        priv->balance_valid =
+            gnc_numeric_check (priv->balance) == GNC_ERROR_OK;
+    }
+    else
+    {
+        priv->balance_valid = FALSE;
+    }
     xaccSplitSetLot(split, NULL);
     priv->is_closed = LOT_CLOSED_UNKNOWN;   /* force an is-closed computation */
+    if (priv->account)
+        gnc_account_lot_changed (priv->account, lot);
 
     if (NULL == priv->splits)
     {
@@ -648,7 +696,12 @@ gnc_lot_get_earliest_split (GNCLot *lot)
     if (!lot) return NULL;
     priv = GET_PRIVATE(lot);
     if (! priv->splits) return NULL;
-    priv->splits = g_list_sort (priv->splits, (GCompareFunc) xaccSplitOrderDateOnly);
+    if (!priv->splits_sorted)
+    {
+        priv->splits = g_list_sort (priv->splits,
+                                    (GCompareFunc) xaccSplitOrderDateOnly);
+        priv->splits_sorted = TRUE;
+    }
     return priv->splits->data;
 }
 
@@ -662,7 +715,12 @@ gnc_lot_get_latest_split (GNCLot *lot)
     if (!lot) return NULL;
     priv = GET_PRIVATE(lot);
     if (! priv->splits) return NULL;
-    priv->splits = g_list_sort (priv->splits, (GCompareFunc) xaccSplitOrderDateOnly);
+    if (!priv->splits_sorted)
+    {
+        priv->splits = g_list_sort (priv->splits,
+                                    (GCompareFunc) xaccSplitOrderDateOnly);
+        priv->splits_sorted = TRUE;
+    }
 
     for (node = priv->splits; node->next; node = node->next)
         ;
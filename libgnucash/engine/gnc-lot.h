@@ -129,7 +129,8 @@ void gnc_lot_set_account(GNCLot*, Account*);
 
 /** The gnc_lot_get_balance() routine returns the balance of the lot.
  *    The commodity in which this balance is expressed is the commodity
- *    of the account. */
+ *    of the account. The balance is cached and kept up to date as
+ *    splits are added and removed, so this is cheap to call. */
 gnc_numeric gnc_lot_get_balance (GNCLot *);
 
 /** The gnc_lot_get_balance_before routine computes both the balance and
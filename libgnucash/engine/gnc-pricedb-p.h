@@ -55,9 +55,10 @@ struct _GncPriceClass
 struct gnc_price_db_s
 {
     QofInstance inst;              /* globally unique object identifier */
-    GHashTable *commodity_hash;
+    GHashTable *commodity_hash;    /* commodity -> currency -> sorted GPtrArray */
     gboolean bulk_update;		 /* TRUE while reading XML file, etc. */
     gboolean reset_nth_price_cache;
+    GHashTable *conversion_cache;  /* (from, to, time) -> prices to convert with */
 };
 
 struct _GncPriceDBClass
@@ -40,9 +40,11 @@ static gboolean remove_price(GNCPriceDB *db, GNCPrice *p, gboolean cleanup);
 static GNCPrice *lookup_nearest_in_time(GNCPriceDB *db, const gnc_commodity *c,
                                         const gnc_commodity *currency,
                                         time64 t, gboolean sameday);
+static GHashTable *conversion_cache_new (void);
+static void pricedb_invalidate_conversion_cache (GNCPriceDB *db);
 static gboolean
 pricedb_pricelist_traversal(GNCPriceDB *db,
-                            gboolean (*f)(GList *p, gpointer user_data),
+                            gboolean (*f)(GPtrArray *p, gpointer user_data),
                             gpointer user_data);
 
 enum
@@ -822,15 +824,162 @@ gnc_price_list_equal(PriceList *prices1, PriceList *prices2)
     return TRUE;
 }
 
+/* ==================================================================== */
+/* price array manipulation functions
+
+   The price database keeps the prices of each commodity/currency pair
+   in a GPtrArray sorted by compare_prices_by_date, i.e. newest first.
+   Being contiguous and sorted, the arrays can be bisected by time
+   instead of walked from the front.
+ */
+
+/* Return the index of the first price in prices not later than t or,
+ * if strict, earlier than t; prices->len if there is none. */
+static guint
+price_array_bisect (GPtrArray *prices, time64 t, gboolean strict)
+{
+    guint lo = 0, hi = prices ? prices->len : 0;
+
+    while (lo < hi)
+    {
+        guint mid = lo + (hi - lo) / 2;
+        time64 price_t = gnc_price_get_time64 (g_ptr_array_index (prices, mid));
+        if (price_t > t || (strict && price_t == t))
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+/* Return the index at which p sorts into prices. */
+static guint
+price_array_position (GPtrArray *prices, GNCPrice *p)
+{
+    guint lo = 0, hi = prices->len;
+
+    while (lo < hi)
+    {
+        guint mid = lo + (hi - lo) / 2;
+        if (compare_prices_by_date (g_ptr_array_index (prices, mid), p) < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+static GNCPrice *
+price_array_nth (GPtrArray *prices, guint index)
+{
+    if (!prices || index >= prices->len) return NULL;
+    return g_ptr_array_index (prices, index);
+}
+
+static GNCPrice *
+price_array_last (GPtrArray *prices)
+{
+    if (!prices || prices->len == 0) return NULL;
+    return g_ptr_array_index (prices, prices->len - 1);
+}
+
+/* Return whichever of a and b sorts first (is newer) or, if !newer,
+ * last. Either may be NULL. */
+static GNCPrice *
+price_pick (GNCPrice *a, GNCPrice *b, gboolean newer)
+{
+    if (!a) return b;
+    if (!b) return a;
+    if (compare_prices_by_date (a, b) < 0)
+        return newer ? a : b;
+    return newer ? b : a;
+}
+
+/* Prices on the same day are adjacent in the array, so only the
+ * neighbours of p's insertion point need to be checked. */
+static gboolean
+price_array_is_duplicate (GPtrArray *prices, guint index, GNCPrice *p)
+{
+    PriceListIsDuplStruct dupl = { p, FALSE };
+    time64 day = time64CanonicalDayTime (gnc_price_get_time64 (p));
+    guint i;
+
+    for (i = index; i > 0 && !dupl.isDupl; --i)
+    {
+        GNCPrice *other = g_ptr_array_index (prices, i - 1);
+        if (time64CanonicalDayTime (gnc_price_get_time64 (other)) != day)
+            break;
+        price_list_is_duplicate (other, &dupl);
+    }
+    for (i = index; i < prices->len && !dupl.isDupl; ++i)
+    {
+        GNCPrice *other = g_ptr_array_index (prices, i);
+        if (time64CanonicalDayTime (gnc_price_get_time64 (other)) != day)
+            break;
+        price_list_is_duplicate (other, &dupl);
+    }
+    return dupl.isDupl;
+}
+
+/* The array counterpart of gnc_price_list_insert. */
+static gboolean
+price_array_insert (GPtrArray *prices, GNCPrice *p, gboolean check_dupl)
+{
+    guint index;
+
+    if (!prices || !p) return FALSE;
+    gnc_price_ref (p);
+
+    index = price_array_position (prices, p);
+    if (check_dupl && price_array_is_duplicate (prices, index, p))
+        return TRUE;
+
+    g_ptr_array_insert (prices, index, p);
+    return TRUE;
+}
+
+/* The array counterpart of gnc_price_list_remove. */
+static gboolean
+price_array_remove (GPtrArray *prices, GNCPrice *p)
+{
+    guint index;
+
+    if (!p) return FALSE;
+    if (!prices) return TRUE;
+
+    index = price_array_position (prices, p);
+    if (index < prices->len && g_ptr_array_index (prices, index) == p)
+        g_ptr_array_remove_index (prices, index);
+    /* Not where its date says it should be, so search for it. */
+    else if (!g_ptr_array_remove (prices, p))
+        return TRUE;
+
+    gnc_price_unref (p);
+    return TRUE;
+}
+
+/* Copy a price array into a PriceList without reffing the prices. */
+static PriceList *
+price_list_from_array (GPtrArray *prices)
+{
+    PriceList *result = NULL;
+    guint i;
+
+    if (!prices) return NULL;
+    for (i = prices->len; i > 0; --i)
+        result = g_list_prepend (result, g_ptr_array_index (prices, i - 1));
+    return result;
+}
+
 /* ==================================================================== */
 /* GNCPriceDB functions
 
    Structurally a GNCPriceDB contains a hash mapping price commodities
    (of type gnc_commodity*) to hashes mapping price currencies (of
-   type gnc_commodity*) to GNCPrice lists (see gnc-pricedb.h for a
-   description of GNCPrice lists).  The top-level key is the commodity
-   you want the prices for, and the second level key is the commodity
-   that the value is expressed in terms of.
+   type gnc_commodity*) to GPtrArrays of GNCPrices sorted newest
+   first (see the price array functions above).  The top-level key is
+   the commodity you want the prices for, and the second level key is
+   the commodity that the value is expressed in terms of.
  */
 
 /* GObject Initialization */
@@ -882,6 +1031,7 @@ gnc_pricedb_create(QofBook * book)
 
     result->commodity_hash = g_hash_table_new(NULL, NULL);
     g_return_val_if_fail (result->commodity_hash, NULL);
+    result->conversion_cache = conversion_cache_new();
     return result;
 }
 
@@ -890,18 +1040,19 @@ destroy_pricedb_currency_hash_data(gpointer key,
                                    gpointer data,
                                    gpointer user_data)
 {
-    GList *price_list = (GList *) data;
-    GList *node;
+    GPtrArray *prices = (GPtrArray *) data;
+    guint i;
     GNCPrice *p;
 
-    for (node = price_list; node; node = node->next)
+    for (i = 0; i < prices->len; i++)
     {
-        p = node->data;
+        p = g_ptr_array_index (prices, i);
 
         p->db = NULL;
+        gnc_price_unref(p);
     }
 
-    gnc_price_list_destroy(price_list);
+    g_ptr_array_free (prices, TRUE);
 }
 
 static void
@@ -929,6 +1080,9 @@ gnc_pricedb_destroy(GNCPriceDB *db)
     }
     g_hash_table_destroy (db->commodity_hash);
     db->commodity_hash = NULL;
+    if (db->conversion_cache)
+        g_hash_table_destroy (db->conversion_cache);
+    db->conversion_cache = NULL;
     /* qof_instance_release (&db->inst); */
     g_object_unref(db);
 }
@@ -1011,7 +1165,7 @@ pricedb_equal_foreach_pricelist(gpointer key, gpointer val, gpointer user_data)
 {
     GNCPriceDBEqualData *equal_data = user_data;
     gnc_commodity *currency = key;
-    GList *price_list1 = val;
+    GList *price_list1 = price_list_from_array (val);
     GList *price_list2;
 
     price_list2 = gnc_pricedb_get_prices (equal_data->db2,
@@ -1021,6 +1175,7 @@ pricedb_equal_foreach_pricelist(gpointer key, gpointer val, gpointer user_data)
     if (!gnc_price_list_equal (price_list1, price_list2))
         equal_data->equal = FALSE;
 
+    g_list_free (price_list1);
     gnc_price_list_destroy (price_list2);
 }
 
@@ -1070,7 +1225,7 @@ add_price(GNCPriceDB *db, GNCPrice *p)
 {
     /* This function will use p, adding a ref, so treat p as read-only
        if this function succeeds. */
-    GList *price_list;
+    GPtrArray *prices;
     gnc_commodity *commodity;
     gnc_commodity *currency;
     GHashTable *currency_hash;
@@ -1131,21 +1286,21 @@ add_price(GNCPriceDB *db, GNCPrice *p)
         g_hash_table_insert(db->commodity_hash, commodity, currency_hash);
     }
 
-    price_list = g_hash_table_lookup(currency_hash, currency);
-    if (!gnc_price_list_insert(&price_list, p, !db->bulk_update))
+    prices = g_hash_table_lookup(currency_hash, currency);
+    if (!prices)
     {
-        LEAVE ("gnc_price_list_insert failed");
-        return FALSE;
+        prices = g_ptr_array_new();
+        g_hash_table_insert(currency_hash, currency, prices);
     }
 
-    if (!price_list)
+    if (!price_array_insert(prices, p, !db->bulk_update))
     {
-        LEAVE (" no price list");
+        LEAVE ("price_array_insert failed");
         return FALSE;
     }
 
-    g_hash_table_insert(currency_hash, currency, price_list);
     p->db = db;
+    pricedb_invalidate_conversion_cache(db);
 
     qof_event_gen (&p->inst, QOF_EVENT_ADD, NULL);
 
@@ -1195,7 +1350,7 @@ gnc_pricedb_add_price(GNCPriceDB *db, GNCPrice *p)
 static gboolean
 remove_price(GNCPriceDB *db, GNCPrice *p, gboolean cleanup)
 {
-    GList *price_list;
+    GPtrArray *prices;
     gnc_commodity *commodity;
     gnc_commodity *currency;
     GHashTable *currency_hash;
@@ -1231,24 +1386,23 @@ remove_price(GNCPriceDB *db, GNCPrice *p, gboolean cleanup)
     }
 
     qof_event_gen (&p->inst, QOF_EVENT_REMOVE, NULL);
-    price_list = g_hash_table_lookup(currency_hash, currency);
+    prices = g_hash_table_lookup(currency_hash, currency);
     gnc_price_ref(p);
-    if (!gnc_price_list_remove(&price_list, p))
+    if (!price_array_remove(prices, p))
     {
         gnc_price_unref(p);
         LEAVE (" cannot remove price list");
         return FALSE;
     }
+    pricedb_invalidate_conversion_cache(db);
 
     /* if the price list is empty, then remove this currency from the
        commodity hash */
-    if (price_list)
-    {
-        g_hash_table_insert(currency_hash, currency, price_list);
-    }
-    else
+    if (!prices || prices->len == 0)
     {
         g_hash_table_remove(currency_hash, currency);
+        if (prices)
+            g_ptr_array_free(prices, TRUE);
 
         if (cleanup)
         {
@@ -1356,14 +1510,13 @@ pricedb_remove_foreach_pricelist (gpointer key,
                                   gpointer val,
                                   gpointer user_data)
 {
-    GList *price_list = (GList *) val;
-    GList *node = price_list;
+    GPtrArray *prices = (GPtrArray *) val;
     remove_info *data = (remove_info *) user_data;
 
     ENTER("key %p, value %p, data %p", key, val, user_data);
 
     /* now check each item in the list */
-    g_list_foreach(node, (GFunc)check_one_price_date, data);
+    g_ptr_array_foreach(prices, (GFunc)check_one_price_date, data);
 
     LEAVE(" ");
 }
@@ -1675,28 +1828,30 @@ hash_values_helper(gpointer key, gpointer value, gpointer data)
     GList ** l = data;
     if (*l)
     {
-        GList *new_l;
-        new_l = pricedb_price_list_merge(*l, value);
+        GList *new_l, *value_l = price_list_from_array (value);
+        new_l = pricedb_price_list_merge(*l, value_l);
         g_list_free (*l);
+        g_list_free (value_l);
         *l = new_l;
     }
     else
-        *l = g_list_copy (value);
+        *l = price_list_from_array (value);
 }
 
 static PriceList *
 price_list_from_hashtable (GHashTable *hash, const gnc_commodity *currency)
 {
-    GList *price_list = NULL, *result = NULL ;
+    GPtrArray *prices = NULL;
+    GList *result = NULL;
     if (currency)
     {
-        price_list = g_hash_table_lookup(hash, currency);
-        if (!price_list)
+        prices = g_hash_table_lookup(hash, currency);
+        if (!prices)
         {
             LEAVE (" no price list");
             return NULL;
         }
-        result = g_list_copy (price_list);
+        result = price_list_from_array (prices);
     }
     else
     {
@@ -1785,24 +1940,49 @@ pricedb_get_prices_internal(GNCPriceDB *db, const gnc_commodity *commodity,
     return forward_list;
 }
 
+/* Find the price arrays for commodity in currency and, for the
+ * bidirectional lookups, for currency in commodity. Unlike
+ * pricedb_get_prices_internal this doesn't copy anything, so the lookups
+ * that want a single price can bisect both arrays and pick the result
+ * from the two candidates. */
+static gboolean
+pricedb_get_price_arrays(GNCPriceDB *db, const gnc_commodity *commodity,
+                         const gnc_commodity *currency,
+                         GPtrArray **forward, GPtrArray **reverse)
+{
+    GHashTable *currency_hash;
+
+    *forward = *reverse = NULL;
+    currency_hash = g_hash_table_lookup(db->commodity_hash, commodity);
+    if (currency_hash)
+        *forward = g_hash_table_lookup(currency_hash, currency);
+    currency_hash = g_hash_table_lookup(db->commodity_hash, currency);
+    if (currency_hash)
+        *reverse = g_hash_table_lookup(currency_hash, commodity);
+    return *forward || *reverse;
+}
+
 GNCPrice *gnc_pricedb_lookup_latest(GNCPriceDB *db,
                           const gnc_commodity *commodity,
                           const gnc_commodity *currency)
 {
-    GList *price_list;
+    GPtrArray *forward, *reverse;
     GNCPrice *result;
 
     if (!db || !commodity || !currency) return NULL;
     ENTER ("db=%p commodity=%p currency=%p", db, commodity, currency);
 
-    price_list = pricedb_get_prices_internal(db, commodity, currency, TRUE);
-    if (!price_list) return NULL;
+    if (!pricedb_get_price_arrays(db, commodity, currency, &forward, &reverse))
+    {
+        LEAVE ("no prices");
+        return NULL;
+    }
     /* This works magically because prices are inserted in date-sorted
      * order, and the latest date always comes first. So return the
-     * first in the list.  */
-    result = price_list->data;
+     * newer of the first in each direction.  */
+    result = price_pick (price_array_nth (forward, 0),
+                         price_array_nth (reverse, 0), TRUE);
     gnc_price_ref(result);
-    g_list_free (price_list);
     LEAVE("price is %p", result);
     return result;
 }
@@ -1825,54 +2005,49 @@ typedef struct
 */
 
 static gboolean
-price_list_scan_any_currency(GList *price_list, gpointer data)
+price_list_scan_any_currency(GPtrArray *prices, gpointer data)
 {
     UsesCommodity *helper = (UsesCommodity*)data;
-    GList *node = price_list;
+    GNCPrice *price;
     gnc_commodity *com;
     gnc_commodity *cur;
+    guint index;
 
-    if (!price_list)
+    if (!prices || prices->len == 0)
         return TRUE;
 
-    com = gnc_price_get_commodity(node->data);
-    cur = gnc_price_get_currency(node->data);
+    price = g_ptr_array_index(prices, 0);
+    com = gnc_price_get_commodity(price);
+    cur = gnc_price_get_currency(price);
 
     /* if this price list isn't for the commodity we are interested in,
        ignore it. */
     if (com != helper->com && cur != helper->com)
         return TRUE;
 
-    /* The price list is sorted in decreasing order of time.  Find the first
-       price on it that is older than the requested time and add it and the
+    /* The price array is sorted in decreasing order of time.  Find the first
+       price in it that is older than the requested time and add it and the
        previous price to the result list. */
-    while (node != NULL)
+    index = price_array_bisect(prices, helper->t, TRUE);
+    if (index < prices->len)
     {
-        GNCPrice *price = node->data;
-        time64 price_t = gnc_price_get_time64(price);
-        if (price_t < helper->t)
+        /* If there is a previous price add it to the results. */
+        if (index > 0)
         {
-            /* If there is a previous price add it to the results. */
-            if (node->prev)
-            {
-                GNCPrice *prev_price = node->prev->data;
-                gnc_price_ref(prev_price);
-                *helper->list = g_list_prepend(*helper->list, prev_price);
-            }
-            /* Add the first price before the desired time */
-            gnc_price_ref(price);
-            *helper->list = g_list_prepend(*helper->list, price);
-            /* No point in looking further, they will all be older */
-            break;
-        }
-        else if (node->next == NULL)
-        {
-            /* The last price is later than given time, add it */
-            gnc_price_ref(price);
-            *helper->list = g_list_prepend(*helper->list, price);
+            GNCPrice *prev_price = g_ptr_array_index(prices, index - 1);
+            gnc_price_ref(prev_price);
+            *helper->list = g_list_prepend(*helper->list, prev_price);
         }
-        node = node->next;
+        /* Add the first price before the desired time */
+        price = g_ptr_array_index(prices, index);
     }
+    else
+    {
+        /* The last price is later than given time, add it */
+        price = price_array_last(prices);
+    }
+    gnc_price_ref(price);
+    *helper->list = g_list_prepend(*helper->list, price);
 
     return TRUE;
 }
@@ -2077,7 +2252,7 @@ gnc_pricedb_has_prices(GNCPriceDB *db,
                        const gnc_commodity *commodity,
                        const gnc_commodity *currency)
 {
-    GList *price_list;
+    GPtrArray *prices;
     GHashTable *currency_hash;
     gint size;
 
@@ -2092,8 +2267,8 @@ gnc_pricedb_has_prices(GNCPriceDB *db,
 
     if (currency)
     {
-        price_list = g_hash_table_lookup(currency_hash, currency);
-        if (price_list)
+        prices = g_hash_table_lookup(currency_hash, currency);
+        if (prices)
         {
             LEAVE("yes");
             return TRUE;
@@ -2137,9 +2312,9 @@ static void
 price_count_helper(gpointer key, gpointer value, gpointer data)
 {
     int *result = data;
-    GList *price_list = value;
+    GPtrArray *prices = value;
 
-    *result += g_list_length(price_list);
+    *result += prices->len;
 }
 
 int
@@ -2168,10 +2343,11 @@ list_combine (gpointer element, gpointer data)
 {
     GList *list = *(GList**)data;
     if (list == NULL)
-        *(GList**)data = g_list_copy (element);
+        *(GList**)data = price_list_from_array (element);
     else
     {
-        GList *new_list = g_list_concat ((GList *)list, g_list_copy (element));
+        GList *new_list = g_list_concat ((GList *)list,
+                                         price_list_from_array (element));
         *(GList**)data = new_list;
     }
 }
@@ -2255,27 +2431,26 @@ gnc_pricedb_lookup_at_time64(GNCPriceDB *db,
                              const gnc_commodity *currency,
                              time64 t)
 {
-    GList *price_list;
-    GList *item = NULL;
+    GPtrArray *forward, *reverse;
+    GNCPrice *p;
 
     if (!db || !c || !currency) return NULL;
     ENTER ("db=%p commodity=%p currency=%p", db, c, currency);
-    price_list = pricedb_get_prices_internal (db, c, currency, TRUE);
-    item = price_list;
-    while (item)
+    if (!pricedb_get_price_arrays (db, c, currency, &forward, &reverse))
     {
-        GNCPrice *p = item->data;
-        time64 price_time = gnc_price_get_time64(p);
-        if (price_time == t)
-        {
-            gnc_price_ref(p);
-            g_list_free (price_list);
-            LEAVE("price is %p", p);
-            return p;
-        }
-        item = item->next;
+        LEAVE (" ");
+        return NULL;
+    }
+    /* The first price not later than t is the one at t, if there is one. */
+    p = price_pick (price_array_nth (forward, price_array_bisect (forward, t, FALSE)),
+                    price_array_nth (reverse, price_array_bisect (reverse, t, FALSE)),
+                    TRUE);
+    if (p && gnc_price_get_time64(p) == t)
+    {
+        gnc_price_ref(p);
+        LEAVE("price is %p", p);
+        return p;
     }
-    g_list_free (price_list);
     LEAVE (" ");
     return NULL;
 }
@@ -2287,37 +2462,40 @@ lookup_nearest_in_time(GNCPriceDB *db,
                        time64 t,
                        gboolean sameday)
 {
-    GList *price_list;
+    GPtrArray *forward, *reverse;
     GNCPrice *current_price = NULL;
     GNCPrice *next_price = NULL;
     GNCPrice *result = NULL;
-    GList *item = NULL;
+    guint forward_index, reverse_index;
 
     if (!db || !c || !currency) return NULL;
     if (t == INT64_MAX) return NULL;
     ENTER ("db=%p commodity=%p currency=%p", db, c, currency);
-    price_list = pricedb_get_prices_internal (db, c, currency, TRUE);
-    if (!price_list) return NULL;
-    item = price_list;
-
-    /* default answer */
-    current_price = item->data;
-
-    /* find the first candidate past the one we want.  Remember that
-       prices are in most-recent-first order. */
-    while (!next_price && item)
+    if (!pricedb_get_price_arrays (db, c, currency, &forward, &reverse))
     {
-        GNCPrice *p = item->data;
-        time64 price_time = gnc_price_get_time64(p);
-        if (price_time <= t)
-        {
-            next_price = item->data;
-            break;
-        }
-        current_price = item->data;
-        item = item->next;
+        LEAVE ("no prices");
+        return NULL;
     }
 
+    /* find the first candidate past the one we want, and the one just
+       before it.  Remember that prices are in most-recent-first order. */
+    forward_index = price_array_bisect (forward, t, FALSE);
+    reverse_index = price_array_bisect (reverse, t, FALSE);
+    next_price = price_pick (price_array_nth (forward, forward_index),
+                             price_array_nth (reverse, reverse_index), TRUE);
+    if (!next_price)
+        current_price = price_pick (price_array_last (forward),
+                                    price_array_last (reverse), FALSE);
+    else if (forward_index == 0 && reverse_index == 0)
+        /* default answer */
+        current_price = next_price;
+    else
+        current_price = price_pick (forward_index ?
+                                    price_array_nth (forward, forward_index - 1) : NULL,
+                                    reverse_index ?
+                                    price_array_nth (reverse, reverse_index - 1) : NULL,
+                                    FALSE);
+
     if (current_price)      /* How can this be null??? */
     {
         if (!next_price)
@@ -2388,7 +2566,6 @@ lookup_nearest_in_time(GNCPriceDB *db,
     }
 
     gnc_price_ref(result);
-    g_list_free (price_list);
     LEAVE (" ");
     return result;
 }
@@ -2409,60 +2586,45 @@ gnc_pricedb_lookup_latest_before_t64 (GNCPriceDB *db,
                                       gnc_commodity *currency,
                                       time64 t)
 {
-    GList *price_list;
+    GPtrArray *forward, *reverse;
     GNCPrice *current_price = NULL;
-    /*  GNCPrice *next_price = NULL;
-        GNCPrice *result = NULL;*/
-    GList *item = NULL;
-    time64 price_time;
 
     if (!db || !c || !currency) return NULL;
     ENTER ("db=%p commodity=%p currency=%p", db, c, currency);
-    price_list = pricedb_get_prices_internal (db, c, currency, TRUE);
-    if (!price_list) return NULL;
-    item = price_list;
-    do
+    if (!pricedb_get_price_arrays (db, c, currency, &forward, &reverse))
     {
-        price_time = gnc_price_get_time64 (item->data);
-        if (price_time <= t)
-            current_price = item->data;
-        item = item->next;
+        LEAVE ("no prices");
+        return NULL;
     }
-    while (price_time > t && item);
+    current_price =
+        price_pick (price_array_nth (forward, price_array_bisect (forward, t, FALSE)),
+                    price_array_nth (reverse, price_array_bisect (reverse, t, FALSE)),
+                    TRUE);
     gnc_price_ref(current_price);
-    g_list_free (price_list);
     LEAVE (" ");
     return current_price;
 }
 
-static gnc_numeric
-direct_balance_conversion (GNCPriceDB *db, gnc_numeric bal,
-                           const gnc_commodity *from, const gnc_commodity *to,
-                           time64 t)
+static GNCPrice *
+direct_balance_price (GNCPriceDB *db, const gnc_commodity *from,
+                      const gnc_commodity *to, time64 t)
 {
-    GNCPrice *price;
-    gnc_numeric retval = gnc_numeric_zero();
-    if (from == NULL || to == NULL)
-        return retval;
-    if (gnc_numeric_zero_p(bal))
-        return retval;
     if (t != INT64_MAX)
-        price = gnc_pricedb_lookup_nearest_in_time64(db, from, to, t);
-    else
-        price = gnc_pricedb_lookup_latest(db, from, to);
-    if (price == NULL)
-        return retval;
-    if (gnc_price_get_commodity(price) == from)
-        retval = gnc_numeric_mul (bal, gnc_price_get_value (price),
-                                  gnc_commodity_get_fraction (to),
-                                  GNC_HOW_RND_ROUND);
-    else
-        retval = gnc_numeric_div (bal, gnc_price_get_value (price),
-                                  gnc_commodity_get_fraction (to),
-                                  GNC_HOW_RND_ROUND);
-    gnc_price_unref (price);
-    return retval;
+        return gnc_pricedb_lookup_nearest_in_time64(db, from, to, t);
+    return gnc_pricedb_lookup_latest(db, from, to);
+}
 
+static gnc_numeric
+direct_balance_conversion (gnc_numeric bal, const gnc_commodity *from,
+                           const gnc_commodity *to, GNCPrice *price)
+{
+    if (gnc_price_get_commodity(price) == from)
+        return gnc_numeric_mul (bal, gnc_price_get_value (price),
+                                gnc_commodity_get_fraction (to),
+                                GNC_HOW_RND_ROUND);
+    return gnc_numeric_div (bal, gnc_price_get_value (price),
+                            gnc_commodity_get_fraction (to),
+                            GNC_HOW_RND_ROUND);
 }
 
 typedef struct
@@ -2543,18 +2705,12 @@ convert_balance(gnc_numeric bal, const gnc_commodity *from,
                            fraction, GNC_HOW_RND_ROUND);
 
 }
-static gnc_numeric
-indirect_balance_conversion (GNCPriceDB *db, gnc_numeric bal,
-                             const gnc_commodity *from, const gnc_commodity *to,
-                             time64 t )
+static PriceTuple
+indirect_balance_prices (GNCPriceDB *db, const gnc_commodity *from,
+                         const gnc_commodity *to, time64 t)
 {
     GList *from_prices = NULL, *to_prices = NULL;
-    PriceTuple tuple;
-    gnc_numeric zero = gnc_numeric_zero();
-    if (from == NULL || to == NULL)
-        return zero;
-    if (gnc_numeric_zero_p(bal))
-        return zero;
+    PriceTuple tuple = {NULL, NULL};
     if (t == INT64_MAX)
     {
         from_prices = gnc_pricedb_lookup_latest_any_currency(db, from);
@@ -2572,15 +2728,168 @@ indirect_balance_conversion (GNCPriceDB *db, gnc_numeric bal,
                                                                     to, t);
     }
     if (from_prices == NULL || to_prices == NULL)
-        return zero;
+    {
+        gnc_price_list_destroy(from_prices);
+        return tuple;
+    }
     tuple = extract_common_prices(from_prices, to_prices, from, to);
     gnc_price_list_destroy(from_prices);
     gnc_price_list_destroy(to_prices);
-    if (tuple.from)
-        return convert_balance(bal, from, to, tuple);
-    return zero;
+    return tuple;
 }
 
+/* ==================================================================== */
+/* balance conversion cache
+
+   Finding the prices to convert between two commodities means a direct
+   lookup and, failing that, a scan of every price list for a common
+   third commodity. Reports convert many balances between the same pair
+   of commodities at the same time, so the prices found are cached in
+   db->conversion_cache keyed on (from, to, t). The cached prices are
+   reffed and the balance is converted with them on each call, so the
+   results are exactly those of a fresh lookup. add_price and
+   remove_price empty the cache.
+ */
+
+#define MAX_CONVERSION_CACHE_SIZE 1024
+
+typedef struct
+{
+    const gnc_commodity *from;
+    const gnc_commodity *to;
+    time64 t;
+} ConversionKey;
+
+typedef struct
+{
+    GNCPrice *direct;
+    gboolean indirect_found;
+    PriceTuple indirect;
+} ConversionPath;
+
+static guint
+conversion_key_hash (gconstpointer key)
+{
+    const ConversionKey *k = key;
+    return g_direct_hash (k->from) ^ (g_direct_hash (k->to) << 1) ^
+        g_int64_hash (&k->t);
+}
+
+static gboolean
+conversion_key_equal (gconstpointer a, gconstpointer b)
+{
+    const ConversionKey *ka = a;
+    const ConversionKey *kb = b;
+    return ka->from == kb->from && ka->to == kb->to && ka->t == kb->t;
+}
+
+static void
+conversion_path_free (gpointer data)
+{
+    ConversionPath *path = data;
+    gnc_price_unref (path->direct);
+    gnc_price_unref (path->indirect.from);
+    gnc_price_unref (path->indirect.to);
+    g_free (path);
+}
+
+static GHashTable *
+conversion_cache_new (void)
+{
+    return g_hash_table_new_full (conversion_key_hash, conversion_key_equal,
+                                  g_free, conversion_path_free);
+}
+
+static void
+pricedb_invalidate_conversion_cache (GNCPriceDB *db)
+{
+    if (db->conversion_cache)
+        g_hash_table_remove_all (db->conversion_cache);
+}
+
+static ConversionPath *
+pricedb_conversion_path (GNCPriceDB *db, const gnc_commodity *from,
+                         const gnc_commodity *to, time64 t)
+{
+    ConversionKey key = {from, to, t};
+    ConversionKey *new_key;
+    ConversionPath *path;
+
+    path = g_hash_table_lookup (db->conversion_cache, &key);
+    if (path)
+        return path;
+
+    if (g_hash_table_size (db->conversion_cache) >= MAX_CONVERSION_CACHE_SIZE)
+        g_hash_table_remove_all (db->conversion_cache);
+
+    path = g_new0 (ConversionPath, 1);
+    path->direct = direct_balance_price (db, from, to, t);
+    new_key = g_new (ConversionKey, 1);
+    *new_key = key;
+    g_hash_table_insert (db->conversion_cache, new_key, path);
+    return path;
+}
+
+static gnc_numeric
+convert_balance_on_path (GNCPriceDB *db, ConversionPath *path,
+                         gnc_numeric bal, const gnc_commodity *from,
+                         const gnc_commodity *to, time64 t)
+{
+    gnc_numeric new_value = gnc_numeric_zero();
+
+    /* Look for a direct price. */
+    if (path->direct)
+        new_value = direct_balance_conversion (bal, from, to, path->direct);
+    if (!gnc_numeric_zero_p (new_value))
+        return new_value;
+
+    /*
+     * no direct price found, try if we find a price in another currency
+     * and convert in two stages
+     */
+    if (!path->indirect_found)
+    {
+        path->indirect = indirect_balance_prices (db, from, to, t);
+        path->indirect_found = TRUE;
+    }
+    if (path->indirect.from)
+        return convert_balance (bal, from, to, path->indirect);
+    return gnc_numeric_zero();
+}
+
+static void
+pricedb_convert_balances (GNCPriceDB *pdb, const gnc_numeric *balances,
+                          gnc_numeric *new_balances, guint n_balances,
+                          const gnc_commodity *balance_currency,
+                          const gnc_commodity *new_currency, time64 t)
+{
+    ConversionPath *path = NULL;
+    guint i;
+
+    for (i = 0; i < n_balances; i++)
+    {
+        gnc_numeric balance = balances[i];
+
+        if (gnc_numeric_zero_p (balance) ||
+            gnc_commodity_equiv (balance_currency, new_currency))
+        {
+            new_balances[i] = balance;
+            continue;
+        }
+        if (!pdb || !balance_currency || !new_currency)
+        {
+            new_balances[i] = gnc_numeric_zero();
+            continue;
+        }
+        /* Resolve the path once for the whole batch. */
+        if (!path)
+            path = pricedb_conversion_path (pdb, balance_currency,
+                                            new_currency, t);
+        new_balances[i] = convert_balance_on_path (pdb, path, balance,
+                                                   balance_currency,
+                                                   new_currency, t);
+    }
+}
 
 /*
  * Convert a balance from one currency to another.
@@ -2593,22 +2902,9 @@ gnc_pricedb_convert_balance_latest_price(GNCPriceDB *pdb,
 {
     gnc_numeric new_value;
 
-    if (gnc_numeric_zero_p (balance) ||
-            gnc_commodity_equiv (balance_currency, new_currency))
-        return balance;
-
-    /* Look for a direct price. */
-    new_value = direct_balance_conversion(pdb, balance, balance_currency,
-                                          new_currency, INT64_MAX);
-    if (!gnc_numeric_zero_p(new_value))
-        return new_value;
-
-    /*
-     * no direct price found, try if we find a price in another currency
-     * and convert in two stages
-     */
-    return indirect_balance_conversion(pdb, balance, balance_currency,
-                                       new_currency, INT64_MAX);
+    pricedb_convert_balances (pdb, &balance, &new_value, 1,
+                              balance_currency, new_currency, INT64_MAX);
+    return new_value;
 }
 
 gnc_numeric
@@ -2620,22 +2916,38 @@ gnc_pricedb_convert_balance_nearest_price_t64(GNCPriceDB *pdb,
 {
     gnc_numeric new_value;
 
-    if (gnc_numeric_zero_p (balance) ||
-        gnc_commodity_equiv (balance_currency, new_currency))
-        return balance;
+    pricedb_convert_balances (pdb, &balance, &new_value, 1,
+                              balance_currency, new_currency, t);
+    return new_value;
+}
 
-    /* Look for a direct price. */
-    new_value = direct_balance_conversion(pdb, balance, balance_currency,
-                                          new_currency, t);
-    if (!gnc_numeric_zero_p(new_value))
-        return new_value;
+void
+gnc_pricedb_convert_balances_latest_price(GNCPriceDB *pdb,
+                                          const gnc_numeric *balances,
+                                          gnc_numeric *new_balances,
+                                          guint n_balances,
+                                          const gnc_commodity *balance_currency,
+                                          const gnc_commodity *new_currency)
+{
+    g_return_if_fail (balances != NULL || n_balances == 0);
+    g_return_if_fail (new_balances != NULL || n_balances == 0);
+    pricedb_convert_balances (pdb, balances, new_balances, n_balances,
+                              balance_currency, new_currency, INT64_MAX);
+}
 
-    /*
-     * no direct price found, try if we find a price in another currency
-     * and convert in two stages
-     */
-    return indirect_balance_conversion(pdb, balance, balance_currency,
-                                       new_currency, t);
+void
+gnc_pricedb_convert_balances_nearest_price_t64(GNCPriceDB *pdb,
+                                               const gnc_numeric *balances,
+                                               gnc_numeric *new_balances,
+                                               guint n_balances,
+                                               const gnc_commodity *balance_currency,
+                                               const gnc_commodity *new_currency,
+                                               time64 t)
+{
+    g_return_if_fail (balances != NULL || n_balances == 0);
+    g_return_if_fail (new_balances != NULL || n_balances == 0);
+    pricedb_convert_balances (pdb, balances, new_balances, n_balances,
+                              balance_currency, new_currency, t);
 }
 
 
@@ -2653,16 +2965,15 @@ typedef struct
 static void
 pricedb_foreach_pricelist(gpointer key, gpointer val, gpointer user_data)
 {
-    GList *price_list = (GList *) val;
-    GList *node = price_list;
+    GPtrArray *prices = (GPtrArray *) val;
     GNCPriceDBForeachData *foreach_data = (GNCPriceDBForeachData *) user_data;
+    guint i;
 
     /* stop traversal when func returns FALSE */
-    while (foreach_data->ok && node)
+    for (i = 0; foreach_data->ok && i < prices->len; i++)
     {
-        GNCPrice *p = (GNCPrice *) node->data;
+        GNCPrice *p = g_ptr_array_index (prices, i);
         foreach_data->ok = foreach_data->func(p, foreach_data->user_data);
-        node = node->next;
     }
 }
 
@@ -2699,18 +3010,18 @@ unstable_price_traversal(GNCPriceDB *db,
 typedef struct
 {
     gboolean ok;
-    gboolean (*func)(GList *p, gpointer user_data);
+    gboolean (*func)(GPtrArray *p, gpointer user_data);
     gpointer user_data;
 } GNCPriceListForeachData;
 
 static void
 pricedb_pricelist_foreach_pricelist(gpointer key, gpointer val, gpointer user_data)
 {
-    GList *price_list = (GList *) val;
+    GPtrArray *prices = (GPtrArray *) val;
     GNCPriceListForeachData *foreach_data = (GNCPriceListForeachData *) user_data;
     if (foreach_data->ok)
     {
-        foreach_data->ok = foreach_data->func(price_list, foreach_data->user_data);
+        foreach_data->ok = foreach_data->func(prices, foreach_data->user_data);
     }
 }
 
@@ -2723,7 +3034,7 @@ pricedb_pricelist_foreach_currencies_hash(gpointer key, gpointer val, gpointer u
 
 static gboolean
 pricedb_pricelist_traversal(GNCPriceDB *db,
-                         gboolean (*f)(GList *p, gpointer user_data),
+                         gboolean (*f)(GPtrArray *p, gpointer user_data),
                          gpointer user_data)
 {
     GNCPriceListForeachData foreach_data;
@@ -2795,12 +3106,12 @@ stable_price_traversal(GNCPriceDB *db,
         for (j = price_lists; j; j = j->next)
         {
             HashEntry *pricelist_entry = (HashEntry *) j->data;
-            GList *price_list = (GList *) pricelist_entry->value;
-            GList *node;
+            GPtrArray *prices = (GPtrArray *) pricelist_entry->value;
+            guint k;
 
-            for (node = (GList *) price_list; node; node = node->next)
+            for (k = 0; k < prices->len; k++)
             {
-                GNCPrice *price = (GNCPrice *) node->data;
+                GNCPrice *price = g_ptr_array_index (prices, k);
 
                 /* stop traversal when f returns FALSE */
                 if (FALSE == ok) break;
@@ -3020,15 +3331,14 @@ VoidGNCPriceDBForeachData;
 static void
 void_pricedb_foreach_pricelist(gpointer key, gpointer val, gpointer user_data)
 {
-    GList *price_list = (GList *) val;
-    GList *node = price_list;
+    GPtrArray *prices = (GPtrArray *) val;
     VoidGNCPriceDBForeachData *foreach_data = (VoidGNCPriceDBForeachData *) user_data;
+    guint i;
 
-    while (node)
+    for (i = 0; i < prices->len; i++)
     {
-        GNCPrice *p = (GNCPrice *) node->data;
+        GNCPrice *p = g_ptr_array_index (prices, i);
         foreach_data->func(p, foreach_data->user_data);
-        node = node->next;
     }
 }
 
@@ -591,6 +591,52 @@ gnc_pricedb_convert_balance_nearest_price_t64(GNCPriceDB *pdb,
                                               const gnc_commodity *new_currency,
                                               time64 t);
 
+/** @brief Convert an array of balances from one currency to another using
+ * the most recent price between the two.
+ *
+ * The prices used are found once for the whole array, which is cheaper than
+ * calling gnc_pricedb_convert_balance_latest_price() for each balance.
+ * @param pdb The pricedb
+ * @param balances The balances to be converted
+ * @param new_balances An array of n_balances to receive the converted
+ * balances; gnc_numeric_zero where no price is available.
+ * @param n_balances The number of balances
+ * @param balance_currency The commodity in which the balances are currently
+ * expressed
+ * @param new_currency The commodity to which the balances should be converted
+ */
+void
+gnc_pricedb_convert_balances_latest_price(GNCPriceDB *pdb,
+                                          const gnc_numeric *balances,
+                                          gnc_numeric *new_balances,
+                                          guint n_balances,
+                                          const gnc_commodity *balance_currency,
+                                          const gnc_commodity *new_currency);
+
+/** @brief Convert an array of balances from one currency to another using
+ * the price nearest to the given time.
+ *
+ * The prices used are found once for the whole array, which is cheaper than
+ * calling gnc_pricedb_convert_balance_nearest_price_t64() for each balance.
+ * @param pdb The pricedb
+ * @param balances The balances to be converted
+ * @param new_balances An array of n_balances to receive the converted
+ * balances; gnc_numeric_zero where no price is available.
+ * @param n_balances The number of balances
+ * @param balance_currency The commodity in which the balances are currently
+ * expressed
+ * @param new_currency The commodity to which the balances should be converted
+ * @param t The time nearest to which price should be used.
+ */
+void
+gnc_pricedb_convert_balances_nearest_price_t64(GNCPriceDB *pdb,
+                                               const gnc_numeric *balances,
+                                               gnc_numeric *new_balances,
+                                               guint n_balances,
+                                               const gnc_commodity *balance_currency,
+                                               const gnc_commodity *new_currency,
+                                               time64 t);
+
 typedef gboolean (*GncPriceForeachFunc)(GNCPrice *p, gpointer user_data);
 
 /** @brief Call a GncPriceForeachFunction once for each price in db, until the
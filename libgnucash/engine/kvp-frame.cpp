@@ -47,12 +47,13 @@ static const char delim = '/';
 
 KvpFrameImpl::KvpFrameImpl(const KvpFrameImpl & rhs) noexcept
 {
+    m_valuemap.reserve(rhs.m_valuemap.size());
     std::for_each(rhs.m_valuemap.begin(), rhs.m_valuemap.end(),
         [this](const map_type::value_type & a)
         {
             auto key = static_cast<char *>(qof_string_cache_insert(a.first));
             auto val = new KvpValueImpl(*a.second);
-            this->m_valuemap.insert({key,val});
+            this->m_valuemap.emplace_back(key,val);
         }
     );
 }
@@ -68,89 +69,151 @@ KvpFrameImpl::~KvpFrameImpl() noexcept
     m_valuemap.clear();
 }
 
-KvpFrame *
-KvpFrame::get_child_frame_or_nullptr (Path const & path) noexcept
+KvpFrameImpl::map_type::iterator
+KvpFrameImpl::find_slot (const char * key) noexcept
 {
-    if (!path.size ())
-        return this;
-    auto key = path.front ();
-    if (m_valuemap.find (key.c_str ()) == m_valuemap.end ())
-        return nullptr;
-    auto child = m_valuemap.at (key.c_str ())->get <KvpFrame *> ();
-    Path send;
-    std::copy (path.begin () + 1, path.end (), std::back_inserter (send));
-    return child->get_child_frame_or_nullptr (send);
+    auto spot = std::lower_bound (m_valuemap.begin (), m_valuemap.end (),
+                                  key, cstring_comparer {});
+    if (spot != m_valuemap.end () &&
+        (spot->first == key || !std::strcmp (spot->first, key)))
+        return spot;
+    return m_valuemap.end ();
+}
+
+KvpFrameImpl::map_type::const_iterator
+KvpFrameImpl::find_slot (const char * key) const noexcept
+{
+    auto spot = std::lower_bound (m_valuemap.begin (), m_valuemap.end (),
+                                  key, cstring_comparer {});
+    if (spot != m_valuemap.end () &&
+        (spot->first == key || !std::strcmp (spot->first, key)))
+        return spot;
+    return m_valuemap.end ();
+}
+
+static inline const char *
+key_c_str (std::string const & key) noexcept
+{
+    return key.c_str ();
+}
+
+static inline const char *
+key_c_str (const char * key) noexcept
+{
+    return key;
+}
+
+/* Walk the frames named by the keys in [begin, end) without copying them. */
+template <typename Iter> KvpFrame *
+KvpFrame::get_child_frame_or_nullptr (Iter begin, Iter end) noexcept
+{
+    auto frame = this;
+    for (auto key = begin; key != end; ++key)
+    {
+        auto spot = frame->find_slot (key_c_str (*key));
+        if (spot == frame->m_valuemap.end ())
+            return nullptr;
+        frame = spot->second->get <KvpFrame *> ();
+        if (!frame)
+            return nullptr;
+    }
+    return frame;
 }
 
 KvpFrame *
-KvpFrame::get_child_frame_or_create (Path const & path) noexcept
+KvpFrame::get_child_frame_or_create (Path::const_iterator begin,
+                                     Path::const_iterator end) noexcept
 {
-    if (!path.size ())
-        return this;
-    auto key = path.front ();
-    auto spot = m_valuemap.find (key.c_str ());
-    if (spot == m_valuemap.end () || spot->second->get_type () != KvpValue::Type::FRAME)
-        delete set_impl (key.c_str (), new KvpValue {new KvpFrame});
-    Path send;
-    std::copy (path.begin () + 1, path.end (), std::back_inserter (send));
-    auto child_val = m_valuemap.at (key.c_str ());
-    auto child = child_val->get <KvpFrame *> ();
-    return child->get_child_frame_or_create (send);
+    auto frame = this;
+    for (auto key = begin; key != end; ++key)
+    {
+        auto spot = frame->find_slot (key->c_str ());
+        if (spot != frame->m_valuemap.end () &&
+            spot->second->get_type () == KvpValue::Type::FRAME)
+        {
+            frame = spot->second->get <KvpFrame *> ();
+            continue;
+        }
+        auto child = new KvpFrame;
+        delete frame->set_impl (key->c_str (), new KvpValue {child});
+        frame = child;
+    }
+    return frame;
 }
 
 
 KvpValue *
-KvpFrame::set_impl (std::string const & key, KvpValue * value) noexcept
+KvpFrame::set_impl (const char * key, KvpValue * value) noexcept
 {
-    KvpValue * ret {};
-    auto spot = m_valuemap.find (key.c_str ());
-    if (spot != m_valuemap.end ())
+    auto spot = std::lower_bound (m_valuemap.begin (), m_valuemap.end (),
+                                  key, cstring_comparer {});
+    if (spot != m_valuemap.end () && !std::strcmp (spot->first, key))
     {
-        qof_string_cache_remove (spot->first);
-        ret = spot->second;
-        m_valuemap.erase (spot);
+        auto ret = spot->second;
+        if (value)
+        {
+            spot->second = value;
+        }
+        else
+        {
+            qof_string_cache_remove (spot->first);
+            m_valuemap.erase (spot);
+        }
+        return ret;
     }
     if (value)
     {
-        auto cachedkey = static_cast <char const *> (qof_string_cache_insert (key.c_str ()));
-        m_valuemap.emplace (cachedkey, value);
+        auto cachedkey = static_cast <char const *> (qof_string_cache_insert (key));
+        m_valuemap.emplace (spot, cachedkey, value);
     }
-    return ret;
+    return nullptr;
+}
+
+KvpValue *
+KvpFrameImpl::set (Path const & path, KvpValue* value) noexcept
+{
+    if (path.empty())
+        return nullptr;
+    auto target = get_child_frame_or_nullptr (path.begin (), path.end () - 1);
+    if (!target)
+        return nullptr;
+    return target->set_impl (path.back ().c_str (), value);
 }
 
 KvpValue *
-KvpFrameImpl::set (Path path, KvpValue* value) noexcept
+KvpFrameImpl::set_path (Path const & path, KvpValue* value) noexcept
 {
     if (path.empty())
         return nullptr;
-    auto key = path.back ();
-    path.pop_back ();
-    auto target = get_child_frame_or_nullptr (path);
+    auto target = get_child_frame_or_create (path.begin (), path.end () - 1);
     if (!target)
         return nullptr;
-    return target->set_impl (key, value);
+    return target->set_impl (path.back ().c_str (), value);
 }
 
 KvpValue *
-KvpFrameImpl::set_path (Path path, KvpValue* value) noexcept
+KvpFrameImpl::get_slot (Path const & path) noexcept
 {
-    auto key = path.back();
-    path.pop_back();
-    auto target = get_child_frame_or_create (path);
+    if (path.empty())
+        return nullptr;
+    auto target = get_child_frame_or_nullptr (path.begin (), path.end () - 1);
     if (!target)
         return nullptr;
-    return target->set_impl (key, value);
+    auto spot = target->find_slot (path.back ().c_str ());
+    if (spot != target->m_valuemap.end ())
+        return spot->second;
+    return nullptr;
 }
 
 KvpValue *
-KvpFrameImpl::get_slot (Path path) noexcept
+KvpFrameImpl::get_slot (std::initializer_list<const char *> path) noexcept
 {
-    auto key = path.back();
-    path.pop_back();
-    auto target = get_child_frame_or_nullptr (path);
+    if (!path.size())
+        return nullptr;
+    auto target = get_child_frame_or_nullptr (path.begin (), path.end () - 1);
     if (!target)
         return nullptr;
-    auto spot = target->m_valuemap.find (key.c_str ());
+    auto spot = target->find_slot (*(path.end () - 1));
     if (spot != target->m_valuemap.end ())
         return spot->second;
     return nullptr;
@@ -218,7 +281,7 @@ int compare(const KvpFrameImpl & one, const KvpFrameImpl & two) noexcept
 {
     for (const auto & a : one.m_valuemap)
     {
-        auto otherspot = two.m_valuemap.find(a.first);
+        auto otherspot = two.find_slot(a.first);
         if (otherspot == two.m_valuemap.end())
         {
             return 1;
@@ -85,9 +85,10 @@
 #define GNC_KVP_FRAME_TYPE
 
 #include "kvp-value.hpp"
-#include <map>
 #include <string>
 #include <vector>
+#include <utility>
+#include <initializer_list>
 #include <cstring>
 #include <algorithm>
 #include <iostream>
@@ -117,8 +118,19 @@ struct KvpFrameImpl
 		auto ret = std::strcmp(one, two) < 0;
 		return ret;
 	    }
+	/* Returns true if the slot's key is less than key. */
+	bool operator()(const std::pair<const char *, KvpValue*>& slot,
+                        const char * key) const
+	    {
+		return std::strcmp(slot.first, key) < 0;
+	    }
     };
-    using map_type = std::map<const char *, KvpValue*, cstring_comparer>;
+    /* The slots, sorted by key. Frames rarely hold more than a few slots, so
+     * a flat vector searched by bisection is both smaller and faster than a
+     * tree of separately allocated nodes. Keys are interned in the
+     * QofStringCache.
+     */
+    using map_type = std::vector<std::pair<const char *, KvpValue*>>;
 
     public:
     KvpFrameImpl() noexcept {};
@@ -156,7 +168,7 @@ struct KvpFrameImpl
      * @param newvalue: The value to set at key.
      * @return The old value if there was one or nullptr.
      */
-    KvpValue* set(Path path, KvpValue* newvalue) noexcept;
+    KvpValue* set(Path const & path, KvpValue* newvalue) noexcept;
      /**
      * Set the value with the key in a subframe following the keys in path,
      * replacing and returning the old value if it exists or nullptr if it
@@ -168,7 +180,7 @@ struct KvpFrameImpl
      * @param newvalue: The value to set at key.
      * @return The old value if there was one or nullptr.
      */
-    KvpValue* set_path(Path path, KvpValue* newvalue) noexcept;
+    KvpValue* set_path(Path const & path, KvpValue* newvalue) noexcept;
     /**
      * Make a string representation of the frame. Mostly useful for debugging.
      * @return A std::string representing the frame and all its children.
@@ -191,7 +203,15 @@ struct KvpFrameImpl
      * @param path: Path of keys leading to the desired value.
      * @return The value at the key or nullptr.
      */
-    KvpValue* get_slot(Path keys) noexcept;
+    KvpValue* get_slot(Path const & keys) noexcept;
+
+    /** Get the value for the tail of the path or nullptr if it doesn't exist.
+     * Unlike the Path version this doesn't copy the keys into std::strings,
+     * so a literal path like get_slot({"counters", name}) doesn't allocate.
+     * @param path: Path of keys leading to the desired value.
+     * @return The value at the key or nullptr.
+     */
+    KvpValue* get_slot(std::initializer_list<const char *> keys) noexcept;
 
     /** The function should be of the form:
      * <anything> func (char const *, KvpValue *, data_type &);
@@ -229,10 +249,14 @@ struct KvpFrameImpl
     private:
     map_type m_valuemap;
 
-    KvpFrame * get_child_frame_or_nullptr (Path const &) noexcept;
-    KvpFrame * get_child_frame_or_create (Path const &) noexcept;
+    map_type::iterator find_slot (const char *) noexcept;
+    map_type::const_iterator find_slot (const char *) const noexcept;
+    template <typename Iter>
+    KvpFrame * get_child_frame_or_nullptr (Iter begin, Iter end) noexcept;
+    KvpFrame * get_child_frame_or_create (Path::const_iterator,
+                                          Path::const_iterator) noexcept;
     void flatten_kvp_impl(std::vector <std::string>, std::vector <KvpEntry> &) const noexcept;
-    KvpValue * set_impl (std::string const &, KvpValue *) noexcept;
+    KvpValue * set_impl (const char *, KvpValue *) noexcept;
 };
 
 template<typename func_type>
@@ -227,6 +227,20 @@ public:
  *    better to wait for the query).
  */
     virtual void load (QofBook*, QofBackendLoadType) = 0;
+/**
+ *    Called before a query is run on the book, so that a backend which loads
+ *    objects on demand can load any the query might match that aren't in
+ *    memory yet.
+ */
+    virtual void load_for_query (QofQuery*) {}
+/**
+ *    Sum the amounts of an account's splits in transactions posted on or
+ *    after start and before end, for a backend that doesn't keep them all in
+ *    memory. Returns false if the splits in memory are all there are, so
+ *    that the engine must sum them itself.
+ */
+    virtual bool get_account_balance (const QofInstance*, time64, time64,
+                                      gnc_numeric*) { return false; }
 /**
  *    Called when the engine is about to make a change to a data structure. It
  *    could provide an advisory lock on data, but no backend does this.
@@ -240,6 +254,23 @@ public:
  *    Revert changes in the engine and unlock the backend.
  */
     virtual void rollback(QofInstance*) {}
+/**
+ *    Start a group commit: the commits that follow, up to the matching
+ *    end_group_commit(), are written to storage together instead of one at a
+ *    time. Groups may be nested; only the outermost one has any effect.
+ */
+    virtual void begin_group_commit() {}
+/**
+ *    Finish a group commit and write out its commits. Returns false if they
+ *    couldn't be written, in which case none of them were and the instances
+ *    they saved are marked dirty again.
+ */
+    virtual bool end_group_commit() { return true; }
+/**
+ *    Finish a group commit without writing any of its commits. The instances
+ *    they saved are marked dirty again.
+ */
+    virtual void rollback_group_commit() {}
 /**
  *    Synchronizes the engine contents to the backend.
  *    This should done by using version numbers (hack alert -- the engine
@@ -30,14 +30,40 @@ extern "C"
 
 #include "qof.h"
 #include "qofevent-p.h"
+#include <vector>
+#include <unordered_set>
+
+struct EventRecordHash
+{
+    size_t operator() (const QofEventRecord& record) const
+    {
+        return guid_hash_to_guint (&record.guid) ^ record.event_type;
+    }
+};
+
+struct EventRecordEqual
+{
+    bool operator() (const QofEventRecord& a, const QofEventRecord& b) const
+    {
+        return a.event_type == b.event_type && guid_equal (&a.guid, &b.guid);
+    }
+};
 
 /* Static Variables ************************************************/
 static guint   suspend_counter   = 0;
+static guint   batch_counter     = 0;
+static guint   batch_handlers    = 0;
 static gint    next_handler_id   = 1;
 static guint   handler_run_level = 0;
 static guint   pending_deletes   = 0;
 static GList   *handlers  =   NULL;
 
+/* The events of the open batch in the order they were generated, and the
+ * same events hashed to drop repeats. */
+static std::vector<QofEventRecord> batch_events;
+static std::unordered_set<QofEventRecord, EventRecordHash,
+                          EventRecordEqual> batch_seen;
+
 /* This static indicates the debugging module that this .o belongs to.  */
 static QofLogModule log_module = QOF_MOD_ENGINE;
 
@@ -72,10 +98,33 @@ find_next_handler_id(void)
     return handler_id;
 }
 
+static gint
+register_handler (QofEventHandler handler, QofEventBatchHandler batch_handler,
+                  gpointer user_data)
+{
+    HandlerInfo *hi;
+    gint handler_id;
+
+    /* look for a free handler id */
+    handler_id = find_next_handler_id();
+
+    /* Found one, add the handler */
+    hi = g_new0 (HandlerInfo, 1);
+
+    hi->handler = handler;
+    hi->batch_handler = batch_handler;
+    hi->user_data = user_data;
+    hi->handler_id = handler_id;
+
+    handlers = g_list_prepend (handlers, hi);
+    if (batch_handler)
+        batch_handlers++;
+    return handler_id;
+}
+
 gint
 qof_event_register_handler (QofEventHandler handler, gpointer user_data)
 {
-    HandlerInfo *hi;
     gint handler_id;
 
     ENTER ("(handler=%p, data=%p)", handler, user_data);
@@ -87,17 +136,27 @@ qof_event_register_handler (QofEventHandler handler, gpointer user_data)
         return 0;
     }
 
-    /* look for a free handler id */
-    handler_id = find_next_handler_id();
+    handler_id = register_handler (handler, NULL, user_data);
+    LEAVE ("(handler=%p, data=%p) handler_id=%d", handler, user_data, handler_id);
+    return handler_id;
+}
 
-    /* Found one, add the handler */
-    hi = g_new0 (HandlerInfo, 1);
+gint
+qof_event_register_batch_handler (QofEventBatchHandler handler,
+                                  gpointer user_data)
+{
+    gint handler_id;
 
-    hi->handler = handler;
-    hi->user_data = user_data;
-    hi->handler_id = handler_id;
+    ENTER ("(handler=%p, data=%p)", handler, user_data);
 
-    handlers = g_list_prepend (handlers, hi);
+    /* sanity check */
+    if (!handler)
+    {
+        PERR ("no handler specified");
+        return 0;
+    }
+
+    handler_id = register_handler (NULL, handler, user_data);
     LEAVE ("(handler=%p, data=%p) handler_id=%d", handler, user_data, handler_id);
     return handler_id;
 }
@@ -123,9 +182,16 @@ qof_event_unregister_handler (gint handler_id)
         if (hi->handler)
             LEAVE ("(handler_id=%d) handler=%p data=%p", handler_id,
                    hi->handler, hi->user_data);
+        if (hi->batch_handler)
+        {
+            LEAVE ("(handler_id=%d) batch handler=%p data=%p", handler_id,
+                   hi->batch_handler, hi->user_data);
+            batch_handlers--;
+        }
 
         /* safety -- clear the handler in case we're running events now */
         hi->handler = NULL;
+        hi->batch_handler = NULL;
 
         if (handler_run_level == 0)
         {
@@ -167,12 +233,40 @@ qof_event_resume (void)
     suspend_counter--;
 }
 
+/* If we're the outermost event runner and we have pending deletes
+ * then go delete the handlers now.
+ */
+static void
+remove_pending_deletes (void)
+{
+    GList *node;
+    GList *next_node = NULL;
+
+    if (handler_run_level != 0 || !pending_deletes)
+        return;
+
+    for (node = handlers; node; node = next_node)
+    {
+        HandlerInfo *hi = static_cast<HandlerInfo*>(node->data);
+        next_node = node->next;
+        if (hi->handler == NULL && hi->batch_handler == NULL)
+        {
+            /* remove this node from the list, then free this node */
+            handlers = g_list_remove_link (handlers, node);
+            g_list_free_1 (node);
+            g_free (hi);
+        }
+    }
+    pending_deletes = 0;
+}
+
 static void
 qof_event_generate_internal (QofInstance *entity, QofEventId event_id,
                              gpointer event_data)
 {
     GList *node;
     GList *next_node = NULL;
+    QofEventRecord record;
 
     g_return_if_fail(entity);
 
@@ -185,6 +279,12 @@ qof_event_generate_internal (QofInstance *entity, QofEventId event_id,
     }
     }
 
+    record.guid = *qof_instance_get_guid (entity);
+    record.entity_type = entity->e_type;
+    record.event_type = event_id;
+    if (batch_counter && batch_handlers && batch_seen.insert (record).second)
+        batch_events.push_back (record);
+
     handler_run_level++;
     for (node = handlers; node; node = next_node)
     {
@@ -197,28 +297,16 @@ qof_event_generate_internal (QofInstance *entity, QofEventId event_id,
                   hi->handler, event_data);
             hi->handler (entity, event_id, hi->user_data, event_data);
         }
-    }
-    handler_run_level--;
-
-    /* If we're the outermost event runner and we have pending deletes
-     * then go delete the handlers now.
-     */
-    if (handler_run_level == 0 && pending_deletes)
-    {
-        for (node = handlers; node; node = next_node)
+        else if (hi->batch_handler && !batch_counter)
         {
-            HandlerInfo *hi = static_cast<HandlerInfo*>(node->data);
-            next_node = node->next;
-            if (hi->handler == NULL)
-            {
-                /* remove this node from the list, then free this node */
-                handlers = g_list_remove_link (handlers, node);
-                g_list_free_1 (node);
-                g_free (hi);
-            }
+            PINFO("id=%d hi=%p batch han=%p", hi->handler_id, hi,
+                  hi->batch_handler);
+            hi->batch_handler (&record, 1, hi->user_data);
         }
-        pending_deletes = 0;
     }
+    handler_run_level--;
+
+    remove_pending_deletes ();
 }
 
 void
@@ -242,4 +330,57 @@ qof_event_gen (QofInstance *entity, QofEventId event_id, gpointer event_data)
     qof_event_generate_internal (entity, event_id, event_data);
 }
 
+void
+qof_event_begin_batch (void)
+{
+    batch_counter++;
+
+    if (batch_counter == 0)
+    {
+        PERR ("batch counter overflow");
+    }
+}
+
+void
+qof_event_end_batch (void)
+{
+    GList *node;
+    GList *next_node = NULL;
+    std::vector<QofEventRecord> events;
+
+    if (batch_counter == 0)
+    {
+        PERR ("batch counter underflow");
+        return;
+    }
+
+    if (--batch_counter)
+        return;
+
+    /* Handlers may generate events, which are delivered right away now
+     * that the batch is closed; don't let them touch the ones being sent. */
+    events.swap (batch_events);
+    batch_seen.clear ();
+    if (events.empty ())
+        return;
+
+    handler_run_level++;
+    for (node = handlers; node; node = next_node)
+    {
+        HandlerInfo *hi = static_cast<HandlerInfo*>(node->data);
+
+        next_node = node->next;
+        if (hi->batch_handler)
+        {
+            PINFO("id=%d hi=%p batch han=%p events=%" G_GSIZE_FORMAT,
+                  hi->handler_id, hi, hi->batch_handler, events.size ());
+            hi->batch_handler (events.data (), static_cast<guint>(events.size ()),
+                               hi->user_data);
+        }
+    }
+    handler_run_level--;
+
+    remove_pending_deletes ();
+}
+
 /* =========================== END OF FILE ======================= */
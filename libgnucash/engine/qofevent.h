@@ -89,6 +89,29 @@ for future libqof1 or libqof2 usage.
 typedef void (*QofEventHandler) (QofInstance *ent,  QofEventId event_type,
                                  gpointer handler_data, gpointer event_data);
 
+/** \brief One entry of a batch of events.
+ *
+ * Batches outlive the events they record, so they identify the entity by
+ * GncGUID and type rather than by pointer: it may have been destroyed by
+ * the time the batch is delivered.
+ */
+typedef struct
+{
+    GncGUID guid;
+    QofIdTypeConst entity_type;
+    QofEventId event_type;
+} QofEventRecord;
+
+/** \brief Handler invoked with the events of a batch.
+ *
+ * @param events:   The events, in the order they were first generated. An
+ *  entity appears at most once for each event type.
+ * @param n_events:  The number of events.
+ * @param handler_data:   data supplied when handler was registered.
+ */
+typedef void (*QofEventBatchHandler) (const QofEventRecord *events,
+                                      guint n_events, gpointer handler_data);
+
 /** \brief Register a handler for events.
  *
  * @param handler:   handler to register
@@ -98,6 +121,22 @@ typedef void (*QofEventHandler) (QofInstance *ent,  QofEventId event_type,
  */
 gint qof_event_register_handler (QofEventHandler handler, gpointer handler_data);
 
+/** \brief Register a handler for batches of events.
+ *
+ * While a batch is open (see qof_event_begin_batch) the handler's events
+ * are collected and it is called once with all of them when the batch
+ * closes. Outside a batch it is called with each event as it happens.
+ * Event data is not passed on.
+ *
+ * @param handler:   handler to register
+ * @param handler_data: data provided when handler is invoked
+ *
+ * @return id identifying handler, to be passed to
+ * qof_event_unregister_handler.
+ */
+gint qof_event_register_batch_handler (QofEventBatchHandler handler,
+                                       gpointer handler_data);
+
 /** \brief Unregister an event handler.
  *
  * @param handler_id: the id of the handler to unregister
@@ -139,6 +178,19 @@ void qof_event_suspend (void);
 /** Resume engine event generation. */
 void qof_event_resume (void);
 
+/** \brief  Start collecting events for batch handlers.
+ *
+ *    Handlers registered with qof_event_register_handler still see every
+ *   event as it happens; handlers registered with
+ *   qof_event_register_batch_handler see each (entity, event type) pair
+ *   once, when the batch ends. Unlike qof_event_suspend no event is lost.
+ *   Batches nest: events are delivered when the outermost one ends.
+ */
+void qof_event_begin_batch (void);
+
+/** Deliver the events collected since the outermost qof_event_begin_batch. */
+void qof_event_end_batch (void);
+
 #ifdef __cplusplus
 }
 #endif
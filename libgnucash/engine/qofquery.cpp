@@ -113,6 +113,9 @@ typedef struct _QofQueryCB
     gint              count;
 } QofQueryCB;
 
+/* Map of object type to the QofQueryIndexFunc registered for it */
+static GHashTable *queryIndexTable = NULL;
+
 /* initial_term will be owned by the new Query */
 static void query_init (QofQuery *q, QofQueryTerm *initial_term)
 {
@@ -723,6 +726,54 @@ void qof_query_purge_terms (QofQuery *q, QofQueryParamList *param_list)
     }
 }
 
+/* If the query's terms are all ANDed together and the index registered for
+ * its object type can answer one of them, set *candidates to the smallest
+ * candidate list the index returns and return TRUE. */
+static gboolean
+query_index_candidates (QofQuery *q, QofBook *book, GList **candidates)
+{
+    QofQueryIndexFunc index_fcn;
+    GList *node;
+    guint best_len = 0;
+    gboolean found = FALSE;
+
+    if (!queryIndexTable || !q->terms || q->terms->next)
+        return FALSE;
+
+    index_fcn = (QofQueryIndexFunc) g_hash_table_lookup (queryIndexTable,
+                                                         q->search_for);
+    if (!index_fcn)
+        return FALSE;
+
+    for (node = static_cast<GList*>(q->terms->data); node; node = node->next)
+    {
+        QofQueryTerm *qt = static_cast<QofQueryTerm*>(node->data);
+        GList *term_candidates = NULL;
+        guint len;
+
+        /* check_object ignores terms it can't evaluate, so they can't
+         * narrow the search either. */
+        if (qt->invert || !qt->param_fcns || !qt->pred_fcn)
+            continue;
+        if (!index_fcn (book, qt->param_list, qt->pdata, &term_candidates))
+            continue;
+
+        len = g_list_length (term_candidates);
+        if (!found || len < best_len)
+        {
+            g_list_free (*candidates);
+            *candidates = term_candidates;
+            best_len = len;
+            found = TRUE;
+        }
+        else
+            g_list_free (term_candidates);
+    }
+    PINFO ("query=%p index %s, %u candidates", q, found ? "used" : "not used",
+           best_len);
+    return found;
+}
+
 static GList * qof_query_run_internal (QofQuery *q,
                                        void(*run_cb)(QofQueryCB*, gpointer),
                                        gpointer cb_arg)
@@ -839,6 +890,18 @@ static void qof_query_run_cb(QofQueryCB* qcb, gpointer cb_arg)
             }
         }
 #endif
+        if (book->backend)
+            book->backend->load_for_query (qcb->query);
+
+        GList *candidates = NULL;
+        if (query_index_candidates (qcb->query, book, &candidates))
+        {
+            /* Only the objects the index found can match */
+            g_list_foreach (candidates, check_item_cb, qcb);
+            g_list_free (candidates);
+            continue;
+        }
+
         /* And then iterate over all the objects */
         qof_object_foreach (qcb->query->search_for, book,
                             (QofInstanceForeachCB) check_item_cb, qcb);
@@ -1349,10 +1412,30 @@ void qof_query_init (void)
 
 void qof_query_shutdown (void)
 {
+    if (queryIndexTable)
+    {
+        g_hash_table_destroy (queryIndexTable);
+        queryIndexTable = NULL;
+    }
     qof_class_shutdown ();
     qof_query_core_shutdown ();
 }
 
+void qof_query_register_index (QofIdTypeConst obj_type,
+                               QofQueryIndexFunc index_fcn)
+{
+    g_return_if_fail (obj_type);
+
+    if (!queryIndexTable)
+        queryIndexTable = g_hash_table_new (g_str_hash, g_str_equal);
+
+    if (index_fcn)
+        g_hash_table_insert (queryIndexTable, (gpointer) obj_type,
+                             (gpointer) index_fcn);
+    else
+        g_hash_table_remove (queryIndexTable, obj_type);
+}
+
 int qof_query_get_max_results (const QofQuery *q)
 {
     if (!q) return 0;
@@ -125,6 +125,28 @@ typedef enum
 
 void qof_query_init (void);
 void qof_query_shutdown (void);
+
+/** An index function answers a single query term for an object type from
+ *  data that the type maintains anyway, so that qof_query_run() doesn't have
+ *  to test every instance in the book.
+ *
+ *  It is given the term's parameter path and predicate. If it can answer the
+ *  term it sets *candidates to a newly allocated list that includes every
+ *  instance in book satisfying the term (it may include others; the query
+ *  tests each candidate against all of its terms) and returns TRUE.
+ *  Otherwise it returns FALSE and the query falls back to testing every
+ *  instance.
+ */
+typedef gboolean (*QofQueryIndexFunc) (QofBook *book,
+                                       QofQueryParamList *param_list,
+                                       QofQueryPredData *pred_data,
+                                       GList **candidates);
+
+/** Register the index function for queries searching for obj_type. Only
+ *  queries whose terms are all ANDed together are answered from an index.
+ */
+void qof_query_register_index (QofIdTypeConst obj_type,
+                               QofQueryIndexFunc index_fcn);
 // @}
 
 /* --------------------------------------------------------- */
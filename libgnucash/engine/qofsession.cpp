@@ -478,6 +478,33 @@ QofSessionImpl::safe_save (QofPercentageFunc percentage_func) noexcept
     }
 }
 
+void
+QofSessionImpl::begin_group_commit () noexcept
+{
+    auto backend = qof_book_get_backend (m_book);
+    if (!backend) return;
+    backend->begin_group_commit ();
+}
+
+bool
+QofSessionImpl::end_group_commit () noexcept
+{
+    auto backend = qof_book_get_backend (m_book);
+    if (!backend) return true;
+    if (backend->end_group_commit ())
+        return true;
+    push_error (backend->get_error(), {});
+    return false;
+}
+
+void
+QofSessionImpl::rollback_group_commit () noexcept
+{
+    auto backend = qof_book_get_backend (m_book);
+    if (!backend) return;
+    backend->rollback_group_commit ();
+}
+
 void
 QofSessionImpl::ensure_all_data_loaded () noexcept
 {
@@ -622,6 +649,27 @@ qof_session_safe_save(QofSession *session, QofPercentageFunc percentage_func)
     session->safe_save (percentage_func);
 }
 
+void
+qof_session_begin_group_commit (QofSession *session)
+{
+    if (!session) return;
+    session->begin_group_commit ();
+}
+
+gboolean
+qof_session_end_group_commit (QofSession *session)
+{
+    if (!session) return TRUE;
+    return session->end_group_commit ();
+}
+
+void
+qof_session_rollback_group_commit (QofSession *session)
+{
+    if (!session) return;
+    session->rollback_group_commit ();
+}
+
 gboolean
 qof_session_save_in_progress(const QofSession *session)
 {
@@ -246,6 +246,25 @@ void     qof_session_save (QofSession *session,
 void     qof_session_safe_save (QofSession *session,
                                 QofPercentageFunc percentage_func);
 
+/** @name Group commits
+ * Each engine commit is normally written to the backend's storage on its
+ * own. Commits made between qof_session_begin_group_commit() and
+ * qof_session_end_group_commit() are written together, which for the SQL
+ * backend means in a single database transaction. Bracket long runs of
+ * edits, such as an import, with these. Groups may be nested; only the
+ * outermost one has any effect. Backends that write nothing on commit,
+ * like the XML backend, ignore them.
+ @{ */
+void     qof_session_begin_group_commit (QofSession *session);
+/** Write out the group's commits. Returns FALSE if they couldn't be
+ * written, in which case none of them were and the objects they saved are
+ * left dirty; the session's error is set. */
+gboolean qof_session_end_group_commit (QofSession *session);
+/** Finish the group without writing any of its commits; the objects they
+ * saved are left dirty. */
+void     qof_session_rollback_group_commit (QofSession *session);
+/** @} */
+
 /**
  * The qof_session_end() method will release the session lock. For the
  *    file backend, it will *not* save the data to a file. Thus,
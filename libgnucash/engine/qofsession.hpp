@@ -51,6 +51,9 @@ struct QofSessionImpl
     void safe_save (QofPercentageFunc) noexcept;
     bool save_in_progress () const noexcept;
     bool export_session (QofSessionImpl & real_session, QofPercentageFunc) noexcept;
+    void begin_group_commit () noexcept;
+    bool end_group_commit () noexcept;
+    void rollback_group_commit () noexcept;
 
     bool events_pending () const noexcept;
     bool process_events () const noexcept;
@@ -2163,3 +2163,30 @@ remove_sx(SchedXaction *sx)
     SchedXactions *sxes = gnc_book_get_schedxactions(book);
     gnc_sxes_del_sx(sxes, sx);
 }
+
+Account*
+add_test_account(QofBook *book, const char *name, GNCAccountType type,
+                 gnc_commodity *comm)
+{
+    Account *acc = xaccMallocAccount(book);
+    xaccAccountBeginEdit(acc);
+    xaccAccountSetName(acc, name);
+    xaccAccountSetType(acc, type);
+    xaccAccountSetCommodity(acc, comm);
+    gnc_account_append_child(gnc_book_get_root_account(book), acc);
+    xaccAccountCommitEdit(acc);
+    return acc;
+}
+
+Split*
+add_test_split(Transaction *trans, Account *acc, gnc_numeric amount,
+               gnc_numeric value)
+{
+    Split *split = xaccMallocSplit(xaccTransGetBook(trans));
+    xaccSplitSetParent(split, trans);
+    if (acc)
+        xaccSplitSetAccount(split, acc);
+    xaccSplitSetAmount(split, amount);
+    xaccSplitSetValue(split, value);
+    return split;
+}
@@ -123,6 +123,13 @@ SchedXaction* add_daily_sx(const gchar *name, const GDate *start,
 SchedXaction* add_once_sx(const gchar *name, const GDate *when);
 void remove_sx(SchedXaction *sx);
 
+/* Fixed rather than random objects, for tests that check values. */
+Account* add_test_account(QofBook *book, const char *name,
+                          GNCAccountType type, gnc_commodity *comm);
+/* acc may be NULL, for a split without an account. */
+Split* add_test_split(Transaction *trans, Account *acc, gnc_numeric amount,
+                      gnc_numeric value);
+
 #ifdef __cplusplus
 }
 #endif
@@ -32,6 +32,8 @@ extern void test_suite_gncEntry();
 extern void test_suite_gncInvoice();
 extern void test_suite_transaction();
 extern void test_suite_split();
+extern void test_suite_scrub();
+extern void test_suite_translog();
 extern void test_suite_engine_kvp_properties (void);
 extern void test_suite_gnc_pricedb();
 extern void test_suite_gnc_uri_utils(void);
@@ -54,6 +56,8 @@ main (int   argc,
     test_suite_gncInvoice();
     test_suite_transaction();
     test_suite_split();
+    test_suite_scrub();
+    test_suite_translog();
     test_suite_engine_kvp_properties ();
     test_suite_gnc_pricedb();
     test_suite_gnc_uri_utils();
@@ -181,6 +181,35 @@ TEST_F (KvpFrameTest, GetSlotPath)
     EXPECT_EQ (v1, t_root.get_slot(path3a));
 }
 
+TEST_F (KvpFrameTest, GetSlotThroughValue)
+{
+    const char* k1 = "top";
+    const char* k2 = "third";
+    EXPECT_EQ (t_str_val, t_root.get_slot({k1, k2}));
+    EXPECT_EQ (nullptr, t_root.get_slot({k1, k2, "thirty-first"}));
+    EXPECT_EQ (nullptr, t_root.get_slot(Path {"top", "first", "one"}));
+    EXPECT_EQ (nullptr, t_root.get_slot({}));
+}
+
+TEST_F (KvpFrameTest, KeysSorted)
+{
+    KvpFrameImpl f1;
+    for (auto key : {"m", "b", "z", "a", "q", "c"})
+        EXPECT_EQ (nullptr, f1.set({key}, new KvpValue {INT64_C(1)}));
+    auto v1 = new KvpValue {INT64_C(2)};
+    auto old = f1.set({"q"}, v1);
+    EXPECT_TRUE (old != nullptr);
+    delete old;
+    delete f1.set({"c"}, nullptr);
+    EXPECT_EQ (nullptr, f1.get_slot({"c"}));
+    EXPECT_EQ (v1, f1.get_slot({"q"}));
+    auto keys = f1.get_keys ();
+    EXPECT_EQ (keys, (std::vector<std::string> {"a", "b", "m", "q", "z"}));
+    KvpFrameImpl f2 {f1};
+    EXPECT_EQ (0, compare (f1, f2));
+    EXPECT_EQ (f2.get_keys (), keys);
+}
+
 TEST_F (KvpFrameTest, Empty)
 {
     KvpFrameImpl f1, f2;
@@ -32,6 +32,8 @@ extern "C"
 #include "qof.h"
 #include "Account.h"
 #include "Scrub3.h"
+#include "cap-gains.h"
+#include "gnc-lot.h"
 #include "cashobjects.h"
 #include "test-stuff.h"
 #include "test-engine-stuff.h"
@@ -71,6 +73,157 @@ run_test (void)
 
 }
 
+/* A lot bought in one transaction and sold in three, the second of which
+ * sells from it twice. */
+typedef struct
+{
+    Account *stock;
+    Account *gains;
+    Transaction *buy;
+    Split *buy_split;
+    Split *cash_split;
+    Split *sales[4];
+    GNCLot *lot;
+} GainsLot;
+
+static Transaction *
+new_trans (QofBook *book, gnc_commodity *currency, time64 date)
+{
+    Transaction *trans = xaccMallocTransaction (book);
+    xaccTransBeginEdit (trans);
+    xaccTransSetCurrency (trans, currency);
+    xaccTransSetDatePostedSecsNormalized (trans, date);
+    return trans;
+}
+
+static void
+make_gains_lot (QofBook *book, gnc_commodity *currency,
+                gnc_commodity *security, Account *cash, GainsLot *gl)
+{
+    const time64 day = 24 * 60 * 60, start = gnc_time (NULL) - 10 * day;
+    Transaction *trans;
+    int i;
+
+    gl->stock = add_test_account (book, "Stock", ACCT_TYPE_STOCK, security);
+    gl->gains = add_test_account (book, "Gains", ACCT_TYPE_INCOME, currency);
+
+    trans = new_trans (book, currency, start);
+    gl->buy_split = add_test_split (trans, gl->stock, gnc_numeric_create (10, 1),
+                                    gnc_numeric_create (100, 1));
+    gl->cash_split = add_test_split (trans, cash, gnc_numeric_create (-100, 1),
+                                     gnc_numeric_create (-100, 1));
+    xaccTransCommitEdit (trans);
+    gl->buy = trans;
+
+    trans = new_trans (book, currency, start + day);
+    gl->sales[0] = add_test_split (trans, gl->stock, gnc_numeric_create (-3, 1),
+                                   gnc_numeric_create (-45, 1));
+    add_test_split (trans, cash, gnc_numeric_create (45, 1),
+                    gnc_numeric_create (45, 1));
+    xaccTransCommitEdit (trans);
+
+    trans = new_trans (book, currency, start + 2 * day);
+    gl->sales[1] = add_test_split (trans, gl->stock, gnc_numeric_create (-2, 1),
+                                   gnc_numeric_create (-30, 1));
+    gl->sales[2] = add_test_split (trans, gl->stock, gnc_numeric_create (-1, 1),
+                                   gnc_numeric_create (-8, 1));
+    add_test_split (trans, cash, gnc_numeric_create (38, 1),
+                    gnc_numeric_create (38, 1));
+    xaccTransCommitEdit (trans);
+
+    trans = new_trans (book, currency, start + 3 * day);
+    gl->sales[3] = add_test_split (trans, gl->stock, gnc_numeric_create (-4, 1),
+                                   gnc_numeric_create (-60, 1));
+    add_test_split (trans, cash, gnc_numeric_create (60, 1),
+                    gnc_numeric_create (60, 1));
+    xaccTransCommitEdit (trans);
+
+    gl->lot = gnc_lot_new (book);
+    /* Out of order, so that the pass has to sort them. */
+    for (i = 3; i >= 0; i--)
+        gnc_lot_add_split (gl->lot, gl->sales[i]);
+    gnc_lot_add_split (gl->lot, gl->buy_split);
+}
+
+/* The gains as they were computed before the single pass: each split of
+ * the lot by itself, summing the lot's splits before it. */
+static void
+compute_gains_per_split (GainsLot *gl)
+{
+    GList *splits = g_list_copy (gnc_lot_get_split_list (gl->lot)), *node;
+    for (node = splits; node; node = node->next)
+        xaccSplitComputeCapGains (static_cast<Split*> (node->data), gl->gains);
+    g_list_free (splits);
+}
+
+static void
+compare_gains (GainsLot *in_order, GainsLot *per_split, const char *when)
+{
+    int i;
+    for (i = 0; i < 4; i++)
+    {
+        gnc_numeric a = xaccSplitGetCapGains (in_order->sales[i]);
+        gnc_numeric b = xaccSplitGetCapGains (per_split->sales[i]);
+        do_test_args (gnc_numeric_equal (a, b), "sale gains", __FILE__,
+                      __LINE__, "%s, sale %d: %s != %s", when, i,
+                      gnc_num_dbg_to_string (a), gnc_num_dbg_to_string (b));
+    }
+    do_test (gnc_numeric_equal (xaccAccountGetBalance (in_order->gains),
+                                xaccAccountGetBalance (per_split->gains)),
+             "gains account balance");
+    do_test (gnc_numeric_equal (xaccAccountGetBalance (in_order->stock),
+                                xaccAccountGetBalance (per_split->stock)),
+             "stock account balance");
+    do_test (gnc_lot_is_closed (in_order->lot) &&
+             gnc_lot_is_closed (per_split->lot), "lots closed");
+}
+
+static void
+test_gains_in_order (void)
+{
+    QofBook *book = qof_book_new ();
+    gnc_commodity_table *table = gnc_commodity_table_get_table (book);
+    gnc_commodity *currency =
+        gnc_commodity_table_lookup (table, GNC_COMMODITY_NS_CURRENCY, "USD");
+    gnc_commodity *security =
+        gnc_commodity_new (book, "Test Shares", "NYSE", "TST", "", 1);
+    Account *cash;
+    GainsLot in_order, per_split;
+    int i;
+
+    gnc_commodity_table_insert (table, security);
+    cash = add_test_account (book, "Cash", ACCT_TYPE_BANK, currency);
+    make_gains_lot (book, currency, security, cash, &in_order);
+    make_gains_lot (book, currency, security, cash, &per_split);
+
+    xaccLotComputeCapGains (in_order.lot, in_order.gains);
+    compute_gains_per_split (&per_split);
+    /* Bought at 10 a share. */
+    do_test (gnc_numeric_equal (gnc_numeric_abs (xaccSplitGetCapGains (in_order.sales[0])),
+                                gnc_numeric_create (15, 1)),
+             "gains of the first sale");
+    compare_gains (&in_order, &per_split, "computed");
+
+    /* A new cost changes the gains of every sale. */
+    for (i = 0; i < 2; i++)
+    {
+        GainsLot *gl = i ? &per_split : &in_order;
+        xaccTransBeginEdit (gl->buy);
+        xaccSplitSetValue (gl->buy_split, gnc_numeric_create (120, 1));
+        xaccSplitSetAmount (gl->cash_split, gnc_numeric_create (-120, 1));
+        xaccSplitSetValue (gl->cash_split, gnc_numeric_create (-120, 1));
+        xaccTransCommitEdit (gl->buy);
+    }
+    xaccLotComputeCapGains (in_order.lot, in_order.gains);
+    compute_gains_per_split (&per_split);
+    do_test (gnc_numeric_equal (gnc_numeric_abs (xaccSplitGetCapGains (in_order.sales[0])),
+                                gnc_numeric_create (9, 1)),
+             "gains of the first sale at the new cost");
+    compare_gains (&in_order, &per_split, "recomputed");
+
+    qof_book_destroy (book);
+}
+
 int
 main (int argc, char **argv)
 {
@@ -93,6 +246,7 @@ main (int argc, char **argv)
         fflush(stdout);
         run_test ();
     }
+    test_gains_in_order ();
     /* 'erase' the recurring tag line with dummy spaces. */
     fprintf(stdout, "Lots: Test series complete.         \n");
     fflush(stdout);
@@ -0,0 +1,248 @@
+/********************************************************************
+ * test-qofevent.c: GLib g_test test suite for qofevent.cpp.        *
+ *                                                                  *
+ * This program is free software; you can redistribute it and/or    *
+ * modify it under the terms of the GNU General Public License as   *
+ * published by the Free Software Foundation; either version 2 of   *
+ * the License, or (at your option) any later version.              *
+ *                                                                  *
+ * This program is distributed in the hope that it will be useful,  *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of   *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the    *
+ * GNU General Public License for more details.                     *
+ *                                                                  *
+ * You should have received a copy of the GNU General Public License*
+ * along with this program; if not, contact:                        *
+ *                                                                  *
+ * Free Software Foundation           Voice:  +1-617-542-5942       *
+ * 51 Franklin Street, Fifth Floor    Fax:    +1-617-542-2652       *
+ * Boston, MA  02110-1301,  USA       gnu@gnu.org                   *
+********************************************************************/
+#include <config.h>
+#include <glib.h>
+#include <unittest-support.h>
+#include "../qof.h"
+
+static const gchar *suitename = "/qof/qofevent";
+void test_suite_qofevent ( void );
+
+typedef struct
+{
+    QofBook *book;
+    QofInstance *inst1;
+    QofInstance *inst2;
+    gint handler_id;
+    gint batch_handler_id;
+    /* Events seen by the ordinary handler */
+    guint n_events;
+    /* Calls to the batch handler and the records they carried */
+    guint n_batches;
+    GArray *records;
+} Fixture;
+
+static void
+event_handler (QofInstance *ent, QofEventId event_type,
+               gpointer handler_data, gpointer event_data)
+{
+    Fixture *fixture = handler_data;
+    if (ent == fixture->inst1 || ent == fixture->inst2)
+        fixture->n_events++;
+}
+
+static void
+batch_handler (const QofEventRecord *events, guint n_events,
+               gpointer handler_data)
+{
+    Fixture *fixture = handler_data;
+    fixture->n_batches++;
+    g_array_append_vals (fixture->records, events, n_events);
+}
+
+static void
+setup (Fixture *fixture, gconstpointer pData)
+{
+    fixture->book = qof_book_new ();
+    fixture->inst1 = g_object_new (QOF_TYPE_INSTANCE, NULL);
+    qof_instance_init_data (fixture->inst1, "test", fixture->book);
+    fixture->inst2 = g_object_new (QOF_TYPE_INSTANCE, NULL);
+    qof_instance_init_data (fixture->inst2, "test", fixture->book);
+    fixture->n_events = 0;
+    fixture->n_batches = 0;
+    fixture->records = g_array_new (FALSE, FALSE, sizeof (QofEventRecord));
+    fixture->handler_id = qof_event_register_handler (event_handler, fixture);
+    fixture->batch_handler_id =
+        qof_event_register_batch_handler (batch_handler, fixture);
+}
+
+static void
+teardown (Fixture *fixture, gconstpointer pData)
+{
+    qof_event_unregister_handler (fixture->handler_id);
+    qof_event_unregister_handler (fixture->batch_handler_id);
+    g_array_free (fixture->records, TRUE);
+    g_object_unref (fixture->inst1);
+    g_object_unref (fixture->inst2);
+    qof_book_destroy (fixture->book);
+}
+
+static void
+assert_record (Fixture *fixture, guint index, QofInstance *inst,
+               QofEventId event_type)
+{
+    QofEventRecord *rec;
+    g_assert_cmpuint (index, <, fixture->records->len);
+    rec = &g_array_index (fixture->records, QofEventRecord, index);
+    g_assert (guid_equal (&rec->guid, qof_instance_get_guid (inst)));
+    g_assert_cmpstr (rec->entity_type, ==, "test");
+    g_assert_cmpint (rec->event_type, ==, event_type);
+}
+
+static void
+test_unbatched (Fixture *fixture, gconstpointer pData)
+{
+    /* Outside a batch the batch handler sees each event by itself. */
+    qof_event_gen (fixture->inst1, QOF_EVENT_MODIFY, NULL);
+    qof_event_gen (fixture->inst1, QOF_EVENT_MODIFY, NULL);
+    g_assert_cmpuint (fixture->n_events, ==, 2);
+    g_assert_cmpuint (fixture->n_batches, ==, 2);
+    g_assert_cmpuint (fixture->records->len, ==, 2);
+    assert_record (fixture, 0, fixture->inst1, QOF_EVENT_MODIFY);
+    assert_record (fixture, 1, fixture->inst1, QOF_EVENT_MODIFY);
+}
+
+static void
+test_batch_delivery (Fixture *fixture, gconstpointer pData)
+{
+    qof_event_begin_batch ();
+    qof_event_gen (fixture->inst1, QOF_EVENT_CREATE, NULL);
+    qof_event_gen (fixture->inst2, QOF_EVENT_MODIFY, NULL);
+    /* Ordinary handlers aren't held back by a batch. */
+    g_assert_cmpuint (fixture->n_events, ==, 2);
+    g_assert_cmpuint (fixture->n_batches, ==, 0);
+    qof_event_end_batch ();
+
+    g_assert_cmpuint (fixture->n_batches, ==, 1);
+    g_assert_cmpuint (fixture->records->len, ==, 2);
+    assert_record (fixture, 0, fixture->inst1, QOF_EVENT_CREATE);
+    assert_record (fixture, 1, fixture->inst2, QOF_EVENT_MODIFY);
+
+    /* An empty batch delivers nothing. */
+    qof_event_begin_batch ();
+    qof_event_end_batch ();
+    g_assert_cmpuint (fixture->n_batches, ==, 1);
+}
+
+static void
+test_batch_dedup (Fixture *fixture, gconstpointer pData)
+{
+    qof_event_begin_batch ();
+    qof_event_gen (fixture->inst1, QOF_EVENT_MODIFY, NULL);
+    qof_event_gen (fixture->inst2, QOF_EVENT_MODIFY, NULL);
+    qof_event_gen (fixture->inst1, QOF_EVENT_MODIFY, NULL);
+    qof_event_gen (fixture->inst1, QOF_EVENT_DESTROY, NULL);
+    qof_event_gen (fixture->inst2, QOF_EVENT_MODIFY, NULL);
+    qof_event_end_batch ();
+
+    g_assert_cmpuint (fixture->n_events, ==, 5);
+    g_assert_cmpuint (fixture->n_batches, ==, 1);
+    /* Each (entity, event) pair once, in the order first generated. */
+    g_assert_cmpuint (fixture->records->len, ==, 3);
+    assert_record (fixture, 0, fixture->inst1, QOF_EVENT_MODIFY);
+    assert_record (fixture, 1, fixture->inst2, QOF_EVENT_MODIFY);
+    assert_record (fixture, 2, fixture->inst1, QOF_EVENT_DESTROY);
+
+    /* The next batch starts afresh. */
+    qof_event_begin_batch ();
+    qof_event_gen (fixture->inst1, QOF_EVENT_MODIFY, NULL);
+    qof_event_end_batch ();
+    g_assert_cmpuint (fixture->n_batches, ==, 2);
+    g_assert_cmpuint (fixture->records->len, ==, 4);
+    assert_record (fixture, 3, fixture->inst1, QOF_EVENT_MODIFY);
+}
+
+static void
+test_nested_batch (Fixture *fixture, gconstpointer pData)
+{
+    gchar *msg = "[qof_event_end_batch()] batch counter underflow";
+    gchar *logdomain = "qof.engine";
+    guint loglevel = G_LOG_LEVEL_CRITICAL | G_LOG_FLAG_FATAL;
+    TestErrorStruct *check = test_error_struct_new (logdomain, loglevel, msg);
+    guint hdlr = g_log_set_handler (logdomain, loglevel,
+                                    (GLogFunc)test_checked_handler, check);
+
+    qof_event_begin_batch ();
+    qof_event_gen (fixture->inst1, QOF_EVENT_MODIFY, NULL);
+    qof_event_begin_batch ();
+    qof_event_gen (fixture->inst2, QOF_EVENT_MODIFY, NULL);
+    qof_event_end_batch ();
+    /* Only the outermost end delivers. */
+    g_assert_cmpuint (fixture->n_batches, ==, 0);
+    qof_event_gen (fixture->inst1, QOF_EVENT_MODIFY, NULL);
+    qof_event_end_batch ();
+
+    g_assert_cmpuint (fixture->n_batches, ==, 1);
+    g_assert_cmpuint (fixture->records->len, ==, 2);
+    assert_record (fixture, 0, fixture->inst1, QOF_EVENT_MODIFY);
+    assert_record (fixture, 1, fixture->inst2, QOF_EVENT_MODIFY);
+
+    /* An unmatched end is reported and doesn't deliver again. */
+    qof_event_end_batch ();
+    g_assert_cmpint (check->hits, ==, 1);
+    g_assert_cmpuint (fixture->n_batches, ==, 1);
+
+    g_log_remove_handler (logdomain, hdlr);
+    test_error_struct_free (check);
+}
+
+static void
+test_nested_suspend (Fixture *fixture, gconstpointer pData)
+{
+    gchar *msg = "[qof_event_resume()] suspend counter underflow";
+    gchar *logdomain = "qof.engine";
+    guint loglevel = G_LOG_LEVEL_CRITICAL | G_LOG_FLAG_FATAL;
+    TestErrorStruct *check = test_error_struct_new (logdomain, loglevel, msg);
+    guint hdlr = g_log_set_handler (logdomain, loglevel,
+                                    (GLogFunc)test_checked_handler, check);
+
+    qof_event_suspend ();
+    qof_event_suspend ();
+    qof_event_gen (fixture->inst1, QOF_EVENT_MODIFY, NULL);
+    qof_event_resume ();
+    qof_event_gen (fixture->inst1, QOF_EVENT_MODIFY, NULL);
+    g_assert_cmpuint (fixture->n_events, ==, 0);
+    g_assert_cmpuint (fixture->n_batches, ==, 0);
+
+    /* Events generated while suspended are dropped, not batched. */
+    qof_event_begin_batch ();
+    qof_event_gen (fixture->inst1, QOF_EVENT_MODIFY, NULL);
+    qof_event_resume ();
+    qof_event_gen (fixture->inst2, QOF_EVENT_MODIFY, NULL);
+    qof_event_end_batch ();
+    g_assert_cmpuint (fixture->n_events, ==, 1);
+    g_assert_cmpuint (fixture->n_batches, ==, 1);
+    g_assert_cmpuint (fixture->records->len, ==, 1);
+    assert_record (fixture, 0, fixture->inst2, QOF_EVENT_MODIFY);
+
+    /* qof_event_force gets through a suspension. */
+    qof_event_suspend ();
+    qof_event_force (fixture->inst1, QOF_EVENT_MODIFY, NULL);
+    qof_event_resume ();
+    g_assert_cmpuint (fixture->n_events, ==, 2);
+    g_assert_cmpuint (fixture->n_batches, ==, 2);
+
+    qof_event_resume ();
+    g_assert_cmpint (check->hits, ==, 1);
+
+    g_log_remove_handler (logdomain, hdlr);
+    test_error_struct_free (check);
+}
+
+void
+test_suite_qofevent ( void )
+{
+    GNC_TEST_ADD (suitename, "unbatched", Fixture, NULL, setup, test_unbatched, teardown);
+    GNC_TEST_ADD (suitename, "batch delivery", Fixture, NULL, setup, test_batch_delivery, teardown);
+    GNC_TEST_ADD (suitename, "batch dedup", Fixture, NULL, setup, test_batch_dedup, teardown);
+    GNC_TEST_ADD (suitename, "nested batch", Fixture, NULL, setup, test_nested_batch, teardown);
+    GNC_TEST_ADD (suitename, "nested suspend", Fixture, NULL, setup, test_nested_suspend, teardown);
+}
@@ -36,6 +36,8 @@ static bool sync_called {false};
 static bool load_error {true};
 static bool hook_called {false};
 static bool data_loaded {false};
+static int group_depth {0};
+static bool group_commit_fails {false};
 
 class QofSessionMockBackend : public QofBackend
 {
@@ -50,6 +52,9 @@ public:
     void sync(QofBook*);
     void safe_sync(QofBook*);
     void export_coa(QofBook*);
+    void begin_group_commit() { ++group_depth; }
+    bool end_group_commit();
+    void rollback_group_commit() { --group_depth; }
 };
 
 static void
@@ -77,6 +82,15 @@ void QofSessionMockBackend::sync (QofBook *)
     sync_called = true;
 }
 
+bool QofSessionMockBackend::end_group_commit ()
+{
+    --group_depth;
+    if (!group_commit_fails)
+        return true;
+    set_error(ERR_BACKEND_SERVER_ERR);
+    return false;
+}
+
 void QofSessionMockBackend::export_coa(QofBook * book)
 {
     exported_book = book;
@@ -222,6 +236,26 @@ TEST (QofSessionTest, safe_save)
     safe_sync_called = false;
 }
 
+TEST (QofSessionTest, group_commit)
+{
+    qof_backend_register_provider (get_provider ());
+    QofSession s;
+    s.begin ("book1", false, false, false);
+    s.begin_group_commit ();
+    EXPECT_EQ (group_depth, 1);
+    EXPECT_TRUE (s.end_group_commit ());
+    EXPECT_EQ (group_depth, 0);
+    group_commit_fails = true;
+    s.begin_group_commit ();
+    EXPECT_FALSE (s.end_group_commit ());
+    EXPECT_EQ (s.get_error (), ERR_BACKEND_SERVER_ERR);
+    group_commit_fails = false;
+    s.begin_group_commit ();
+    s.rollback_group_commit ();
+    EXPECT_EQ (group_depth, 0);
+    qof_backend_unregister_all_providers ();
+}
+
 TEST (QofSessionTest, export_session)
 {
     qof_backend_register_provider (get_provider ());
@@ -24,9 +24,11 @@ extern "C"
 {
 #include <config.h>
 #include <glib.h>
+#include <string.h>
 #include "qof.h"
 #include "cashobjects.h"
 #include "Transaction.h"
+#include "Query.h"
 #include "TransLog.h"
 #include "gnc-engine.h"
 #include "test-engine-stuff.h"
@@ -67,6 +69,74 @@ test_trans_query (Transaction *trans, gpointer data)
     return 0;
 }
 
+typedef struct
+{
+    Account *account;
+    time64 start;
+    guint count;
+} SplitMatchCount;
+
+static void
+count_split_cb (QofInstance *inst, gpointer data)
+{
+    Split *split = GNC_SPLIT (inst);
+    SplitMatchCount *match = static_cast<SplitMatchCount*>(data);
+
+    if (match->account && xaccSplitGetAccount (split) != match->account)
+        return;
+    if (xaccTransGetDate (xaccSplitGetParent (split)) < match->start)
+        return;
+    match->count++;
+}
+
+/* Set from qofquery's log when a query is answered from an index. */
+static gboolean index_used = FALSE;
+
+static void
+query_log_handler (const gchar *log_domain, GLogLevelFlags log_level,
+                   const gchar *message, gpointer user_data)
+{
+    if (strstr (message, "index used"))
+        index_used = TRUE;
+}
+
+/* The split query index must find exactly what a scan of every split does.
+ * With twice set the account's GUID is listed twice in its term. */
+static void
+test_split_index_query (QofBook *book, Account *account, time64 start,
+                        gboolean twice)
+{
+    SplitMatchCount match = {account, start, 0};
+    QofQuery *q = qof_query_create_for (GNC_ID_SPLIT);
+    GList *list;
+
+    index_used = FALSE;
+    qof_query_set_book (q, book);
+    if (account && twice)
+    {
+        GList *guids = NULL;
+        guids = g_list_prepend (guids, (gpointer)xaccAccountGetGUID (account));
+        guids = g_list_prepend (guids, (gpointer)xaccAccountGetGUID (account));
+        xaccQueryAddAccountGUIDMatch (q, guids, QOF_GUID_MATCH_ANY,
+                                      QOF_QUERY_AND);
+        g_list_free (guids);
+    }
+    else if (account)
+        xaccQueryAddSingleAccountMatch (q, account, QOF_QUERY_AND);
+    xaccQueryAddDateMatchTT (q, TRUE, start, FALSE, 0, QOF_QUERY_AND);
+    list = qof_query_run (q);
+
+    qof_collection_foreach (qof_book_get_collection (book, GNC_ID_SPLIT),
+                            count_split_cb, &match);
+    if (g_list_length (list) != match.count)
+        failure_args ("split index", __FILE__, __LINE__,
+                      "query found %d splits, not %d",
+                      g_list_length (list), match.count);
+    else
+        success ("split index query matches scan");
+    qof_query_destroy (q);
+}
+
 static void
 run_test (void)
 {
@@ -82,6 +152,66 @@ run_test (void)
 
     xaccAccountTreeForEachTransaction (root, test_trans_query, book);
 
+    {
+        GList *accounts = gnc_account_get_descendants (root);
+        GList *splits = accounts ? xaccAccountGetSplitList (
+            static_cast<Account*>(accounts->data)) : NULL;
+        time64 start = splits ? xaccTransGetDate (
+            xaccSplitGetParent (static_cast<Split*>(splits->data))) : 0;
+
+        test_split_index_query (book, NULL, start, FALSE);
+        for (GList *node = accounts; node; node = node->next)
+        {
+            test_split_index_query (book, static_cast<Account*>(node->data),
+                                    start, FALSE);
+            test_split_index_query (book, static_cast<Account*>(node->data),
+                                    start, TRUE);
+        }
+
+        /* While a split is moved in an open transaction the accounts'
+         * split lists are out of date, so queries must still see it in
+         * the account it is set to. */
+        if (splits && accounts->next)
+        {
+            Split *split = static_cast<Split*>(splits->data);
+            Transaction *trans = xaccSplitGetParent (split);
+            Account *other = static_cast<Account*>(accounts->next->data);
+
+            xaccTransBeginEdit (trans);
+            xaccSplitSetAccount (split, other);
+            test_split_index_query (book, other, start, FALSE);
+            test_split_index_query (book,
+                                    static_cast<Account*>(accounts->data),
+                                    start, FALSE);
+            xaccTransRollbackEdit (trans);
+        }
+
+        /* A register keeps its blank transaction open, with a split set
+         * to the register's account that isn't in the account yet. The
+         * index must still be used and must find that split. */
+        if (accounts)
+        {
+            Account *account = static_cast<Account*>(accounts->data);
+            Transaction *blank = xaccMallocTransaction (book);
+            Split *split = xaccMallocSplit (book);
+
+            xaccTransBeginEdit (blank);
+            xaccTransSetCurrency (blank, xaccAccountGetCommodity (account));
+            xaccTransSetDatePostedSecs (blank, start);
+            xaccSplitSetParent (split, blank);
+            xaccSplitSetAccount (split, account);
+            test_split_index_query (book, account, start, FALSE);
+            if (!index_used)
+                failure ("split index not used while a transaction is open");
+            else
+                success ("split index used while a transaction is open");
+            test_split_index_query (book, NULL, start, FALSE);
+            xaccTransDestroy (blank);
+            xaccTransCommitEdit (blank);
+        }
+        g_list_free (accounts);
+    }
+
     qof_session_end (session);
 }
 
@@ -94,6 +224,8 @@ main (int argc, char **argv)
     g_log_set_always_fatal((GLogLevelFlags)(G_LOG_LEVEL_CRITICAL | G_LOG_LEVEL_WARNING));
 
     xaccLogDisable ();
+    g_log_set_handler (QOF_MOD_QUERY, G_LOG_LEVEL_INFO, query_log_handler,
+                       NULL);
 
     /* Always start from the same random seed so we fail consistently */
     srand(0);
@@ -43,6 +43,7 @@ void test_suite_account (void);
 
 #include <qofinstance-p.h>
 #include <kvp-frame.hpp>
+#include "../AccountP.hpp"
 
 typedef struct
 {
@@ -1151,6 +1152,9 @@ test_gnc_account_insert_remove_split (Fixture *fixture, gconstpointer pData)
     g_assert (gnc_account_insert_split (fixture->acct, split3));
     qof_instance_decrease_editlevel (fixture->acct);
     g_assert_cmpuint (g_list_length (priv->splits), == , 3);
+    g_assert_cmpuint (priv->splits_vec.size (), == , 3);
+    g_assert_cmpuint (priv->splits_hash.size (), == , 3);
+    g_assert (priv->splits_vec.back () == split3);
     g_assert (priv->sort_dirty);
     g_assert (priv->balance_dirty);
     test_signal_assert_hits (sig1, 3);
@@ -1162,6 +1166,8 @@ test_gnc_account_insert_remove_split (Fixture *fixture, gconstpointer pData)
                             split3);
     g_assert (gnc_account_remove_split (fixture->acct, split3));
     g_assert_cmpuint (g_list_length (priv->splits), == , 2);
+    g_assert_cmpuint (priv->splits_vec.size (), == , 2);
+    g_assert (priv->splits_hash.find (split3) == priv->splits_hash.end ());
     g_assert (priv->sort_dirty);
     g_assert (!priv->balance_dirty);
     test_signal_assert_hits (sig1, 4);
@@ -1174,6 +1180,16 @@ test_gnc_account_insert_remove_split (Fixture *fixture, gconstpointer pData)
     g_assert (!priv->balance_dirty);
     test_signal_assert_hits (sig1, 4);
     test_signal_assert_hits (sig3, 1);
+    /* Sorting must leave the list and the vector in the same order. */
+    xaccAccountSortSplits (fixture->acct, TRUE);
+    g_assert (!priv->sort_dirty);
+    g_assert (priv->splits->prev == NULL);
+    for (auto node = priv->splits; node; node = node->next)
+    {
+        auto index = g_list_position (priv->splits, node);
+        g_assert (priv->splits_vec[index] == node->data);
+        g_assert (priv->splits_hash[priv->splits_vec[index]] == node);
+    }
 
     /* Clean up the handlers */
     test_signal_free (sig3);
@@ -1327,6 +1343,78 @@ test_xaccAccountRecomputeBalance (Fixture *fixture, gconstpointer pData)
     g_assert (gnc_numeric_eq (priv->cleared_balance, clr_bal));
     g_assert (gnc_numeric_eq (priv->reconciled_balance, rec_bal));
     g_assert (!priv->balance_dirty);
+
+    /* Record the incrementally computed running balances, recompute them
+     * all from the start and compare. */
+    auto check_full_pass = [priv, fixture]() {
+        g_assert (!priv->balance_dirty);
+        std::vector<gnc_numeric> incremental;
+        for (auto s : priv->splits_vec)
+        {
+            incremental.push_back (xaccSplitGetBalance (s));
+            incremental.push_back (xaccSplitGetClearedBalance (s));
+            incremental.push_back (xaccSplitGetReconciledBalance (s));
+        }
+        auto inc_bal = priv->balance, inc_clr_bal = priv->cleared_balance,
+            inc_rec_bal = priv->reconciled_balance;
+        priv->balance_dirty = TRUE;
+        xaccAccountRecomputeBalance (fixture->acct);
+        auto value = incremental.begin ();
+        for (auto s : priv->splits_vec)
+        {
+            g_assert (gnc_numeric_eq (xaccSplitGetBalance (s), *value++));
+            g_assert (gnc_numeric_eq (xaccSplitGetClearedBalance (s), *value++));
+            g_assert (gnc_numeric_eq (xaccSplitGetReconciledBalance (s), *value++));
+        }
+        g_assert (gnc_numeric_eq (priv->balance, inc_bal));
+        g_assert (gnc_numeric_eq (priv->cleared_balance, inc_clr_bal));
+        g_assert (gnc_numeric_eq (priv->reconciled_balance, inc_rec_bal));
+    };
+
+    /* Reconcile a split in the middle: only it is moved and the running
+     * balances are recomputed from its position on. The result must be
+     * the same as a full pass. */
+    xaccAccountSortSplits (fixture->acct, TRUE);
+    xaccAccountRecomputeBalance (fixture->acct);
+    g_assert (!priv->sort_dirty);
+    /* The setup transactions are committed without scrubbing, so the
+     * edits below end the same way. */
+    auto split = priv->splits_vec[priv->splits_vec.size () / 2];
+    auto txn = xaccSplitGetParent (split);
+    xaccTransBeginEdit (txn);
+    xaccSplitSetReconcile (split, xaccSplitGetReconcile (split) == NREC ?
+                           YREC : NREC);
+    qof_commit_edit (QOF_INSTANCE (txn));
+    g_assert (priv->sort_dirty);
+    g_assert_cmpuint (priv->sort_dirty_splits.size (), ==, 1);
+    xaccAccountSortSplits (fixture->acct, FALSE);
+    xaccAccountRecomputeBalance (fixture->acct);
+    check_full_pass ();
+
+    /* Post the same transaction before all the others and then after
+     * them, so that its split moves to each end of the account and the
+     * running balances of the splits it passes change. */
+    auto first = xaccTransGetDate (xaccSplitGetParent (priv->splits_vec.front ()));
+    xaccTransBeginEdit (txn);
+    xaccTransSetDatePostedSecs (txn, first - 86400);
+    qof_commit_edit (QOF_INSTANCE (txn));
+    g_assert (priv->sort_dirty);
+    g_assert_cmpuint (priv->sort_dirty_splits.size (), ==, 1);
+    xaccAccountSortSplits (fixture->acct, FALSE);
+    g_assert (priv->splits_vec.front () == split);
+    xaccAccountRecomputeBalance (fixture->acct);
+    check_full_pass ();
+
+    auto last = xaccTransGetDate (xaccSplitGetParent (priv->splits_vec.back ()));
+    xaccTransBeginEdit (txn);
+    xaccTransSetDatePostedSecs (txn, last + 86400);
+    qof_commit_edit (QOF_INSTANCE (txn));
+    g_assert (priv->sort_dirty);
+    g_assert_cmpuint (priv->sort_dirty_splits.size (), ==, 1);
+    xaccAccountSortSplits (fixture->acct, FALSE);
+    g_assert (priv->splits_vec.back () == split);
+    xaccAccountRecomputeBalance (fixture->acct);
+    check_full_pass ();
 }
 
 /* xaccAccountOrder
@@ -1918,6 +2006,7 @@ test_xaccAccountGetBalanceAsOfDate (Fixture *fixture, gconstpointer pData)
     int ind;
     gint min_ind = 2;
     gint offset = 24 * 3600 * 3; /* 3 days in seconds */
+    AccountPrivate *priv = fixture->func->get_private (fixture->acct);
     g_assert (sdata != NULL);
     t_arr = (TxnParms*)sdata->txns;
     for (ind = 0; ind < min_ind; ind++)
@@ -1931,6 +2020,15 @@ test_xaccAccountGetBalanceAsOfDate (Fixture *fixture, gconstpointer pData)
                                          (gnc_time (NULL) - offset));
     dval = gnc_numeric_to_double (val);
     g_assert_cmpfloat (dval, == , dbal);
+    /* The lookup is answered from the date index. */
+    g_assert_cmpuint (priv->splits_dates.size (), == ,
+                      priv->splits_vec.size ());
+    /* Before the first split, and after the last one. */
+    val = xaccAccountGetBalanceAsOfDate (fixture->acct, 0);
+    g_assert (gnc_numeric_zero_p (val));
+    val = xaccAccountGetBalanceAsOfDate (fixture->acct,
+                                         gnc_time (NULL) + 365 * 24 * 3600);
+    g_assert (gnc_numeric_equal (val, xaccAccountGetBalance (fixture->acct)));
 }
 /* xaccAccountGetPresentBalance
 gnc_numeric
@@ -2062,6 +2160,51 @@ test_xaccAccountForEachLot (Fixture *fixture, gconstpointer pData)
     xaccAccountForEachLot (acct, bogus_for_each_lot_func, &count_calls);
     g_assert_cmpint (count_calls, == , 5);
 }
+
+/* gnc_account_find_open_lot
+GNCLot *
+gnc_account_find_open_lot (Account *acc, gnc_numeric sign,
+                           gnc_commodity *currency, gboolean latest) */
+static void
+test_gnc_account_find_open_lot (Fixture *fixture, gconstpointer pData)
+{
+    Account *root = gnc_account_get_root (fixture->acct);
+    Account *acct = gnc_account_lookup_by_name (root, "baz");
+    auto sell = gnc_numeric_create (-1, 1);
+    auto buy = gnc_numeric_create (1, 1);
+
+    g_assert (acct);
+    auto earliest = gnc_account_find_open_lot (acct, sell, NULL, FALSE);
+    auto latest = gnc_account_find_open_lot (acct, sell, NULL, TRUE);
+    g_assert (earliest != NULL);
+    g_assert (latest != NULL);
+    g_assert_cmpstr (xaccSplitGetMemo (gnc_lot_get_earliest_split (earliest)),
+                     ==, "waldo_baz");
+    g_assert_cmpstr (xaccSplitGetMemo (gnc_lot_get_earliest_split (latest)),
+                     ==, "links_baz");
+    g_assert (gnc_numeric_equal (gnc_lot_get_balance (earliest),
+                                 gnc_numeric_create (500, 1)));
+    g_assert (gnc_account_find_open_lot (acct, buy, NULL, FALSE) == NULL);
+
+    /* Emptying the latest lot takes it out of the index. */
+    auto split = gnc_lot_get_earliest_split (latest);
+    gnc_lot_remove_split (latest, split);
+    g_assert (gnc_lot_get_account (latest) == NULL);
+    g_assert (gnc_account_find_open_lot (acct, sell, NULL, TRUE) == earliest);
+
+    /* The lot balance follows splits moving in and out of the lot. */
+    auto closing = gnc_lot_get_latest_split (earliest);
+    g_assert_cmpstr (xaccSplitGetMemo (closing), ==, "sausage_baz");
+    gnc_lot_remove_split (earliest, closing);
+    g_assert (gnc_numeric_equal (gnc_lot_get_balance (earliest),
+                                 gnc_numeric_create (1000, 1)));
+    gnc_lot_add_split (earliest, closing);
+    gnc_lot_add_split (earliest, split);
+    g_assert (gnc_numeric_equal (gnc_lot_get_balance (earliest),
+                                 gnc_numeric_create (1000, 1)));
+    g_assert (gnc_account_find_open_lot (acct, sell, NULL, FALSE) == earliest);
+    gnc_lot_destroy (latest);
+}
 /* These getters and setters look in KVP, so I guess their delegators instead:
  * xaccAccountGetTaxRelated
  * xaccAccountSetTaxRelated
@@ -2581,6 +2724,7 @@ test_suite_account (void)
     GNC_TEST_ADD (suitename, "xaccAccountGetPresentBalance", Fixture, &some_data, setup, test_xaccAccountGetPresentBalance,  teardown );
     GNC_TEST_ADD (suitename, "xaccAccountFindOpenLots", Fixture, &complex_data, setup, test_xaccAccountFindOpenLots,  teardown );
     GNC_TEST_ADD (suitename, "xaccAccountForEachLot", Fixture, &complex_data, setup, test_xaccAccountForEachLot,  teardown );
+    GNC_TEST_ADD (suitename, "gnc account find open lot", Fixture, &complex_data, setup, test_gnc_account_find_open_lot,  teardown );
 
     GNC_TEST_ADD (suitename, "xaccAccountHasAncestor", Fixture, &complex, setup, test_xaccAccountHasAncestor,  teardown );
     GNC_TEST_ADD_FUNC (suitename, "AccountType Stuff", test_xaccAccountType_Stuff );
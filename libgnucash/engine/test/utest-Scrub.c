@@ -0,0 +1,259 @@
+/********************************************************************
+ * utest-Scrub.c: GLib g_test test suite for Scrub.c.               *
+ *                                                                  *
+ * This program is free software; you can redistribute it and/or    *
+ * modify it under the terms of the GNU General Public License as   *
+ * published by the Free Software Foundation; either version 2 of   *
+ * the License, or (at your option) any later version.              *
+ *                                                                  *
+ * This program is distributed in the hope that it will be useful,  *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of   *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the    *
+ * GNU General Public License for more details.                     *
+ *                                                                  *
+ * You should have received a copy of the GNU General Public License*
+ * along with this program; if not, contact:                        *
+ *                                                                  *
+ * Free Software Foundation           Voice:  +1-617-542-5942       *
+ * 51 Franklin Street, Fifth Floor    Fax:    +1-617-542-2652       *
+ * Boston, MA  02110-1301,  USA       gnu@gnu.org                   *
+ ********************************************************************/
+#include <config.h>
+#include <glib.h>
+#include <unittest-support.h>
+/* Add specific headers for this class */
+#include <Account.h>
+#include <Transaction.h>
+#include <TransactionP.h>
+#include <Split.h>
+#include <Scrub.h>
+#include "test-engine-stuff.h"
+
+static const gchar *suitename = "/engine/Scrub";
+void test_suite_scrub (void);
+
+/* More than one chunk of the check, so that it uses the thread pool. */
+#define NUM_TRANS 3000
+
+typedef struct
+{
+    QofBook *book;
+    Account *root;
+    gnc_commodity *curr;
+} Book;
+
+typedef struct
+{
+    /* Two books with the same problems: one for the check, one for the
+     * serial scrub. */
+    Book checked;
+    Book serial;
+} Fixture;
+
+/* Every seventh transaction from the second has an orphan split, from
+ * the fourth doesn't balance and from the sixth has an amount that isn't
+ * its value in the currency. */
+static void
+make_book (Book *b)
+{
+    Account *bank, *expense;
+    int i;
+
+    b->book = qof_book_new ();
+    b->root = gnc_book_get_root_account (b->book);
+    b->curr = gnc_commodity_new (b->book, "US Dollar", "CURRENCY", "USD",
+                                 "", 100);
+    bank = add_test_account (b->book, "Bank", ACCT_TYPE_BANK, b->curr);
+    expense = add_test_account (b->book, "Expense", ACCT_TYPE_EXPENSE,
+                                b->curr);
+
+    /* Committing would scrub the problems away. */
+    xaccDisableDataScrubbing ();
+    for (i = 0; i < NUM_TRANS; i++)
+    {
+        Transaction *trans = xaccMallocTransaction (b->book);
+        gint64 value = 100 + i;
+        xaccTransBeginEdit (trans);
+        xaccTransSetCurrency (trans, b->curr);
+        xaccTransSetDatePostedSecsNormalized (trans, gnc_time (NULL) - i);
+        switch (i % 7)
+        {
+        case 1:
+            add_test_split (trans, bank, gnc_numeric_create (-value, 100),
+                            gnc_numeric_create (-value, 100));
+            add_test_split (trans, NULL, gnc_numeric_create (value, 100),
+                            gnc_numeric_create (value, 100));
+            break;
+        case 3:
+            add_test_split (trans, bank, gnc_numeric_create (-value, 100),
+                            gnc_numeric_create (-value, 100));
+            add_test_split (trans, expense, gnc_numeric_create (value - 1, 100),
+                            gnc_numeric_create (value - 1, 100));
+            break;
+        case 5:
+            add_test_split (trans, bank, gnc_numeric_create (-value - 1, 100),
+                            gnc_numeric_create (-value, 100));
+            add_test_split (trans, expense, gnc_numeric_create (value, 100),
+                            gnc_numeric_create (value, 100));
+            break;
+        default:
+            add_test_split (trans, bank, gnc_numeric_create (-value, 100),
+                            gnc_numeric_create (-value, 100));
+            add_test_split (trans, expense, gnc_numeric_create (value, 100),
+                            gnc_numeric_create (value, 100));
+            break;
+        }
+        xaccTransCommitEdit (trans);
+    }
+    xaccEnableDataScrubbing ();
+}
+
+static void
+setup (Fixture *fixture, gconstpointer pData)
+{
+    make_book (&fixture->checked);
+    make_book (&fixture->serial);
+}
+
+static void
+teardown (Fixture *fixture, gconstpointer pData)
+{
+    qof_book_destroy (fixture->checked.book);
+    qof_book_destroy (fixture->serial.book);
+}
+
+static void
+no_progress (const char *message, double percent)
+{
+}
+
+/* The problems the serial scrub fixes, found with the public API. */
+static ScrubCheckFlags
+serial_problems (Transaction *trans)
+{
+    ScrubCheckFlags problems = 0;
+    gnc_commodity *currency = xaccTransGetCurrency (trans);
+    GList *node;
+
+    if (!gnc_commodity_is_currency (currency))
+        problems |= SCRUB_CHECK_NO_CURRENCY;
+    for (node = xaccTransGetSplitList (trans); node; node = node->next)
+    {
+        Split *s = node->data;
+        Account *acc = xaccSplitGetAccount (s);
+        if (!acc)
+            problems |= SCRUB_CHECK_ORPHAN;
+        else if (gnc_commodity_equiv (xaccAccountGetCommodity (acc), currency)
+                 && !gnc_numeric_equal (xaccSplitGetAmount (s),
+                                        xaccSplitGetValue (s)))
+            problems |= SCRUB_CHECK_COMMODITY;
+    }
+    if (!xaccTransIsBalanced (trans))
+        problems |= SCRUB_CHECK_IMBALANCE;
+    return problems;
+}
+
+typedef struct
+{
+    GHashTable *checked;
+    guint n_trans;
+    guint n_problems;
+} Compare;
+
+static void
+compare_trans (QofInstance *inst, gpointer data)
+{
+    Compare *compare = data;
+    Transaction *trans = GNC_TRANSACTION (inst);
+    ScrubCheckFlags expected = serial_problems (trans);
+    ScrubCheckFlags found =
+        GPOINTER_TO_UINT (g_hash_table_lookup (compare->checked, trans));
+
+    g_assert_cmpuint (found, ==, expected);
+    compare->n_trans++;
+    if (expected)
+        compare->n_problems++;
+}
+
+/* Compares the check's results with what the serial scrub would fix in
+ * each transaction of the book, returning how many have problems. */
+static guint
+compare_with_serial (Book *b, GList *results)
+{
+    Compare compare = {g_hash_table_new (g_direct_hash, g_direct_equal), 0, 0};
+    GList *node;
+
+    for (node = results; node; node = node->next)
+    {
+        ScrubCheckResult *result = node->data;
+        g_assert (!g_hash_table_contains (compare.checked, result->trans));
+        g_hash_table_insert (compare.checked, result->trans,
+                             GUINT_TO_POINTER (result->problems));
+    }
+    qof_collection_foreach (qof_book_get_collection (b->book, GNC_ID_TRANS),
+                            compare_trans, &compare);
+    g_assert_cmpuint (compare.n_trans, ==, NUM_TRANS);
+    g_assert_cmpuint (compare.n_problems, ==, g_list_length (results));
+    g_hash_table_destroy (compare.checked);
+    return compare.n_problems;
+}
+
+static void
+test_check_finds_serial_problems (Fixture *fixture, gconstpointer pData)
+{
+    GList *results =
+        xaccAccountTreeCheckTransactions (fixture->checked.root);
+
+    /* Three in every seven. */
+    g_assert_cmpuint (compare_with_serial (&fixture->checked, results), ==,
+                      3 * (NUM_TRANS / 7) + 2);
+    g_list_free_full (results, g_free);
+}
+
+static gnc_numeric
+named_balance (Account *root, const char *name)
+{
+    Account *acc = gnc_account_lookup_by_name (root, name);
+    g_assert (acc != NULL);
+    return xaccAccountGetBalance (acc);
+}
+
+static void
+test_fix_checked (Fixture *fixture, gconstpointer pData)
+{
+    GList *results =
+        xaccAccountTreeCheckTransactions (fixture->checked.root);
+
+    xaccScrubCheckedTransactions (results, fixture->checked.root, NULL);
+    g_list_free_full (results, g_free);
+    xaccAccountTreeScrubOrphans (fixture->serial.root, no_progress);
+    xaccAccountTreeScrubImbalance (fixture->serial.root, no_progress);
+
+    /* Nothing is left for the check or the serial scrub to find. */
+    results = xaccAccountTreeCheckTransactions (fixture->checked.root);
+    g_assert (results == NULL);
+    g_assert_cmpuint (compare_with_serial (&fixture->checked, NULL), ==, 0);
+    results = xaccAccountTreeCheckTransactions (fixture->serial.root);
+    g_assert (results == NULL);
+
+    /* And the fixes are the same as the serial scrub's. */
+    g_assert (gnc_numeric_equal (named_balance (fixture->checked.root,
+                                                "Orphan-USD"),
+                                 named_balance (fixture->serial.root,
+                                                "Orphan-USD")));
+    g_assert (gnc_numeric_equal (named_balance (fixture->checked.root,
+                                                "Imbalance-USD"),
+                                 named_balance (fixture->serial.root,
+                                                "Imbalance-USD")));
+    g_assert (gnc_numeric_equal (named_balance (fixture->checked.root, "Bank"),
+                                 named_balance (fixture->serial.root, "Bank")));
+}
+
+void
+test_suite_scrub (void)
+{
+    GNC_TEST_ADD (suitename, "check finds serial problems", Fixture, NULL,
+                  setup, test_check_finds_serial_problems, teardown);
+    GNC_TEST_ADD (suitename, "fix checked", Fixture, NULL, setup,
+                  test_fix_checked, teardown);
+}
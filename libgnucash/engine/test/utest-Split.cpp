@@ -1131,8 +1131,13 @@ test_xaccSplitOrder (Fixture *fixture, gconstpointer pData)
 
     /* The book_use_split_action_for_num_field book option hasn't been set so it
      * should sort on tran-num, so xaccTransOrder_num_action returns -1.
+     * split's number is set through its transaction so that the sort keys
+     * xaccSplitOrder caches are refreshed; o_txn has no splits and would be
+     * destroyed by a commit, so its number is only set once. Scrubbing would
+     * balance txn.
      */
-    split->parent->num = "123";
+    xaccDisableDataScrubbing ();
+    xaccTransSetNum (split->parent, "123");
     split->action = "5";
     o_split->parent->num = "124";
     o_split->action = "6";
@@ -1140,8 +1145,7 @@ test_xaccSplitOrder (Fixture *fixture, gconstpointer pData)
 
     /* Reverse, so xaccTransOrder_num_action returns +1.
      */
-    split->parent->num = "124";
-    o_split->parent->num = "123";
+    xaccTransSetNum (split->parent, "125");
     g_assert_cmpint (xaccSplitOrder (split, o_split), ==, +1);
 
     /* Now set the book_use_split_action_for_num_field book option so it will
@@ -1159,7 +1163,11 @@ test_xaccSplitOrder (Fixture *fixture, gconstpointer pData)
 
     g_assert_cmpint (xaccSplitOrder (split, o_split), ==, -1);
 
+    /* Changed in an edit of the parent, as xaccSplitSetAction does. */
+    xaccTransBeginEdit (split->parent);
     split->action = "7";
+    xaccTransCommitEdit (split->parent);
+    xaccEnableDataScrubbing ();
     g_assert_cmpint (xaccSplitOrder (split, o_split), ==, +1);
 
     /* Revert settings for the rest of the test */
@@ -1221,6 +1229,82 @@ test_xaccSplitOrder (Fixture *fixture, gconstpointer pData)
     test_destroy (o_split);
     test_destroy (o_txn);
 }
+/* xaccSplitOrder caches the parts of the order that come from the
+ * transaction; changing any of them through the API must change the order.
+ */
+static Split *
+order_split (QofBook *book, gnc_commodity *curr, time64 posted)
+{
+    Transaction *txn = xaccMallocTransaction (book);
+    Split *split = xaccMallocSplit (book);
+
+    xaccTransBeginEdit (txn);
+    xaccTransSetCurrency (txn, curr);
+    xaccTransSetDatePostedSecs (txn, posted);
+    xaccTransSetDateEnteredSecs (txn, posted);
+    xaccSplitSetParent (split, txn);
+    xaccTransCommitEdit (txn);
+    return split;
+}
+
+static void
+test_xaccSplitOrder_cached (Fixture *fixture, gconstpointer pData)
+{
+    QofBook *book = xaccSplitGetBook (fixture->split);
+    time64 now = gnc_time (NULL);
+    Split *split, *o_split;
+    Transaction *txn, *o_txn;
+
+    /* One-split transactions would be balanced by scrubbing. */
+    xaccDisableDataScrubbing ();
+    split = order_split (book, fixture->curr, now);
+    o_split = order_split (book, fixture->curr, now);
+    txn = xaccSplitGetParent (split);
+    o_txn = xaccSplitGetParent (o_split);
+
+    xaccTransSetNum (txn, "1");
+    xaccTransSetNum (o_txn, "2");
+    g_assert_cmpint (xaccSplitOrder (split, o_split), ==, -1);
+    xaccTransSetNum (txn, "3");
+    g_assert_cmpint (xaccSplitOrder (split, o_split), ==, +1);
+
+    xaccTransSetDatePostedSecs (txn, now - 86400);
+    g_assert_cmpint (xaccSplitOrder (split, o_split), ==, -1);
+    xaccTransSetDatePostedSecs (o_txn, now - 2 * 86400);
+    g_assert_cmpint (xaccSplitOrder (split, o_split), ==, +1);
+    xaccTransSetDatePostedSecs (txn, now - 2 * 86400);
+    g_assert_cmpint (xaccSplitOrder (split, o_split), ==, +1);
+
+    xaccTransSetNum (txn, "2");
+    xaccTransSetDateEnteredSecs (txn, now - 10);
+    g_assert_cmpint (xaccSplitOrder (split, o_split), ==, -1);
+    xaccTransSetDateEnteredSecs (txn, now + 10);
+    g_assert_cmpint (xaccSplitOrder (split, o_split), ==, +1);
+
+    qof_book_begin_edit (book);
+    qof_instance_set (QOF_INSTANCE (book),
+                      "split-action-num-field", "t",
+                      NULL);
+    qof_book_commit_edit (book);
+    xaccSplitSetAction (split, "1");
+    xaccSplitSetAction (o_split, "5");
+    g_assert_cmpint (xaccSplitOrder (split, o_split), ==, -1);
+    xaccSplitSetAction (split, "9");
+    g_assert_cmpint (xaccSplitOrder (split, o_split), ==, +1);
+    qof_book_begin_edit (book);
+    qof_instance_set (QOF_INSTANCE (book),
+                      "split-action-num-field", "f",
+                      NULL);
+    qof_book_commit_edit (book);
+    xaccEnableDataScrubbing ();
+
+    xaccTransBeginEdit (txn);
+    xaccTransDestroy (txn);
+    xaccTransCommitEdit (txn);
+    xaccTransBeginEdit (o_txn);
+    xaccTransDestroy (o_txn);
+    xaccTransCommitEdit (o_txn);
+}
 /* xaccSplitOrderDateOnly
 gint
 xaccSplitOrderDateOnly (const Split *sa, const Split *sb)// C: 2 in 1
@@ -1922,6 +2006,7 @@ test_suite_split (void)
     GNC_TEST_ADD_FUNC (suitename, "xaccSplitConvertAmount", test_xaccSplitConvertAmount);
     GNC_TEST_ADD_FUNC (suitename, "xaccSplitDestroy", test_xaccSplitDestroy);
     GNC_TEST_ADD (suitename, "xaccSplitOrder", Fixture, NULL, setup, test_xaccSplitOrder, teardown);
+    GNC_TEST_ADD (suitename, "xaccSplitOrder cached", Fixture, NULL, setup, test_xaccSplitOrder_cached, teardown);
     GNC_TEST_ADD (suitename, "xaccSplitOrderDateOnly", Fixture, NULL, setup, test_xaccSplitOrderDateOnly, teardown);
     GNC_TEST_ADD (suitename, "get corr account split", Fixture, NULL, setup, test_get_corr_account_split, teardown);
     GNC_TEST_ADD (suitename, "xaccSplitGetCorrAccountFullName", Fixture, NULL, setup, test_xaccSplitGetCorrAccountFullName, teardown);
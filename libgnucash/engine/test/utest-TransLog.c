@@ -0,0 +1,260 @@
+/********************************************************************
+ * utest-TransLog.c: GLib g_test test suite for TransLog.c.         *
+ *                                                                  *
+ * This program is free software; you can redistribute it and/or    *
+ * modify it under the terms of the GNU General Public License as   *
+ * published by the Free Software Foundation; either version 2 of   *
+ * the License, or (at your option) any later version.              *
+ *                                                                  *
+ * This program is distributed in the hope that it will be useful,  *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of   *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the    *
+ * GNU General Public License for more details.                     *
+ *                                                                  *
+ * You should have received a copy of the GNU General Public License*
+ * along with this program; if not, contact:                        *
+ *                                                                  *
+ * Free Software Foundation           Voice:  +1-617-542-5942       *
+ * 51 Franklin Street, Fifth Floor    Fax:    +1-617-542-2652       *
+ * Boston, MA  02110-1301,  USA       gnu@gnu.org                   *
+ ********************************************************************/
+#include <config.h>
+#include <string.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <unittest-support.h>
+/* Add specific headers for this class */
+#include <Account.h>
+#include <Transaction.h>
+#include <Split.h>
+#include <TransLog.h>
+#include <TransLogP.h>
+#include "test-engine-stuff.h"
+
+static const gchar *suitename = "/engine/TransLog";
+void test_suite_translog (void);
+
+/* Enough that the writer is still busy when the log is closed. */
+#define NUM_TRANS 2000
+
+typedef struct
+{
+    gchar *dir;
+    QofBook *book;
+    gnc_commodity *curr;
+    Account *bank;
+    Account *expense;
+} Fixture;
+
+static void
+setup (Fixture *fixture, gconstpointer pData)
+{
+    gchar *base;
+
+    fixture->dir = g_dir_make_tmp ("utest-TransLog-XXXXXX", NULL);
+    g_assert (fixture->dir != NULL);
+    base = g_build_filename (fixture->dir, "translog", NULL);
+    xaccLogSetBaseName (base);
+    g_free (base);
+    xaccLogEnable ();
+
+    fixture->book = qof_book_new ();
+    fixture->curr = gnc_commodity_new (fixture->book, "US Dollar", "CURRENCY",
+                                       "USD", "", 100);
+    fixture->bank = add_test_account (fixture->book, "Bank", ACCT_TYPE_BANK,
+                                      fixture->curr);
+    fixture->expense = add_test_account (fixture->book, "Expense",
+                                         ACCT_TYPE_EXPENSE, fixture->curr);
+}
+
+static void
+remove_logs (Fixture *fixture)
+{
+    GDir *dir = g_dir_open (fixture->dir, 0, NULL);
+    const gchar *name;
+
+    while ((name = g_dir_read_name (dir)))
+    {
+        gchar *path = g_build_filename (fixture->dir, name, NULL);
+        g_unlink (path);
+        g_free (path);
+    }
+    g_dir_close (dir);
+}
+
+static void
+teardown (Fixture *fixture, gconstpointer pData)
+{
+    xaccCloseLog ();
+    xaccLogDisable ();
+    xaccLogSetSyncPolicy (XACC_LOG_SYNC_NONE);
+    _utest_translog_set_threaded (TRUE);
+    qof_book_destroy (fixture->book);
+
+    remove_logs (fixture);
+    g_rmdir (fixture->dir);
+    g_free (fixture->dir);
+}
+
+/* Each transaction is logged by xaccTransBeginEdit and again when it is
+ * committed. */
+static void
+log_transactions (Fixture *fixture, int n_trans)
+{
+    int i;
+
+    for (i = 0; i < n_trans; i++)
+    {
+        Transaction *trans = xaccMallocTransaction (fixture->book);
+        gchar *desc = g_strdup_printf ("trans %d", i);
+
+        xaccTransBeginEdit (trans);
+        xaccTransSetCurrency (trans, fixture->curr);
+        xaccTransSetDescription (trans, desc);
+        add_test_split (trans, fixture->bank,
+                        gnc_numeric_create (-100 - i, 100),
+                        gnc_numeric_create (-100 - i, 100));
+        add_test_split (trans, fixture->expense,
+                        gnc_numeric_create (100 + i, 100),
+                        gnc_numeric_create (100 + i, 100));
+        xaccTransCommitEdit (trans);
+        g_free (desc);
+    }
+}
+
+/* The contents of the one log file in the fixture's directory. */
+static gchar *
+read_log (Fixture *fixture)
+{
+    GDir *dir = g_dir_open (fixture->dir, 0, NULL);
+    const gchar *name = g_dir_read_name (dir);
+    gchar *path, *contents = NULL;
+
+    g_assert (name != NULL);
+    g_assert (g_str_has_prefix (name, "translog."));
+    g_assert (g_str_has_suffix (name, ".log"));
+    path = g_build_filename (fixture->dir, name, NULL);
+    g_file_get_contents (path, &contents, NULL, NULL);
+    g_assert (contents != NULL);
+    g_free (path);
+    name = g_dir_read_name (dir);
+    g_assert (name == NULL);
+    g_dir_close (dir);
+    return contents;
+}
+
+/* Checks that the log holds a begin and a commit record for each of the
+ * first n_trans transactions, in the order they were logged. */
+static void
+check_log (Fixture *fixture, int n_trans)
+{
+    gchar *contents = read_log (fixture);
+    gchar **lines = g_strsplit (contents, "\n", -1);
+    gchar **line = lines;
+    int i;
+
+    g_assert (g_str_has_prefix (*line, "mod\ttrans_guid\tsplit_guid\t"));
+    line++;
+    g_assert_cmpstr (*line++, ==, "-----------------");
+    for (i = 0; i < n_trans; i++)
+    {
+        gchar *desc = g_strdup_printf ("trans %d", i);
+        gchar **fields, *amount;
+        int j;
+
+        /* The transaction has no splits when it is begun. */
+        g_assert_cmpstr (*line++, ==, "===== START");
+        g_assert_cmpstr (*line++, ==, "===== END");
+
+        g_assert_cmpstr (*line++, ==, "===== START");
+        for (j = 0; j < 2; j++)
+        {
+            g_assert (*line != NULL);
+            fields = g_strsplit (*line++, "\t", -1);
+            g_assert_cmpuint (g_strv_length (fields), ==, 17);
+            g_assert_cmpstr (fields[0], ==, "C");
+            g_assert_cmpstr (fields[7], ==, j ? "Expense" : "Bank");
+            g_assert_cmpstr (fields[9], ==, desc);
+            amount = g_strdup_printf ("%d/100", j ? 100 + i : -100 - i);
+            g_assert_cmpstr (fields[14], ==, amount);
+            g_assert_cmpstr (fields[15], ==, amount);
+            g_free (amount);
+            g_strfreev (fields);
+        }
+        g_assert_cmpstr (*line++, ==, "===== END");
+        g_free (desc);
+    }
+    g_assert_cmpstr (*line++, ==, "");
+    g_assert (*line == NULL);
+
+    g_strfreev (lines);
+    g_free (contents);
+}
+
+static void
+test_close_drains (Fixture *fixture, gconstpointer pData)
+{
+    log_transactions (fixture, NUM_TRANS);
+    xaccCloseLog ();
+    check_log (fixture, NUM_TRANS);
+
+    /* Nothing more is written once logging is disabled. */
+    xaccLogDisable ();
+    log_transactions (fixture, 1);
+    check_log (fixture, NUM_TRANS);
+}
+
+static void
+test_synchronous (Fixture *fixture, gconstpointer pData)
+{
+    GDir *dir;
+
+    /* Without the writer thread each record is in the file as soon as it
+     * is logged. */
+    _utest_translog_set_threaded (FALSE);
+    log_transactions (fixture, 10);
+    check_log (fixture, 10);
+
+    dir = g_dir_open (fixture->dir, 0, NULL);
+    g_assert (xaccFileIsCurrentLog (g_dir_read_name (dir)));
+    g_dir_close (dir);
+
+    xaccCloseLog ();
+    check_log (fixture, 10);
+}
+
+static void
+test_sync_policies (Fixture *fixture, gconstpointer pData)
+{
+    XaccLogSyncPolicy policies[] = { XACC_LOG_SYNC_NONE, XACC_LOG_SYNC_CLOSE,
+                                     XACC_LOG_SYNC_BATCH };
+    guint i;
+
+    g_assert_cmpint (xaccLogGetSyncPolicy (), ==, XACC_LOG_SYNC_NONE);
+    for (i = 0; i < 2 * G_N_ELEMENTS (policies); i++)
+    {
+        XaccLogSyncPolicy policy = policies[i / 2];
+
+        xaccLogSetSyncPolicy (policy);
+        g_assert_cmpint (xaccLogGetSyncPolicy (), ==, policy);
+
+        /* Syncing doesn't change what is written, with the writer thread
+         * or without. */
+        _utest_translog_set_threaded (i % 2 == 0);
+        log_transactions (fixture, NUM_TRANS);
+        xaccCloseLog ();
+        check_log (fixture, NUM_TRANS);
+        remove_logs (fixture);
+    }
+}
+
+void
+test_suite_translog (void)
+{
+    GNC_TEST_ADD (suitename, "close drains", Fixture, NULL, setup,
+                  test_close_drains, teardown);
+    GNC_TEST_ADD (suitename, "synchronous", Fixture, NULL, setup,
+                  test_synchronous, teardown);
+    GNC_TEST_ADD (suitename, "sync policies", Fixture, NULL, setup,
+                  test_sync_policies, teardown);
+}
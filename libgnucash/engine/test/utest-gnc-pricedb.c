@@ -1095,11 +1095,27 @@ test_gnc_pricedb_lookup_day_t64 (PriceDBFixture *fixture, gconstpointer pData)
     g_log_set_default_handler (hdlr, 0);
 }
 
-// Not Used
 /* gnc_pricedb_lookup_at_time64
 GNCPrice *
 gnc_pricedb_lookup_at_time64(GNCPriceDB *db,// Local: 0:0:0
 */
+static void
+test_gnc_pricedb_lookup_at_time64 (PriceDBFixture *fixture, gconstpointer pData)
+{
+    time64 t = gnc_dmy2time64(19, 11, 2012);
+    GNCPrice *price = gnc_pricedb_lookup_at_time64(fixture->pricedb,
+                                                   fixture->com->amzn,
+                                                   fixture->com->usd, t);
+    g_assert(price != NULL);
+    g_assert_cmpint(gnc_price_get_time64(price), ==, t);
+    g_assert(gnc_numeric_equal(gnc_price_get_value(price),
+                               gnc_numeric_create(23988, 100)));
+    gnc_price_unref(price);
+    price = gnc_pricedb_lookup_at_time64(fixture->pricedb,
+                                         fixture->com->amzn,
+                                         fixture->com->usd, t + 1);
+    g_assert(price == NULL);
+}
 /* lookup_nearest_in_time
 static GNCPrice *
 lookup_nearest_in_time(GNCPriceDB *db,// Local: 2:0:0
@@ -1129,11 +1145,44 @@ test_gnc_pricedb_lookup_nearest_in_time64 (PriceDBFixture *fixture, gconstpointe
     g_assert_cmpstr(GET_CUR_NAME(price), ==, "AUD");
     g_assert_cmpstr(GET_COM_NAME(price), ==, "USD");
 }
-// Not Used
 /* gnc_pricedb_lookup_latest_before_t64
 GNCPrice *
 gnc_pricedb_lookup_latest_before_t64 (GNCPriceDB *db,// Local: 0:0:0
 */
+static void
+test_gnc_pricedb_lookup_latest_before_t64 (PriceDBFixture *fixture, gconstpointer pData)
+{
+    GNCPrice *price =
+        gnc_pricedb_lookup_latest_before_t64(fixture->pricedb,
+                                             fixture->com->amzn,
+                                             fixture->com->usd,
+                                             gnc_dmy2time64(1, 1, 2012));
+    g_assert(price != NULL);
+    g_assert(gnc_numeric_equal(gnc_price_get_value(price),
+                               gnc_numeric_create(22252, 100)));
+    gnc_price_unref(price);
+    price = gnc_pricedb_lookup_latest_before_t64(fixture->pricedb,
+                                                 fixture->com->amzn,
+                                                 fixture->com->usd,
+                                                 gnc_dmy2time64(19, 11, 2012));
+    g_assert(price != NULL);
+    g_assert(gnc_numeric_equal(gnc_price_get_value(price),
+                               gnc_numeric_create(23988, 100)));
+    gnc_price_unref(price);
+    price = gnc_pricedb_lookup_latest_before_t64(fixture->pricedb,
+                                                 fixture->com->amzn,
+                                                 fixture->com->usd,
+                                                 gnc_dmy2time64(1, 1, 2015));
+    g_assert(price != NULL);
+    g_assert(gnc_numeric_equal(gnc_price_get_value(price),
+                               gnc_numeric_create(31151, 100)));
+    gnc_price_unref(price);
+    price = gnc_pricedb_lookup_latest_before_t64(fixture->pricedb,
+                                                 fixture->com->amzn,
+                                                 fixture->com->usd,
+                                                 gnc_dmy2time64(1, 1, 2009));
+    g_assert(price == NULL);
+}
 /* direct_balance_conversion
 static gnc_numeric
 direct_balance_conversion (GNCPriceDB *db, gnc_numeric bal,// Local: 2:0:0
@@ -1248,6 +1297,55 @@ test_gnc_pricedb_convert_balance_nearest_price_t64 (PriceDBFixture *fixture, gco
     g_assert_cmpint(result.denom, ==, 100);
 
 }
+/* gnc_pricedb_convert_balances_nearest_price_t64
+void
+gnc_pricedb_convert_balances_nearest_price_t64(GNCPriceDB *pdb,// Local: 0:0:0
+*/
+static void
+test_gnc_pricedb_convert_balances_nearest_price_t64 (PriceDBFixture *fixture, gconstpointer pData)
+{
+    QofBook *book = qof_instance_get_book(fixture->pricedb);
+    time64 t = gnc_dmy2time64(15, 8, 2011);
+    gnc_numeric from[3] = {gnc_numeric_create(10000, 100), gnc_numeric_zero(),
+                           gnc_numeric_create(-2345, 100)};
+    gnc_numeric result[3];
+    GNCPrice *price;
+    int i;
+
+    gnc_pricedb_convert_balances_nearest_price_t64(fixture->pricedb, from,
+                                                   result, 3,
+                                                   fixture->com->usd,
+                                                   fixture->com->aud, t);
+    for (i = 0; i < 3; i++)
+    {
+        gnc_numeric single =
+            gnc_pricedb_convert_balance_nearest_price_t64(fixture->pricedb,
+                                                          from[i],
+                                                          fixture->com->usd,
+                                                          fixture->com->aud,
+                                                          t);
+        g_assert(gnc_numeric_equal(result[i], single));
+    }
+    g_assert_cmpint(result[0].num, ==, 9391);
+    g_assert(gnc_numeric_zero_p(result[1]));
+
+    /* Adding or removing a price must not leave a stale conversion behind. */
+    price = construct_price(book, fixture->com->usd, fixture->com->aud, t,
+                            PRICE_SOURCE_EDIT_DLG, gnc_numeric_create(2, 1));
+    gnc_pricedb_add_price(fixture->pricedb, price);
+    gnc_pricedb_convert_balances_nearest_price_t64(fixture->pricedb, from,
+                                                   result, 1,
+                                                   fixture->com->usd,
+                                                   fixture->com->aud, t);
+    g_assert_cmpint(result[0].num, ==, 20000);
+    g_assert_cmpint(result[0].denom, ==, 100);
+    gnc_pricedb_remove_price(fixture->pricedb, price);
+    gnc_pricedb_convert_balances_nearest_price_t64(fixture->pricedb, from,
+                                                   result, 1,
+                                                   fixture->com->usd,
+                                                   fixture->com->aud, t);
+    g_assert_cmpint(result[0].num, ==, 9391);
+}
 /* pricedb_foreach_pricelist
 static void
 pricedb_foreach_pricelist(gpointer key, gpointer val, gpointer user_data)// Local: 0:1:0
@@ -1496,14 +1594,17 @@ test_suite_gnc_pricedb (void)
     GNC_TEST_ADD (suitename, "gnc pricedb has prices", PriceDBFixture, NULL, setup, test_gnc_pricedb_has_prices, teardown);
     GNC_TEST_ADD (suitename, "gnc pricedb get prices", PriceDBFixture, NULL, setup, test_gnc_pricedb_get_prices, teardown);
     GNC_TEST_ADD (suitename, "gnc pricedb lookup day", PriceDBFixture, NULL, setup, test_gnc_pricedb_lookup_day_t64, teardown);
+    GNC_TEST_ADD (suitename, "gnc pricedb lookup at time", PriceDBFixture, NULL, setup, test_gnc_pricedb_lookup_at_time64, teardown);
 // GNC_TEST_ADD (suitename, "lookup nearest in time", Fixture, NULL, setup, test_lookup_nearest_in_time, teardown);
     GNC_TEST_ADD (suitename, "gnc pricedb lookup nearest in time", PriceDBFixture, NULL, setup, test_gnc_pricedb_lookup_nearest_in_time64, teardown);
+    GNC_TEST_ADD (suitename, "gnc pricedb lookup latest before", PriceDBFixture, NULL, setup, test_gnc_pricedb_lookup_latest_before_t64, teardown);
 // GNC_TEST_ADD (suitename, "direct balance conversion", Fixture, NULL, setup, test_direct_balance_conversion, teardown);
 // GNC_TEST_ADD (suitename, "extract common prices", Fixture, NULL, setup, test_extract_common_prices, teardown);
 // GNC_TEST_ADD (suitename, "convert balance", Fixture, NULL, setup, test_convert_balance, teardown);
 // GNC_TEST_ADD (suitename, "indirect balance conversion", Fixture, NULL, setup, test_indirect_balance_conversion, teardown);
     GNC_TEST_ADD (suitename, "gnc pricedb convert balance latest price", PriceDBFixture, NULL, setup, test_gnc_pricedb_convert_balance_latest_price, teardown);
     GNC_TEST_ADD (suitename, "gnc pricedb convert balance nearest price", PriceDBFixture, NULL, setup, test_gnc_pricedb_convert_balance_nearest_price_t64, teardown);
+    GNC_TEST_ADD (suitename, "gnc pricedb convert balances nearest price", PriceDBFixture, NULL, setup, test_gnc_pricedb_convert_balances_nearest_price_t64, teardown);
 // GNC_TEST_ADD (suitename, "pricedb foreach pricelist", Fixture, NULL, setup, test_pricedb_foreach_pricelist, teardown);
 // GNC_TEST_ADD (suitename, "pricedb foreach currencies hash", Fixture, NULL, setup, test_pricedb_foreach_currencies_hash, teardown);
 // GNC_TEST_ADD (suitename, "unstable price traversal", Fixture, NULL, setup, test_unstable_price_traversal, teardown);